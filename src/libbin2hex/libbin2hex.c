@@ -20,6 +20,14 @@
 **      Returns 0 if the byte array is converted successfully **
 **      -1 if not.                                            **
 **                                                            **
+** int fbin2hex(FILE * out, ...)                              **
+**      As bin2hex() but the output goes to the stream out    **
+**      rather than stdout.                                   **
+**                                                            **
+** int wbin2hex(put, void * ctx, ...)                         **
+**      As bin2hex() but each line is handed to the function  **
+**      put(ctx, line, length) rather than printed.           **
+**                                                            **
 ** byte_array   an array of binary bytes with values          **
 **              0 <= value >= 255                             **
 **                                                            **
@@ -61,11 +69,23 @@ along with bin2hex.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "./libbin2hex.h"
 
+// The longest line wbin2hex() can build: a gap, two hex digits and an ansi
+// character for each of 1024 columns, a 1024 space margin, an offset and the
+// terminating characters
+#define BIN2HEX_MAXLINE ((1024 * 4) + 1024 + 0x20)
+
+//Private function declarations
+void fbin2hex_put(void *, const char *, size_t);
 
 extern int bin2hex(unsigned char * byte_array, unsigned int size, unsigned int gap, unsigned int cols, unsigned int margin, unsigned int ansi, unsigned int hdr)
+{
+  return fbin2hex(stdout, byte_array, size, gap, cols, margin, ansi, hdr);
+}
+
+extern int wbin2hex(void (*put)(void *, const char *, size_t), void * ctx, unsigned char * byte_array, unsigned int size, unsigned int gap, unsigned int cols, unsigned int margin, unsigned int ansi, unsigned int hdr)
 {
   unsigned int i, j, stringlen = 0, line = 0, numlines = 0, charsinlastline = 0, spaces = 0;
-  char *string, *pad, hex[4], offset[10], printchar[2], ansistr[34];
+  char string[BIN2HEX_MAXLINE], under[BIN2HEX_MAXLINE], hex[4], offset[10], printchar[2], ansistr[1026];
 
   // Ensure that parameters are within boundaries
 #if defined NDEBUG // If NDEBUG is defined then use assert.h to check parameters
@@ -91,15 +111,14 @@ extern int bin2hex(unsigned char * byte_array, unsigned int size, unsigned int g
   }
 #endif
 
-  stringlen = (gap * cols) + (cols * 2) + margin + (ansi * cols) + 0x20; // determine max length of a line
+  stringlen = ((gap > 0) * cols) + (cols * 2) + margin + ((ansi == 1) * cols) + 0x20; // determine max length of a line
                                                                          // with (quite) a bit left over for a terminating 0x00 and other stuff
   numlines = size / cols;
   charsinlastline = size % cols;
-
-  string = malloc(stringlen);
-  if (string == NULL)
+  ansistr[0] = 0x00;
+  if (stringlen > BIN2HEX_MAXLINE)
   {
-    fprintf(stderr, "\nERROR: bin2hex() function unable to allocate memory\n");
+    fprintf(stderr, "\nERROR: bin2hex() function called with a line too long to build\n");
     return -1;
   }
 
@@ -114,14 +133,12 @@ extern int bin2hex(unsigned char * byte_array, unsigned int size, unsigned int g
     }
     strcat(string, " ANSI\n");
     // Print the header
-    printf("%s", string);
+    put(ctx, string, strlen(string));
     // Now underline the header
-    printf("%*s", margin, "");
-    for (j = 0; j < (int)strlen(string); j++)
-    {
-      printf("-");
-    }
-    printf("\n");
+    memset(under, ' ', margin);
+    memset(under + margin, '-', strlen(string));
+    under[margin + strlen(string)] = '\n';
+    put(ctx, under, margin + strlen(string) + 1);
   }
 
   while (line < numlines) // line is the number of the whole line we are working on (0 based)
@@ -160,7 +177,7 @@ extern int bin2hex(unsigned char * byte_array, unsigned int size, unsigned int g
     }
     strcat(string, ansistr);
     strcat(string, "\n");
-    printf("%s", string);
+    put(ctx, string, strlen(string));
     line++;
   }
   // Print the last line
@@ -197,21 +214,20 @@ extern int bin2hex(unsigned char * byte_array, unsigned int size, unsigned int g
     }
   }
   spaces = ((cols - charsinlastline) * (2 + gap));
-  pad = malloc(spaces + 2);
-  if (pad == NULL)
-  {
-    fprintf(stderr, "\nERROR: bin2hex() function unable to allocate memory\n");
-    return -1;
-  }
-  else
-  {
-    snprintf(pad, spaces + 1, "%*s", spaces, "");
-  }
-  strcat(string, pad);
-  strcat(string, ansistr);
-  printf("%s", string);
-  printf("\n");
-  free(pad);
-  free(string);
+  j = (unsigned int)strlen(string);
+  memset(string + j, ' ', spaces);
+  snprintf(string + j + spaces, BIN2HEX_MAXLINE - j - spaces, "%s\n", ansistr);
+  put(ctx, string, strlen(string));
   return 0;
 }
+
+//Hands each line built by wbin2hex() to a stream
+void fbin2hex_put(void * out, const char * line, size_t len)
+{
+  fwrite(line, 1, len, (FILE *)out);
+}
+
+extern int fbin2hex(FILE * out, unsigned char * byte_array, unsigned int size, unsigned int gap, unsigned int cols, unsigned int margin, unsigned int ansi, unsigned int hdr)
+{
+  return wbin2hex(fbin2hex_put, out, byte_array, size, gap, cols, margin, ansi, hdr);
+}
@@ -20,6 +20,14 @@
 **      Returns 0 if the byte array is converted successfully **
 **      -1 if not.                                            **
 **                                                            **
+** int fbin2hex(FILE * out, ...)                              **
+**      As bin2hex() but the output goes to the stream out    **
+**      rather than stdout.                                   **
+**                                                            **
+** int wbin2hex(put, void * ctx, ...)                         **
+**      As bin2hex() but each line is handed to the function  **
+**      put(ctx, line, length) rather than printed.           **
+**                                                            **
 ** byte_array   an array of binary bytes with values          **
 **              0 <= value >= 255                             **
 **                                                            **
@@ -70,5 +78,7 @@ along with libbin2hex.  If not, see <http://www.gnu.org/licenses/>.
 #include <assert.h>
 
 extern int bin2hex(unsigned char *, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int);
+extern int fbin2hex(FILE *, unsigned char *, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int);
+extern int wbin2hex(void (*)(void *, const char *, size_t), void *, unsigned char *, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int);
 
 #endif
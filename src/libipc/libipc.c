@@ -0,0 +1,901 @@
+/*********************************************************
+**                                                      **
+**                 libipc.c                             **
+**                                                      **
+** A library to write typed columns of data in the      **
+** Apache Arrow IPC stream format                       **
+**                                                      **
+**         Copyright Paul Tew 2011 to 2024              **
+**                                                      **
+*********************************************************/
+
+/*
+This file is part of Lifer.
+
+    Lifer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Lifer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Lifer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "./libipc.h"
+
+#define IPC_NULL 0x80          // Added to the type of a cell that has no value
+
+//Values from the Arrow FlatBuffers schema (Schema.fbs and Message.fbs)
+#define IPC_FB_SCHEMA 1        // MessageHeader
+#define IPC_FB_DICTBATCH 2
+#define IPC_FB_RECORDBATCH 3
+#define IPC_FB_INT 2           // Type
+#define IPC_FB_UTF8 5
+#define IPC_FB_TIMESTAMP 10
+#define IPC_FB_V5 4            // MetadataVersion
+
+struct IPC_BUF                 // A buffer of the body of a batch
+{
+  const void *       data;
+  size_t             len;
+};
+
+//Private function declarations
+void ipc_put32(struct OBUF *, uint32_t);
+void ipc_put64(struct OBUF *, uint64_t);
+uint32_t ipc_get32(const char *);
+int fb_room(struct IPC_FB *, size_t);
+void fb_pad(struct IPC_FB *, size_t);
+void fb_prep(struct IPC_FB *, size_t, size_t);
+void fb_bytes(struct IPC_FB *, const void *, size_t);
+void fb_le(struct IPC_FB *, uint64_t, size_t);
+void fb_offset(struct IPC_FB *, size_t);
+size_t fb_string(struct IPC_FB *, const char *);
+void fb_start(struct IPC_FB *, int);
+void fb_field(struct IPC_FB *, int, uint64_t, size_t);
+void fb_field_off(struct IPC_FB *, int, size_t);
+size_t fb_end(struct IPC_FB *);
+size_t fb_int(struct IPC_FB *, int, int);
+void ipc_message(struct IPC_WRITER *, int, size_t, size_t, struct IPC_BUF *, int);
+void ipc_schema(struct IPC_WRITER *);
+void ipc_batch(struct IPC_WRITER *, int64_t, int, size_t, uint64_t *, int, struct IPC_BUF *, int);
+void ipc_dictbatch(struct IPC_WRITER *, int);
+void ipc_records(struct IPC_WRITER *);
+int ipc_column(struct IPC_WRITER *, const char *, enum IPC_TYPE);
+void ipc_cell(struct OBUF *, const char *, int);
+void ipc_valid(struct IPC_WRITER *, struct IPC_COLUMN *, int);
+uint32_t ipc_hash(const char *, size_t);
+int ipc_rehash(struct IPC_DICT *);
+uint32_t ipc_lookup(struct IPC_WRITER *, struct IPC_DICT *, const char *, size_t);
+
+//
+//Function: ipc_put32() and ipc_put64() append v to ob in little endian order.
+void ipc_put32(struct OBUF * ob, uint32_t v)
+{
+  char le[4];
+
+  le[0] = (char)v;
+  le[1] = (char)(v >> 8);
+  le[2] = (char)(v >> 16);
+  le[3] = (char)(v >> 24);
+  obuf_mem(ob, le, 4);
+}
+
+void ipc_put64(struct OBUF * ob, uint64_t v)
+{
+  ipc_put32(ob, (uint32_t)v);
+  ipc_put32(ob, (uint32_t)(v >> 32));
+}
+
+//
+//Function: ipc_get32() returns the little endian uint32_t at p.
+uint32_t ipc_get32(const char * p)
+{
+  const unsigned char * b = (const unsigned char *)p;
+
+  return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+//
+//Function: fb_room() makes room for n more bytes at the front of fb, moving
+//          what is there to the end of a bigger allocation if need be.
+//          Returns 0 if successful or -1 if memory ran out.
+//
+//A FlatBuffer is built backwards, children before their parents, so that
+//every offset from a parent to a child points forwards as the format needs.
+//Positions while building are counted from the end of the buffer.
+int fb_room(struct IPC_FB * fb, size_t n)
+{
+  size_t cap;
+  unsigned char * buf;
+
+  if (fb->len + n <= fb->cap)
+  {
+    return 0;
+  }
+  cap = (fb->cap < 1024) ? 1024 : fb->cap;
+  while (cap < fb->len + n)
+  {
+    cap *= 2;
+  }
+  if ((buf = (unsigned char *)malloc(cap)) == NULL)
+  {
+    fb->failed = 1;
+    return -1;
+  }
+  if (fb->len > 0)
+  {
+    memcpy(buf + cap - fb->len, fb->buf + fb->cap - fb->len, fb->len);
+  }
+  free(fb->buf);
+  fb->buf = buf;
+  fb->cap = cap;
+  return 0;
+}
+
+//
+//Function: fb_pad() adds n zero bytes to the front of fb.
+void fb_pad(struct IPC_FB * fb, size_t n)
+{
+  if (fb_room(fb, n) == 0)
+  {
+    fb->len += n;
+    memset(fb->buf + fb->cap - fb->len, 0, n);
+  }
+}
+
+//
+//Function: fb_prep() pads fb so that it will be aligned to align (a power of
+//          2) once another extra bytes have been added.
+void fb_prep(struct IPC_FB * fb, size_t align, size_t extra)
+{
+  if (align > fb->minalign)
+  {
+    fb->minalign = align;
+  }
+  fb_pad(fb, (~(fb->len + extra) + 1) & (align - 1));
+}
+
+//
+//Function: fb_bytes() adds n bytes from data to the front of fb.
+void fb_bytes(struct IPC_FB * fb, const void * data, size_t n)
+{
+  if (fb_room(fb, n) == 0)
+  {
+    fb->len += n;
+    memcpy(fb->buf + fb->cap - fb->len, data, n);
+  }
+}
+
+//
+//Function: fb_le() adds the size byte scalar v, aligned and little endian,
+//          to the front of fb.
+void fb_le(struct IPC_FB * fb, uint64_t v, size_t size)
+{
+  unsigned char * p;
+  size_t i;
+
+  fb_prep(fb, size, 0);
+  if (fb_room(fb, size) == 0)
+  {
+    fb->len += size;
+    p = fb->buf + fb->cap - fb->len;
+    for (i = 0; i < size; i++)
+    {
+      p[i] = (unsigned char)(v >> (8 * i));
+    }
+  }
+}
+
+//
+//Function: fb_offset() adds an offset to the object at position off.
+void fb_offset(struct IPC_FB * fb, size_t off)
+{
+  fb_prep(fb, 4, 0);
+  fb_le(fb, fb->len + 4 - off, 4);
+}
+
+//
+//Function: fb_string() adds the string s and returns its position.
+size_t fb_string(struct IPC_FB * fb, const char * s)
+{
+  size_t n = strlen(s);
+
+  fb_prep(fb, 4, n + 1);
+  fb_pad(fb, 1);
+  fb_bytes(fb, s, n);
+  fb_le(fb, n, 4);
+  return fb->len;
+}
+
+//
+//Function: fb_start() starts a table of n fields (at most 8). The objects the
+//          table refers to must already have been added.
+void fb_start(struct IPC_FB * fb, int n)
+{
+  fb->nfields = n;
+  memset(fb->fields, 0, sizeof(fb->fields));
+  fb->tstart = fb->len;
+}
+
+//
+//Function: fb_field() adds field id of the current table, a size byte scalar.
+void fb_field(struct IPC_FB * fb, int id, uint64_t v, size_t size)
+{
+  fb_le(fb, v, size);
+  fb->fields[id] = fb->len;
+}
+
+//
+//Function: fb_field_off() adds field id of the current table, an offset to
+//          the object at position off.
+void fb_field_off(struct IPC_FB * fb, int id, size_t off)
+{
+  fb_offset(fb, off);
+  fb->fields[id] = fb->len;
+}
+
+//
+//Function: fb_end() finishes the current table by adding its vtable (the
+//          offset of each field within the table) and returns its position.
+size_t fb_end(struct IPC_FB * fb)
+{
+  size_t tpos, vpos;
+  unsigned char * p;
+  int i;
+
+  fb_le(fb, 0, 4); // Offset to the vtable, set below
+  tpos = fb->len;
+  for (i = fb->nfields - 1; i >= 0; i--)
+  {
+    fb_le(fb, (fb->fields[i] > 0) ? tpos - fb->fields[i] : 0, 2);
+  }
+  fb_le(fb, tpos - fb->tstart, 2);
+  fb_le(fb, 4 + (2 * fb->nfields), 2);
+  vpos = fb->len;
+  if (!fb->failed)
+  {
+    p = fb->buf + fb->cap - tpos;
+    p[0] = (unsigned char)(vpos - tpos);
+    p[1] = (unsigned char)((vpos - tpos) >> 8);
+    p[2] = (unsigned char)((vpos - tpos) >> 16);
+    p[3] = (unsigned char)((vpos - tpos) >> 24);
+  }
+  return tpos;
+}
+
+//
+//Function: fb_int() adds an Int type table and returns its position.
+size_t fb_int(struct IPC_FB * fb, int bits, int is_signed)
+{
+  fb_start(fb, 2);
+  fb_field(fb, 0, bits, 4);
+  fb_field(fb, 1, is_signed, 1);
+  return fb_end(fb);
+}
+
+//
+//Function: ipc_message() finishes a message with the header at position hdr,
+//          of type type, and writes it out followed by the n buffers of its
+//          body (each padded to 8 bytes).
+void ipc_message(struct IPC_WRITER * w, int type, size_t hdr, size_t bodylen, struct IPC_BUF * bufs, int n)
+{
+  struct IPC_FB * fb = &w->fb;
+  size_t msg;
+  int i;
+
+  fb_start(fb, 4);
+  fb_field(fb, 3, bodylen, 8);
+  fb_field_off(fb, 2, hdr);
+  fb_field(fb, 0, IPC_FB_V5, 2);
+  fb_field(fb, 1, type, 1);
+  msg = fb_end(fb);
+  fb_prep(fb, fb->minalign, 4);
+  fb_offset(fb, msg);
+  if (fb->failed)
+  {
+    w->failed = 1;
+    return;
+  }
+
+  ipc_put32(w->out, 0xFFFFFFFF); // Continuation marker
+  ipc_put32(w->out, (uint32_t)fb->len);
+  obuf_mem(w->out, fb->buf + fb->cap - fb->len, fb->len);
+  for (i = 0; i < n; i++)
+  {
+    if (bufs[i].len > 0)
+    {
+      obuf_mem(w->out, bufs[i].data, bufs[i].len);
+      obuf_mem(w->out, "\0\0\0\0\0\0\0", (~bufs[i].len + 1) & 7);
+    }
+  }
+}
+
+//
+//Function: ipc_schema() writes the schema message, a field for each column.
+void ipc_schema(struct IPC_WRITER * w)
+{
+  struct IPC_FB * fb = &w->fb;
+  size_t * fields, name, children, type, tz, index, dict, vec, schema;
+  int c, typetype;
+
+  if ((fields = (size_t *)malloc(w->ncols * sizeof(size_t))) == NULL)
+  {
+    w->failed = 1;
+    return;
+  }
+  fb->len = 0;
+  fb->minalign = 1;
+  for (c = 0; c < w->ncols; c++)
+  {
+    name = fb_string(fb, w->cols[c].name);
+    fb_le(fb, 0, 4); // No children
+    children = fb->len;
+    dict = 0;
+    switch (w->cols[c].type)
+    {
+    case IPC_INT32:
+    case IPC_UINT32:
+      typetype = IPC_FB_INT;
+      type = fb_int(fb, 32, w->cols[c].type == IPC_INT32);
+      break;
+    case IPC_INT64:
+      typetype = IPC_FB_INT;
+      type = fb_int(fb, 64, 1);
+      break;
+    case IPC_TIMESTAMP:
+      typetype = IPC_FB_TIMESTAMP;
+      tz = fb_string(fb, "UTC");
+      fb_start(fb, 2);
+      fb_field_off(fb, 1, tz);
+      fb_field(fb, 0, 0, 2); // TimeUnit SECOND
+      type = fb_end(fb);
+      break;
+    default:
+      typetype = IPC_FB_UTF8;
+      fb_start(fb, 0);
+      type = fb_end(fb);
+      if (w->cols[c].type == IPC_DICT)
+      {
+        index = fb_int(fb, 32, 1);
+        fb_start(fb, 2);
+        fb_field(fb, 0, c, 8); // The dictionary id is the column number
+        fb_field_off(fb, 1, index);
+        dict = fb_end(fb);
+      }
+    }
+    fb_start(fb, 6);
+    fb_field_off(fb, 0, name);
+    fb_field_off(fb, 3, type);
+    fb_field_off(fb, 5, children);
+    if (dict > 0)
+    {
+      fb_field_off(fb, 4, dict);
+    }
+    fb_field(fb, 1, 1, 1); // Nullable
+    fb_field(fb, 2, typetype, 1);
+    fields[c] = fb_end(fb);
+  }
+  fb_prep(fb, 4, 4 * w->ncols);
+  for (c = w->ncols - 1; c >= 0; c--)
+  {
+    fb_offset(fb, fields[c]);
+  }
+  fb_le(fb, w->ncols, 4);
+  vec = fb->len;
+  fb_start(fb, 2);
+  fb_field_off(fb, 1, vec);
+  fb_field(fb, 0, 0, 2); // Little endian
+  schema = fb_end(fb);
+  free(fields);
+  ipc_message(w, IPC_FB_SCHEMA, schema, 0, NULL, 0);
+}
+
+//
+//Function: ipc_batch() writes a record batch of rows rows with a node (the
+//          length and null count) for each of the n columns and the nb
+//          buffers that hold them. If id isn't negative the batch is a
+//          dictionary batch for dictionary id.
+void ipc_batch(struct IPC_WRITER * w, int64_t id, int delta, size_t rows, uint64_t * nodes, int n, struct IPC_BUF * bufs, int nb)
+{
+  struct IPC_FB * fb = &w->fb;
+  size_t body = 0, vbufs, vnodes, rb;
+  size_t * offsets;
+  int i;
+
+  if ((offsets = (size_t *)malloc((nb + 1) * sizeof(size_t))) == NULL)
+  {
+    w->failed = 1;
+    return;
+  }
+  for (i = 0; i < nb; i++)
+  {
+    offsets[i] = body;
+    body += (bufs[i].len + 7) & ~(size_t)7;
+  }
+  fb->len = 0;
+  fb->minalign = 1;
+  fb_prep(fb, 8, 16 * nb);
+  for (i = nb - 1; i >= 0; i--)
+  {
+    fb_le(fb, bufs[i].len, 8);
+    fb_le(fb, offsets[i], 8);
+  }
+  fb_le(fb, nb, 4);
+  vbufs = fb->len;
+  fb_prep(fb, 8, 16 * n);
+  for (i = n - 1; i >= 0; i--)
+  {
+    fb_le(fb, nodes[(2 * i) + 1], 8);
+    fb_le(fb, nodes[2 * i], 8);
+  }
+  fb_le(fb, n, 4);
+  vnodes = fb->len;
+  fb_start(fb, 3);
+  fb_field(fb, 0, rows, 8);
+  fb_field_off(fb, 1, vnodes);
+  fb_field_off(fb, 2, vbufs);
+  rb = fb_end(fb);
+  free(offsets);
+  if (id < 0)
+  {
+    ipc_message(w, IPC_FB_RECORDBATCH, rb, body, bufs, nb);
+    return;
+  }
+  fb_start(fb, 3);
+  fb_field(fb, 0, (uint64_t)id, 8);
+  fb_field_off(fb, 1, rb);
+  fb_field(fb, 2, delta, 1);
+  ipc_message(w, IPC_FB_DICTBATCH, fb_end(fb), body, bufs, nb);
+}
+
+//
+//Function: ipc_dictbatch() writes the strings added to the dictionary of
+//          column c since the last time.
+void ipc_dictbatch(struct IPC_WRITER * w, int c)
+{
+  struct IPC_DICT * dict = w->cols[c].dict;
+  struct IPC_BUF bufs[3];
+  uint64_t node[2];
+  uint32_t i, base;
+
+  base = ipc_get32(dict->offsets.buf + (4 * dict->sent));
+  obuf_reset(&w->scratch);
+  for (i = dict->sent; i <= dict->count; i++)
+  {
+    ipc_put32(&w->scratch, ipc_get32(dict->offsets.buf + (4 * i)) - base);
+  }
+  if (w->scratch.failed)
+  {
+    w->failed = 1;
+    return;
+  }
+  node[0] = dict->count - dict->sent;
+  node[1] = 0;
+  bufs[0].data = NULL;
+  bufs[0].len = 0;
+  bufs[1].data = w->scratch.buf;
+  bufs[1].len = w->scratch.len;
+  bufs[2].data = dict->data.buf + base;
+  bufs[2].len = dict->data.len - base;
+  ipc_batch(w, c, w->batches > 0, dict->count - dict->sent, node, 1, bufs, 3);
+  dict->sent = dict->count;
+}
+
+//
+//Function: ipc_records() writes the rows held by w as a record batch, after
+//          any strings that have been added to the dictionaries. The columns
+//          are emptied ready for the next batch.
+void ipc_records(struct IPC_WRITER * w)
+{
+  struct IPC_COLUMN * col;
+  struct IPC_BUF * bufs;
+  uint64_t * nodes;
+  int c, nb = 0;
+
+  for (c = 0; c < w->ncols; c++)
+  {
+    col = &w->cols[c];
+    if (col->valid.failed || col->values.failed || col->data.failed)
+    {
+      w->failed = 1;
+    }
+    //The first batch needs every dictionary, even an empty one
+    if ((col->type == IPC_DICT) && ((w->batches == 0) || (col->dict->count > col->dict->sent)))
+    {
+      if (col->dict->offsets.failed || col->dict->data.failed)
+      {
+        w->failed = 1;
+      }
+      if (!w->failed)
+      {
+        ipc_dictbatch(w, c);
+      }
+    }
+  }
+  bufs = (struct IPC_BUF *)malloc(3 * w->ncols * sizeof(struct IPC_BUF));
+  nodes = (uint64_t *)malloc(2 * w->ncols * sizeof(uint64_t));
+  if ((bufs == NULL) || (nodes == NULL))
+  {
+    w->failed = 1;
+  }
+  if (w->failed)
+  {
+    free(bufs);
+    free(nodes);
+    return;
+  }
+
+  for (c = 0; c < w->ncols; c++)
+  {
+    col = &w->cols[c];
+    nodes[2 * c] = w->rows;
+    nodes[(2 * c) + 1] = col->nulls;
+    bufs[nb].data = col->valid.buf;
+    bufs[nb++].len = (col->nulls > 0) ? (w->rows + 7) / 8 : 0;
+    bufs[nb].data = col->values.buf;
+    bufs[nb++].len = col->values.len;
+    if (col->type == IPC_UTF8)
+    {
+      bufs[nb].data = col->data.buf;
+      bufs[nb++].len = col->data.len;
+    }
+  }
+  ipc_batch(w, -1, 0, w->rows, nodes, w->ncols, bufs, nb);
+  free(bufs);
+  free(nodes);
+  w->batches++;
+  w->rows = 0;
+
+  for (c = 0; c < w->ncols; c++)
+  {
+    col = &w->cols[c];
+    obuf_reset(&col->valid);
+    obuf_reset(&col->values);
+    obuf_reset(&col->data);
+    col->nulls = 0;
+    if (col->type == IPC_UTF8)
+    {
+      ipc_put32(&col->values, 0);
+    }
+  }
+}
+
+//
+//Function: ipc_column() adds a column to w. Returns 0 if successful or -1 if
+//          memory ran out.
+int ipc_column(struct IPC_WRITER * w, const char * name, enum IPC_TYPE type)
+{
+  struct IPC_COLUMN * cols, * col;
+
+  if ((type < IPC_INT32) || (type > IPC_DICT))
+  {
+    return -1;
+  }
+  if ((cols = (struct IPC_COLUMN *)realloc(w->cols, (w->ncols + 1) * sizeof(struct IPC_COLUMN))) == NULL)
+  {
+    return -1;
+  }
+  w->cols = cols;
+  col = &cols[w->ncols];
+  memset(col, 0, sizeof(struct IPC_COLUMN));
+  col->name = name;
+  col->type = type;
+  obuf_init(&col->valid, NULL);
+  obuf_init(&col->values, NULL);
+  obuf_init(&col->data, NULL);
+  if (type == IPC_UTF8)
+  {
+    ipc_put32(&col->values, 0);
+  }
+  if (type == IPC_DICT)
+  {
+    if ((col->dict = (struct IPC_DICT *)calloc(1, sizeof(struct IPC_DICT))) == NULL)
+    {
+      return -1;
+    }
+    obuf_init(&col->dict->offsets, NULL);
+    obuf_init(&col->dict->data, NULL);
+    ipc_put32(&col->dict->offsets, 0);
+  }
+  w->ncols++;
+  return 0;
+}
+
+//
+//Function: ipc_valid() sets or clears the validity bit of col for the row
+//          being added to w.
+void ipc_valid(struct IPC_WRITER * w, struct IPC_COLUMN * col, int valid)
+{
+  if ((w->rows % 8) == 0)
+  {
+    obuf_chr(&col->valid, 0);
+  }
+  if (col->valid.len <= w->rows / 8)
+  {
+    w->failed = 1;
+    return;
+  }
+  if (valid)
+  {
+    col->valid.buf[w->rows / 8] |= (char)(1 << (w->rows % 8));
+  }
+  else
+  {
+    col->nulls++;
+  }
+}
+
+//
+//Function: ipc_hash() returns the FNV-1a hash of n bytes at s.
+uint32_t ipc_hash(const char * s, size_t n)
+{
+  uint32_t h = 2166136261u;
+
+  while (n-- > 0)
+  {
+    h = (h ^ (unsigned char)*s++) * 16777619u;
+  }
+  return h;
+}
+
+//
+//Function: ipc_rehash() doubles the hash table of dict. Returns 0 if
+//          successful or -1 if memory ran out.
+int ipc_rehash(struct IPC_DICT * dict)
+{
+  uint32_t * slots, nslots, i, slot, start, end;
+
+  nslots = (dict->nslots > 0) ? dict->nslots * 2 : 64;
+  if ((slots = (uint32_t *)calloc(nslots, sizeof(uint32_t))) == NULL)
+  {
+    return -1;
+  }
+  for (i = 0; i < dict->count; i++)
+  {
+    start = ipc_get32(dict->offsets.buf + (4 * i));
+    end = ipc_get32(dict->offsets.buf + (4 * (i + 1)));
+    slot = ipc_hash(dict->data.buf + start, end - start) & (nslots - 1);
+    while (slots[slot] != 0)
+    {
+      slot = (slot + 1) & (nslots - 1);
+    }
+    slots[slot] = i + 1;
+  }
+  free(dict->slots);
+  dict->slots = slots;
+  dict->nslots = nslots;
+  return 0;
+}
+
+//
+//Function: ipc_lookup() returns the index of the n byte string s in dict,
+//          adding it if it isn't there yet.
+uint32_t ipc_lookup(struct IPC_WRITER * w, struct IPC_DICT * dict, const char * s, size_t n)
+{
+  uint32_t slot, i, start, end;
+
+  if (((dict->count + 1) * 2 > dict->nslots) && (ipc_rehash(dict) != 0))
+  {
+    w->failed = 1;
+    return 0;
+  }
+  slot = ipc_hash(s, n) & (dict->nslots - 1);
+  while (dict->slots[slot] != 0)
+  {
+    i = dict->slots[slot] - 1;
+    start = ipc_get32(dict->offsets.buf + (4 * i));
+    end = ipc_get32(dict->offsets.buf + (4 * (i + 1)));
+    //An empty entry matches without a compare (data.buf may still be NULL)
+    if ((end - start == n) && ((n == 0) || (memcmp(dict->data.buf + start, s, n) == 0)))
+    {
+      return i;
+    }
+    slot = (slot + 1) & (dict->nslots - 1);
+  }
+  obuf_mem(&dict->data, s, n);
+  ipc_put32(&dict->offsets, (uint32_t)dict->data.len);
+  if (dict->offsets.failed || dict->data.failed)
+  {
+    w->failed = 1;
+    return 0;
+  }
+  dict->slots[slot] = ++dict->count;
+  return dict->count - 1;
+}
+
+//
+//Function: ipc_init() prepares w to write a stream to out in batches of
+//          batchrows rows (IPC_BATCHROWS if batchrows is 0).
+void ipc_init(struct IPC_WRITER * w, struct OBUF * out, size_t batchrows)
+{
+  memset(w, 0, sizeof(struct IPC_WRITER));
+  w->out = out;
+  w->batchrows = (batchrows > 0) ? batchrows : IPC_BATCHROWS;
+  obuf_init(&w->scratch, NULL);
+}
+
+//
+//Function: ipc_cell() appends the start of a cell, its type and the column
+//          name, to row.
+void ipc_cell(struct OBUF * row, const char * name, int type)
+{
+  obuf_chr(row, (char)type);
+  obuf_mem(row, &name, sizeof(name));
+}
+
+//
+//Function: ipc_cell_int() appends a cell holding the number n to row.
+void ipc_cell_int(struct OBUF * row, const char * name, enum IPC_TYPE type, int64_t n)
+{
+  ipc_cell(row, name, type);
+  obuf_mem(row, &n, sizeof(n));
+}
+
+//
+//Function: ipc_cell_str() appends a cell holding the nul terminated string
+//          str to row. The string is made valid UTF-8 here so that the work
+//          is done by whichever thread builds the row.
+void ipc_cell_str(struct OBUF * row, const char * name, enum IPC_TYPE type, const void * str)
+{
+  ipc_cell(row, name, type);
+  obuf_utf8(row, str);
+  obuf_chr(row, 0);
+}
+
+//
+//Function: ipc_cell_null() appends a cell with no value to row.
+void ipc_cell_null(struct OBUF * row, const char * name, enum IPC_TYPE type)
+{
+  ipc_cell(row, name, type | IPC_NULL);
+}
+
+//
+//Function: ipc_row() adds the len byte row (built with the ipc_cell
+//          functions) to w. The first row decides the columns and is
+//          followed by the schema. A record batch is written each time
+//          w->batchrows rows have been added. Returns 0 if successful or -1
+//          if memory ran out or the row doesn't match the columns.
+int ipc_row(struct IPC_WRITER * w, const void * row, size_t len)
+{
+  const char * p = (const char *)row;
+  const char * end = p + len;
+  const char * name;
+  struct IPC_COLUMN * col;
+  int type, c = 0;
+  int64_t n;
+  size_t slen;
+
+  while ((p < end) && !w->failed)
+  {
+    if ((size_t)(end - p) < 1 + sizeof(name) + sizeof(n))
+    {
+      //Too short for even the smallest cell that holds a value
+      if (((size_t)(end - p) < 1 + sizeof(name)) || !((unsigned char)*p & IPC_NULL))
+      {
+        w->failed = 1;
+        break;
+      }
+    }
+    type = (unsigned char)*p++;
+    memcpy(&name, p, sizeof(name));
+    p += sizeof(name);
+    if (!w->started)
+    {
+      if (ipc_column(w, name, (enum IPC_TYPE)(type & ~IPC_NULL)) != 0)
+      {
+        w->failed = 1;
+        break;
+      }
+    }
+    else if ((c >= w->ncols) || (w->cols[c].name != name) || ((int)w->cols[c].type != (type & ~IPC_NULL)))
+    {
+      w->failed = 1;
+      break;
+    }
+    col = &w->cols[c++];
+    ipc_valid(w, col, !(type & IPC_NULL));
+    switch (type)
+    {
+    case IPC_INT32:
+    case IPC_UINT32:
+      memcpy(&n, p, sizeof(n));
+      p += sizeof(n);
+      ipc_put32(&col->values, (uint32_t)n);
+      break;
+    case IPC_INT64:
+    case IPC_TIMESTAMP:
+      memcpy(&n, p, sizeof(n));
+      p += sizeof(n);
+      ipc_put64(&col->values, (uint64_t)n);
+      break;
+    case IPC_UTF8:
+      slen = strlen(p);
+      obuf_mem(&col->data, p, slen);
+      ipc_put32(&col->values, (uint32_t)col->data.len);
+      p += slen + 1;
+      break;
+    case IPC_DICT:
+      slen = strlen(p);
+      ipc_put32(&col->values, ipc_lookup(w, col->dict, p, slen));
+      p += slen + 1;
+      break;
+    case IPC_UTF8 | IPC_NULL:
+      ipc_put32(&col->values, (uint32_t)col->data.len);
+      break;
+    case IPC_INT64 | IPC_NULL:
+    case IPC_TIMESTAMP | IPC_NULL:
+      ipc_put64(&col->values, 0);
+      break;
+    default: // A null 32 bit number or dictionary index
+      ipc_put32(&col->values, 0);
+    }
+  }
+  if (!w->failed && (c != w->ncols))
+  {
+    w->failed = 1;
+  }
+  if (w->failed)
+  {
+    return -1;
+  }
+
+  if (!w->started)
+  {
+    ipc_schema(w);
+    w->started = 1;
+  }
+  if (++w->rows >= w->batchrows)
+  {
+    ipc_records(w);
+  }
+  return w->failed ? -1 : 0;
+}
+
+//
+//Function: ipc_end() writes any rows still held by w and the end of stream
+//          marker. Nothing at all is written if no rows were added, as there
+//          is no schema to write. Returns 0 if successful or -1 if not.
+int ipc_end(struct IPC_WRITER * w)
+{
+  if (w->started && !w->failed)
+  {
+    if (w->rows > 0)
+    {
+      ipc_records(w);
+    }
+    ipc_put32(w->out, 0xFFFFFFFF);
+    ipc_put32(w->out, 0);
+  }
+  return w->failed ? -1 : 0;
+}
+
+//
+//Function: ipc_free() releases the memory held by w.
+void ipc_free(struct IPC_WRITER * w)
+{
+  int c;
+
+  for (c = 0; c < w->ncols; c++)
+  {
+    obuf_free(&w->cols[c].valid);
+    obuf_free(&w->cols[c].values);
+    obuf_free(&w->cols[c].data);
+    if (w->cols[c].dict != NULL)
+    {
+      obuf_free(&w->cols[c].dict->offsets);
+      obuf_free(&w->cols[c].dict->data);
+      free(w->cols[c].dict->slots);
+      free(w->cols[c].dict);
+    }
+  }
+  free(w->cols);
+  free(w->fb.buf);
+  obuf_free(&w->scratch);
+  memset(w, 0, sizeof(struct IPC_WRITER));
+}
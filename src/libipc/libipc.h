@@ -0,0 +1,177 @@
+/***************************************************************
+**                                                            **
+**                        libipc.h                            **
+**                                                            **
+**    A library to write typed columns of data in the         **
+**    Apache Arrow IPC stream format                          **
+**                                                            **
+**            Copyright Paul Tew 2011 to 2024                 **
+**                                                            **
+** Structures:                                                **
+** -----------                                                **
+** IPC_WRITER - The columns of the batch being built and the  **
+**              OBUF the stream is written to                 **
+**                                                            **
+** Exported Functions:                                        **
+** -------------------                                        **
+** ipc_init(IPC_WRITER*, OBUF*, size_t)                       **
+**       Prepares a writer for a stream of record batches of  **
+**       (at most) the given number of rows                   **
+**                                                            **
+** ipc_cell_int(OBUF*, const char*, IPC_TYPE, int64_t)        **
+** ipc_cell_str(OBUF*, const char*, IPC_TYPE, const void*)    **
+** ipc_cell_null(OBUF*, const char*, IPC_TYPE)                **
+**       Append a number, a string or a null to a row         **
+**                                                            **
+** ipc_row(IPC_WRITER*, const void*, size_t)                  **
+**       Adds a row built with the ipc_cell functions to the  **
+**       stream. Returns 0 on success, -1 on failure.         **
+**                                                            **
+** ipc_end(IPC_WRITER*)                                       **
+**       Writes the last batch and the end of the stream.     **
+**       Returns 0 on success, -1 on failure.                 **
+**                                                            **
+** ipc_free(IPC_WRITER*)                                      **
+**       Releases the memory held by an IPC_WRITER            **
+**                                                            **
+***************************************************************/
+
+/*
+This file is part of Lifer.
+
+    Lifer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Lifer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Lifer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+
+The stream (https://arrow.apache.org/docs/format/Columnar.html) is a schema
+message, then a dictionary batch for each dictionary encoded column and a
+record batch for every IPC_WRITER.batchrows rows, then an end of stream
+marker. Only the new strings in a dictionary are sent before each record batch
+(as a delta) so a dictionary costs one copy of each distinct string however
+many batches there are. The FlatBuffers that describe each message are built
+here without any library, so nothing beyond libobuf is needed.
+
+A row is built first as a list of cells in an OBUF of its own (this can be
+done in any thread) and then handed to ipc_row(). The cells of the first row
+give the schema: the name and type of each column in turn. Every later row
+must have the same cells in the same order, with a null cell in place of a
+value that is missing. Column names are kept by pointer so they must be
+string literals (or otherwise outlive the writer).
+
+Memory is bounded by the size of a batch plus the distinct dictionary strings.
+Numbers are written little endian, as Arrow expects, whatever the host.
+
+*/
+
+#ifndef _LIBIPC_H_
+#define _LIBIPC_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "../libobuf/libobuf.h"
+
+#define IPC_BATCHROWS 16384   // The default number of rows in a record batch
+
+enum IPC_TYPE
+{
+  IPC_INT32,      // Signed 32 bit integer
+  IPC_UINT32,     // Unsigned 32 bit integer
+  IPC_INT64,      // Signed 64 bit integer
+  IPC_TIMESTAMP,  // Seconds since 1970-01-01 (UTC) as a signed 64 bit integer
+  IPC_UTF8,       // String
+  IPC_DICT        // String stored as an index into a dictionary of strings
+};
+
+struct IPC_DICT
+{
+  struct OBUF        offsets; // int32 offset of each string in data (and one past the last)
+  struct OBUF        data;    // The strings, one after the other
+  uint32_t           count;   // Strings in the dictionary
+  uint32_t           sent;    // Strings already written to the stream
+  uint32_t *         slots;   // Hash table of string number + 1 (0 is an empty slot)
+  uint32_t           nslots;  // Size of slots (a power of 2)
+};
+
+struct IPC_COLUMN
+{
+  const char *       name;
+  enum IPC_TYPE      type;
+  struct OBUF        valid;   // Validity bitmap, a bit for each row
+  struct OBUF        values;  // Values, string offsets or dictionary indices
+  struct OBUF        data;    // String bytes (IPC_UTF8 only)
+  size_t             nulls;   // Null values in this batch
+  struct IPC_DICT *  dict;    // The dictionary (IPC_DICT only)
+};
+
+struct IPC_FB                 // A FlatBuffer, built from the end backwards
+{
+  unsigned char *    buf;
+  size_t             cap;
+  size_t             len;     // Bytes used (at the end of buf)
+  size_t             minalign;
+  size_t             tstart;  // len when the current table was started
+  int                nfields; // Fields in the current table
+  size_t             fields[8]; // len after each field of the current table was added
+  int                failed;  // Set if memory ran out
+};
+
+struct IPC_WRITER
+{
+  struct OBUF *      out;       // Where the stream is written
+  struct IPC_COLUMN* cols;
+  int                ncols;
+  size_t             rows;      // Rows in the batch being built
+  size_t             batchrows; // Rows in a full batch
+  int                batches;   // Record batches written so far
+  int                started;   // Set once the schema has been written
+  int                failed;    // Set if memory ran out or a row didn't match the schema
+  struct IPC_FB      fb;
+  struct OBUF        scratch;
+};
+
+/******************************************************************************/
+//Public Function Declarations
+
+//Prepares a writer
+extern void ipc_init(struct IPC_WRITER *, struct OBUF *, size_t);
+//IPC_WRITER* is the writer to prepare
+//OBUF* is where the stream is written
+//size_t is the number of rows in each record batch (0 for IPC_BATCHROWS)
+
+//Append a cell to a row
+extern void ipc_cell_int(struct OBUF *, const char *, enum IPC_TYPE, int64_t);
+extern void ipc_cell_str(struct OBUF *, const char *, enum IPC_TYPE, const void *);
+extern void ipc_cell_null(struct OBUF *, const char *, enum IPC_TYPE);
+//OBUF* is the row being built
+//const char* is the column name (a string literal)
+//IPC_TYPE is the column type
+//int64_t or const void* is the value (a nul terminated string, not
+//necessarily UTF-8, bytes that aren't are taken as Latin-1)
+
+//Adds a row to the stream (0 if successful, -1 if not)
+extern int ipc_row(struct IPC_WRITER *, const void *, size_t);
+//IPC_WRITER* is the writer
+//const void* is the row
+//size_t is the length of the row
+
+//Writes the last batch and the end of stream marker (0 if successful, -1 if not)
+extern int ipc_end(struct IPC_WRITER *);
+
+//Frees the memory held by an IPC_WRITER
+extern void ipc_free(struct IPC_WRITER *);
+
+#endif
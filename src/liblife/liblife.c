@@ -27,93 +27,254 @@ This file is part of Lifer.
 
 #include "./liblife.h"
 
+//SSE2 is always there on x86-64 (and on 32 bit x86 if the compiler is told
+//it can use it), AVX2 only if the compiler is told it can use it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define LIF_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+//A FILE is locked while it is read so that another thread using it can't
+//move its position in between (see read_start())
+#ifdef _WIN32
+#define LIF_LOCKFILE(fp)   _lock_file(fp)
+#define LIF_UNLOCKFILE(fp) _unlock_file(fp)
+#define LIF_FSEEK(fp, o, w) _fseeki64(fp, (__int64)(o), w)
+#define LIF_FTELL(fp)      ((int64_t)_ftelli64(fp))
+#else
+#include <sys/types.h>
+#define LIF_LOCKFILE(fp)   flockfile(fp)
+#define LIF_UNLOCKFILE(fp) funlockfile(fp)
+#define LIF_FSEEK(fp, o, w) fseeko(fp, (off_t)(o), w)
+#define LIF_FTELL(fp)      ((int64_t)ftello(fp))
+#endif
+
+//Refuse to compile if struct LIF_A has grown beyond its budget (see liblife.h)
+typedef char lif_a_budget_check[(sizeof(struct LIF_A) <= LIF_A_BUDGET) ? 1 : -1];
+
+//Where put_lif() is writing a link file to
+struct LIF_OUT
+{
+  uint8_t *          buf;
+  size_t             size;
+  size_t             pos;     // Bytes made so far (it carries on counting past size)
+};
+
 //Declaration of functions used privately
-int get_lhdr(FILE *, struct LIF *);
+int get_lhdr(const unsigned char *, size_t, struct LIF_HDR *);
+int test_lhdr(struct LIF_HDR *);
+int lhdr_err(int);
 int get_lhdr_a(struct LIF_HDR *, struct LIF_HDR_A *);
-int get_idlist(FILE *, int, int, struct LIF *);
-int get_idlist_a(struct LIF_IDLIST *, struct LIF_IDLIST_A *);
-int get_linkinfo(FILE *, int, int, struct LIF *);
+int get_idlist(const unsigned char *, size_t, size_t, struct LIF *);
+int get_idlist_a(struct LIF_IDLIST *, struct LIF_IDLIST_A *, uint32_t);
+int get_linkinfo(const unsigned char *, size_t, size_t, struct LIF *);
 int get_linkinfo_a(struct LIF_INFO *, struct LIF_INFO_A *);
-int get_stringdata(FILE *, int, struct LIF *);
+int get_stringdata(const unsigned char *, size_t, size_t, struct LIF *);
 int get_stringdata_a(struct LIF_STRINGDATA *, struct LIF_STRINGDATA_A *);
-int get_extradata(FILE *, int, struct LIF *);
-int get_extradata_a(struct LIF_EXTRA_DATA *, struct LIF_EXTRA_DATA_A *);
+int get_extradata(const unsigned char *, size_t, size_t, struct LIF *);
+int get_extradata_a(struct LIF_EXTRA_DATA *, struct LIF_EXTRA_DATA_A *, struct LIF_ARENA *, uint32_t);
 void get_flag_a(unsigned char *, struct LIF_HDR *);
 void get_attr_a(unsigned char *, struct LIF_HDR *);
-uint64_t get_le_uint64(unsigned char[], int);
-int64_t get_le_int64(unsigned char[], int);
-uint32_t  get_le_uint32(unsigned char[], int);
-uint16_t get_le_uint16(unsigned char[], int);
-int32_t get_le_int32(unsigned char[], int);
-int16_t get_le_int16(unsigned char[], int);
-void get_chars(unsigned char[], int, int, unsigned char[]);
-int get_le_unistr(unsigned char[], int, int, wchar_t[]);
+uint64_t get_le_uint64(const unsigned char[], int);
+int64_t get_le_int64(const unsigned char[], int);
+uint32_t  get_le_uint32(const unsigned char[], int);
+uint16_t get_le_uint16(const unsigned char[], int);
+int32_t get_le_int32(const unsigned char[], int);
+int16_t get_le_int16(const unsigned char[], int);
+void get_chars(const unsigned char[], int, int, unsigned char[]);
+size_t get_bytes(const unsigned char *, size_t, size_t, size_t, unsigned char[]);
+int span_ok(size_t, size_t, size_t);
+void get_cstr(const unsigned char *, size_t, size_t, size_t, unsigned char[]);
+int get_le_unistr(const unsigned char[], int, int, wchar_t[]);
+int get_le_unistr_n(const unsigned char *, size_t, size_t, int, wchar_t[]);
 void get_filetime_a_short(int64_t, unsigned char[]);
 void get_filetime_a_long(int64_t, unsigned char[]);
-void get_ltp(struct LIF_TRACKER_PROPS *, unsigned char*);
+char * put_datetime(char *, uint64_t);
+char * put_digits(char *, uint32_t, int);
+void get_ltp(struct LIF_TRACKER_PROPS *, const unsigned char*);
 void get_droid_a(struct LIF_CLSID *, struct LIF_CLSID_A *);
 void led_setnull(struct LIF_EXTRA_DATA *);
+void lif_absent(struct LIF *, uint32_t);
+uint32_t ed_minsize(uint32_t);
+void * arena_get(struct LIF_ARENA *, size_t);
+void view_cstr(const struct LIF_VIEW *, uint32_t, uint32_t, uint32_t, struct LIF_SPAN *);
+void view_ustr(const struct LIF_VIEW *, uint32_t, uint32_t, uint32_t, struct LIF_SPAN *);
+int sig_match(const uint8_t *, const uint8_t *, size_t);
+size_t file_read(FILE *, uint64_t, uint8_t *, size_t);
+size_t file_read_at(void *, uint64_t, uint8_t *, size_t);
+size_t mem_read_at(void *, uint64_t, uint8_t *, size_t);
+uint64_t src_extent(const struct LIF_SOURCE *);
+size_t batch_run(const struct LIF_INPUT *, size_t, struct LIF *, int *, uint32_t);
+#ifndef _WIN32
+void * batch_thread(void *);
+#endif
+int prop_strlen(const unsigned char[], int);
+int visit_props(const struct LIF_VIEW *, struct LIF_SPAN, const struct LIF_VISITOR *, void *);
+void out_bytes(struct LIF_OUT *, const void *, size_t);
+void out_le(struct LIF_OUT *, uint64_t, int);
+void out_le_at(struct LIF_OUT *, size_t, uint64_t, int);
+size_t out_str(struct LIF_OUT *, const char *, int, int);
+void out_linkinfo(struct LIF_OUT *, const struct LIF_SPEC *);
+size_t low_bit(unsigned int);
 
 
-//Function get_lif(FILE* fp, int size, struct LIF lif) takes an open file
-//pointer and populates the LIF with relevant data.
-extern int get_lif(FILE* fp, int size, struct LIF* lif)
+//Function get_lif(FILE* fp, int size, struct LIF lif, struct LIF_ARENA* arena)
+//takes an open file pointer and populates the LIF with relevant data.
+//The whole file is read into memory from arena in one go and then handed to
+//get_lif_buf() to be decoded.
+extern int get_lif(FILE* fp, int size, struct LIF* lif, struct LIF_ARENA* arena)
 {
-  int pos = 0;
+  unsigned char * buf;
+  size_t          len;
+  int             result;
 
-  assert(size >= 0x4C);   //Min size for a LIF (must contain a header at least)
-  if (get_lhdr(fp, lif) < 0)
+  if (size < 0x4C) //Min size for a LIF (must contain a header at least)
   {
-    return -1;
+    return LIF_ERR_HDR;
+  }
+  buf = (unsigned char *)arena_get(arena, (size_t)size);
+  if (buf == NULL)
+  {
+    return LIF_ERR_MEMORY;
+  }
+  len = file_read(fp, 0, buf, (size_t)size);
+  result = get_lif_buf(buf, len, lif);
+
+  return result;
+}
+//
+//Function get_lif_buf(const uint8_t* buf, size_t len, struct LIF* lif) takes
+//a buffer holding the whole of a link file (len bytes long) and populates the
+//LIF with relevant data. Nothing is read beyond buf[len - 1].
+//The header is validated (as test_link() does) before any other section is
+//decoded so there is no need to call test_link() first. The return value is
+//LIF_OK (0) or one of the (negative) LIF_ERR values.
+extern int get_lif_buf(const uint8_t* buf, size_t len, struct LIF* lif)
+{
+  return get_lif_sect(buf, len, lif, LIF_SECT_ALL);
+}
+//
+//Function get_lif_sect(const uint8_t* buf, size_t len, struct LIF* lif, uint32_t sections)
+//is get_lif_buf() but only decodes the contents of the sections in sections
+//(LIF_SECT_IDLIST and the EDTYPES of the ExtraData blocks wanted). The header,
+//LinkInfo and StringData are always decoded, as are the position, size and
+//signature of every ExtraData block. The contents of the other sections are
+//left unset and get_lif_a() won't look at them either.
+//Nothing in the file can make it fail other than with a LIF_ERR value. With
+//LIF_SECT_PARTIAL in sections only a bad header does, the damage to any other
+//part is recorded in lif->damage (see LIF_DMG) and whatever could be decoded
+//is kept. A part that couldn't be found is left as though it were absent.
+extern int get_lif_sect(const uint8_t* buf, size_t len, struct LIF* lif, uint32_t sections)
+{
+  size_t pos = 0;
+  int    result;
+
+  lif->sections = sections;
+  lif->damage = 0;
+  if (get_lhdr(buf, len, &lif->lh) < 0)
+  {
+    return LIF_ERR_HDR;
+  }
+  if ((result = lhdr_err(test_lhdr(&lif->lh))) != LIF_OK)
+  {
+    return result;
   }
   pos += 0x4C;
 
-  if (get_idlist(fp, size, pos, lif) < 0)
+  if (get_idlist(buf, len, pos, lif) < 0)
   {
-    return -2;
+    lif->damage |= LIF_DMG_IDLIST;
+    lif_absent(lif, LIF_DMG_IDLIST);
+    return (sections & LIF_SECT_PARTIAL) ? LIF_OK : LIF_ERR_IDLIST;
+  }
+  if ((lif->damage & LIF_DMG_IDLIST) && (sections & LIF_SECT_PARTIAL))
+  {
+    //The ItemIDs that are there are kept but nothing after them can be found
+    lif_absent(lif, LIF_DMG_LINKINFO);
+    return LIF_OK;
   }
   if (lif->lidl.IDListSize > 0)
   {
     pos += (lif->lidl.IDListSize + 2);
   }
 
-  if (get_linkinfo(fp, size, pos, lif) < 0)
+  if (get_linkinfo(buf, len, pos, lif) < 0)
   {
-    return -3;
+    lif->damage |= LIF_DMG_LINKINFO;
+    lif_absent(lif, LIF_DMG_LINKINFO);
+    return (sections & LIF_SECT_PARTIAL) ? LIF_OK : LIF_ERR_LINKINFO;
   }
   pos += (lif->li.Size);
 
-  if (get_stringdata(fp, pos, lif) < 0)
+  if (get_stringdata(buf, len, pos, lif) < 0)
   {
-    return -4;
+    //The strings before the damage are kept
+    lif->damage |= LIF_DMG_STRINGDATA;
+    lif_absent(lif, LIF_DMG_EXTRADATA);
+    return (sections & LIF_SECT_PARTIAL) ? LIF_OK : LIF_ERR_STRINGDATA;
   }
   pos += (lif->lsd.Size);
 
-  if (pos < size) //Only get the extra data if it exists
+  if (pos < len) //Only get the extra data if it exists
   {
-    if (get_extradata(fp, pos, lif) < 0)
+    if (get_extradata(buf, len, pos, lif) < 0)
     {
-      return -5;
+      //The blocks before the damage are kept
+      lif->damage |= LIF_DMG_EXTRADATA;
+      return (sections & LIF_SECT_PARTIAL) ? LIF_OK : LIF_ERR_EXTRADATA;
     }
     pos += (lif->led.Size);
   }
   else //If it does not exist then set it to null
   {
-    led_setnull(&lif->led);
+    lif_absent(lif, LIF_DMG_EXTRADATA);
   }
 
-  return 0;
+  return LIF_OK;
+}
+//
+//Function lif_absent(struct LIF* lif, uint32_t from) leaves the section of the
+//LIF given by from (its LIF_DMG value) and every section after it as they
+//would be if they weren't in the link file.
+void lif_absent(struct LIF* lif, uint32_t from)
+{
+  if (from <= LIF_DMG_IDLIST)
+  {
+    lif->lidl.IDListSize = 0;
+    lif->lidl.NumItemIDs = 0;
+  }
+  if (from <= LIF_DMG_LINKINFO)
+  {
+    memset(&lif->li, 0, sizeof(lif->li));
+  }
+  if (from <= LIF_DMG_STRINGDATA)
+  {
+    memset(&lif->lsd, 0, sizeof(lif->lsd));
+  }
+  if (from <= LIF_DMG_EXTRADATA)
+  {
+    led_setnull(&lif->led);
+    lif->led.edtypes = EMPTY;
+  }
 }
 //
-//Function get_lif_a(struct LIF* lif, struct LIF_A* lif_a) populates the LIF_A
-//structure with the ASCII representation of a LIF
-extern int get_lif_a(struct LIF* lif, struct LIF_A* lif_a)
+//Function get_lif_a(struct LIF* lif, struct LIF_A* lif_a, struct LIF_ARENA* arena)
+//populates the LIF_A structure with the ASCII representation of a LIF. Any
+//parts of it that vary in size are allocated from arena. Sections that weren't
+//decoded (see get_lif_sect()) are shown as they would be if they were absent.
+extern int get_lif_a(struct LIF* lif, struct LIF_A* lif_a, struct LIF_ARENA* arena)
 {
   if (get_lhdr_a(&lif->lh, &lif_a->lha) < 0)
   {
     return -1;
   }
-  if (get_idlist_a(&lif->lidl, &lif_a->lidla) < 0)
+  if (get_idlist_a(&lif->lidl, &lif_a->lidla, lif->sections) < 0)
   {
     return -2;
   }
@@ -125,57 +286,553 @@ extern int get_lif_a(struct LIF* lif, struct LIF_A* lif_a)
   {
     return -4;
   }
-  if (get_extradata_a(&lif->led, &lif_a->leda) < 0)
+  if (get_extradata_a(&lif->led, &lif_a->leda, arena, lif->sections) < 0)
   {
     return -5;
   }
   return 0;
 }
 //
+//Function lif_arena_init(struct LIF_ARENA* arena) prepares an empty arena
+extern void lif_arena_init(struct LIF_ARENA* arena)
+{
+  arena->first = NULL;
+  arena->cur = NULL;
+  arena->held = 0;
+  arena->limit = 0;
+}
+//
+//Function lif_arena_limit(struct LIF_ARENA* arena, size_t limit) caps the
+//number of bytes arena may hold at limit (0 for no cap). Allocations that
+//would take it past the cap fail, so an absurd size read from a damaged link
+//file can't use up the memory of the machine.
+extern void lif_arena_limit(struct LIF_ARENA* arena, size_t limit)
+{
+  arena->limit = limit;
+}
+//
+//Function lif_arena_alloc(struct LIF_ARENA* arena, size_t size) returns size
+//bytes of zeroed memory from the arena. Returns NULL if no memory is
+//available.
+extern void * lif_arena_alloc(struct LIF_ARENA* arena, size_t size)
+{
+  void * mem;
+
+  if ((mem = arena_get(arena, size)) != NULL)
+  {
+    memset(mem, 0, size);
+  }
+  return mem;
+}
+//
+//Function arena_get(struct LIF_ARENA* arena, size_t size) returns size bytes
+//of memory from the arena (not zeroed), adding a new block to it if the
+//current one is full. Returns NULL (with errno set to ENOMEM) if no memory is
+//available or the arena's limit would be passed.
+void * arena_get(struct LIF_ARENA* arena, size_t size)
+{
+  struct LIF_ARENA_BLOCK * block;
+  unsigned char *          mem;
+  size_t                   hdr, bsize;
+
+  //Keep every allocation (and the block header) 16 byte aligned
+  hdr = (sizeof(struct LIF_ARENA_BLOCK) + 15) & ~(size_t)15;
+  if (size > ((size_t)-1 - hdr - 15))
+  {
+    errno = ENOMEM;
+    return NULL;
+  }
+  size = (size + 15) & ~(size_t)15;
+  //Use the current block or, after a reset, any following one with room
+  while ((arena->cur != NULL) && ((arena->cur->size - arena->cur->used) < size))
+  {
+    if (arena->cur->next == NULL)
+    {
+      break;
+    }
+    arena->cur = arena->cur->next;
+  }
+  if ((arena->cur == NULL) || ((arena->cur->size - arena->cur->used) < size))
+  {
+    bsize = (size > LIF_ARENA_BLOCKSIZE) ? size : LIF_ARENA_BLOCKSIZE;
+    if ((arena->limit > 0) && ((hdr + bsize > arena->limit) || (arena->held > arena->limit - hdr - bsize)))
+    {
+      errno = ENOMEM;
+      return NULL;
+    }
+    block = (struct LIF_ARENA_BLOCK *)malloc(hdr + bsize);
+    if (block == NULL)
+    {
+      errno = ENOMEM;
+      return NULL;
+    }
+    arena->held += hdr + bsize;
+    block->size = bsize;
+    block->used = 0;
+    if (arena->cur == NULL)
+    {
+      block->next = NULL;
+      arena->first = block;
+    }
+    else
+    {
+      //Slot it in after the current block so later blocks are kept
+      block->next = arena->cur->next;
+      arena->cur->next = block;
+    }
+    arena->cur = block;
+  }
+  mem = (unsigned char *)arena->cur + hdr + arena->cur->used;
+  arena->cur->used += size;
+  return mem;
+}
+//
+//Function lif_arena_reset(struct LIF_ARENA* arena) makes all the memory held
+//by the arena available again without freeing it, apart from any blocks over
+//LIF_ARENA_KEEP bytes (made for an unusually large file) which are released
+extern void lif_arena_reset(struct LIF_ARENA* arena)
+{
+  struct LIF_ARENA_BLOCK * block, **link;
+
+  link = &arena->first;
+  while ((block = *link) != NULL)
+  {
+    if (block->size > LIF_ARENA_KEEP)
+    {
+      *link = block->next;
+      arena->held -= ((sizeof(struct LIF_ARENA_BLOCK) + 15) & ~(size_t)15) + block->size;
+      free(block);
+    }
+    else
+    {
+      block->used = 0;
+      link = &block->next;
+    }
+  }
+  arena->cur = arena->first;
+}
+//
+//Function lif_arena_free(struct LIF_ARENA* arena) releases all the memory
+//held by the arena, leaving it empty
+extern void lif_arena_free(struct LIF_ARENA* arena)
+{
+  struct LIF_ARENA_BLOCK * block, *next;
+
+  for (block = arena->first; block != NULL; block = next)
+  {
+    next = block->next;
+    free(block);
+  }
+  arena->first = NULL;
+  arena->cur = NULL;
+  arena->held = 0; //The limit stays as it was
+}
+//
 //Function test_link(FILE *fp) takes an open file pointer as an argument
 //and returns 0 if the file IS a Windows link file or -1 if not.
 extern int test_link(FILE* fp)
 {
-  struct LIF lif;
-  int i;
+  unsigned char header[0x4C];
+
+  if (fp == NULL)
+  {
+    return -1;
+  }
+
+  return test_link_buf(header, file_read(fp, 0, header, 0x4C));
+}
+//
+//Function file_read(FILE* fp, uint64_t offset, uint8_t* buf, size_t num) reads
+//up to num bytes from offset in fp into buf and returns how many were read.
+//fp is locked while this happens and is left at the position it was at
+//before, so the caller (or another thread sharing fp) sees no change.
+size_t file_read(FILE* fp, uint64_t offset, uint8_t* buf, size_t num)
+{
+  int64_t posn;
+  size_t  got = 0;
+
+  LIF_LOCKFILE(fp);
+  posn = LIF_FTELL(fp);
+  if (LIF_FSEEK(fp, offset, SEEK_SET) == 0)
+  {
+    got = fread(buf, 1, num, fp);
+    if (posn >= 0)
+    {
+      LIF_FSEEK(fp, posn, SEEK_SET);
+    }
+  }
+  LIF_UNLOCKFILE(fp);
+  return got;
+}
+//
+//Function lif_source_mem(struct LIF_SOURCE* src, const uint8_t* buf, size_t len)
+//makes src a source for the len bytes at buf (which must stay there while
+//src is in use). This is also the way to read a file that has been mapped
+//into memory with mmap() or MapViewOfFile().
+extern void lif_source_mem(struct LIF_SOURCE* src, const uint8_t* buf, size_t len)
+{
+  src->read_at = mem_read_at;
+  src->ctx = (void *)buf;
+  src->base = 0;
+  src->size = len;
+  src->mem = buf;
+}
+//
+//Function lif_source_file(struct LIF_SOURCE* src, FILE* fp) makes src a source
+//for the whole of the open file fp. Reads lock fp and leave its position as
+//it was (see file_read()). Returns 0 if successful or -1 if the size of the
+//file couldn't be found.
+extern int lif_source_file(struct LIF_SOURCE* src, FILE* fp)
+{
+  int64_t posn, size = -1;
+
+  if (fp == NULL)
+  {
+    return -1;
+  }
+  LIF_LOCKFILE(fp);
+  posn = LIF_FTELL(fp);
+  if ((posn >= 0) && (LIF_FSEEK(fp, 0, SEEK_END) == 0))
+  {
+    size = LIF_FTELL(fp);
+    LIF_FSEEK(fp, posn, SEEK_SET);
+  }
+  LIF_UNLOCKFILE(fp);
+  if (size < 0)
+  {
+    return -1;
+  }
+  src->read_at = file_read_at;
+  src->ctx = (void *)fp;
+  src->base = 0;
+  src->size = (uint64_t)size;
+  src->mem = NULL;
+  return 0;
+}
+//
+//Function lif_source_slice(struct LIF_SOURCE* dst, const struct LIF_SOURCE* src,
+//uint64_t offset, uint64_t size) makes dst a source for the size bytes starting
+//offset bytes into src, such as a link file somewhere in a disk image. The
+//slice is cut short if src ends first. dst and src may be the same.
+extern void lif_source_slice(struct LIF_SOURCE* dst, const struct LIF_SOURCE* src, uint64_t offset, uint64_t size)
+{
+  if (offset > src->size)
+  {
+    offset = src->size;
+  }
+  if (size > (src->size - offset))
+  {
+    size = src->size - offset;
+  }
+  *dst = *src;
+  dst->base = src->base + offset;
+  dst->size = size;
+  if (src->mem != NULL)
+  {
+    dst->mem = src->mem + offset;
+  }
+}
+//
+//Function lif_source_read(const struct LIF_SOURCE* src, uint64_t offset,
+//uint8_t* buf, size_t len) copies up to len bytes from offset in src into buf.
+//Returns the number of bytes copied, fewer than len if src ends first (or its
+//read_at fails).
+extern size_t lif_source_read(const struct LIF_SOURCE* src, uint64_t offset, uint8_t* buf, size_t len)
+{
+  if (offset >= src->size)
+  {
+    return 0;
+  }
+  if (len > (src->size - offset))
+  {
+    len = (size_t)(src->size - offset);
+  }
+  return src->read_at(src->ctx, src->base + offset, buf, len);
+}
+//
+//Function mem_read_at() is the read_at function of a lif_source_mem() source,
+//ctx is the start of the buffer.
+size_t mem_read_at(void* ctx, uint64_t offset, uint8_t* buf, size_t len)
+{
+  memcpy(buf, (const uint8_t *)ctx + offset, len);
+  return len;
+}
+//
+//Function file_read_at() is the read_at function of a lif_source_file() source,
+//ctx is the FILE*.
+size_t file_read_at(void* ctx, uint64_t offset, uint8_t* buf, size_t len)
+{
+  return file_read((FILE *)ctx, offset, buf, len);
+}
+//
+//Function get_lif_src(const struct LIF_SOURCE* src, struct LIF* lif,
+//struct LIF_ARENA* arena, uint32_t sections) is get_lif_sect() for a link file
+//that starts at the beginning of src. A source held in memory is decoded
+//where it is. Otherwise the size of the link file is worked out from its
+//section sizes with a few small reads (see src_extent()) and then just those
+//bytes are read into memory from arena, in one go. Returns LIF_OK or a LIF_ERR
+//value, LIF_ERR_MEMORY if the arena couldn't supply the memory.
+extern int get_lif_src(const struct LIF_SOURCE* src, struct LIF* lif, struct LIF_ARENA* arena, uint32_t sections)
+{
+  uint8_t* buf;
+  uint64_t len;
+
+  if (src->mem != NULL)
+  {
+    len = (src->size < (uint64_t)SIZE_MAX) ? src->size : (uint64_t)SIZE_MAX;
+    return get_lif_sect(src->mem, (size_t)len, lif, sections);
+  }
+  len = src_extent(src);
+  //A source too short for a header still goes to get_lif_sect() to say so
+  if ((len > (uint64_t)SIZE_MAX) || ((buf = (uint8_t *)arena_get(arena, (len < 0x4C) ? 0x4C : (size_t)len)) == NULL))
+  {
+    return LIF_ERR_MEMORY;
+  }
+  return get_lif_sect(buf, lif_source_read(src, 0, buf, (size_t)len), lif, sections);
+}
+//
+//The share of a get_lif_batch() that one thread decodes
+struct LIF_BATCH
+{
+  const struct LIF_INPUT * inputs;
+  size_t                   n;
+  struct LIF *             out;
+  int *                    status;
+  uint32_t                 sections;
+  size_t                   ok;       // How many of them decoded with LIF_OK
+};
+//
+//Function get_lif_batch(const struct LIF_INPUT* inputs, size_t n,
+//struct LIF* out, int* status, uint32_t sections, int threads) decodes the n
+//link files held in memory at inputs into out[0] to out[n - 1], with the
+//get_lif_sect() result for each in status[i]. With threads > 1 the inputs are
+//shared out, in runs of neighbouring ones, between that many threads (the
+//calling thread being one of them); if a thread can't be started its share
+//is decoded by the calling thread. Threads aren't used on Windows. Returns
+//the number of link files that decoded with LIF_OK.
+extern size_t get_lif_batch(const struct LIF_INPUT* inputs, size_t n, struct LIF* out, int* status, uint32_t sections, int threads)
+{
+#ifndef _WIN32
+  pthread_t        tids[LIF_BATCH_MAXTHREADS];
+  struct LIF_BATCH part[LIF_BATCH_MAXTHREADS];
+  int              started[LIF_BATCH_MAXTHREADS];
+  size_t           first, last, ok = 0;
+  int              i;
+
+  if (threads < 1)
+  {
+    threads = 1;
+  }
+  if ((size_t)threads > n)
+  {
+    threads = (int)n;
+  }
+  if (threads > LIF_BATCH_MAXTHREADS)
+  {
+    threads = LIF_BATCH_MAXTHREADS;
+  }
+  if (threads > 1)
+  {
+    //Thread i gets inputs[first, last), thread 0 being this one
+    for (i = 0; i < threads; i++)
+    {
+      first = n * (size_t)i / (size_t)threads;
+      last = n * (size_t)(i + 1) / (size_t)threads;
+      part[i].inputs = inputs + first;
+      part[i].n = last - first;
+      part[i].out = out + first;
+      part[i].status = status + first;
+      part[i].sections = sections;
+      part[i].ok = 0;
+      started[i] = (i > 0) && (pthread_create(&tids[i], NULL, batch_thread, &part[i]) == 0);
+    }
+    for (i = 0; i < threads; i++)
+    {
+      if (!started[i])
+      {
+        batch_thread(&part[i]);
+      }
+    }
+    for (i = 0; i < threads; i++)
+    {
+      if (started[i])
+      {
+        pthread_join(tids[i], NULL);
+      }
+      ok += part[i].ok;
+    }
+    return ok;
+  }
+#else
+  (void)threads;
+#endif
+  return batch_run(inputs, n, out, status, sections);
+}
+//
+//Function batch_run() decodes n link files for get_lif_batch() and returns
+//the number that decoded with LIF_OK.
+size_t batch_run(const struct LIF_INPUT* inputs, size_t n, struct LIF* out, int* status, uint32_t sections)
+{
+  size_t i, ok = 0;
+
+  for (i = 0; i < n; i++)
+  {
+    status[i] = get_lif_sect(inputs[i].buf, inputs[i].len, &out[i], sections);
+    if (status[i] == LIF_OK)
+    {
+      ok++;
+    }
+  }
+  return ok;
+}
+#ifndef _WIN32
+//
+//Function batch_thread() is run by each of get_lif_batch()'s threads for its
+//share (a struct LIF_BATCH).
+void * batch_thread(void* arg)
+{
+  struct LIF_BATCH* part = (struct LIF_BATCH *)arg;
+
+  part->ok = batch_run(part->inputs, part->n, part->out, part->status, part->sections);
+  return NULL;
+}
+#endif
+//
+//Function src_extent(const struct LIF_SOURCE* src) returns the number of bytes
+//of src that get_lif_sect() would look at when decoding the link file at its
+//start, going by the section sizes in it. Sections are followed the way
+//get_lif_sect() finds them, damaged ones included, but never beyond the end
+//of src.
+uint64_t src_extent(const struct LIF_SOURCE* src)
+{
+  uint8_t  field[4];
+  uint64_t end = 0x4C;
+  uint32_t flags, blocksize;
+  int      i;
+
+  if (lif_source_read(src, 0x14, field, 4) != 4)
+  {
+    return (src->size < 0x4C) ? src->size : 0x4C;
+  }
+  flags = get_le_uint32(field, 0);
+  if (flags & 0x00000001) //IDList, its size field is only skipped if it isn't 0
+  {
+    if (lif_source_read(src, end, field, 2) != 2)
+    {
+      return src->size;
+    }
+    if (get_le_uint16(field, 0) > 0)
+    {
+      end += 2 + (uint64_t)get_le_uint16(field, 0);
+    }
+  }
+  if (flags & 0x00000002) //LinkInfo
+  {
+    if (lif_source_read(src, end, field, 4) != 4)
+    {
+      return src->size;
+    }
+    end += get_le_uint32(field, 0);
+  }
+  for (i = 0; i < 5; i++) //StringData
+  {
+    if (flags & (0x00000004 << i))
+    {
+      if (lif_source_read(src, end, field, 2) != 2)
+      {
+        return src->size;
+      }
+      end += 2 + (uint64_t)get_le_uint16(field, 0) * ((flags & 0x00000080) ? 2 : 1);
+    }
+  }
+  //ExtraData, as far as the terminal block or a block get_extradata() won't
+  //accept. Any last few bytes too short to be a block are included too as
+  //they are what tell get_extradata() the terminal block is missing
+  while (end < src->size)
+  {
+    if (lif_source_read(src, end, field, 4) != 4)
+    {
+      return src->size;
+    }
+    blocksize = get_le_uint32(field, 0);
+    if ((blocksize < 8) || (blocksize >= 4096))
+    {
+      end += 4;
+      break;
+    }
+    end += blocksize;
+  }
+  return (end < src->size) ? end : src->size;
+}
+//
+//Function test_link_buf(const uint8_t* buf, size_t len) does the same job as
+//test_link() for a link file that is already held in memory.
+extern int test_link_buf(const uint8_t* buf, size_t len)
+{
+  struct LIF_HDR lh;
 
-  assert(fp >= 0); //Ensure we have a live file pointer - this kills execution on failure
-  if (fp < 0)
+  if (get_lhdr(buf, len, &lh) < 0)
   {
-    return -1; //Same as the previous but won't kill execution if NDEBUG is defined
+    return -1;
   }
+  return test_lhdr(&lh);
+}
+//
+//Function test_lhdr(struct LIF_HDR *lh) checks the magic values in a decoded
+//header. Returns 0 if they are correct for a link file otherwise:
+//-1 HeaderSize, -2 to -7 CLSID, -8 to -10 Reserved fields.
+int test_lhdr(struct LIF_HDR *lh)
+{
+  int i;
 
-  get_lhdr(fp, &lif);
   //Check the value of HeaderSize
-  if (lif.lh.H_size != 0x0000004C)
+  if (lh->H_size != 0x0000004C)
     return -1;
   //Check the CLSID
-  if (lif.lh.CLSID.Data1 != 0x00021401)
+  if (lh->CLSID.Data1 != 0x00021401)
     return -2;
-  if (lif.lh.CLSID.Data2 != 0x0000)
+  if (lh->CLSID.Data2 != 0x0000)
     return -3;
-  if (lif.lh.CLSID.Data3 != 0x0000)
+  if (lh->CLSID.Data3 != 0x0000)
     return -4;
-  if (!((lif.lh.CLSID.Data4hi[0] == 0xC0) && (lif.lh.CLSID.Data4hi[1] == 0)))
+  if (!((lh->CLSID.Data4hi[0] == 0xC0) && (lh->CLSID.Data4hi[1] == 0)))
     return -5;
   for (i = 0; i < 5; i++)
   {
-    if (lif.lh.CLSID.Data4lo[i] != 0)
+    if (lh->CLSID.Data4lo[i] != 0)
     {
       return -6;
     }
   }
-  if (lif.lh.CLSID.Data4lo[5] != 0x46)
+  if (lh->CLSID.Data4lo[5] != 0x46)
     return -7;
   //Now check that the reserved data areas are 0 (as specified in MS-SHLLINK)
-  if (lif.lh.Reserved1 != 0x0000)
+  if (lh->Reserved1 != 0x0000)
     return -8;
-  if (lif.lh.Reserved2 != 0x00000000)
+  if (lh->Reserved2 != 0x00000000)
     return -9;
-  if (lif.lh.Reserved3 != 0x00000000)
+  if (lh->Reserved3 != 0x00000000)
     return -10;
   return 0;
 }
+//
+//Function lhdr_err(int result) turns a test_lhdr() result into a LIF_ERR value
+int lhdr_err(int result)
+{
+  if (result == -1)
+  {
+    return LIF_ERR_HSIZE;
+  }
+  else if (result < -7)
+  {
+    return LIF_ERR_RESERVED;
+  }
+  else if (result < 0)
+  {
+    return LIF_ERR_CLSID;
+  }
+  return LIF_OK;
+}
 
 //EXPERIMENTAL!!
 //Function: find_propstore(unsigned char * data_buf, int size, struct LIF_PROPERTY_STORE_PROPS * psp)
@@ -193,102 +850,255 @@ extern int test_link(FILE* fp)
 //          LIF_SER_PROPSTORE is in psp->Posn.
 extern int find_propstores(unsigned char * data_buf, int size, int position, struct LIF_PROPERTY_STORE_PROPS * psp)
 {
-  int i, j, k, p, vp, posn;
+  static const uint8_t version[4] = { 0x31, 0x53, 0x50, 0x53 }; // '1SPS'
+  int i, j;
+  size_t k, p, vp, posn, len;
 
-  for (k = 4; k < (size - 23); k++) // No point looking for Version sig prior to posn 4 or 
-                                    // in last 23 bytes (length of which is determined from: 0 size Property Value [4 bytes]
-                                    // + FormatID GUID [16 bytes] + the 3 bytes remaining in the Version signature).
+  // No point looking for Version sig prior to posn 4 or in last 23 bytes
+  // (length of which is determined from: 0 size Property Value [4 bytes]
+  // + FormatID GUID [16 bytes] + the 3 bytes remaining in the Version signature).
+  if ((size < 28) || (lif_scan(data_buf, (size_t)size - 20, version, sizeof(version), 4, &k, 1) == 0))
+  {
+    return -1;
+  }
+  // Version signature found. Nothing is read from beyond the len bytes of data_buf
+  len = (size_t)size;
+  posn = k - 4; // The location of the first LIF_PROPERTY_STORE_PROPS
+                     // This is constructed data for the most part as LIF_PROPERTY_STORE_PROPS 
+                     // does not exist in an ITemID but it is used here because it is useful to
+                     // draw together a series of LIF_SER_PROPSTORE objects.
+  psp->Posn = (uint16_t)(posn + position);
+  psp->Size = 4; // The size of the last (uncounted) property store
+  psp->sig = 0; // This is not needed here
+  psp->NumStores = 0;
+  for (i = 0; i < PROPSTORES; i++) // Cycle through all the valid property stores
   {
-    if (data_buf[k] == 0x31)
+    psp->Stores[i].NumValues = 0;
+    if (!span_ok(len, posn, 24)) // No room for a property store header
     {
-      if (data_buf[k + 1] == 0x53)
+      break;
+    }
+    psp->Stores[i].StorageSize = get_le_uint32(data_buf, (int)posn);
+    psp->Size += psp->Stores[i].StorageSize; // Keep a running total
+    if (psp->Stores[i].StorageSize == 0) // An empty property store
+    {
+      break;
+    }
+    p = posn + 4;
+    psp->Stores[i].Version = get_le_uint32(data_buf, (int)p);
+    p += 4;
+    psp->Stores[i].FormatID.Data1 = get_le_uint32(data_buf, (int)p);
+    p += 4;
+    psp->Stores[i].FormatID.Data2 = get_le_uint16(data_buf, (int)p);
+    p += 2;
+    psp->Stores[i].FormatID.Data3 = get_le_uint16(data_buf, (int)p);
+    p += 2;
+    get_chars(data_buf, (int)p, 2, psp->Stores[i].FormatID.Data4hi);
+    p += 2;
+    get_chars(data_buf, (int)p, 6, psp->Stores[i].FormatID.Data4lo);
+    p += 6;
+    if ((psp->Stores[i].FormatID.Data1 == 0xD5CDD505) &&
+      (psp->Stores[i].FormatID.Data2 == 0x2E9C) &&
+      (psp->Stores[i].FormatID.Data3 == 0x101B) &&
+      (psp->Stores[i].FormatID.Data4hi[0] == 0x93) &&
+      (psp->Stores[i].FormatID.Data4hi[1] == 0x97) &&
+      (psp->Stores[i].FormatID.Data4hi[0] == 0x08) &&
+      (psp->Stores[i].FormatID.Data4hi[1] == 0x00) &&
+      (psp->Stores[i].FormatID.Data4hi[2] == 0x2B) &&
+      (psp->Stores[i].FormatID.Data4hi[3] == 0x2C) &&
+      (psp->Stores[i].FormatID.Data4hi[4] == 0xF9) &&
+      (psp->Stores[i].FormatID.Data4hi[5] == 0xAE)
+      )
+    {
+      psp->Stores[i].NameType = 0x00;
+    }
+    else
+    {
+      psp->Stores[i].NameType = 0xFF;
+    }
+    for (j = 0; j < PROPVALUES; j++) // Cycle through all the valid property values
+    {
+      vp = p; // Save the position of the start of this value
+      if (!span_ok(len, vp, 4))
       {
-        if (data_buf[k + 2] == 0x50)
-        {
-          if (data_buf[k + 3] == 0x53)
-          {
-            // Version signature found
-            posn = k - 4; // The location of the first LIF_PROPERTY_STORE_PROPS
-                         // This is constructed data for the most part as LIF_PROPERTY_STORE_PROPS 
-                         // does not exist in an ITemID but it is used here because it is useful to
-                         // draw together a series of LIF_SER_PROPSTORE objects.
-            psp->Posn = posn + position;
-            psp->Size = 4; // The size of the last (uncounted) property store
-            psp->sig = 0; // This is not needed here
-            psp->NumStores = 0;
-            for (i = 0; i < PROPSTORES; i++) // Cycle through all the valid property stores
-            {
-              psp->Stores[i].NumValues = 0;
-              psp->Stores[i].StorageSize = get_le_uint32(data_buf, posn);
-              psp->Size += psp->Stores[i].StorageSize; // Keep a running total
-              if (psp->Stores[i].StorageSize == 0) // An empty property store
-              {
-                break;
-              }
-              p = posn + 4;
-              psp->Stores[i].Version = get_le_uint32(data_buf, p);
-              p += 4;
-              psp->Stores[i].FormatID.Data1 = get_le_uint32(data_buf, p);
-              p += 4;
-              psp->Stores[i].FormatID.Data2 = get_le_uint16(data_buf, p);
-              p += 2;
-              psp->Stores[i].FormatID.Data3 = get_le_uint16(data_buf, p);
-              p += 2;
-              get_chars(data_buf, p, 2, psp->Stores[i].FormatID.Data4hi);
-              p += 2;
-              get_chars(data_buf, p, 6, psp->Stores[i].FormatID.Data4lo);
-              p += 6;
-              if ((psp->Stores[i].FormatID.Data1 == 0xD5CDD505) &&
-                (psp->Stores[i].FormatID.Data2 == 0x2E9C) &&
-                (psp->Stores[i].FormatID.Data3 == 0x101B) &&
-                (psp->Stores[i].FormatID.Data4hi[0] == 0x93) &&
-                (psp->Stores[i].FormatID.Data4hi[1] == 0x97) &&
-                (psp->Stores[i].FormatID.Data4hi[0] == 0x08) &&
-                (psp->Stores[i].FormatID.Data4hi[1] == 0x00) &&
-                (psp->Stores[i].FormatID.Data4hi[2] == 0x2B) &&
-                (psp->Stores[i].FormatID.Data4hi[3] == 0x2C) &&
-                (psp->Stores[i].FormatID.Data4hi[4] == 0xF9) &&
-                (psp->Stores[i].FormatID.Data4hi[5] == 0xAE)
-                )
-              {
-                psp->Stores[i].NameType = 0x00;
-              }
-              else
-              {
-                psp->Stores[i].NameType = 0xFF;
-              }
-              for (j = 0; j < PROPVALUES; j++) // Cycle through all the valid property values
-              {
-                vp = p; // Save the position of the start of this value
-                psp->Stores[i].PropValues[j].ValueSize = get_le_uint32(data_buf, vp);
-                p += (int)psp->Stores[i].PropValues[j].ValueSize;// Move p to the next value store
-                if (psp->Stores[i].PropValues[j].ValueSize == 0)
-                {
-                  psp->Stores[i].NumValues++; // Unlike a Property Store, an empty Value Store is counted
-                  break;
-                }
-                psp->Stores[i].PropValues[j].NameSizeOrID = get_le_uint32(data_buf, vp + 4);
-                psp->Stores[i].PropValues[j].Reserved = (uint8_t)data_buf[vp + 8];
-                if (psp->Stores[i].NameType == 0)
-                {
-                  get_chars(data_buf, vp + 9, psp->Stores[i].PropValues[j].NameSizeOrID, psp->Stores[i].PropValues[j].Name);
-                  vp += psp->Stores[i].PropValues[j].NameSizeOrID; // In the Case of a name type, offset the value pointer
-                }
-                psp->Stores[i].PropValues[j].PropertyType = get_le_uint16(data_buf, vp + 9);
-                psp->Stores[i].PropValues[j].Padding = get_le_uint16(data_buf, vp + 11);
-                get_chars(data_buf, vp + 13, (psp->Stores[i].PropValues[j].ValueSize), psp->Stores[i].PropValues[j].Value);
-                psp->Stores[i].NumValues++;
-              }
-              posn += psp->Stores[i].StorageSize; // Move to the next propertystore
-              psp->NumStores++;
-            } //Cycle through the Propstores
-            return 0;
-          }
+        break;
+      }
+      psp->Stores[i].PropValues[j].ValueSize = get_le_uint32(data_buf, (int)vp);
+      p += psp->Stores[i].PropValues[j].ValueSize;// Move p to the next value store
+      if (psp->Stores[i].PropValues[j].ValueSize == 0)
+      {
+        psp->Stores[i].NumValues++; // Unlike a Property Store, an empty Value Store is counted
+        break;
+      }
+      if (!span_ok(len, vp, 13))
+      {
+        break;
+      }
+      psp->Stores[i].PropValues[j].NameSizeOrID = get_le_uint32(data_buf, (int)vp + 4);
+      psp->Stores[i].PropValues[j].Reserved = (uint8_t)data_buf[vp + 8];
+      if (psp->Stores[i].NameType == 0)
+      {
+        get_bytes(data_buf, len, vp + 9,
+          (psp->Stores[i].PropValues[j].NameSizeOrID < 300) ? psp->Stores[i].PropValues[j].NameSizeOrID : 300,
+          psp->Stores[i].PropValues[j].Name);
+        vp += psp->Stores[i].PropValues[j].NameSizeOrID; // In the Case of a name type, offset the value pointer
+        if (!span_ok(len, vp, 13))
+        {
+          break;
+        }
+      }
+      psp->Stores[i].PropValues[j].PropertyType = get_le_uint16(data_buf, (int)vp + 9);
+      psp->Stores[i].PropValues[j].Padding = get_le_uint16(data_buf, (int)vp + 11);
+      get_bytes(data_buf, len, vp + 13,
+        (psp->Stores[i].PropValues[j].ValueSize < 400) ? psp->Stores[i].PropValues[j].ValueSize : 400,
+        psp->Stores[i].PropValues[j].Value);
+      psp->Stores[i].NumValues++;
+    }
+    posn += psp->Stores[i].StorageSize; // Move to the next propertystore
+    psp->NumStores++;
+  } //Cycle through the Propstores
+  return 0;
+}
+
+//
+//Function: lif_scan() finds the signature sig (siglen bytes) in the first
+//          len bytes of buf, starting from start. The offset of each match is
+//          put in offs, in order, until max of them have been found. Returns
+//          the number found. If that is max there may be more, so call it
+//          again from one past the last of them.
+//          Candidates are found a block at a time by comparing the first and
+//          last bytes of the signature at once (with AVX2 or SSE2 where the
+//          processor allows it, otherwise memchr()) so that it runs at about
+//          the speed memory can be read, whatever is being scanned.
+extern size_t lif_scan(const uint8_t* buf, size_t len, const uint8_t* sig, size_t siglen, size_t start, size_t* offs, size_t max)
+{
+  size_t i = start, found = 0, end;
+  const uint8_t* p;
+  unsigned int mask;
+#ifdef __AVX2__
+  __m256i first32, last32, hit32;
+#endif
+#ifdef LIF_SSE2
+  __m128i first16, last16, hit;
+#endif
+
+  if ((siglen == 0) || (max == 0) || (len < siglen) || (start > len - siglen))
+  {
+    return 0;
+  }
+  end = len - siglen + 1; // One past the last place a match can start
+#ifdef __AVX2__
+  first32 = _mm256_set1_epi8((char)sig[0]);
+  last32 = _mm256_set1_epi8((char)sig[siglen - 1]);
+#endif
+#ifdef LIF_SSE2
+  first16 = _mm_set1_epi8((char)sig[0]);
+  last16 = _mm_set1_epi8((char)sig[siglen - 1]);
+#endif
+#ifdef __AVX2__
+  while (i + 32 <= end)
+  {
+    hit32 = _mm256_and_si256(
+      _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(buf + i)), first32),
+      _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(buf + i + siglen - 1)), last32));
+    for (mask = (unsigned int)_mm256_movemask_epi8(hit32); mask != 0; mask &= mask - 1)
+    {
+      p = buf + i + low_bit(mask);
+      if (sig_match(p, sig, siglen))
+      {
+        offs[found++] = (size_t)(p - buf);
+        if (found == max)
+        {
+          return found;
+        }
+      }
+    }
+    i += 32;
+  }
+#endif
+#ifdef LIF_SSE2
+  while (i + 16 <= end)
+  {
+    hit = _mm_and_si128(
+      _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buf + i)), first16),
+      _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buf + i + siglen - 1)), last16));
+    for (mask = (unsigned int)_mm_movemask_epi8(hit); mask != 0; mask &= mask - 1)
+    {
+      p = buf + i + low_bit(mask);
+      if (sig_match(p, sig, siglen))
+      {
+        offs[found++] = (size_t)(p - buf);
+        if (found == max)
+        {
+          return found;
         }
       }
     }
+    i += 16;
+  }
+#endif
+  while ((i < end) && ((p = (const uint8_t*)memchr(buf + i, sig[0], end - i)) != NULL))
+  {
+    if (sig_match(p, sig, siglen))
+    {
+      offs[found++] = (size_t)(p - buf);
+      if (found == max)
+      {
+        return found;
+      }
+    }
+    i = (size_t)(p - buf) + 1;
+  }
+  return found;
+}
+
+//
+//Function: sig_match() returns 1 if the n bytes at p are the signature sig or
+//          0 if not. Signatures of 16 bytes or more are compared 16 bytes at
+//          a time where the processor allows it.
+int sig_match(const uint8_t* p, const uint8_t* sig, size_t n)
+{
+#ifdef LIF_SSE2
+  size_t i;
+
+  if (n >= 16)
+  {
+    //The last block overlaps the one before it unless n is a multiple of 16
+    for (i = 0; i < n; i += 16)
+    {
+      if (i + 16 > n)
+      {
+        i = n - 16;
+      }
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i)),
+        _mm_loadu_si128((const __m128i*)(sig + i)))) != 0xFFFF)
+      {
+        return 0;
+      }
+    }
+    return 1;
+  }
+#endif
+  return (memcmp(p, sig, n) == 0);
+}
+
+//
+//Function: low_bit() returns the number of the lowest bit set in mask (which
+//          must not be 0).
+size_t low_bit(unsigned int mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (size_t)__builtin_ctz(mask);
+#else
+  size_t n = 0;
+
+  while ((mask & 1) == 0)
+  {
+    mask >>= 1;
+    n++;
   }
-  return -1;
+  return n;
+#endif
 }
 
 //THIS FUNCTION IS EXPERIMENTAL!!!
@@ -326,7 +1136,7 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
   snprintf((char *)psa->StorageSize, 12, "%"PRIu32, ps->StorageSize);
   snprintf((char *)psa->Version, 12, "0x%.8"PRIX32, ps->Version);
   get_droid_a(&ps->FormatID, &psa->FormatID);
-  if (ps->NameType.ValueSize==0)
+  if (ps->NameType == 0)
   {
     snprintf((char *)psa->NameType, 13, "String Name");
   }
@@ -404,7 +1214,7 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
         break;
       case VT_BSTR:
         strcat((char *)psa->PropValues[j].PropertyType, " VT_BSTR");
-        len = get_le_uint32(ps->PropValues[j].Value, 0);
+        len = prop_strlen(ps->PropValues[j].Value, (int)sizeof(lp_buf));
         get_chars(ps->PropValues[j].Value, 4, len, (unsigned char *)lp_buf);
         if ((lp_buf[len - 1] == 0) && (lp_buf[len - 2] == 0)) // Is it unicode (2 byte string terminator)?
         {
@@ -413,7 +1223,7 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
         }
         else // Must be ANSI
         {
-          snprintf((char *)psa->PropValues[j].Value, len, "%s", lp_buf);
+          snprintf((char *)psa->PropValues[j].Value, len, "%.*s", len, lp_buf);
         }
         break;
       case VT_ERROR:  // Not tested
@@ -496,7 +1306,7 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
         break;
       case VT_LPSTR:  // Because the definition is CodePageString this could be Unicode
         strcat((char *)psa->PropValues[j].PropertyType, " VT_LPSTR");
-        len = get_le_uint32(ps->PropValues[j].Value, 0);
+        len = prop_strlen(ps->PropValues[j].Value, (int)sizeof(lp_buf));
         get_chars(ps->PropValues[j].Value, 4, len, (unsigned char *)lp_buf);
         if ((lp_buf[len - 1] == 0) && (lp_buf[len - 2] == 0)) // Is it unicode (2 byte string terminator)?
         {
@@ -505,12 +1315,12 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
         }
         else // Must be ANSI
         {
-          snprintf((char *)psa->PropValues[j].Value, len, "%s", lp_buf);
+          snprintf((char *)psa->PropValues[j].Value, len, "%.*s", len, lp_buf);
         }
         break;
       case VT_LPWSTR: // Always Unicode
         strcat((char *)psa->PropValues[j].PropertyType, " VT_LPWSTR");
-        len = get_le_uint32(ps->PropValues[j].Value, 0);
+        len = prop_strlen(ps->PropValues[j].Value, (int)(sizeof(ps->PropValues[j].Value) - 4) / 2);
         get_le_unistr(ps->PropValues[j].Value, 4, len, lpw_buf);
         snprintf((char *)psa->PropValues[j].Value, len, "%ls", lpw_buf);
         break;
@@ -526,7 +1336,7 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
         break;
       case VT_STREAM: //Not Tested
         strcat((char *)psa->PropValues[j].PropertyType, " VT_STREAM");
-        len = get_le_uint32(ps->PropValues[j].Value, 0);
+        len = prop_strlen(ps->PropValues[j].Value, (int)sizeof(lp_buf));
         get_chars(ps->PropValues[j].Value, 4, len, (unsigned char *)lp_buf);
         if ((lp_buf[len - 1] == 0) && (lp_buf[len - 2] == 0)) // Is it unicode (2 byte string terminator)?
         {
@@ -535,12 +1345,12 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
         }
         else // Must be ANSI
         {
-          snprintf((char *)psa->PropValues[j].Value, len, "%s", lp_buf);
+          snprintf((char *)psa->PropValues[j].Value, len, "%.*s", len, lp_buf);
         }
         break;
       case VT_STORAGE: //Not Tested
         strcat((char *)psa->PropValues[j].PropertyType, " VT_STORAGE");
-        len = get_le_uint32(ps->PropValues[j].Value, 0);
+        len = prop_strlen(ps->PropValues[j].Value, (int)sizeof(lp_buf));
         get_chars(ps->PropValues[j].Value, 4, len, (unsigned char *)lp_buf);
         if ((lp_buf[len - 1] == 0) && (lp_buf[len - 2] == 0)) // Is it unicode (2 byte string terminator)?
         {
@@ -549,12 +1359,12 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
         }
         else // Must be ANSI
         {
-          snprintf((char *)psa->PropValues[j].Value, len, "%s", lp_buf);
+          snprintf((char *)psa->PropValues[j].Value, len, "%.*s", len, lp_buf);
         }
         break;
       case VT_STREAMED_OBJECT: //Not Tested
         strcat((char *)psa->PropValues[j].PropertyType, " VT_STREAMED_OBJECT");
-        len = get_le_uint32(ps->PropValues[j].Value, 0);
+        len = prop_strlen(ps->PropValues[j].Value, (int)sizeof(lp_buf));
         get_chars(ps->PropValues[j].Value, 4, len, (unsigned char *)lp_buf);
         if ((lp_buf[len - 1] == 0) && (lp_buf[len - 2] == 0)) // Is it unicode (2 byte string terminator)?
         {
@@ -563,12 +1373,12 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
         }
         else // Must be ANSI
         {
-          snprintf((char *)psa->PropValues[j].Value, len, "%s", lp_buf);
+          snprintf((char *)psa->PropValues[j].Value, len, "%.*s", len, lp_buf);
         }
         break;
       case VT_STORED_OBJECT: //Not Tested
         strcat((char *)psa->PropValues[j].PropertyType, " VT_STORED_OBJECT");
-        len = get_le_uint32(ps->PropValues[j].Value, 0);
+        len = prop_strlen(ps->PropValues[j].Value, (int)sizeof(lp_buf));
         get_chars(ps->PropValues[j].Value, 4, len, (unsigned char *)lp_buf);
         if ((lp_buf[len - 1] == 0) && (lp_buf[len - 2] == 0)) // Is it unicode (2 byte string terminator)?
         {
@@ -577,7 +1387,7 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
         }
         else // Must be ANSI
         {
-          snprintf((char *)psa->PropValues[j].Value, len, "%s", lp_buf);
+          snprintf((char *)psa->PropValues[j].Value, len, "%.*s", len, lp_buf);
         }
         break;
       case VT_BLOB_OBJECT: //Not Tested
@@ -603,7 +1413,7 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
         break;
       case VT_VERSIONED_STREAM: //Not Tested
         strcat((char *)psa->PropValues[j].PropertyType, " VT_VERSIONED_STREAM");
-        len = get_le_uint32(ps->PropValues[j].Value, 0);
+        len = prop_strlen(ps->PropValues[j].Value, (int)sizeof(lp_buf));
         get_chars(ps->PropValues[j].Value, 4, len, (unsigned char *)lp_buf);
         if ((lp_buf[len - 1] == 0) && (lp_buf[len - 2] == 0)) // Is it unicode (2 byte string terminator)?
         {
@@ -612,7 +1422,7 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
         }
         else // Must be ANSI
         {
-          snprintf((char *)psa->PropValues[j].Value, len, "%s", lp_buf);
+          snprintf((char *)psa->PropValues[j].Value, len, "%.*s", len, lp_buf);
         }
         break;
       default:
@@ -640,56 +1450,36 @@ extern int get_propstore_a(struct LIF_SER_PROPSTORE * ps, struct LIF_SER_PROPSTO
   return 0;
 }
 //
-//Function get_lhdr(FILE *fp, struct LIF_HDR *lh) takes an open file pointer
-//and a pointer to a LIF_HDR structure.
-//On exit the LIF_HDR will be populated.
-int get_lhdr(FILE *fp, struct LIF *lif)
+//Function get_lhdr(const unsigned char *buf, size_t len, struct LIF_HDR *lh)
+//takes a buffer holding (at least) the 76 byte header and a pointer to a
+//LIF_HDR. On exit the LIF_HDR will be populated.
+int get_lhdr(const unsigned char *buf, size_t len, struct LIF_HDR *lh)
 {
-  unsigned char header[0x4C];
-  int chr;
-  int i;
+  const unsigned char * header = buf;
 
-
-  assert(fp >= 0); //Ensure we have a live file pointer - this kills execution
-  if (fp < 0)
+  if (len < 0x4C) //Too short to hold a header
   {
-    return -1; //Same as the previous but won't kill execution if NDEBUG defined
+    return -1;
   }
-
-  rewind(fp);
-  //I'd love to use 'read()' here but I'm trying to avoid using unistd.h
-  //because I want the library to compile under Windoze
-  for (i = 0; i < 0x4C; i++)
-  {
-    chr = getc(fp);
-    if (chr != EOF)
-    {
-      header[i] = (unsigned char)chr;
-    }
-    else
-    {
-      perror("Error in function get_lhdr()");
-    }
-  }
-  lif->lh.H_size = get_le_uint32(header, 0);
-  lif->lh.CLSID.Data1 = get_le_uint32(header, 4);
-  lif->lh.CLSID.Data2 = get_le_uint16(header, 8);
-  lif->lh.CLSID.Data3 = get_le_uint16(header, 10);
-  get_chars(header, 12, 2, lif->lh.CLSID.Data4hi);
-  get_chars(header, 14, 6, lif->lh.CLSID.Data4lo);
-  lif->lh.Flags = get_le_uint32(header, 20);
-  lif->lh.Attr = get_le_uint32(header, 24);
-  lif->lh.CrDate = get_le_uint64(header, 28);
-  lif->lh.AcDate = get_le_uint64(header, 36);
-  lif->lh.WtDate = get_le_uint64(header, 44);
-  lif->lh.Size = get_le_uint32(header, 52);
-  lif->lh.IconIndex = get_le_int32(header, 56);
-  lif->lh.ShowState = get_le_uint32(header, 60);
-  lif->lh.Hotkey.LowKey = header[64];
-  lif->lh.Hotkey.HighKey = header[65];
-  lif->lh.Reserved1 = get_le_uint16(header, 66);
-  lif->lh.Reserved2 = get_le_uint32(header, 68);
-  lif->lh.Reserved3 = get_le_uint32(header, 72);
+  lh->H_size = get_le_uint32(header, 0);
+  lh->CLSID.Data1 = get_le_uint32(header, 4);
+  lh->CLSID.Data2 = get_le_uint16(header, 8);
+  lh->CLSID.Data3 = get_le_uint16(header, 10);
+  get_chars(header, 12, 2, lh->CLSID.Data4hi);
+  get_chars(header, 14, 6, lh->CLSID.Data4lo);
+  lh->Flags = get_le_uint32(header, 20);
+  lh->Attr = get_le_uint32(header, 24);
+  lh->CrDate = get_le_uint64(header, 28);
+  lh->AcDate = get_le_uint64(header, 36);
+  lh->WtDate = get_le_uint64(header, 44);
+  lh->Size = get_le_uint32(header, 52);
+  lh->IconIndex = get_le_int32(header, 56);
+  lh->ShowState = get_le_uint32(header, 60);
+  lh->Hotkey.LowKey = header[64];
+  lh->Hotkey.HighKey = header[65];
+  lh->Reserved1 = get_le_uint16(header, 66);
+  lh->Reserved2 = get_le_uint32(header, 68);
+  lh->Reserved3 = get_le_uint32(header, 72);
   return 0;
 }
 //
@@ -802,38 +1592,42 @@ int get_lhdr_a(struct LIF_HDR* lh, struct LIF_HDR_A* lha)
 }
 //
 // Function 'get_idlist()' fills a LIF_IDLIST structure with data from the
-// opened file fp
-int get_idlist(FILE * fp, int size, int loc, struct LIF * lif)
+// link file held in buf (len bytes long). loc is the offset of the IDList.
+int get_idlist(const unsigned char * buf, size_t len, size_t loc, struct LIF * lif)
 {
-  unsigned char   size_buf[2];   //A small buffer to hold the size element
-  int             numItems = 0, posn = loc + 2, i, datasize;
+  int             numItems = 0;
+  size_t          posn = loc + 2, end;
 
   if (lif->lh.Flags & 0x00000001)
   {
-    fseek(fp, loc, SEEK_SET);
-    size_buf[0] = getc(fp);
-    size_buf[1] = getc(fp);
-    lif->lidl.IDListSize = get_le_uint16(size_buf, 0);
+    if (len < (loc + 2))
+    {
+      return -1;
+    }
+    lif->lidl.IDListSize = get_le_uint16(buf, (int)loc);
+    lif->lidl.NumItemIDs = 0;
     if (lif->lidl.IDListSize > 0)
     {
+      end = loc + 2 + lif->lidl.IDListSize;
+      if (end > len)
+      {
+        lif->damage |= LIF_DMG_IDLIST;
+      }
       //posn points to the first ItemID relative to the start of TargetIDList
-      while (posn < (loc + 2 + lif->lidl.IDListSize))
+      while ((posn < end) && (posn + 2 <= len) && (numItems < ITEMIDS))
       {
-        fseek(fp, posn, SEEK_SET);
-        size_buf[0] = getc(fp);
-        size_buf[1] = getc(fp);
-        lif->lidl.Items[numItems].ItemIDSize = get_le_uint16(size_buf, 0);
-        datasize = lif->lidl.Items[numItems].ItemIDSize - 2;
+        lif->lidl.Items[numItems].ItemIDSize = get_le_uint16(buf, (int)posn);
         if (lif->lidl.Items[numItems].ItemIDSize == 0)
         {
           break;
         }
-        else
+        //Data holds the ItemID bytes that follow the size element (an ItemID
+        //that claims to run past the end of the IDList is cut short there)
+        if (lif->sections & LIF_SECT_IDLIST)
         {
-          for (i = 0; (i < datasize + 2) && (i <= MAXITEMIDSIZE); i++)
-          {
-            lif->lidl.Items[numItems].Data[i] = getc(fp);
-          }
+          get_bytes(buf, (end < len) ? end : len, posn + 2,
+            (lif->lidl.Items[numItems].ItemIDSize < MAXITEMIDSIZE) ? lif->lidl.Items[numItems].ItemIDSize : MAXITEMIDSIZE,
+            lif->lidl.Items[numItems].Data);
         }
         posn = posn + lif->lidl.Items[numItems].ItemIDSize;
         numItems++;
@@ -851,7 +1645,7 @@ int get_idlist(FILE * fp, int size, int loc, struct LIF * lif)
 }
 //
 // Converts the data in a LIF_IDLIST into its ASCII representation
-int get_idlist_a(struct LIF_IDLIST * lidl, struct LIF_IDLIST_A * lidla)
+int get_idlist_a(struct LIF_IDLIST * lidl, struct LIF_IDLIST_A * lidla, uint32_t sections)
 {
   int  i;
 
@@ -865,7 +1659,7 @@ int get_idlist_a(struct LIF_IDLIST * lidl, struct LIF_IDLIST_A * lidla)
     snprintf((char *)lidla->IDListSize, 10, "[N/A]");
     snprintf((char *)lidla->NumItemIDs, 10, "[N/A]");
   }
-  for (i = 0; i < lidl->NumItemIDs; i++)
+  for (i = 0; (sections & LIF_SECT_IDLIST) && (i < lidl->NumItemIDs); i++)
   {
     snprintf((char *)lidla->Items[i].ItemIDSize, 10, "%"PRIu16, lidl->Items[i].ItemIDSize);
   }
@@ -876,35 +1670,32 @@ int get_idlist_a(struct LIF_IDLIST * lidl, struct LIF_IDLIST_A * lidla)
 // Fills a LIF_INFO structure with data
 // This includes filling the VolID and CNR structures (a lot of data, hence the
 // big function)
-int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
+int get_linkinfo(const unsigned char * buf, size_t len, size_t pos, struct LIF * lif)
 {
-  unsigned char      size_buf[4];   //A small buffer to hold the size element
-  unsigned char *    data_buf;
-  unsigned int       i;
-  //uint16_t  u16;
+  const unsigned char * data_buf;
+  size_t                data_size, off;
 
   if (lif->lh.Flags & 0x00000002) //There is a LinkInfo structure
   {
-    if (size < (pos + 4)) // There is something wrong because the size of the
+    if (len < (pos + 4)) // There is something wrong because the size of the
       // file is less than the current position
       // (just a sanity check)
     {
       return -1;
     }
-    fseek(fp, pos, SEEK_SET);
-    for (i = 0; i < 4; i++) // Get the initial size
+    lif->li.Size = get_le_uint32(buf, (int)pos);
+    // data_buf is a view of the LinkInfo structure (less the size element)
+    // inside the file buffer. Every read from it is checked against data_size
+    // which is the smaller of the LinkInfo size and the bytes left in the file.
+    if ((lif->li.Size < 0x20) || (!span_ok(len, pos + 4, 0x1C)))
     {
-      size_buf[i] = getc(fp);
+      return -1;
     }
-    lif->li.Size = get_le_uint32(size_buf, 0);
-    // The general idea here is to fill a temporary buffer with the characters
-    // (rather than read the data directly) I then have control over reading the
-    // data from the buffer as little/big endian or ANSI vs Unicode too.
-    data_buf = (unsigned char*)malloc((size_t)(lif->li.Size - 4));
-    assert(data_buf != NULL);
-    for (i = 0; i < (lif->li.Size - 4); i++)
+    data_buf = &buf[pos + 4];
+    data_size = len - (pos + 4);
+    if (data_size > (size_t)(lif->li.Size - 4))
     {
-      data_buf[i] = getc(fp);
+      data_size = (size_t)(lif->li.Size - 4);
     }
     lif->li.HeaderSize = get_le_uint32(data_buf, 0);
     lif->li.Flags = get_le_uint32(data_buf, 4);
@@ -912,7 +1703,7 @@ int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
     lif->li.LBPOffset = get_le_uint32(data_buf, 12);
     lif->li.CNRLOffset = get_le_uint32(data_buf, 16);
     lif->li.CPSOffset = get_le_uint32(data_buf, 20);
-    if (lif->li.HeaderSize >= 0x00000024)
+    if ((lif->li.HeaderSize >= 0x00000024) && span_ok(data_size, 24, 8))
     {
       lif->li.LBPOffsetU = get_le_uint32(data_buf, 24);
       lif->li.CPSOffsetU = get_le_uint32(data_buf, 28);
@@ -922,16 +1713,18 @@ int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
       lif->li.LBPOffsetU = 0;
       lif->li.CPSOffsetU = 0;
     }
-    if (lif->li.Flags & 0x00000001) //There is a Volume ID structure
+    //IDOffset is from start of LinkInfo but our buffer starts at pos 4
+    if ((lif->li.Flags & 0x00000001) && (lif->li.IDOffset >= 4) &&
+      span_ok(data_size, (size_t)lif->li.IDOffset - 4, 16)) //There is a Volume ID structure
     {
-      //IDOffset is from start of LinkInfo but our buffer starts at pos 4
-      lif->li.VolID.Size = get_le_uint32(data_buf, ((lif->li.IDOffset) - 4));
+      off = (size_t)lif->li.IDOffset - 4;
+      lif->li.VolID.Size = get_le_uint32(data_buf, (int)off);
 
-      lif->li.VolID.DriveType = get_le_uint32(data_buf, ((lif->li.IDOffset) - 4) + 4);
+      lif->li.VolID.DriveType = get_le_uint32(data_buf, (int)off + 4);
 
-      lif->li.VolID.DriveSN = get_le_uint32(data_buf, ((lif->li.IDOffset) - 4) + 8);
+      lif->li.VolID.DriveSN = get_le_uint32(data_buf, (int)off + 8);
 
-      lif->li.VolID.VLOffset = get_le_uint32(data_buf, ((lif->li.IDOffset) - 4) + 12);
+      lif->li.VolID.VLOffset = get_le_uint32(data_buf, (int)off + 12);
 
       //Is the volume label ANSI or Unicode?
       //There are two ways to work this out...
@@ -939,7 +1732,7 @@ int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
       //2) lif->li.VolID.VLOffset != 0x00000014 = ANSI  (MSSHLLINK Sec 2.3.1)
       if (lif->li.HeaderSize < 0x00000024) //ANSI
       {
-        snprintf((char *)lif->li.VolID.VolumeLabel, 33, "%s", &data_buf[(lif->li.VolID.VLOffset) + ((lif->li.IDOffset) - 4)]);
+        get_cstr(data_buf, data_size, off + lif->li.VolID.VLOffset, 33, lif->li.VolID.VolumeLabel);
 
         if (strlen((char *)lif->li.VolID.VolumeLabel) == 0)
         {
@@ -951,8 +1744,18 @@ int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
       }
       else //Unicode
       {
-        //Fetch the unicode string
-        get_le_unistr(data_buf, ((lif->li.VolID.VLOffsetU) + ((lif->li.IDOffset) - 4)), 33, lif->li.VolID.VolumeLabelU);
+        //VolumeLabelOffsetUnicode only exists if VolumeLabelOffset is 0x14
+        if ((lif->li.VolID.VLOffset == 0x00000014) && span_ok(data_size, off + 16, 4))
+        {
+          lif->li.VolID.VLOffsetU = get_le_uint32(data_buf, (int)off + 16);
+          //Fetch the unicode string
+          get_le_unistr_n(data_buf, data_size, off + lif->li.VolID.VLOffsetU, 33, lif->li.VolID.VolumeLabelU);
+        }
+        else
+        {
+          lif->li.VolID.VLOffsetU = 0;
+          lif->li.VolID.VolumeLabelU[0] = (wchar_t)0;
+        }
 
         snprintf((char *)lif->li.VolID.VolumeLabel, 33, "[NOT USED]");
       }
@@ -960,7 +1763,7 @@ int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
       //Get the Local Base Path string
       //We get this now because it is dependant on the
       //VolumeIDAndLocalBasePath flag being set just as the VolumeID is
-      snprintf((char *)lif->li.LBP, 300, "%s", &data_buf[(lif->li.LBPOffset - 4)]);
+      get_cstr(data_buf, data_size, (size_t)lif->li.LBPOffset - 4, 300, lif->li.LBP);
     }
     else //There isn't a VolumeID structure so fill that part of the LIF with
       //empty values
@@ -977,17 +1780,19 @@ int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
     }
 
     //There is a CNR structure
-    if (lif->li.Flags & 0x00000002)
+    if ((lif->li.Flags & 0x00000002) && (lif->li.CNRLOffset >= 4) &&
+      span_ok(data_size, (size_t)lif->li.CNRLOffset - 4, 20))
     {
-      lif->li.CNR.Size = get_le_uint32(data_buf, (lif->li.CNRLOffset) - 4);
-      lif->li.CNR.Flags = get_le_uint32(data_buf, (lif->li.CNRLOffset + 4) - 4);
-      lif->li.CNR.NetNameOffset = get_le_uint32(data_buf, (lif->li.CNRLOffset + 8) - 4);
-      lif->li.CNR.DeviceNameOffset = get_le_uint32(data_buf, (lif->li.CNRLOffset + 12) - 4);
-      lif->li.CNR.NetworkProviderType = get_le_uint32(data_buf, (lif->li.CNRLOffset + 16) - 4);
-      if (lif->li.CNR.NetNameOffset > 0x00000014)
+      off = (size_t)lif->li.CNRLOffset - 4;
+      lif->li.CNR.Size = get_le_uint32(data_buf, (int)off);
+      lif->li.CNR.Flags = get_le_uint32(data_buf, (int)off + 4);
+      lif->li.CNR.NetNameOffset = get_le_uint32(data_buf, (int)off + 8);
+      lif->li.CNR.DeviceNameOffset = get_le_uint32(data_buf, (int)off + 12);
+      lif->li.CNR.NetworkProviderType = get_le_uint32(data_buf, (int)off + 16);
+      if ((lif->li.CNR.NetNameOffset > 0x00000014) && span_ok(data_size, off + 20, 8))
       {
-        lif->li.CNR.NetNameOffsetU = get_le_uint32(data_buf, (lif->li.CNRLOffset + 20) - 4);
-        lif->li.CNR.DeviceNameOffsetU = get_le_uint32(data_buf, (lif->li.CNRLOffset + 24) - 4);
+        lif->li.CNR.NetNameOffsetU = get_le_uint32(data_buf, (int)off + 20);
+        lif->li.CNR.DeviceNameOffsetU = get_le_uint32(data_buf, (int)off + 24);
       }
       else
       {
@@ -997,7 +1802,7 @@ int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
       //Get the NetName
       if (lif->li.CNR.NetNameOffset > 0)
       {
-        snprintf((char *)lif->li.CNR.NetName, 300, "%s", &data_buf[(lif->li.CNR.NetNameOffset) + ((lif->li.CNRLOffset) - 4)]);
+        get_cstr(data_buf, data_size, off + lif->li.CNR.NetNameOffset, 300, lif->li.CNR.NetName);
       }
       else
       {
@@ -1006,7 +1811,7 @@ int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
       //Get the DeviceName
       if (lif->li.CNR.DeviceNameOffset > 0)
       {
-        snprintf((char *)lif->li.CNR.DeviceName, 300, "%s", &data_buf[(lif->li.CNR.DeviceNameOffset) + ((lif->li.CNRLOffset) - 4)]);
+        get_cstr(data_buf, data_size, off + lif->li.CNR.DeviceNameOffset, 300, lif->li.CNR.DeviceName);
       }
       else
       {
@@ -1015,8 +1820,8 @@ int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
       //Get the NetNameUnicode and DeviceNameUnicode
       if (lif->li.CNR.NetNameOffset > 0x00000014)
       {
-        get_le_unistr(data_buf, ((lif->li.CNR.NetNameOffsetU) + ((lif->li.IDOffset) - 4)), 300, lif->li.CNR.NetNameU);
-        get_le_unistr(data_buf, ((lif->li.CNR.DeviceNameOffsetU) + ((lif->li.IDOffset) - 4)), 300, lif->li.CNR.DeviceNameU);
+        get_le_unistr_n(data_buf, data_size, off + lif->li.CNR.NetNameOffsetU, 300, lif->li.CNR.NetNameU);
+        get_le_unistr_n(data_buf, data_size, off + lif->li.CNR.DeviceNameOffsetU, 300, lif->li.CNR.DeviceNameU);
       }
       else
       {
@@ -1042,13 +1847,17 @@ int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
     //There is a common path suffix
     if (lif->li.CPSOffset > 0)
     {
-      snprintf((char *)lif->li.CPS, 100, "%s", &data_buf[(lif->li.CPSOffset - 4)]);
+      get_cstr(data_buf, data_size, (size_t)lif->li.CPSOffset - 4, 100, lif->li.CPS);
+    }
+    else
+    {
+      lif->li.CPS[0] = 0;
     }
     //There is a LocalBasePathUnicode
     if (lif->li.LBPOffsetU > 0)
     {
       //Fetch the unicode string
-      get_le_unistr(data_buf, ((lif->li.LBPOffsetU) - 4), 300, lif->li.LBPU);
+      get_le_unistr_n(data_buf, data_size, (size_t)lif->li.LBPOffsetU - 4, 300, lif->li.LBPU);
     }
     else
     {
@@ -1058,14 +1867,12 @@ int get_linkinfo(FILE * fp, int size, int pos, struct LIF * lif)
     if (lif->li.CPSOffsetU > 0)
     {
       //Fetch the unicode string
-      get_le_unistr(data_buf, ((lif->li.LBPOffsetU) - 4), 100, lif->li.CPSU);
+      get_le_unistr_n(data_buf, data_size, (size_t)lif->li.CPSOffsetU - 4, 100, lif->li.CPSU);
     }
     else
     {
       lif->li.CPSU[0] = (wchar_t)0;
     }
-
-    free(data_buf);
   }
   else // What to fill the LinkInfo structure with, in case it does not exist
   {
@@ -1460,12 +2267,10 @@ int get_linkinfo_a(struct LIF_INFO *li, struct LIF_INFO_A *lia)
 //
 //Fills the LIF_STRINGDATA structure with the necessary data (converting
 //Unicode strings to ASCII if necessary)
-int get_stringdata(FILE * fp, int pos, struct LIF * lif)
+int get_stringdata(const unsigned char * buf, size_t len, size_t pos, struct LIF * lif)
 {
-  unsigned char      size_buf[2];   //A small buffer to hold the size element
   uint32_t           tsize = 0, str_size = 0;
-  unsigned int       i, j;
-  unsigned char      data_buf[600];
+  unsigned int       i;
   wchar_t            uni_buf[300];
 
   // Initialise the lif->lsd values to 0
@@ -1480,22 +2285,18 @@ int get_stringdata(FILE * fp, int pos, struct LIF * lif)
     {
       if (lif->lh.Flags & (0x00000004 << i))
       {
-        fseek(fp, (pos + (tsize)), SEEK_SET);
-        size_buf[0] = getc(fp);
-        size_buf[1] = getc(fp);
-        str_size = get_le_uint16(size_buf, 0);
+        if (len < (pos + tsize + 2))
+        {
+          lif->lsd.Size = tsize; //The size of the strings before the damage
+          return -1;
+        }
+        str_size = get_le_uint16(buf, (int)(pos + tsize));
         lif->lsd.CountChars[i] = str_size;
         if (str_size > 299)
         {
           str_size = 299;
         }
-        for (j = 0; j < (str_size * 2); j++)
-        {
-          data_buf[j] = getc(fp);
-        }
-        data_buf[str_size * 2] = 0;
-        data_buf[(str_size * 2) + 1] = 0;
-        get_le_unistr(data_buf, 0, str_size + 1, uni_buf);
+        get_le_unistr_n(buf, len, pos + tsize + 2, str_size + 1, uni_buf);
         snprintf((char *)lif->lsd.Data[i], 300, "%ls", uni_buf);
 
         tsize += ((lif->lsd.CountChars[i] * 2) + 2);
@@ -1508,24 +2309,19 @@ int get_stringdata(FILE * fp, int pos, struct LIF * lif)
     {
       if (lif->lh.Flags & (0x00000004 << i))
       {
-        fseek(fp, (pos + (tsize)), SEEK_SET);
-        size_buf[0] = getc(fp);
-        size_buf[1] = getc(fp);
-        str_size = get_le_uint16(size_buf, 0);
+        if (len < (pos + tsize + 2))
+        {
+          lif->lsd.Size = tsize; //The size of the strings before the damage
+          return -1;
+        }
+        str_size = get_le_uint16(buf, (int)(pos + tsize));
         lif->lsd.CountChars[i] = str_size;
         if (str_size > 299)
         {
           str_size = 299;
         }
-        for (j = 0; j < lif->lsd.CountChars[i]; j++)
-        {
-          data_buf[j] = getc(fp);
-        }
-        get_chars(data_buf, 0, str_size + 1, lif->lsd.Data[i]);
-        if (str_size == 299)
-        {
-          lif->lsd.Data[i][str_size] = 0;
-        }
+        get_bytes(buf, len, pos + tsize + 2, str_size, lif->lsd.Data[i]);
+        lif->lsd.Data[i][str_size] = 0;
         tsize += (lif->lsd.CountChars[i] + 2);
       }
     }
@@ -1560,94 +2356,112 @@ int get_stringdata_a(struct LIF_STRINGDATA * lsd, struct LIF_STRINGDATA_A * lsda
 //
 //Fills the LIF_EXTRA_DATA structure with the necessary data (converting
 //Unicode strings to ASCII if necessary)
-int get_extradata(FILE * fp, int pos, struct LIF * lif)
+int get_extradata(const unsigned char * buf, size_t len, size_t pos, struct LIF * lif)
 {
-  unsigned int       i = 0, j = 0, p = 0, vp = 0, posn = 0, offset = pos;
+  unsigned int       i = 0, j = 0, p = 0, vp = 0, posn = 0, offset = (unsigned int)pos;
   uint32_t           blocksize, blocksig, datasize;
-  unsigned char      size_buf[4];   //A small buffer to hold the size element
-  unsigned char      sig_buf[4];
-  unsigned char      data_buf[4096];
+  int                damaged = 0;
+  const unsigned char * data_buf;
+  unsigned char      scratch[4096];
 
   led_setnull(&lif->led); //set all the extradata BlockSize and BlockSignature sections to 0 initially
   lif->led.edtypes = EMPTY;
 
-  fseek(fp, pos, SEEK_SET);
-  size_buf[0] = getc(fp);
-  size_buf[1] = getc(fp);
-  size_buf[2] = getc(fp);
-  size_buf[3] = getc(fp);
-  blocksize = get_le_uint32(size_buf, 0);
+  if (len < (pos + 4)) //No room for even a terminal block
+  {
+    return -1;
+  }
+  blocksize = get_le_uint32(buf, (int)pos);
   while (blocksize > 3) //The spec is that anything less than 4 signifies a terminal block
   {
-    if (blocksize >= 4096)    //Don't want to exceed the limits of the buffer 4KiB seems a reasonable limit (for now)
+    //Don't want to exceed the limits of the buffer 4KiB seems a reasonable
+    //limit (for now). A block that is too large or truncated ends the
+    //processing of the ExtraData, the blocks before it are kept.
+    if ((blocksize >= 4096) || (blocksize < 8) || (len < ((size_t)offset + 8)))
     {
-      fprintf(stderr, "ExtraData block is too large\n");
-      fprintf(stderr, "Processing of ExtraData block terminated.\n");
-      return -1;
+      damaged = 1;
+      break;
     }
     datasize = blocksize - 8;
-    sig_buf[0] = getc(fp);
-    sig_buf[1] = getc(fp);
-    sig_buf[2] = getc(fp);
-    sig_buf[3] = getc(fp);
-    blocksig = get_le_uint32(sig_buf, 0);
-    for (i = 0; i < datasize; i++)
+    blocksig = get_le_uint32(buf, (int)offset + 4);
+    // data_buf holds just the data for this ExtraData Block. It points
+    // straight into buf unless the block is cut short by the end of the file
+    // or is too small for its type, in which case the data is copied into a
+    // zero filled scratch buffer so the fixed size reads below stay in bounds.
+    if (span_ok(len, (size_t)offset + 8, datasize) && (datasize >= ed_minsize(blocksig)))
+    {
+      data_buf = &buf[offset + 8];
+    }
+    else
     {
-      // data_buf holds just the data for this ExtraData Block
-      data_buf[i] = getc(fp);
+      get_bytes(buf, len, (size_t)offset + 8, datasize, scratch);
+      memset(&scratch[datasize], 0, sizeof(scratch) - datasize);
+      data_buf = scratch;
     }
     switch (blocksig)
     {
     case 0xA0000001: // Signature for a EnvironmentVariableDataBlock S2.5.4
       lif->led.lep.Posn = (uint16_t)offset;
-      assert(blocksize == 0x00000314); // Spec states this MUST be the value
+      if (blocksize != 0x00000314) // Spec states this MUST be the value
+      {
+        lif->damage |= LIF_DMG_BLOCKSIZE;
+      }
       lif->led.lep.Size = blocksize;
       lif->led.lep.sig = blocksig;
       lif->led.edtypes += ENVIRONMENT_PROPS;
-      get_chars(data_buf, 0, 260, lif->led.lep.TargetAnsi);
-      if (get_le_unistr(data_buf, 260, 260, lif->led.lep.TargetUnicode) < 0)
+      if (lif->sections & ENVIRONMENT_PROPS)
       {
-        lif->led.lep.TargetUnicode[0] = (wchar_t)0;
+        get_chars(data_buf, 0, 260, lif->led.lep.TargetAnsi);
+        if (get_le_unistr(data_buf, 260, 260, lif->led.lep.TargetUnicode) < 0)
+        {
+          lif->led.lep.TargetUnicode[0] = (wchar_t)0;
+        }
       }
       break;
     case 0xA0000002: // Signature for a ConsoleDataBlock S2.5.1
       lif->led.lcp.Posn = (uint16_t)offset;
-      assert(blocksize == 0x000000CC); // Spec states this MUST be the value
+      if (blocksize != 0x000000CC) // Spec states this MUST be the value
+      {
+        lif->damage |= LIF_DMG_BLOCKSIZE;
+      }
       lif->led.lcp.Size = blocksize;
       lif->led.lcp.sig = blocksig;
       lif->led.edtypes += CONSOLE_PROPS;
-      lif->led.lcp.FillAttributes = get_le_uint16(data_buf, 0);
-      lif->led.lcp.PopupFillAttributes = get_le_uint16(data_buf, 2);
-      lif->led.lcp.ScreenBufferSizeX = get_le_uint16(data_buf, 4);
-      lif->led.lcp.ScreenBufferSizeY = get_le_uint16(data_buf, 6);
-      lif->led.lcp.WindowSizeX = get_le_uint16(data_buf, 8);
-      lif->led.lcp.WindowSizeY = get_le_uint16(data_buf, 10);
-      lif->led.lcp.WindowOriginX = get_le_uint16(data_buf, 12);
-      lif->led.lcp.WindowOriginY = get_le_uint16(data_buf, 14);
-      lif->led.lcp.Unused1 = get_le_uint32(data_buf, 16);
-      lif->led.lcp.Unused2 = get_le_uint32(data_buf, 20);
-      //In previous versions FontSize is a 32 bit DWORD but in MS-SHLLINK v5.0 it is split into FontHeight & FontWidth
-      lif->led.lcp.FontSize_Width = get_le_uint16(data_buf, 24);
-      lif->led.lcp.FontSize_Height = get_le_uint16(data_buf, 26);
-      lif->led.lcp.FontFamily = get_le_uint32(data_buf, 28);
-      lif->led.lcp.FontFamily_Family = lif->led.lcp.FontFamily & 0x00F0;
-      lif->led.lcp.FontFamily_Pitch = lif->led.lcp.FontFamily & 0x000F;
-      lif->led.lcp.FontWeight = get_le_uint32(data_buf, 32);
-      if (get_le_unistr(data_buf, 36, 32, lif->led.lcp.FaceName) == 0)
-      {
-        lif->led.lcp.FaceName[0] = (wchar_t)0; //Null string if no characters read
-      }
-      lif->led.lcp.CursorSize = get_le_uint32(data_buf, 100);
-      lif->led.lcp.FullScreen = get_le_uint32(data_buf, 104);
-      lif->led.lcp.QuickEdit = get_le_uint32(data_buf, 108);
-      lif->led.lcp.InsertMode = get_le_uint32(data_buf, 112);
-      lif->led.lcp.AutoPosition = get_le_uint32(data_buf, 116);
-      lif->led.lcp.HistoryBufferSize = get_le_uint32(data_buf, 120);
-      lif->led.lcp.NumberOfHistoryBuffers = get_le_uint32(data_buf, 124);
-      lif->led.lcp.HistoryNoDup = get_le_uint32(data_buf, 128);
-      for (j = 0; j < 16; j++)
-      {
-        lif->led.lcp.ColorTable[j] = get_le_uint32(data_buf, (j * 4) + 132);
+      if (lif->sections & CONSOLE_PROPS)
+      {
+        lif->led.lcp.FillAttributes = get_le_uint16(data_buf, 0);
+        lif->led.lcp.PopupFillAttributes = get_le_uint16(data_buf, 2);
+        lif->led.lcp.ScreenBufferSizeX = get_le_uint16(data_buf, 4);
+        lif->led.lcp.ScreenBufferSizeY = get_le_uint16(data_buf, 6);
+        lif->led.lcp.WindowSizeX = get_le_uint16(data_buf, 8);
+        lif->led.lcp.WindowSizeY = get_le_uint16(data_buf, 10);
+        lif->led.lcp.WindowOriginX = get_le_uint16(data_buf, 12);
+        lif->led.lcp.WindowOriginY = get_le_uint16(data_buf, 14);
+        lif->led.lcp.Unused1 = get_le_uint32(data_buf, 16);
+        lif->led.lcp.Unused2 = get_le_uint32(data_buf, 20);
+        //In previous versions FontSize is a 32 bit DWORD but in MS-SHLLINK v5.0 it is split into FontHeight & FontWidth
+        lif->led.lcp.FontSize_Width = get_le_uint16(data_buf, 24);
+        lif->led.lcp.FontSize_Height = get_le_uint16(data_buf, 26);
+        lif->led.lcp.FontFamily = get_le_uint32(data_buf, 28);
+        lif->led.lcp.FontFamily_Family = lif->led.lcp.FontFamily & 0x00F0;
+        lif->led.lcp.FontFamily_Pitch = lif->led.lcp.FontFamily & 0x000F;
+        lif->led.lcp.FontWeight = get_le_uint32(data_buf, 32);
+        if (get_le_unistr(data_buf, 36, 32, lif->led.lcp.FaceName) == 0)
+        {
+          lif->led.lcp.FaceName[0] = (wchar_t)0; //Null string if no characters read
+        }
+        lif->led.lcp.CursorSize = get_le_uint32(data_buf, 100);
+        lif->led.lcp.FullScreen = get_le_uint32(data_buf, 104);
+        lif->led.lcp.QuickEdit = get_le_uint32(data_buf, 108);
+        lif->led.lcp.InsertMode = get_le_uint32(data_buf, 112);
+        lif->led.lcp.AutoPosition = get_le_uint32(data_buf, 116);
+        lif->led.lcp.HistoryBufferSize = get_le_uint32(data_buf, 120);
+        lif->led.lcp.NumberOfHistoryBuffers = get_le_uint32(data_buf, 124);
+        lif->led.lcp.HistoryNoDup = get_le_uint32(data_buf, 128);
+        for (j = 0; j < 16; j++)
+        {
+          lif->led.lcp.ColorTable[j] = get_le_uint32(data_buf, (j * 4) + 132);
+        }
       }
       break;
     case 0xA0000003: //Signature for a TrackerDataBlock S2.5.10
@@ -1655,46 +2469,70 @@ int get_extradata(FILE * fp, int pos, struct LIF * lif)
       lif->led.ltp.Size = blocksize;
       lif->led.ltp.sig = blocksig;
       lif->led.edtypes += TRACKER_PROPS;
-      get_ltp(&lif->led.ltp, data_buf);
+      if (lif->sections & TRACKER_PROPS)
+      {
+        get_ltp(&lif->led.ltp, data_buf);
+      }
       break;
     case 0xA0000004: // Signature for a ConsoleFEDataBlock S2.5.2
       lif->led.lcfep.Posn = (uint16_t)offset;
-      assert(blocksize == 0x0000000C); // Spec states this MUST be the value
+      if (blocksize != 0x0000000C) // Spec states this MUST be the value
+      {
+        lif->damage |= LIF_DMG_BLOCKSIZE;
+      }
       lif->led.lcfep.Size = blocksize;
       lif->led.lcfep.sig = blocksig;
       lif->led.edtypes += CONSOLE_FE_PROPS;
-      lif->led.lcfep.CodePage = get_le_int32(data_buf, 0);
+      if (lif->sections & CONSOLE_FE_PROPS)
+      {
+        lif->led.lcfep.CodePage = get_le_int32(data_buf, 0);
+      }
       break;
     case 0xA0000005: // Signature for a SpecialFolderDataBlock S2.5.9
       lif->led.lsfp.Posn = (uint16_t)offset;
       lif->led.lsfp.Size = blocksize;
       lif->led.lsfp.sig = blocksig;
       lif->led.edtypes += SPECIAL_FOLDER_PROPS;
-      lif->led.lsfp.SpecialFolderID = get_le_uint32(data_buf, 0);
-      lif->led.lsfp.Offset = get_le_uint32(data_buf, 4);
+      if (lif->sections & SPECIAL_FOLDER_PROPS)
+      {
+        lif->led.lsfp.SpecialFolderID = get_le_uint32(data_buf, 0);
+        lif->led.lsfp.Offset = get_le_uint32(data_buf, 4);
+      }
       break;
     case 0xA0000006: // Signature for a DarwinDataBlock S2.5.3
       lif->led.ldp.Posn = (uint16_t)offset;
-      assert(blocksize == 0x00000314); // Spec states this MUST be the value
+      if (blocksize != 0x00000314) // Spec states this MUST be the value
+      {
+        lif->damage |= LIF_DMG_BLOCKSIZE;
+      }
       lif->led.ldp.Size = blocksize;
       lif->led.ldp.sig = blocksig;
       lif->led.edtypes += DARWIN_PROPS;
-      get_chars(data_buf, 0, 260, lif->led.ldp.DarwinDataAnsi);
-      if(get_le_unistr(data_buf, 260, 260, lif->led.ldp.DarwinDataUnicode) < 0)
+      if (lif->sections & DARWIN_PROPS)
       {
-        lif->led.ldp.DarwinDataUnicode[0] = (wchar_t)0;
+        get_chars(data_buf, 0, 260, lif->led.ldp.DarwinDataAnsi);
+        if(get_le_unistr(data_buf, 260, 260, lif->led.ldp.DarwinDataUnicode) < 0)
+        {
+          lif->led.ldp.DarwinDataUnicode[0] = (wchar_t)0;
+        }
       }
       break;
     case 0xA0000007: // Signature for a IconEnvironmentDataBlock S2.5.5
       lif->led.liep.Posn = (uint16_t)offset;
-      assert(blocksize == 0x00000314); // Spec states this MUST be the value
+      if (blocksize != 0x00000314) // Spec states this MUST be the value
+      {
+        lif->damage |= LIF_DMG_BLOCKSIZE;
+      }
       lif->led.liep.Size = blocksize;
       lif->led.liep.sig = blocksig;
       lif->led.edtypes += ICON_ENVIRONMENT_PROPS;
-      get_chars(data_buf, 0, 260, lif->led.liep.TargetAnsi);
-      if (get_le_unistr(data_buf, 260, 260, lif->led.liep.TargetUnicode) < 0)
+      if (lif->sections & ICON_ENVIRONMENT_PROPS)
       {
-        lif->led.liep.TargetUnicode[0] = (wchar_t)0;
+        get_chars(data_buf, 0, 260, lif->led.liep.TargetAnsi);
+        if (get_le_unistr(data_buf, 260, 260, lif->led.liep.TargetUnicode) < 0)
+        {
+          lif->led.liep.TargetUnicode[0] = (wchar_t)0;
+        }
       }
       break;
     case 0xA0000008: // Signature for a ShimDataBlock S2.5.8
@@ -1702,9 +2540,12 @@ int get_extradata(FILE * fp, int pos, struct LIF * lif)
       lif->led.lsp.Size = blocksize;
       lif->led.lsp.sig = blocksig;
       lif->led.edtypes += SHIM_PROPS;
-      if (get_le_unistr(data_buf, 0, 600, lif->led.lsp.LayerName) < 0)
+      if (lif->sections & SHIM_PROPS)
       {
-        lif->led.lsp.LayerName[0] = (wchar_t)0;
+        if (get_le_unistr_n(data_buf, datasize, 0, 600, lif->led.lsp.LayerName) < 0)
+        {
+          lif->led.lsp.LayerName[0] = (wchar_t)0;
+        }
       }
       break;
     case 0xA0000009: // Signature for a PropertyStoreDataBlock S2.5.7
@@ -1715,64 +2556,88 @@ int get_extradata(FILE * fp, int pos, struct LIF * lif)
       for (i = 0; i < PROPSTORES; i++) // Cycle through all the valid property stores
       {
         lif->led.lpsp.Stores[i].NumValues = 0;
-        lif->led.lpsp.Stores[i].StorageSize = get_le_uint32(data_buf, posn);
-        if (lif->led.lpsp.Stores[i].StorageSize == 0) // An empty property store
+        if (!span_ok(datasize, posn, 24)) // No room for a property store header
         {
           break;
         }
-        p = posn + 4;
-        lif->led.lpsp.Stores[i].Version = get_le_uint32(data_buf, p);
-        p += 4;
-        lif->led.lpsp.Stores[i].FormatID.Data1 = get_le_uint32(data_buf, p);
-        p += 4;
-        lif->led.lpsp.Stores[i].FormatID.Data2 = get_le_uint16(data_buf, p);
-        p += 2;
-        lif->led.lpsp.Stores[i].FormatID.Data3 = get_le_uint16(data_buf, p);
-        p += 2;
-        get_chars(data_buf, p, 2, lif->led.lpsp.Stores[i].FormatID.Data4hi);
-        p += 2;
-        get_chars(data_buf, p, 6, lif->led.lpsp.Stores[i].FormatID.Data4lo);
-        p += 6;
-        if((lif->led.lpsp.Stores[i].FormatID.Data1 == 0xD5CDD505) &&
-          (lif->led.lpsp.Stores[i].FormatID.Data2 == 0x2E9C) &&
-          (lif->led.lpsp.Stores[i].FormatID.Data3 == 0x101B) &&
-          (lif->led.lpsp.Stores[i].FormatID.Data4hi[0] == 0x93) &&
-          (lif->led.lpsp.Stores[i].FormatID.Data4hi[1] == 0x97) &&
-          (lif->led.lpsp.Stores[i].FormatID.Data4hi[0] == 0x08) &&
-          (lif->led.lpsp.Stores[i].FormatID.Data4hi[1] == 0x00) &&
-          (lif->led.lpsp.Stores[i].FormatID.Data4hi[2] == 0x2B) &&
-          (lif->led.lpsp.Stores[i].FormatID.Data4hi[3] == 0x2C) &&
-          (lif->led.lpsp.Stores[i].FormatID.Data4hi[4] == 0xF9) &&
-          (lif->led.lpsp.Stores[i].FormatID.Data4hi[5] == 0xAE)
-          )
-        {
-          lif->led.lpsp.Stores[i].NameType = 0x00;
-        }
-        else
+        lif->led.lpsp.Stores[i].StorageSize = get_le_uint32(data_buf, posn);
+        if (lif->led.lpsp.Stores[i].StorageSize == 0) // An empty property store
         {
-          lif->led.lpsp.Stores[i].NameType = 0xFF;
+          break;
         }
-        for (j = 0; j < PROPVALUES; j++) // Cycle through all the valid property values
+        //The stores are always counted but only decoded if wanted
+        if (lif->sections & PROPERTY_STORE_PROPS)
         {
-          vp = p; // Save the position of the start of this value
-          lif->led.lpsp.Stores[i].PropValues[j].ValueSize = get_le_uint32(data_buf, vp);
-          p += (int)lif->led.lpsp.Stores[i].PropValues[j].ValueSize;// Move p to the next value store
-          if (lif->led.lpsp.Stores[i].PropValues[j].ValueSize == 0)
+          p = posn + 4;
+          lif->led.lpsp.Stores[i].Version = get_le_uint32(data_buf, p);
+          p += 4;
+          lif->led.lpsp.Stores[i].FormatID.Data1 = get_le_uint32(data_buf, p);
+          p += 4;
+          lif->led.lpsp.Stores[i].FormatID.Data2 = get_le_uint16(data_buf, p);
+          p += 2;
+          lif->led.lpsp.Stores[i].FormatID.Data3 = get_le_uint16(data_buf, p);
+          p += 2;
+          get_chars(data_buf, p, 2, lif->led.lpsp.Stores[i].FormatID.Data4hi);
+          p += 2;
+          get_chars(data_buf, p, 6, lif->led.lpsp.Stores[i].FormatID.Data4lo);
+          p += 6;
+          if((lif->led.lpsp.Stores[i].FormatID.Data1 == 0xD5CDD505) &&
+            (lif->led.lpsp.Stores[i].FormatID.Data2 == 0x2E9C) &&
+            (lif->led.lpsp.Stores[i].FormatID.Data3 == 0x101B) &&
+            (lif->led.lpsp.Stores[i].FormatID.Data4hi[0] == 0x93) &&
+            (lif->led.lpsp.Stores[i].FormatID.Data4hi[1] == 0x97) &&
+            (lif->led.lpsp.Stores[i].FormatID.Data4hi[0] == 0x08) &&
+            (lif->led.lpsp.Stores[i].FormatID.Data4hi[1] == 0x00) &&
+            (lif->led.lpsp.Stores[i].FormatID.Data4hi[2] == 0x2B) &&
+            (lif->led.lpsp.Stores[i].FormatID.Data4hi[3] == 0x2C) &&
+            (lif->led.lpsp.Stores[i].FormatID.Data4hi[4] == 0xF9) &&
+            (lif->led.lpsp.Stores[i].FormatID.Data4hi[5] == 0xAE)
+            )
+          {
+            lif->led.lpsp.Stores[i].NameType = 0x00;
+          }
+          else
           {
-            lif->led.lpsp.Stores[i].NumValues++; // Unlike a Property Store, an empty Value Store is counted
-            break;
+            lif->led.lpsp.Stores[i].NameType = 0xFF;
           }
-          lif->led.lpsp.Stores[i].PropValues[j].NameSizeOrID = get_le_uint32(data_buf, vp + 4);
-          lif->led.lpsp.Stores[i].PropValues[j].Reserved = (uint8_t)data_buf[vp + 8];
-          if (lif->led.lpsp.Stores[i].NameType == 0)
+          for (j = 0; j < PROPVALUES; j++) // Cycle through all the valid property values
           {
-            get_chars(data_buf, vp + 9, lif->led.lpsp.Stores[i].PropValues[j].NameSizeOrID, lif->led.lpsp.Stores[i].PropValues[j].Name);
-            vp += lif->led.lpsp.Stores[i].PropValues[j].NameSizeOrID; // In the Case of a name type, offset the value pointer
+            vp = p; // Save the position of the start of this value
+            if (!span_ok(datasize, vp, 4))
+            {
+              break;
+            }
+            lif->led.lpsp.Stores[i].PropValues[j].ValueSize = get_le_uint32(data_buf, vp);
+            p += (int)lif->led.lpsp.Stores[i].PropValues[j].ValueSize;// Move p to the next value store
+            if (lif->led.lpsp.Stores[i].PropValues[j].ValueSize == 0)
+            {
+              lif->led.lpsp.Stores[i].NumValues++; // Unlike a Property Store, an empty Value Store is counted
+              break;
+            }
+            if (!span_ok(datasize, vp, 13))
+            {
+              break;
+            }
+            lif->led.lpsp.Stores[i].PropValues[j].NameSizeOrID = get_le_uint32(data_buf, vp + 4);
+            lif->led.lpsp.Stores[i].PropValues[j].Reserved = (uint8_t)data_buf[vp + 8];
+            if (lif->led.lpsp.Stores[i].NameType == 0)
+            {
+              get_bytes(data_buf, datasize, (size_t)vp + 9,
+                (lif->led.lpsp.Stores[i].PropValues[j].NameSizeOrID < 300) ? lif->led.lpsp.Stores[i].PropValues[j].NameSizeOrID : 300,
+                lif->led.lpsp.Stores[i].PropValues[j].Name);
+              vp += lif->led.lpsp.Stores[i].PropValues[j].NameSizeOrID; // In the Case of a name type, offset the value pointer
+              if (!span_ok(datasize, vp, 13))
+              {
+                break;
+              }
+            }
+            lif->led.lpsp.Stores[i].PropValues[j].PropertyType = get_le_uint16(data_buf, vp + 9);
+            lif->led.lpsp.Stores[i].PropValues[j].Padding = get_le_uint16(data_buf, vp + 11);
+            get_bytes(data_buf, datasize, (size_t)vp + 13,
+              (lif->led.lpsp.Stores[i].PropValues[j].ValueSize < 400) ? lif->led.lpsp.Stores[i].PropValues[j].ValueSize : 400,
+              lif->led.lpsp.Stores[i].PropValues[j].Value);
+            lif->led.lpsp.Stores[i].NumValues++;
           }
-          lif->led.lpsp.Stores[i].PropValues[j].PropertyType = get_le_uint16(data_buf, vp + 9);
-          lif->led.lpsp.Stores[i].PropValues[j].Padding = get_le_uint16(data_buf, vp + 11);
-          get_chars(data_buf, vp + 13, (lif->led.lpsp.Stores[i].PropValues[j].ValueSize), lif->led.lpsp.Stores[i].PropValues[j].Value);
-          lif->led.lpsp.Stores[i].NumValues++;
         }
         posn += lif->led.lpsp.Stores[i].StorageSize; // Move to the next propertystore
         lif->led.lpsp.NumStores++;
@@ -1784,9 +2649,16 @@ int get_extradata(FILE * fp, int pos, struct LIF * lif)
       lif->led.lvidlp.sig = blocksig;
       lif->led.lvidlp.NumItemIDs = 0;
       lif->led.edtypes += VISTA_AND_ABOVE_IDLIST_PROPS;
-      while (posn < (lif->led.lvidlp.Size - 8))
+      //Count the ItemIDs, a 0 size is the TerminalID. posn always moves on so
+      //the count can't exceed the (4KiB at most) size of the block
+      posn = 0;
+      while (posn + 2 <= datasize)
       {
         i = get_le_uint16(data_buf, posn);
+        if (i == 0)
+        {
+          break;
+        }
         posn += i;
         lif->led.lvidlp.NumItemIDs++;
       }
@@ -1796,24 +2668,29 @@ int get_extradata(FILE * fp, int pos, struct LIF * lif)
       lif->led.lkfp.Size = blocksize;
       lif->led.lkfp.sig = blocksig;
       lif->led.edtypes += KNOWN_FOLDER_PROPS;
-      lif->led.lkfp.KFGUID.Data1 = get_le_uint32(data_buf, 0);
-      lif->led.lkfp.KFGUID.Data2 = get_le_uint16(data_buf, 4);
-      lif->led.lkfp.KFGUID.Data3 = get_le_uint16(data_buf, 6);
-      get_chars(data_buf, 8, 2, lif->led.lkfp.KFGUID.Data4hi);
-      get_chars(data_buf, 10, 6, lif->led.lkfp.KFGUID.Data4lo);
-      lif->led.lkfp.KFOffset = get_le_uint32(data_buf, 16);
+      if (lif->sections & KNOWN_FOLDER_PROPS)
+      {
+        lif->led.lkfp.KFGUID.Data1 = get_le_uint32(data_buf, 0);
+        lif->led.lkfp.KFGUID.Data2 = get_le_uint16(data_buf, 4);
+        lif->led.lkfp.KFGUID.Data3 = get_le_uint16(data_buf, 6);
+        get_chars(data_buf, 8, 2, lif->led.lkfp.KFGUID.Data4hi);
+        get_chars(data_buf, 10, 6, lif->led.lkfp.KFGUID.Data4lo);
+        lif->led.lkfp.KFOffset = get_le_uint32(data_buf, 16);
+      }
       break;
     }
     offset += blocksize;
 
-    size_buf[0] = getc(fp); //Get the next block size (or the terminal block)
-    size_buf[1] = getc(fp);
-    size_buf[2] = getc(fp);
-    size_buf[3] = getc(fp);
-    blocksize = get_le_uint32(size_buf, 0);
+    //Get the next block size (or the terminal block)
+    if (len < ((size_t)offset + 4))
+    {
+      blocksize = 0;
+      break;
+    }
+    blocksize = get_le_uint32(buf, (int)offset);
   }//End of the while loop that parses each ExtraData block
 
-  lif->led.terminal = blocksize;
+  lif->led.terminal = damaged ? 0 : blocksize;
 
   //Compute the size of the ExtraData section
   lif->led.Size = lif->led.lcp.Size +
@@ -1828,12 +2705,13 @@ int get_extradata(FILE * fp, int pos, struct LIF * lif)
     lif->led.ltp.Size +
     lif->led.lvidlp.Size +
     4;
-  return lif->led.Size;
+  return damaged ? -1 : (int)lif->led.Size;
 }
 //
-//Function get_extradata_a(struct LIF_EXTRA_DATA*, struct LIF_EXTRA_DATA_A)
-//copies the strings and creates an ASCII representation of the data.
-int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
+//Function get_extradata_a(struct LIF_EXTRA_DATA*, struct LIF_EXTRA_DATA_A, struct LIF_ARENA*, uint32_t sections)
+//copies the strings and creates an ASCII representation of the data. Only the
+//contents of the blocks in sections are converted.
+int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda, struct LIF_ARENA * arena, uint32_t sections)
 {
   int       i;
 
@@ -1846,6 +2724,15 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->lcpa.Posn, 8, "%"PRIu16, led->lcp.Posn);
     snprintf((char *)leda->lcpa.Size, 10, "%"PRIu32, led->lcp.Size);
     snprintf((char *)leda->lcpa.sig, 12, "0x%.8"PRIX32, led->lcp.sig);
+  }
+  else
+  {
+    snprintf((char *)leda->lcpa.Posn, 8, "[N/A]");
+    snprintf((char *)leda->lcpa.Size, 10, "[N/A]");
+    snprintf((char *)leda->lcpa.sig, 12, "[N/A]");
+  }
+  if (led->edtypes & sections & CONSOLE_PROPS)
+  {
     snprintf((char *)leda->lcpa.FillAttributes, 8, "0x%.4"PRIX16, led->lcp.FillAttributes);
     snprintf((char *)leda->lcpa.PopupFillAttributes, 8, "0x%.4"PRIX16, led->lcp.PopupFillAttributes);
     snprintf((char *)leda->lcpa.ScreenBufferSizeX, 8, "%"PRIu16, led->lcp.ScreenBufferSizeX);
@@ -1877,9 +2764,6 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
   }
   else
   {
-    snprintf((char *)leda->lcpa.Posn, 8, "[N/A]");
-    snprintf((char *)leda->lcpa.Size, 10, "[N/A]");
-    snprintf((char *)leda->lcpa.sig, 12, "[N/A]");
     snprintf((char *)leda->lcpa.FillAttributes, 8, "[N/A]");
     snprintf((char *)leda->lcpa.PopupFillAttributes, 8, "[N/A]");
     snprintf((char *)leda->lcpa.ScreenBufferSizeX, 8, "[N/A]");
@@ -1893,6 +2777,7 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->lcpa.FontHeight, 12, "[N/A]");
     snprintf((char *)leda->lcpa.FontWidth, 12, "[N/A]");
     snprintf((char *)leda->lcpa.FontFamily, 12, "[N/A]");
+    snprintf((char *)leda->lcpa.FontPitch, 12, "[N/A]");
     snprintf((char *)leda->lcpa.FontWeight, 12, "[N/A]");
     snprintf((char *)leda->lcpa.FaceName, 64, "[N/A]");
     snprintf((char *)leda->lcpa.CursorSize, 12, "[N/A]");
@@ -1915,13 +2800,19 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->lcfepa.Posn, 8, "%"PRIu16, led->lcfep.Posn);
     snprintf((char *)leda->lcfepa.Size, 10, "%"PRIu32, led->lcfep.Size);
     snprintf((char *)leda->lcfepa.sig, 12, "0x%.8"PRIX32, led->lcfep.sig);
-    snprintf((char *)leda->lcfepa.CodePage, 12, "0x%.8"PRIX32, led->lcfep.CodePage);
   }
   else
   {
     snprintf((char *)leda->lcfepa.Posn, 8, "[N/A]");
     snprintf((char *)leda->lcfepa.Size, 10, "[N/A]");
     snprintf((char *)leda->lcfepa.sig, 12, "[N/A]");
+  }
+  if (led->edtypes & sections & CONSOLE_FE_PROPS)
+  {
+    snprintf((char *)leda->lcfepa.CodePage, 12, "0x%.8"PRIX32, led->lcfep.CodePage);
+  }
+  else
+  {
     snprintf((char *)leda->lcfepa.CodePage, 12, "[N/A]");
   }
   //Get Darwin Data block
@@ -1931,14 +2822,20 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->ldpa.Posn, 8, "%"PRIu16, led->ldp.Posn);
     snprintf((char *)leda->ldpa.Size, 10, "%"PRIu32, led->ldp.Size);
     snprintf((char *)leda->ldpa.sig, 12, "0x%.8"PRIX32, led->ldp.sig);
-    snprintf((char *)leda->ldpa.DarwinDataAnsi, 260, "%s", led->ldp.DarwinDataAnsi);
-    snprintf((char *)leda->ldpa.DarwinDataUnicode, 520, "%ls", led->ldp.DarwinDataUnicode);
   }
   else
   {
     snprintf((char *)leda->ldpa.Posn, 8, "[N/A]");
     snprintf((char *)leda->ldpa.Size, 10, "[N/A]");
     snprintf((char *)leda->ldpa.sig, 12, "[N/A]");
+  }
+  if (led->edtypes & sections & DARWIN_PROPS)
+  {
+    snprintf((char *)leda->ldpa.DarwinDataAnsi, 260, "%s", led->ldp.DarwinDataAnsi);
+    snprintf((char *)leda->ldpa.DarwinDataUnicode, 520, "%ls", led->ldp.DarwinDataUnicode);
+  }
+  else
+  {
     snprintf((char *)leda->ldpa.DarwinDataAnsi, 260, "[N/A]");
     snprintf((char *)leda->ldpa.DarwinDataUnicode, 520, "[N/A]");
   }
@@ -1949,14 +2846,20 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->lepa.Posn, 8, "%"PRIu16, led->lep.Posn);
     snprintf((char *)leda->lepa.Size, 10, "%"PRIu32, led->lep.Size);
     snprintf((char *)leda->lepa.sig, 12, "0x%.8"PRIX32, led->lep.sig);
-    snprintf((char *)leda->lepa.TargetAnsi, 260, "%s", led->lep.TargetAnsi);
-    snprintf((char *)leda->lepa.TargetUnicode, 520, "%ls", led->lep.TargetUnicode);
   }
   else
   {
     snprintf((char *)leda->lepa.Posn, 8, "[N/A]");
     snprintf((char *)leda->lepa.Size, 10, "[N/A]");
     snprintf((char *)leda->lepa.sig, 12, "[N/A]");
+  }
+  if (led->edtypes & sections & ENVIRONMENT_PROPS)
+  {
+    snprintf((char *)leda->lepa.TargetAnsi, 260, "%s", led->lep.TargetAnsi);
+    snprintf((char *)leda->lepa.TargetUnicode, 520, "%ls", led->lep.TargetUnicode);
+  }
+  else
+  {
     snprintf((char *)leda->lepa.TargetAnsi, 260, "[N/A]");
     snprintf((char *)leda->lepa.TargetUnicode, 520, "[N/A]");
   }
@@ -1967,14 +2870,20 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->liepa.Posn, 8, "%"PRIu16, led->liep.Posn);
     snprintf((char *)leda->liepa.Size, 10, "%"PRIu32, led->liep.Size);
     snprintf((char *)leda->liepa.sig, 12, "0x%.8"PRIX32, led->liep.sig);
-    snprintf((char *)leda->liepa.TargetAnsi, 260, "%s", led->liep.TargetAnsi);
-    snprintf((char *)leda->liepa.TargetUnicode, 520, "%ls", led->liep.TargetUnicode);
   }
   else
   {
     snprintf((char *)leda->liepa.Posn, 8, "[N/A]");
     snprintf((char *)leda->liepa.Size, 10, "[N/A]");
     snprintf((char *)leda->liepa.sig, 12, "[N/A]");
+  }
+  if (led->edtypes & sections & ICON_ENVIRONMENT_PROPS)
+  {
+    snprintf((char *)leda->liepa.TargetAnsi, 260, "%s", led->liep.TargetAnsi);
+    snprintf((char *)leda->liepa.TargetUnicode, 520, "%ls", led->liep.TargetUnicode);
+  }
+  else
+  {
     snprintf((char *)leda->liepa.TargetAnsi, 260, "[N/A]");
     snprintf((char *)leda->liepa.TargetUnicode, 520, "[N/A]");
   }
@@ -1985,14 +2894,20 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->lkfpa.Posn, 8, "%"PRIu16, led->lkfp.Posn);
     snprintf((char *)leda->lkfpa.Size, 10, "%"PRIu32, led->lkfp.Size);
     snprintf((char *)leda->lkfpa.sig, 12, "0x%.8"PRIX32, led->lkfp.sig);
-    get_droid_a(&led->lkfp.KFGUID, &leda->lkfpa.KFGUID);
-    snprintf((char *)leda->lkfpa.KFOffset, 10, "%"PRIu32, led->lkfp.KFOffset);
   }
   else
   {
     snprintf((char *)leda->lkfpa.Posn, 8, "[N/A]");
     snprintf((char *)leda->lkfpa.Size, 10, "[N/A]");
     snprintf((char *)leda->lkfpa.sig, 10, "[N/A]");
+  }
+  if (led->edtypes & sections & KNOWN_FOLDER_PROPS)
+  {
+    get_droid_a(&led->lkfp.KFGUID, &leda->lkfpa.KFGUID);
+    snprintf((char *)leda->lkfpa.KFOffset, 10, "%"PRIu32, led->lkfp.KFOffset);
+  }
+  else
+  {
     snprintf((char *)leda->lkfpa.KFGUID.UUID, 40, "[N/A]");
     snprintf((char *)leda->lkfpa.KFGUID.Version, 40, "[N/A]");
     snprintf((char *)leda->lkfpa.KFGUID.Variant, 40, "[N/A]");
@@ -2009,10 +2924,6 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->lpspa.Size, 10, "%"PRIu32, led->lpsp.Size);
     snprintf((char *)leda->lpspa.sig, 12, "0x%.8"PRIX32, led->lpsp.sig);
     snprintf((char *)leda->lpspa.NumStores, 10, "%"PRIi32, led->lpsp.NumStores);
-    for (i = 0; i < led->lpsp.NumStores; i++)
-    {
-      get_propstore_a(&led->lpsp.Stores[i], &leda->lpspa.Stores[i]);
-    }
   }
   else
   {
@@ -2021,6 +2932,28 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->lpspa.sig, 10, "[N/A]");
     snprintf((char *)leda->lpspa.NumStores, 10, "[N/A]");
   }
+  if (led->edtypes & sections & PROPERTY_STORE_PROPS)
+  {
+    leda->lpspa.Stores = NULL;
+    if (led->lpsp.NumStores > 0)
+    {
+      //Only room for the stores actually found
+      leda->lpspa.Stores = (struct LIF_SER_PROPSTORE_A *)lif_arena_alloc(arena,
+        (size_t)led->lpsp.NumStores * sizeof(struct LIF_SER_PROPSTORE_A));
+      if (leda->lpspa.Stores == NULL)
+      {
+        return -1;
+      }
+    }
+    for (i = 0; i < led->lpsp.NumStores; i++)
+    {
+      get_propstore_a(&led->lpsp.Stores[i], &leda->lpspa.Stores[i]);
+    }
+  }
+  else
+  {
+    leda->lpspa.Stores = NULL;
+  }
   //Get Shim Data block
   if (led->edtypes & SHIM_PROPS)
   {
@@ -2028,13 +2961,19 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->lspa.Posn, 8, "%"PRIu16, led->lsp.Posn);
     snprintf((char *)leda->lspa.Size, 10, "%"PRIu32, led->lsp.Size);
     snprintf((char *)leda->lspa.sig, 12, "0x%.8"PRIX32, led->lsp.sig);
-    snprintf((char *)leda->lspa.LayerName, 600, "%ls", led->lsp.LayerName);
   }
   else
   {
     snprintf((char *)leda->lspa.Posn, 8, "[N/A]");
     snprintf((char *)leda->lspa.Size, 10, "[N/A]");
     snprintf((char *)leda->lspa.sig, 10, "[N/A]");
+  }
+  if (led->edtypes & sections & SHIM_PROPS)
+  {
+    snprintf((char *)leda->lspa.LayerName, 600, "%ls", led->lsp.LayerName);
+  }
+  else
+  {
     snprintf((char *)leda->lspa.LayerName, 600, "[N/A]");
   }
   //Get Special Folder Data block
@@ -2044,16 +2983,22 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->lsfpa.Posn, 8, "%"PRIu16, led->lsfp.Posn);
     snprintf((char *)leda->lsfpa.Size, 10, "%"PRIu32, led->lsfp.Size);
     snprintf((char *)leda->lsfpa.sig, 12, "0x%.8"PRIX32, led->lsfp.sig);
-    snprintf((char *)leda->lsfpa.SpecialFolderID, 10, "%"PRIu32, led->lsfp.SpecialFolderID);
-    snprintf((char *)leda->lsfpa.Offset, 10, "%"PRIu32, led->lsfp.Offset);
   }
   else
   {
     snprintf((char *)leda->lsfpa.Posn, 8, "[N/A]");
     snprintf((char *)leda->lsfpa.Size, 10, "[N/A]");
     snprintf((char *)leda->lsfpa.sig, 10, "[N/A]");
-    snprintf((char *)leda->lsfpa.SpecialFolderID, 10, "[N/A]");
-    snprintf((char *)leda->lsfpa.Offset, 10, "[N/A]");
+  }
+  if (led->edtypes & sections & SPECIAL_FOLDER_PROPS)
+  {
+    snprintf((char *)leda->lsfpa.SpecialFolderID, 10, "%"PRIu32, led->lsfp.SpecialFolderID);
+    snprintf((char *)leda->lsfpa.Offset, 10, "%"PRIu32, led->lsfp.Offset);
+  }
+  else
+  {
+    snprintf((char *)leda->lsfpa.SpecialFolderID, 10, "[N/A]");
+    snprintf((char *)leda->lsfpa.Offset, 10, "[N/A]");
   }
   //Get the Link File Tracker Properties
   if (led->edtypes & TRACKER_PROPS)
@@ -2062,6 +3007,15 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
     snprintf((char *)leda->ltpa.Posn, 8, "%"PRIu16, led->ltp.Posn);
     snprintf((char *)leda->ltpa.Size, 10, "%"PRIu32, led->ltp.Size);
     snprintf((char *)leda->ltpa.sig, 12, "0x%.8"PRIX32, led->ltp.sig);
+  }
+  else
+  {
+    snprintf((char *)leda->ltpa.Posn, 8, "[N/A]");
+    snprintf((char *)leda->ltpa.Size, 10, "[N/A]");
+    snprintf((char *)leda->ltpa.sig, 10, "[N/A]");
+  }
+  if (led->edtypes & sections & TRACKER_PROPS)
+  {
     snprintf((char *)leda->ltpa.Length, 10, "%"PRIu32, led->ltp.Length);
     snprintf((char *)leda->ltpa.Version, 10, "%"PRIu32, led->ltp.Version);
     snprintf((char *)leda->ltpa.MachineID, 17, "%s", led->ltp.MachineID);
@@ -2072,9 +3026,6 @@ int get_extradata_a(struct LIF_EXTRA_DATA * led, struct LIF_EXTRA_DATA_A * leda)
   }
   else
   {
-    snprintf((char *)leda->ltpa.Posn, 8, "[N/A]");
-    snprintf((char *)leda->ltpa.Size, 10, "[N/A]");
-    snprintf((char *)leda->ltpa.sig, 10, "[N/A]");
     snprintf((char *)leda->ltpa.Length, 10, "[N/A]");
     snprintf((char *)leda->ltpa.Version, 10, "[N/A]");
     snprintf((char *)leda->ltpa.MachineID, 17, "[N/A]");
@@ -2207,7 +3158,7 @@ void get_flag_a(unsigned char *flag_str, struct LIF_HDR *lh)
   if (lh->Flags & 0x4000000)
     strcat((char *)flag_str, "KeepLocalIDListForUNCTarget | ");
 
-  if (strlen((char *)flag_str) > 0)
+  if (strlen((char *)flag_str) > 3)
     flag_str[strlen((char *)flag_str) - 3] = (unsigned char)0;
   return;
 }
@@ -2276,14 +3227,14 @@ void get_attr_a(unsigned char *attr_str, struct LIF_HDR *lh)
 //return the unsigned long integer
 //The definition of unsigned long is the one from the Microsoft (TM) open
 //document 'MS_SHLLINK'
-uint32_t get_le_uint32(unsigned char buf[], int pos)
+uint32_t get_le_uint32(const unsigned char buf[], int pos)
 {
   int i;
   uint32_t result = 0;
 
   for (i = 0; i < 4; i++)
   {
-    result += (buf[(i + pos)] << (8 * i));
+    result += ((uint32_t)buf[(i + pos)] << (8 * i));
   }
   return result;
 }
@@ -2293,7 +3244,7 @@ uint32_t get_le_uint32(unsigned char buf[], int pos)
 //return the unsigned long integer
 //The definition of unsigned long is the one from the Microsoft (TM) open
 //document 'MS_SHLLINK'
-uint64_t get_le_uint64(unsigned char buf[], int pos)
+uint64_t get_le_uint64(const unsigned char buf[], int pos)
 {
   uint64_t result = 0;
   uint32_t lo = 0, hi = 0; //Have to split the 64 bits in two
@@ -2309,7 +3260,7 @@ uint64_t get_le_uint64(unsigned char buf[], int pos)
 //return the unsigned long integer
 //The definition of unsigned long is the one from the Microsoft (TM) open
 //document 'MS_SHLLINK'
-int64_t get_le_int64(unsigned char buf[], int pos)
+int64_t get_le_int64(const unsigned char buf[], int pos)
 {
   int64_t result = 0;
   uint64_t interim = 0;
@@ -2335,14 +3286,14 @@ int64_t get_le_int64(unsigned char buf[], int pos)
 //return the signed long integer
 //The definition of signed long is the one from the Microsoft (TM) open
 //document 'MS_SHLLINK'
-int32_t get_le_int32(unsigned char buf[], int pos)
+int32_t get_le_int32(const unsigned char buf[], int pos)
 {
   int i;
   int32_t stor = 0;
 
   for (i = 0; i < 4; i++)
   {
-    stor += (buf[(i + pos)] << (8 * i));
+    stor += ((uint32_t)buf[(i + pos)] << (8 * i));
   }
   return stor;
 }
@@ -2352,14 +3303,14 @@ int32_t get_le_int32(unsigned char buf[], int pos)
 //return the unsigned integer
 //The definition of unsigned int is the one from the Microsoft (TM) open
 //document 'MS_SHLLINK'
-uint16_t get_le_uint16(unsigned char buf[], int pos)
+uint16_t get_le_uint16(const unsigned char buf[], int pos)
 {
   int i;
   uint16_t result = 0;
 
   for (i = 0; i < 2; i++)
   {
-    result += (buf[(i + pos)] << (8 * i));
+    result += ((uint32_t)buf[(i + pos)] << (8 * i));
   }
   return result;
 }
@@ -2369,14 +3320,14 @@ uint16_t get_le_uint16(unsigned char buf[], int pos)
 //return the signed short integer
 //The definition of signed short is the one from the Microsoft (TM) open
 //document 'MS_SHLLINK'
-int16_t get_le_int16(unsigned char buf[], int pos)
+int16_t get_le_int16(const unsigned char buf[], int pos)
 {
   int i;
   int32_t stor = 0;
 
   for (i = 0; i < 2; i++)
   {
-    stor += (buf[(i + pos)] << (8 * i));
+    stor += ((uint32_t)buf[(i + pos)] << (8 * i));
   }
   return stor;
 //
@@ -2385,71 +3336,117 @@ int16_t get_le_int16(unsigned char buf[], int pos)
 //ISO 8601 specification (i.e. 'yyyy-mm-dd hh:mm:ss')
 }
 //
-//Function get_filetime_a_short(struct FILETIME ft) returns the character string
-//representation of the Filetime passed in ft. The output is as per the
-//ISO 8601 specification (i.e. 'yyyy-mm-dd hh:mm:ss')
+//Function get_filetime_a_short(int64_t ft, unsigned char result[]) puts the
+//character string representation of the FILETIME ft in result (at least 30
+//bytes). The output is as per the ISO 8601 specification
+//(i.e. 'yyyy-mm-dd hh:mm:ss'). Every FILETIME Windows accepts (years 1601 to
+//30828) can be converted and no library time functions are used so it is
+//safe to call from several threads at once.
 void get_filetime_a_short(int64_t ft, unsigned char result[])
 {
-  struct tm* tms;
-  time_t time;
-  int64_t epoch_diff = 11644473600LL, cns2sec = 10000000L;
-
-  ft = ft / cns2sec; //Reduce to seconds
-  ft = ft - epoch_diff; //Number of seconds between epoch dates
+  char * p;
 
-  if ((sizeof(time_t) == sizeof(int64_t)) && ((ft > 0) && (ft < 0x7FFFFFFFL)))
+  if (ft == 0)
   {
-    time = (time_t)ft;
-    tms = gmtime(&time);
-    strftime((char *)result, 29, "%Y-%m-%d %H:%M:%S (UTC)", tms);
+    snprintf((char *)result, 30, "Date not set (i.e. 0 value)");
   }
-  //Can't cope with large time_t values
-  else if (ft == -11644473600LL)
+  else if (ft < 0) //Windows won't convert FILETIMEs with the top bit set
   {
-    snprintf((char *)result, 30, "Date not set (i.e. 0 value)");
+    snprintf((char *)result, 30, "Could not convert");
   }
   else
   {
-    snprintf((char *)result, 30, "Could not convert");
+    p = put_datetime((char *)result, (uint64_t)ft / 10000000);
+    memcpy(p, " (UTC)", 7);
   }
 }
 //
-//Function get_filetime_a_long(struct FILETIME ft) returns the character string
-//representation of the Filetime passed in ft. The output is as per the
-//ISO 8601 specification (i.e. 'yyyy-mm-dd hh:mm:ss.sssssss')
+//Function get_filetime_a_long(int64_t ft, unsigned char result[]) puts the
+//character string representation of the FILETIME ft in result (at least 40
+//bytes). The output is as per the ISO 8601 specification
+//(i.e. 'yyyy-mm-dd hh:mm:ss.sssssss'), see get_filetime_a_short().
 void get_filetime_a_long(int64_t ft, unsigned char result[])
 {
-  struct tm* tms;
-  time_t time;
-  uint64_t cns; //100 nanosecond component
-  int64_t epoch_diff = 11644473600LL, cns2sec = 10000000;
-  unsigned char interim[30];
+  char * p;
 
-  cns = (uint64_t)ft%cns2sec; //Extract the 100 nanosecond component
-  ft = ft / cns2sec; //Reduce to seconds
-  ft = ft - epoch_diff; //Number of seconds between epoch dates
-  if ((sizeof(time_t) == sizeof(int64_t)) && ((ft > 0) && (ft < 0x7FFFFFFFL)))
+  if (ft == 0)
   {
-    time = (time_t)ft;
-    tms = gmtime(&time);
-    strftime((char *)interim, 29, "%Y-%m-%d %H:%M:%S", tms);
-    snprintf((char *)result, 40, "%s.%"PRIu64" (UTC)", interim, cns);
+    snprintf((char *)result, 40, "Date not set (i.e. 0 value)");
   }
-  //Can't cope with large time_t values
-  else if (ft == -11644473600LL)
+  else if (ft < 0)
   {
-    snprintf((char *)result, 40, "Date not set (i.e. 0 value)");
+    snprintf((char *)result, 40, "Could not convert");
   }
   else
   {
-    snprintf((char *)result, 40, "Could not convert");
+    p = put_datetime((char *)result, (uint64_t)ft / 10000000);
+    *p++ = '.';
+    p = put_digits(p, (uint32_t)((uint64_t)ft % 10000000), 7); //100 nanosecond component
+    memcpy(p, " (UTC)", 7);
+  }
+}
+//
+//Function put_datetime(char* p, uint64_t secs) writes the date and time secs
+//seconds after 1601-01-01 00:00:00 to p as 'yyyy-mm-dd hh:mm:ss' (with a five
+//digit year after 9999) and returns a pointer to the character after it. It
+//isn't zero terminated.
+//The date is found with the days to civil algorithm (Howard Hinnant) which
+//counts in 400 year eras from 0000-03-01 so that the leap day falls at the
+//end of each year.
+char * put_datetime(char* p, uint64_t secs)
+{
+  uint64_t days, era, doe, yoe, year;
+  uint32_t sod, doy, mp, month, day;
+
+  days = secs / 86400;
+  sod = (uint32_t)(secs % 86400);
+  days += 584694; //Days from 0000-03-01 to 1601-01-01
+  era = days / 146097;
+  doe = days - (era * 146097); //[0, 146096]
+  yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365; //[0, 399]
+  year = yoe + (era * 400);
+  doy = (uint32_t)(doe - ((365 * yoe) + (yoe / 4) - (yoe / 100))); //[0, 365]
+  mp = ((5 * doy) + 2) / 153; //[0, 11] with March as 0
+  day = doy - (((153 * mp) + 2) / 5) + 1;
+  month = (mp < 10) ? mp + 3 : mp - 9;
+  if (month <= 2)
+  {
+    year++;
+  }
+
+  p = put_digits(p, (uint32_t)year, (year > 9999) ? 5 : 4);
+  *p++ = '-';
+  p = put_digits(p, month, 2);
+  *p++ = '-';
+  p = put_digits(p, day, 2);
+  *p++ = ' ';
+  p = put_digits(p, sod / 3600, 2);
+  *p++ = ':';
+  p = put_digits(p, (sod / 60) % 60, 2);
+  *p++ = ':';
+  p = put_digits(p, sod % 60, 2);
+  return p;
+}
+//
+//Function put_digits(char* p, uint32_t val, int num) writes the lowest num
+//decimal digits of val to p (with leading zeros) and returns a pointer to the
+//character after them
+char * put_digits(char* p, uint32_t val, int num)
+{
+  int i;
+
+  for (i = num - 1; i >= 0; i--)
+  {
+    p[i] = (char)('0' + (val % 10));
+    val /= 10;
   }
+  return p + num;
 }
 //
 //Function get_chars(unsigned char buf[], int pos ,int num, unsigned char targ[])
 // reads num unsigned characters starting at pos in buf. It will interpret these
 // as big endian (straight copy) and place them in targ
-void get_chars(unsigned char buf[], int pos, int num, unsigned char targ[])
+void get_chars(const unsigned char buf[], int pos, int num, unsigned char targ[])
 {
   int i;
 
@@ -2459,13 +3456,79 @@ void get_chars(unsigned char buf[], int pos, int num, unsigned char targ[])
   }
 }
 //
+//Function get_bytes(const unsigned char *buf, size_t len, size_t pos,
+// size_t num, unsigned char targ[]) copies num bytes starting at pos in buf
+// (which is len bytes long) into targ. Any bytes that would lie beyond the end
+// of buf are set to 0 in targ. Returns the number of bytes actually copied.
+size_t get_bytes(const unsigned char *buf, size_t len, size_t pos, size_t num, unsigned char targ[])
+{
+  size_t avail = 0;
+
+  if (pos < len)
+  {
+    avail = len - pos;
+  }
+  if (avail > num)
+  {
+    avail = num;
+  }
+  if (avail > 0)
+  {
+    memcpy(targ, &buf[pos], avail);
+  }
+  if (avail < num)
+  {
+    memset(&targ[avail], 0, num - avail);
+  }
+  return avail;
+}
+//
+//Function span_ok(size_t len, size_t pos, size_t num) returns 1 if the num
+// bytes starting at pos all lie inside a buffer of len bytes, 0 if not.
+int span_ok(size_t len, size_t pos, size_t num)
+{
+  return ((pos <= len) && (num <= (len - pos)));
+}
+//
+//Function get_cstr(const unsigned char *buf, size_t len, size_t pos,
+// size_t max, unsigned char targ[]) copies a NULL terminated string from
+// pos in buf (which is len bytes long) into targ. It stops at the NULL, the
+// end of buf or when max - 1 characters have been copied. targ is always NULL
+// terminated and is an empty string if pos is outside buf.
+void get_cstr(const unsigned char *buf, size_t len, size_t pos, size_t max, unsigned char targ[])
+{
+  size_t i = 0;
+
+  while ((pos < len) && (i < (len - pos)) && (i < (max - 1)) && (buf[pos + i] != 0))
+  {
+    targ[i] = buf[pos + i];
+    i++;
+  }
+  targ[i] = 0;
+}
+//
+//Function prop_strlen(const unsigned char value[], int max) returns the
+// length field at the start of a serialized string property, clamped to
+// between 2 and max so that a damaged value cannot index outside the buffer
+// it is copied into.
+int prop_strlen(const unsigned char value[], int max)
+{
+  uint32_t len = get_le_uint32(value, 0);
+
+  if (len < 2)
+  {
+    return 2;
+  }
+  return (len > (uint32_t)max) ? max : (int)len;
+}
+//
 //Function get_le_unistr(unsigned char buf[], int pos, int max, wchar_t targ[])
 //Fetches a unicode string from buf starting at position pos. It quits when a
 //(wchar_t) 0 is encountered or max (in whchar_t terms) characters are copied.
 //The encoding is considered to be the Windows default (little endian)
 //The result is placed in targ. The function returns the number of wchar_t
 //characters that have been copied or -1 on failure.
-int get_le_unistr(unsigned char buf[], int pos, int max, wchar_t targ[])
+int get_le_unistr(const unsigned char buf[], int pos, int max, wchar_t targ[])
 {
   int i, n = 0;
   uint16_t widechar;
@@ -2488,10 +3551,28 @@ int get_le_unistr(unsigned char buf[], int pos, int max, wchar_t targ[])
   return n;
 }
 //
+//Function get_le_unistr_n(const unsigned char *buf, size_t len, size_t pos,
+// int max, wchar_t targ[]) is get_le_unistr() for a buffer that is len bytes
+// long. The string is cut short rather than read beyond the end of buf.
+int get_le_unistr_n(const unsigned char *buf, size_t len, size_t pos, int max, wchar_t targ[])
+{
+  size_t avail = 0;
+
+  if (pos < len)
+  {
+    avail = (len - pos) / 2;
+  }
+  if (avail < (size_t)(max - 1))
+  {
+    max = (int)avail + 1;
+  }
+  return get_le_unistr(buf, (int)pos, max, targ);
+}
+//
 //Function void get_ltp(struct LIF_TRACKER_PROPS *, unsigned char[]);
 //fills the LIF_TRACKER_PROPS properties with the relevant data from the
 //character buffer
-void get_ltp(struct LIF_TRACKER_PROPS * ltp, unsigned char * data_buf)
+void get_ltp(struct LIF_TRACKER_PROPS * ltp, const unsigned char * data_buf)
 {
   int pos = 0;
 
@@ -2554,7 +3635,8 @@ void get_ltp(struct LIF_TRACKER_PROPS * ltp, unsigned char * data_buf)
 void get_droid_a(struct LIF_CLSID * droid, struct LIF_CLSID_A * droid_a)
 {
   uint8_t  Version, Variant;
-  int16_t Timehi, ClockSeq;
+  int16_t Timehi;
+  uint16_t ClockSeq;
   int64_t Time;
   // Build the UUID string
   snprintf((char *)droid_a->UUID, 40, "{%.8"PRIX32"-%.4"PRIX16"-%.4"PRIX16"-%.2"PRIX8"%.2"PRIX8"-%.2"PRIX8"%.2"PRIX8"%.2"PRIX8"%.2"PRIX8"%.2"PRIX8"%.2"PRIX8"}",
@@ -2616,8 +3698,7 @@ void get_droid_a(struct LIF_CLSID * droid, struct LIF_CLSID_A * droid_a)
   if (Version == 1)
   {
     //Work out the Clock Sequence
-    ClockSeq = ((uint16_t)((droid->Data4hi[0] & 0x3F << 8)))
-      | (droid->Data4hi[1]);
+    ClockSeq = (uint16_t)(((droid->Data4hi[0] & 0x3F) << 8) | droid->Data4hi[1]);
     snprintf((char *)droid_a->ClockSeq, 10, "%"PRIu16, ClockSeq);
 
     //Work out the time
@@ -2654,6 +3735,32 @@ void get_droid_a(struct LIF_CLSID * droid, struct LIF_CLSID_A * droid_a)
   }
 }
 //
+//Function ed_minsize(uint32_t sig) returns the number of data bytes (i.e.
+//excluding the size and signature) that get_extradata() reads from an
+//ExtraData block with signature sig.
+uint32_t ed_minsize(uint32_t sig)
+{
+  switch (sig)
+  {
+  case 0xA0000001: // EnvironmentVariableDataBlock
+  case 0xA0000006: // DarwinDataBlock
+  case 0xA0000007: // IconEnvironmentDataBlock
+    return 780;
+  case 0xA0000002: // ConsoleDataBlock
+    return 196;
+  case 0xA0000003: // TrackerDataBlock
+    return 88;
+  case 0xA0000004: // ConsoleFEDataBlock
+    return 4;
+  case 0xA0000005: // SpecialFolderDataBlock
+    return 8;
+  case 0xA000000B: // KnownFolderDataBlock
+    return 20;
+  default:         // Variable length blocks are bounds checked as they are read
+    return 0;
+  }
+}
+//
 //Function led_setnull(struct LIF_EXTRA_DATA * led) just sets all the Extra Data
 //structures to 0
 void led_setnull(struct LIF_EXTRA_DATA * led)
@@ -2716,3 +3823,846 @@ void led_setnull(struct LIF_EXTRA_DATA * led)
 
   led->terminal = 0;
 }
+//
+//Function get_lif_view(const uint8_t* buf, size_t len, struct LIF_VIEW* view)
+//finds the parts of the link file held in buf (len bytes long) and records
+//their positions in view. Nothing is copied or decoded apart from the header
+//and a few fixed size values so there are no limits on the sizes or numbers
+//of any of the parts. Returns LIF_OK or one of the (negative) LIF_ERR values.
+extern int get_lif_view(const uint8_t* buf, size_t len, struct LIF_VIEW* view)
+{
+  uint32_t pos, size, li, end, off, isize, i;
+  int      result;
+
+  memset(view, 0, sizeof(struct LIF_VIEW));
+  if (len > 0xFFFFFFFF) //Spans are 32 bit but no link file comes close to that
+  {
+    len = 0xFFFFFFFF;
+  }
+  view->buf = buf;
+  view->len = len;
+  if (get_lhdr(buf, len, &view->lh) < 0)
+  {
+    return LIF_ERR_HDR;
+  }
+  if ((result = lhdr_err(test_lhdr(&view->lh))) != LIF_OK)
+  {
+    return result;
+  }
+  pos = 0x4C;
+
+  //S2.2 LinkTargetIDList
+  if (view->lh.Flags & 0x00000001)
+  {
+    if (!span_ok(len, pos, 2))
+    {
+      return LIF_ERR_IDLIST;
+    }
+    size = get_le_uint16(buf, (int)pos);
+    if (!span_ok(len, pos + 2, size) || (size < 2))
+    {
+      return LIF_ERR_IDLIST;
+    }
+    view->IDList.Offset = pos + 2;
+    view->IDList.Length = size - 2; //Less the TerminalID
+    //Count the ItemIDs, checking that none of them overruns the list
+    for (off = 0; off < view->IDList.Length; off += isize)
+    {
+      isize = get_le_uint16(buf, (int)(view->IDList.Offset + off));
+      if ((isize < 2) || (isize > view->IDList.Length - off))
+      {
+        return LIF_ERR_IDLIST;
+      }
+      view->NumItemIDs++;
+    }
+    pos += 2 + size;
+  }
+
+  //S2.3 LinkInfo
+  if (view->lh.Flags & 0x00000002)
+  {
+    if (!span_ok(len, pos, 0x1C))
+    {
+      return LIF_ERR_LINKINFO;
+    }
+    size = get_le_uint32(buf, (int)pos);
+    if ((size < 0x1C) || !span_ok(len, pos, size))
+    {
+      return LIF_ERR_LINKINFO;
+    }
+    li = pos;
+    end = li + size;
+    view->LinkInfo.Offset = li;
+    view->LinkInfo.Length = size;
+    view->LinkInfoFlags = get_le_uint32(buf, (int)li + 8);
+    //VolumeID
+    off = get_le_uint32(buf, (int)li + 12);
+    if ((view->LinkInfoFlags & 0x00000001) && (off >= 0x1C) && (off <= size - 0x10))
+    {
+      view->VolumeID.Offset = li + off;
+      view->VolumeID.Length = get_le_uint32(buf, (int)(li + off));
+      if ((view->VolumeID.Length < 0x10) || (view->VolumeID.Length > size - off))
+      {
+        return LIF_ERR_LINKINFO;
+      }
+      view->DriveType = get_le_uint32(buf, (int)(li + off + 4));
+      view->DriveSN = get_le_uint32(buf, (int)(li + off + 8));
+      i = get_le_uint32(buf, (int)(li + off + 12)); //VolumeLabelOffset
+      if ((i == 0x14) && (view->VolumeID.Length >= 0x14))
+      {
+        i = get_le_uint32(buf, (int)(li + off + 16)); //VolumeLabelOffsetUnicode
+        view_ustr(view, view->VolumeID.Offset, i, view->VolumeID.Length, &view->VolumeLabelU);
+      }
+      else
+      {
+        view_cstr(view, view->VolumeID.Offset, i, view->VolumeID.Length, &view->VolumeLabel);
+      }
+    }
+    if (view->LinkInfoFlags & 0x00000001)
+    {
+      view_cstr(view, li, get_le_uint32(buf, (int)li + 16), size, &view->LBP);
+    }
+    //CommonNetworkRelativeLink
+    off = get_le_uint32(buf, (int)li + 20);
+    if ((view->LinkInfoFlags & 0x00000002) && (off >= 0x1C) && (off <= size - 0x14))
+    {
+      view->CNR.Offset = li + off;
+      view->CNR.Length = get_le_uint32(buf, (int)(li + off));
+      if ((view->CNR.Length < 0x14) || (view->CNR.Length > size - off))
+      {
+        return LIF_ERR_LINKINFO;
+      }
+      view->CNRFlags = get_le_uint32(buf, (int)(li + off + 4));
+      view->NetworkProviderType = get_le_uint32(buf, (int)(li + off + 16));
+      i = get_le_uint32(buf, (int)(li + off + 8)); //NetNameOffset
+      view_cstr(view, view->CNR.Offset, i, view->CNR.Length, &view->NetName);
+      if (view->CNRFlags & 0x00000001)
+      {
+        view_cstr(view, view->CNR.Offset, get_le_uint32(buf, (int)(li + off + 12)),
+          view->CNR.Length, &view->DeviceName);
+      }
+      if ((i > 0x14) && (view->CNR.Length >= 0x1C))
+      {
+        view_ustr(view, view->CNR.Offset, get_le_uint32(buf, (int)(li + off + 20)),
+          view->CNR.Length, &view->NetNameU);
+        if (view->CNRFlags & 0x00000001)
+        {
+          view_ustr(view, view->CNR.Offset, get_le_uint32(buf, (int)(li + off + 24)),
+            view->CNR.Length, &view->DeviceNameU);
+        }
+      }
+    }
+    view_cstr(view, li, get_le_uint32(buf, (int)li + 24), size, &view->CPS);
+    if ((get_le_uint32(buf, (int)li + 4) >= 0x24) && (size >= 0x24))
+    {
+      view_ustr(view, li, get_le_uint32(buf, (int)li + 28), size, &view->LBPU);
+      view_ustr(view, li, get_le_uint32(buf, (int)li + 32), size, &view->CPSU);
+    }
+    pos = end;
+  }
+
+  //S2.4 StringData
+  view->StringUnicode = ((view->lh.Flags & 0x00000080) != 0);
+  for (i = 0; i < 5; i++)
+  {
+    if (view->lh.Flags & (0x00000004 << i))
+    {
+      if (!span_ok(len, pos, 2))
+      {
+        return LIF_ERR_STRINGDATA;
+      }
+      size = get_le_uint16(buf, (int)pos) * (view->StringUnicode ? 2 : 1);
+      if (!span_ok(len, pos + 2, size))
+      {
+        return LIF_ERR_STRINGDATA;
+      }
+      view->StringData[i].Offset = pos + 2;
+      view->StringData[i].Length = size;
+      pos += 2 + size;
+    }
+  }
+
+  //S2.5 ExtraData (its blocks are checked by lif_next_block())
+  view->ExtraData.Offset = pos;
+  view->ExtraData.Length = (uint32_t)len - pos;
+  return LIF_OK;
+}
+//
+//Function view_cstr() sets str to the code page string that starts off bytes
+//into the structure at base (size bytes long). The string runs up to its
+//terminator or the end of the structure. str is left empty if off is 0 or
+//outside the structure.
+void view_cstr(const struct LIF_VIEW* view, uint32_t base, uint32_t off, uint32_t size, struct LIF_SPAN* str)
+{
+  const uint8_t * p;
+  uint32_t        n = 0;
+
+  str->Offset = 0;
+  str->Length = 0;
+  if ((off == 0) || (off >= size))
+  {
+    return;
+  }
+  p = &view->buf[base + off];
+  while ((n < size - off) && (p[n] != 0))
+  {
+    n++;
+  }
+  str->Offset = base + off;
+  str->Length = n;
+}
+//
+//Function view_ustr() is view_cstr() for UTF-16LE strings
+void view_ustr(const struct LIF_VIEW* view, uint32_t base, uint32_t off, uint32_t size, struct LIF_SPAN* str)
+{
+  const uint8_t * p;
+  uint32_t        n = 0;
+
+  str->Offset = 0;
+  str->Length = 0;
+  if ((off == 0) || (off >= size))
+  {
+    return;
+  }
+  p = &view->buf[base + off];
+  while ((n + 1 < size - off) && ((p[n] != 0) || (p[n + 1] != 0)))
+  {
+    n += 2;
+  }
+  str->Offset = base + off;
+  str->Length = n;
+}
+//
+//Function lif_next_itemid(const struct LIF_VIEW* view, uint32_t* pos, struct LIF_SPAN* item)
+//sets item to the data of the ItemID at *pos in the LinkTargetIDList and moves
+//*pos on to the next one. Returns 1 or 0 if there are no more ItemIDs.
+extern int lif_next_itemid(const struct LIF_VIEW* view, uint32_t* pos, struct LIF_SPAN* item)
+{
+  uint32_t size;
+
+  if (*pos + 2 > view->IDList.Length)
+  {
+    return 0;
+  }
+  //get_lif_view() has checked every ItemID fits
+  size = get_le_uint16(view->buf, (int)(view->IDList.Offset + *pos));
+  item->Offset = view->IDList.Offset + *pos + 2;
+  item->Length = size - 2;
+  *pos += size;
+  return 1;
+}
+//
+//Function lif_next_block(const struct LIF_VIEW* view, uint32_t* pos, uint32_t* sig, struct LIF_SPAN* block)
+//sets sig and block to the signature and data of the ExtraData block at *pos
+//and moves *pos on to the next one. Returns 1 or 0 at the TerminalBlock, the
+//end of the file or a block that doesn't fit in the file.
+extern int lif_next_block(const struct LIF_VIEW* view, uint32_t* pos, uint32_t* sig, struct LIF_SPAN* block)
+{
+  uint32_t size;
+
+  if ((*pos > view->ExtraData.Length) || (view->ExtraData.Length - *pos < 8))
+  {
+    return 0;
+  }
+  size = get_le_uint32(view->buf, (int)(view->ExtraData.Offset + *pos));
+  if ((size < 8) || (size > view->ExtraData.Length - *pos))
+  {
+    return 0;
+  }
+  *sig = get_le_uint32(view->buf, (int)(view->ExtraData.Offset + *pos + 4));
+  block->Offset = view->ExtraData.Offset + *pos + 8;
+  block->Length = size - 8;
+  *pos += size;
+  return 1;
+}
+//
+//Function lif_next_propstore(const struct LIF_VIEW* view, struct LIF_SPAN storage, uint32_t* pos, struct LIF_SPAN* store)
+//sets store to the whole of the property store at *pos in the serialized
+//property storage and moves *pos on to the next one. Returns 1 or 0 at the
+//empty store that ends the storage or a store that doesn't fit.
+extern int lif_next_propstore(const struct LIF_VIEW* view, struct LIF_SPAN storage, uint32_t* pos, struct LIF_SPAN* store)
+{
+  uint32_t size;
+
+  if ((*pos > storage.Length) || (storage.Length - *pos < 4))
+  {
+    return 0;
+  }
+  size = get_le_uint32(view->buf, (int)(storage.Offset + *pos));
+  //Size, Version & FormatID come to 24 bytes
+  if ((size < 24) || (size > storage.Length - *pos))
+  {
+    return 0;
+  }
+  store->Offset = storage.Offset + *pos;
+  store->Length = size;
+  *pos += size;
+  return 1;
+}
+//
+//Function lif_next_propvalue(const struct LIF_VIEW* view, struct LIF_SPAN store, uint32_t* pos, struct LIF_SPAN* value)
+//sets value to the whole of the property value at *pos in the property store
+//(starting from the first value if *pos is 0) and moves *pos on to the next
+//one. Returns 1 or 0 at the empty value that ends the store or a value that
+//doesn't fit.
+extern int lif_next_propvalue(const struct LIF_VIEW* view, struct LIF_SPAN store, uint32_t* pos, struct LIF_SPAN* value)
+{
+  uint32_t size;
+
+  if (*pos < 24) //Skip Size, Version & FormatID
+  {
+    *pos = 24;
+  }
+  if ((*pos > store.Length) || (store.Length - *pos < 4))
+  {
+    return 0;
+  }
+  size = get_le_uint32(view->buf, (int)(store.Offset + *pos));
+  //ValueSize, Name Size/ID & Reserved come to 9 bytes
+  if ((size < 9) || (size > store.Length - *pos))
+  {
+    return 0;
+  }
+  value->Offset = store.Offset + *pos;
+  value->Length = size;
+  *pos += size;
+  return 1;
+}
+//
+//Function lif_span_ptr(const struct LIF_VIEW* view, struct LIF_SPAN span)
+//returns a pointer to the first byte of span or NULL if it is empty
+extern const uint8_t * lif_span_ptr(const struct LIF_VIEW* view, struct LIF_SPAN span)
+{
+  if ((span.Length == 0) || !span_ok(view->len, span.Offset, span.Length))
+  {
+    return NULL;
+  }
+  return &view->buf[span.Offset];
+}
+//
+//Function lif_span_cstr(const struct LIF_VIEW* view, struct LIF_SPAN span, char* str, size_t size)
+//copies the code page string in span to str (size bytes long) and zero
+//terminates it. The copy stops at a terminator in the span. Returns the length
+//of the whole string, which is size or more if it had to be truncated.
+extern size_t lif_span_cstr(const struct LIF_VIEW* view, struct LIF_SPAN span, char* str, size_t size)
+{
+  const uint8_t * p = lif_span_ptr(view, span);
+  size_t          n = 0;
+
+  if (p != NULL)
+  {
+    while ((n < span.Length) && (p[n] != 0))
+    {
+      if (n + 1 < size)
+      {
+        str[n] = (char)p[n];
+      }
+      n++;
+    }
+  }
+  if (size > 0)
+  {
+    str[(n < size) ? n : size - 1] = 0;
+  }
+  return n;
+}
+//
+//Function lif_span_utf16(const struct LIF_VIEW* view, struct LIF_SPAN span, char* str, size_t size)
+//converts the UTF-16LE string in span to UTF-8 in str (size bytes long) and
+//zero terminates it. Unpaired surrogates become U+FFFD and the conversion
+//stops at a terminator in the span. Only whole characters are written.
+//Returns the length of the whole UTF-8 string, which is size or more if it
+//had to be truncated.
+extern size_t lif_span_utf16(const struct LIF_VIEW* view, struct LIF_SPAN span, char* str, size_t size)
+{
+  const uint8_t * p = lif_span_ptr(view, span);
+  size_t          n = 0, w = 0, k, i;
+  uint32_t        c, c2;
+  unsigned char   u[4];
+
+  for (i = 0; (p != NULL) && (i + 1 < span.Length); i += 2)
+  {
+    c = p[i] | ((uint32_t)p[i + 1] << 8);
+    if (c == 0)
+    {
+      break;
+    }
+    if ((c >= 0xD800) && (c <= 0xDBFF) && (i + 3 < span.Length))
+    {
+      c2 = p[i + 2] | ((uint32_t)p[i + 3] << 8);
+      if ((c2 >= 0xDC00) && (c2 <= 0xDFFF))
+      {
+        c = 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+        i += 2;
+      }
+    }
+    if ((c >= 0xD800) && (c <= 0xDFFF))
+    {
+      c = 0xFFFD;
+    }
+    if (c < 0x80)
+    {
+      u[0] = (unsigned char)c;
+      k = 1;
+    }
+    else if (c < 0x800)
+    {
+      u[0] = (unsigned char)(0xC0 | (c >> 6));
+      u[1] = (unsigned char)(0x80 | (c & 0x3F));
+      k = 2;
+    }
+    else if (c < 0x10000)
+    {
+      u[0] = (unsigned char)(0xE0 | (c >> 12));
+      u[1] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+      u[2] = (unsigned char)(0x80 | (c & 0x3F));
+      k = 3;
+    }
+    else
+    {
+      u[0] = (unsigned char)(0xF0 | (c >> 18));
+      u[1] = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+      u[2] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+      u[3] = (unsigned char)(0x80 | (c & 0x3F));
+      k = 4;
+    }
+    if ((w == n) && (n + k < size))
+    {
+      memcpy(&str[n], u, k);
+      w = n + k;
+    }
+    n += k;
+  }
+  if (size > 0)
+  {
+    str[(w < size) ? w : size - 1] = 0;
+  }
+  return n;
+}
+//
+//Function lif_visit(const uint8_t* buf, size_t len, const struct LIF_VISITOR* visitor, void* ctx)
+//walks the link file held in buf (len bytes long) in file order, calling the
+//visitor's functions for the header, each ItemID, the LinkInfo, each StringData
+//string, each ExtraData block and each value in a PropertyStoreDataBlock. Any
+//of them may be NULL and the parts they would be called for are then skipped
+//(property stores aren't even stepped through without a propvalue function).
+//Nothing is copied so there are no limits on the number or size of the parts.
+//Returns LIF_OK once everything has been visited, a (negative) LIF_ERR value if
+//the link file couldn't be decoded or the (positive) value returned by a
+//function to stop the walk.
+extern int lif_visit(const uint8_t* buf, size_t len, const struct LIF_VISITOR* visitor, void* ctx)
+{
+  struct LIF_VIEW view;
+  struct LIF_SPAN span;
+  uint32_t        pos, sig, i;
+  int             result;
+
+  if ((result = get_lif_view(buf, len, &view)) != LIF_OK)
+  {
+    return result;
+  }
+  if ((visitor->header != NULL) && ((result = visitor->header(ctx, &view)) != 0))
+  {
+    return result;
+  }
+  if (visitor->itemid != NULL)
+  {
+    for (pos = 0, i = 0; lif_next_itemid(&view, &pos, &span); i++)
+    {
+      if ((result = visitor->itemid(ctx, &view, i, span)) != 0)
+      {
+        return result;
+      }
+    }
+  }
+  if ((visitor->linkinfo != NULL) && (view.LinkInfo.Length > 0) &&
+    ((result = visitor->linkinfo(ctx, &view)) != 0))
+  {
+    return result;
+  }
+  if (visitor->stringdata != NULL)
+  {
+    for (i = 0; i < 5; i++)
+    {
+      if ((view.lh.Flags & (0x00000004 << i)) &&
+        ((result = visitor->stringdata(ctx, &view, (int)i, view.StringData[i])) != 0))
+      {
+        return result;
+      }
+    }
+  }
+  if ((visitor->block != NULL) || (visitor->propvalue != NULL))
+  {
+    for (pos = 0; lif_next_block(&view, &pos, &sig, &span);)
+    {
+      if ((visitor->block != NULL) && ((result = visitor->block(ctx, &view, sig, span)) != 0))
+      {
+        return result;
+      }
+      if ((visitor->propvalue != NULL) && (sig == 0xA0000009) &&
+        ((result = visit_props(&view, span, visitor, ctx)) != 0))
+      {
+        return result;
+      }
+    }
+  }
+  return LIF_OK;
+}
+//
+//Function visit_props() calls the visitor's propvalue function for each value
+//in the serialized property storage. Returns 0 or the value that function
+//returned to stop the walk.
+int visit_props(const struct LIF_VIEW* view, struct LIF_SPAN storage, const struct LIF_VISITOR* visitor, void* ctx)
+{
+  struct LIF_PROP prop;
+  struct LIF_SPAN value;
+  uint32_t        spos, vpos, p;
+  int             named, result;
+
+  for (spos = 0; lif_next_propstore(view, storage, &spos, &prop.Store);)
+  {
+    p = prop.Store.Offset + 8;
+    prop.FormatID.Data1 = get_le_uint32(view->buf, (int)p);
+    prop.FormatID.Data2 = get_le_uint16(view->buf, (int)p + 4);
+    prop.FormatID.Data3 = get_le_uint16(view->buf, (int)p + 6);
+    get_chars(view->buf, (int)p + 8, 2, prop.FormatID.Data4hi);
+    get_chars(view->buf, (int)p + 10, 6, prop.FormatID.Data4lo);
+    //Values in the {D5CDD505-2E9C-101B-9397-08002B2CF9AE} store have names, not IDs
+    named = sig_match(&view->buf[p], (const uint8_t *)
+      "\x05\xD5\xCD\xD5\x9C\x2E\x1B\x10\x93\x97\x08\x00\x2B\x2C\xF9\xAE", 16);
+    for (vpos = 0, prop.Index = 0; lif_next_propvalue(view, prop.Store, &vpos, &value); prop.Index++)
+    {
+      //value is at least 9 bytes: ValueSize, Name Size/ID & Reserved
+      p = value.Offset + 9;
+      prop.ID = 0;
+      prop.Name.Offset = 0;
+      prop.Name.Length = 0;
+      if (named)
+      {
+        prop.Name.Length = get_le_uint32(view->buf, (int)value.Offset + 4);
+        if (prop.Name.Length > value.Length - 9)
+        {
+          break;
+        }
+        prop.Name.Offset = p;
+        p += prop.Name.Length;
+      }
+      else
+      {
+        prop.ID = get_le_uint32(view->buf, (int)value.Offset + 4);
+      }
+      //Type & Padding come before the value itself
+      if (value.Offset + value.Length - p < 4)
+      {
+        break;
+      }
+      prop.Type = get_le_uint16(view->buf, (int)p);
+      prop.Value.Offset = p + 4;
+      prop.Value.Length = value.Offset + value.Length - prop.Value.Offset;
+      if ((result = visitor->propvalue(ctx, view, &prop)) != 0)
+      {
+        return result;
+      }
+    }
+  }
+  return 0;
+}
+//
+//Function put_lif(const struct LIF_SPEC* spec, uint8_t* buf, size_t size)
+//makes the link file that spec describes in buf (size bytes long). The
+//sizes, offsets and signatures are all worked out here, as are the flags
+//that say which parts are present. Returns the size of the whole link file,
+//which is more than size if only the start of it fitted, or 0 if an ItemID,
+//the LinkTargetIDList or a StringData string is too big for its size field.
+extern size_t put_lif(const struct LIF_SPEC* spec, uint8_t* buf, size_t size)
+{
+  struct LIF_OUT out;
+  uint32_t       flags, i;
+  size_t         start, n;
+
+  out.buf = buf;
+  out.size = size;
+  out.pos = 0;
+  flags = spec->lh.Flags & ~0x0000007F; //The Has... flags are set from the parts given
+  if (spec->NumItemIDs > 0)
+  {
+    flags |= 0x00000001;
+  }
+  if ((spec->LocalBasePath != NULL) || (spec->NetName != NULL))
+  {
+    flags |= 0x00000002;
+  }
+  for (i = 0; i < 5; i++)
+  {
+    if (spec->StringData[i] != NULL)
+    {
+      flags |= 0x00000004 << i;
+    }
+  }
+
+  //S2.1 ShellLinkHeader
+  out_le(&out, 0x4C, 4);
+  out_bytes(&out, "\x01\x14\x02\x00\x00\x00\x00\x00\xC0\x00\x00\x00\x00\x00\x00\x46", 16);
+  out_le(&out, flags, 4);
+  out_le(&out, spec->lh.Attr, 4);
+  out_le(&out, (uint64_t)spec->lh.CrDate, 8);
+  out_le(&out, (uint64_t)spec->lh.AcDate, 8);
+  out_le(&out, (uint64_t)spec->lh.WtDate, 8);
+  out_le(&out, spec->lh.Size, 4);
+  out_le(&out, (uint32_t)spec->lh.IconIndex, 4);
+  out_le(&out, spec->lh.ShowState, 4);
+  out_le(&out, spec->lh.Hotkey.LowKey, 1);
+  out_le(&out, spec->lh.Hotkey.HighKey, 1);
+  out_bytes(&out, NULL, 10); //Reserved1, 2 & 3
+
+  //S2.2 LinkTargetIDList
+  if (flags & 0x00000001)
+  {
+    start = out.pos;
+    out_le(&out, 0, 2); //IDListSize (filled in below)
+    for (i = 0; i < spec->NumItemIDs; i++)
+    {
+      if (spec->ItemIDs[i].len > 0xFFFF - 2)
+      {
+        return 0;
+      }
+      out_le(&out, spec->ItemIDs[i].len + 2, 2);
+      out_bytes(&out, spec->ItemIDs[i].buf, spec->ItemIDs[i].len);
+    }
+    out_le(&out, 0, 2); //TerminalID
+    n = out.pos - start - 2;
+    if (n > 0xFFFF)
+    {
+      return 0;
+    }
+    out_le_at(&out, start, n, 2);
+  }
+
+  //S2.3 LinkInfo
+  if (flags & 0x00000002)
+  {
+    out_linkinfo(&out, spec);
+  }
+
+  //S2.4 StringData
+  for (i = 0; i < 5; i++)
+  {
+    if (flags & (0x00000004 << i))
+    {
+      start = out.pos;
+      out_le(&out, 0, 2); //CountCharacters (filled in below)
+      n = out_str(&out, spec->StringData[i], (flags & 0x00000080) != 0, 0);
+      if (n > 0xFFFF)
+      {
+        return 0;
+      }
+      out_le_at(&out, start, n, 2);
+    }
+  }
+
+  //S2.5 ExtraData
+  for (i = 0; i < spec->NumBlocks; i++)
+  {
+    if (spec->Blocks[i].Size > 0xFFFFFFFF - 8)
+    {
+      return 0;
+    }
+    out_le(&out, spec->Blocks[i].Size + 8, 4);
+    out_le(&out, spec->Blocks[i].Signature, 4);
+    out_bytes(&out, spec->Blocks[i].Data, spec->Blocks[i].Size);
+  }
+  out_le(&out, 0, 4); //TerminalBlock
+  return out.pos;
+}
+//
+//Function out_linkinfo() puts the LinkInfo structure that spec describes in
+//out. Its header is 0x24 bytes long if the Unicode strings are wanted too,
+//otherwise 0x1C. Each offset is filled in once the part it points to is put.
+void out_linkinfo(struct LIF_OUT* out, const struct LIF_SPEC* spec)
+{
+  size_t   li, vol, cnr;
+  uint32_t flags = 0, cnrflags = 0;
+  int      unicode = (spec->LinkInfoUnicode != 0);
+
+  if (spec->LocalBasePath != NULL)
+  {
+    flags |= 0x00000001; //VolumeIDAndLocalBasePath
+  }
+  if (spec->NetName != NULL)
+  {
+    flags |= 0x00000002; //CommonNetworkRelativeLinkAndPathSuffix
+  }
+  li = out->pos;
+  out_le(out, 0, 4); //LinkInfoSize (filled in below)
+  out_le(out, unicode ? 0x24 : 0x1C, 4);
+  out_le(out, flags, 4);
+  out_bytes(out, NULL, unicode ? 0x18 : 0x10); //The offsets (filled in below)
+  if (flags & 0x00000001)
+  {
+    out_le_at(out, li + 12, out->pos - li, 4);
+    vol = out->pos;
+    out_le(out, 0, 4); //VolumeIDSize (filled in below)
+    out_le(out, spec->DriveType, 4);
+    out_le(out, spec->DriveSN, 4);
+    if (unicode)
+    {
+      out_le(out, 0x14, 4); //VolumeLabelOffset says to use VolumeLabelOffsetUnicode
+      out_le(out, 0x14, 4);
+    }
+    else
+    {
+      out_le(out, 0x10, 4);
+    }
+    out_str(out, (spec->VolumeLabel != NULL) ? spec->VolumeLabel : "", unicode, 1);
+    out_le_at(out, vol, out->pos - vol, 4);
+    out_le_at(out, li + 16, out->pos - li, 4);
+    out_str(out, spec->LocalBasePath, 0, 1);
+  }
+  if (flags & 0x00000002)
+  {
+    out_le_at(out, li + 20, out->pos - li, 4);
+    cnr = out->pos;
+    if (spec->DeviceName != NULL)
+    {
+      cnrflags |= 0x00000001; //ValidDevice
+    }
+    if (spec->NetworkProviderType != 0)
+    {
+      cnrflags |= 0x00000002; //ValidNetType
+    }
+    out_le(out, 0, 4); //CommonNetworkRelativeLinkSize (filled in below)
+    out_le(out, cnrflags, 4);
+    out_bytes(out, NULL, 8); //NetNameOffset & DeviceNameOffset (filled in below)
+    out_le(out, spec->NetworkProviderType, 4);
+    if (unicode)
+    {
+      out_bytes(out, NULL, 8); //NetNameOffsetUnicode & DeviceNameOffsetUnicode
+    }
+    out_le_at(out, cnr + 8, out->pos - cnr, 4);
+    out_str(out, spec->NetName, 0, 1);
+    if (cnrflags & 0x00000001)
+    {
+      out_le_at(out, cnr + 12, out->pos - cnr, 4);
+      out_str(out, spec->DeviceName, 0, 1);
+    }
+    if (unicode)
+    {
+      out_le_at(out, cnr + 20, out->pos - cnr, 4);
+      out_str(out, spec->NetName, 1, 1);
+      if (cnrflags & 0x00000001)
+      {
+        out_le_at(out, cnr + 24, out->pos - cnr, 4);
+        out_str(out, spec->DeviceName, 1, 1);
+      }
+    }
+    out_le_at(out, cnr, out->pos - cnr, 4);
+  }
+  out_le_at(out, li + 24, out->pos - li, 4);
+  out_str(out, (spec->CommonPathSuffix != NULL) ? spec->CommonPathSuffix : "", 0, 1);
+  if (unicode)
+  {
+    if (flags & 0x00000001)
+    {
+      out_le_at(out, li + 28, out->pos - li, 4);
+      out_str(out, spec->LocalBasePath, 1, 1);
+    }
+    out_le_at(out, li + 32, out->pos - li, 4);
+    out_str(out, (spec->CommonPathSuffix != NULL) ? spec->CommonPathSuffix : "", 1, 1);
+  }
+  out_le_at(out, li, out->pos - li, 4);
+}
+//
+//Function out_bytes() puts n bytes from p in out (or n zero bytes if p is
+//NULL). Only those that fit in the buffer are put but all of them are counted.
+void out_bytes(struct LIF_OUT* out, const void* p, size_t n)
+{
+  size_t fit = (out->pos < out->size) ? out->size - out->pos : 0;
+
+  if (fit > n)
+  {
+    fit = n;
+  }
+  if (fit > 0)
+  {
+    if (p != NULL)
+    {
+      memcpy(&out->buf[out->pos], p, fit);
+    }
+    else
+    {
+      memset(&out->buf[out->pos], 0, fit);
+    }
+  }
+  out->pos += n;
+}
+//
+//Function out_le() puts the n byte little endian value in out
+void out_le(struct LIF_OUT* out, uint64_t value, int n)
+{
+  out_le_at(out, out->pos, value, n);
+  out->pos += n;
+}
+//
+//Function out_le_at() puts the n byte little endian value in out at pos
+//(which is already made), for sizes and offsets only known later on
+void out_le_at(struct LIF_OUT* out, size_t pos, uint64_t value, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+  {
+    if (pos + i < out->size)
+    {
+      out->buf[pos + i] = (uint8_t)(value >> (8 * i));
+    }
+  }
+}
+//
+//Function out_str() puts the UTF-8 string str in out, either as UTF-16LE (if
+//unicode) or byte for byte, with a terminator if terminate. Returns its length
+//in characters (UTF-16 code units or bytes) less the terminator. Bytes that
+//aren't part of a UTF-8 sequence are taken to be code points of their own.
+size_t out_str(struct LIF_OUT* out, const char* str, int unicode, int terminate)
+{
+  const unsigned char * p = (const unsigned char *)str;
+  uint32_t              c;
+  size_t                n = 0;
+  int                   more;
+
+  if (!unicode)
+  {
+    n = strlen(str);
+    out_bytes(out, str, n + (terminate ? 1 : 0));
+    return n;
+  }
+  while (*p != 0)
+  {
+    c = *p++;
+    if ((c >= 0xC0) && (c < 0xF8))
+    {
+      more = (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : 1;
+      c &= 0x3F >> more;
+      while ((more-- > 0) && ((*p & 0xC0) == 0x80))
+      {
+        c = (c << 6) | (*p++ & 0x3F);
+      }
+    }
+    if (c > 0xFFFF) //A surrogate pair
+    {
+      c -= 0x10000;
+      out_le(out, 0xD800 | (c >> 10), 2);
+      out_le(out, 0xDC00 | (c & 0x3FF), 2);
+      n += 2;
+    }
+    else
+    {
+      out_le(out, c, 2);
+      n++;
+    }
+  }
+  if (terminate)
+  {
+    out_le(out, 0, 2);
+  }
+  return n;
+}
@@ -10,6 +10,11 @@
 ** -----------                                                **
 ** LIF       - Link File data                                 **
 ** LIF_A     - ASCII representation of a LIF                  **
+** LIF_ARENA - Memory for the variable parts of a LIF_A       **
+** LIF_VIEW  - Where each part of a link file is (no copies)  **
+** LIF_SOURCE - Somewhere to read link files from             **
+** LIF_VISITOR - What lif_visit() calls for each part         **
+** LIF_SPEC  - What put_lif() makes a link file from          **
 **                                                            **
 ** Exported Functions:                                        **
 ** -------------------                                        **
@@ -17,15 +22,84 @@
 **       Returns 0 if the file pointed to by fp is a          **
 **       Windows Link file -1 if not.                         **
 **                                                            **
-** get_lif(FILE*, int, LIF*)                                  **
-**       Populates LIF with the decoded link file data        **
+** test_link_buf(const uint8_t*, size_t)                      **
+**       As test_link() but for a link file held in memory    **
 **                                                            **
-** get_lif_a(LIF*, LIF_A*)                                    **
-**       Converts the LIF to a readable version               **
+** get_lif(FILE*, int, LIF*, LIF_ARENA*)                      **
+**       Populates LIF with the decoded link file data. The   **
+**       file is read into memory from the LIF_ARENA          **
+**                                                            **
+** get_lif_buf(const uint8_t*, size_t, LIF*)                  **
+**       As get_lif() but decodes a link file already held    **
+**       in memory. Both validate the header first and        **
+**       return a LIF_ERR value                               **
+**                                                            **
+** get_lif_sect(const uint8_t*, size_t, LIF*, uint32_t)       **
+**       As get_lif_buf() but only the sections asked for are **
+**       decoded (get_lif_a() then skips the rest too)        **
+**                                                            **
+** get_lif_src(LIF_SOURCE*, LIF*, LIF_ARENA*, uint32_t)       **
+**       As get_lif_sect() but the link file is read from a   **
+**       LIF_SOURCE, only as much of it as is needed          **
+**                                                            **
+** get_lif_batch(LIF_INPUT*, size_t, LIF*, int*, uint32_t, int)**
+**       As get_lif_sect() for many link files at once,       **
+**       optionally shared out between several threads        **
+**                                                            **
+** lif_source_mem(), lif_source_file(), lif_source_slice()    **
+**       Make a LIF_SOURCE for a buffer (or mapped file), an  **
+**       open FILE or part of another LIF_SOURCE              **
+**                                                            **
+** lif_source_read(LIF_SOURCE*, uint64_t, uint8_t*, size_t)   **
+**       Reads bytes from anywhere in a LIF_SOURCE            **
+**                                                            **
+** get_lif_a(LIF*, LIF_A*, LIF_ARENA*)                        **
+**       Converts the LIF to a readable version. Parts that   **
+**       vary in size are allocated from the LIF_ARENA        **
+**                                                            **
+** lif_arena_init(LIF_ARENA*) / lif_arena_reset(LIF_ARENA*)   **
+** lif_arena_free(LIF_ARENA*)                                 **
+**       Set up, empty (for the next file) and release an     **
+**       arena                                                **
+**                                                            **
+** lif_arena_limit(LIF_ARENA*, size_t)                        **
+**       Caps the memory an arena may hold                    **
+**                                                            **
+** lif_arena_alloc(LIF_ARENA*, size_t)                        **
+**       Returns zeroed memory that lasts until the arena is  **
+**       reset or freed                                       **
 **                                                            **
 ** get_propstore_a(LIF_SER_PROPSTORE * LIF_SER_PROPSTORE_A *) **
 **       Converts the property store to a readable version    **
 **                                                            **
+** get_lif_view(const uint8_t*, size_t, LIF_VIEW*)            **
+**       Locates the parts of a link file held in memory      **
+**       without copying or truncating any of them. Returns   **
+**       a LIF_ERR value                                      **
+**                                                            **
+** lif_next_itemid(), lif_next_block(), lif_next_propstore(), **
+** lif_next_propvalue()                                       **
+**       Step through the ItemIDs, ExtraData blocks, property **
+**       stores and property values found by get_lif_view()   **
+**                                                            **
+** lif_span_ptr(), lif_span_cstr(), lif_span_utf16()          **
+**       Get at, or decode, the bytes a LIF_SPAN refers to    **
+**                                                            **
+** lif_visit(const uint8_t*, size_t, LIF_VISITOR*, void*)     **
+**       Walks a link file held in memory, calling a function **
+**       for each part of it that is wanted. Returns a        **
+**       LIF_ERR value (or what a function stopped it with)   **
+**                                                            **
+** put_lif(const LIF_SPEC*, uint8_t*, size_t)                 **
+**       Makes the bytes of a link file from a LIF_SPEC and   **
+**       returns how many there are (like snprintf())         **
+**                                                            **
+** lif_scan(const uint8_t*, size_t, const uint8_t*, size_t,   **
+**          size_t, size_t*, size_t)                          **
+**       Finds every place a byte signature (such as a link   **
+**       file header) appears in a buffer, at about the       **
+**       speed memory can be read                             **
+**                                                            **
 ***************************************************************/
 
 /*
@@ -53,6 +127,19 @@ https://msdn.microsoft.com/en-us/library/dd871305.aspx )
 
 */
 
+/*
+
+Thread safety: liblife has no global or static data that changes, so any
+number of threads may decode link files at once as long as each has its own
+LIF, LIF_A and LIF_ARENA (nothing in them is locked). A buffer given to the
+functions that decode from memory is only ever read, so threads may share
+one. test_link() and get_lif() lock the FILE while they read it and leave
+its position as it was, so threads may share a FILE as well. get_lif_a()
+converts the wide strings with the C library's current locale, which should
+be set (if at all) before the threads start.
+
+*/
+
 #ifndef _LIBLIFE_H_
 #define _LIBLIFE_H_
 
@@ -72,6 +159,89 @@ https://msdn.microsoft.com/en-us/library/dd871305.aspx )
 #define PROPVALUES    10    // The number of LIF_SER_PROPVALUE in each LIF_SER_PROPSTORE structure
 #define ITEMIDS       10    // The number of LIF_ITEMID items in a LIF_IDLIST
 #define MAXITEMIDSIZE 4096  // The maximum number of raw bytes in an ItemID
+#define LIF_ARENA_BLOCKSIZE 16384 // The usual size of each block of memory in a LIF_ARENA
+#define LIF_ARENA_KEEP (1024 * 1024) // Larger blocks are released when a LIF_ARENA is reset
+
+// The most that sizeof(struct LIF_A) may be. A LIF_A used to hold every
+// property store that might be present and came to over 600 KiB. Now only
+// the fixed size fields are held in it and the property stores that are
+// actually present are allocated from a LIF_ARENA. Keeping it under 16 KiB
+// (it is about 12 KiB) means a LIF_A for each of several parser threads fits
+// in a typical L2 cache and in a default thread stack. liblife.c won't compile
+// if it is exceeded.
+#define LIF_A_BUDGET  16384
+
+// A LIF_ARENA hands out memory from a chain of blocks. Nothing is freed
+// individually, instead the whole arena is reset (ready for the next file,
+// keeping its blocks) or freed. Every allocation liblife makes comes from
+// the arena it is given so, once the blocks have been made, a thread that
+// resets its arena between files makes no further heap calls.
+struct LIF_ARENA_BLOCK
+{
+  struct LIF_ARENA_BLOCK *  next;
+  size_t                    size;  // Bytes available after this header
+  size_t                    used;
+};
+
+struct LIF_ARENA
+{
+  struct LIF_ARENA_BLOCK *  first;
+  struct LIF_ARENA_BLOCK *  cur;   // The block being allocated from
+  size_t                    held;  // Bytes in all the blocks
+  size_t                    limit; // The most held may be (0 for no limit)
+};
+
+// One link file held in memory, for get_lif_batch()
+struct LIF_INPUT
+{
+  const uint8_t *  buf;   // The first byte of the link file
+  size_t           len;   // Bytes at buf
+};
+#define LIF_BATCH_MAXTHREADS 64 // The most threads get_lif_batch() will use
+
+// Somewhere link files can be read from without needing a FILE: a file, a
+// buffer, part of a disk image, a member of an archive, etc. lif_source_mem(),
+// lif_source_file() and lif_source_slice() make the common ones. For anything
+// else fill in read_at, ctx and size and set base to 0 and mem to NULL; for
+// example read_at might inflate a zip member (ctx) up to the offset asked for.
+// read_at copies len bytes from offset into buf and returns the number it
+// could. It is only ever asked for bytes between base and base + size and is
+// only called by one thread at a time for a source unless it is safe to do
+// otherwise.
+struct LIF_SOURCE
+{
+  size_t         (*read_at)(void *ctx, uint64_t offset, uint8_t *buf, size_t len);
+  void *           ctx;   // Handed to read_at (the FILE*, the archive, etc.)
+  uint64_t         base;  // Where the source starts in what read_at reads (a slice)
+  uint64_t         size;  // Bytes in the source
+  const uint8_t *  mem;   // The bytes themselves if they are all in memory, NULL if not
+};
+
+// get_lif() and get_lif_buf() return values
+enum LIF_ERR
+{
+  LIF_OK                        = 0,
+  LIF_ERR_HDR                   = -1,   // Too short to hold a ShellLinkHeader
+  LIF_ERR_IDLIST                = -2,   // LinkTargetIDList could not be decoded
+  LIF_ERR_LINKINFO              = -3,   // LinkInfo could not be decoded
+  LIF_ERR_STRINGDATA            = -4,   // StringData could not be decoded
+  LIF_ERR_EXTRADATA             = -5,   // ExtraData could not be decoded
+  LIF_ERR_HSIZE                 = -6,   // HeaderSize is not 0x0000004C
+  LIF_ERR_CLSID                 = -7,   // LinkCLSID is not {00021401-0000-0000-C000-000000000046}
+  LIF_ERR_RESERVED              = -8,   // Reserved1, 2 or 3 is not 0
+  LIF_ERR_MEMORY                = -9    // Out of memory (or the LIF_ARENA's limit was reached)
+};
+
+// The parts of a link file found to be damaged (the damage member of a LIF).
+// Without LIF_SECT_PARTIAL get_lif_sect() fails with the matching LIF_ERR if
+// any of the first four are found; with it the part is left empty (along with
+// every part after it that couldn't be found because of it) and LIF_OK is
+// returned. LIF_DMG_BLOCKSIZE never stops decoding.
+#define LIF_DMG_IDLIST      0x00000001 // The LinkTargetIDList runs past the end of the file
+#define LIF_DMG_LINKINFO    0x00000002 // The LinkInfo is cut short or its size is impossible
+#define LIF_DMG_STRINGDATA  0x00000004 // The StringData is cut short (strings before the break are kept)
+#define LIF_DMG_EXTRADATA   0x00000008 // An ExtraData block is cut short or too large (blocks before it are kept)
+#define LIF_DMG_BLOCKSIZE   0x00000010 // An ExtraData block's size isn't the one the spec requires
 
 // extradata types
 enum EDTYPES
@@ -90,6 +260,13 @@ enum EDTYPES
   VISTA_AND_ABOVE_IDLIST_PROPS  = 1024
 };
 
+// Sections for get_lif_sect(). The ExtraData blocks are selected with their
+// EDTYPES value so LIF_SECT_EXTRADATA is all of them.
+#define LIF_SECT_IDLIST     0x00010000 // The ItemIDs in the LinkTargetIDList
+#define LIF_SECT_EXTRADATA  0x000007FF // Every ExtraData block
+#define LIF_SECT_ALL        (LIF_SECT_IDLIST | LIF_SECT_EXTRADATA)
+#define LIF_SECT_PARTIAL    0x00020000 // Keep what can be decoded of a damaged link file (see LIF_DMG)
+
 enum PROPERTY_TYPE // From MS-OLEPS https://msdn.microsoft.com/en-us/library/dd942532.aspx
 {
   VT_EMPTY              = 0x0000, // 0 bytes
@@ -213,7 +390,7 @@ struct LIF_PROPERTY_STORE_PROPS_A
   unsigned char               Size[10];
   unsigned char               sig[12];
   unsigned char               NumStores[10];
-  struct LIF_SER_PROPSTORE_A  Stores[PROPSTORES];
+  struct LIF_SER_PROPSTORE_A* Stores;  // NumStores of them, allocated from a LIF_ARENA (NULL if none)
 };
 
 struct LIF_CONSOLE_PROPS
@@ -612,7 +789,6 @@ struct LIF_ITEMID_A
 {
   unsigned char               ItemIDSize[10];
   unsigned char               Data[100];  // Room for some general notes about the data
-  struct LIF_SER_PROPSTORE_A  DataStores[PROPSTORES]; // Where the ID list contains property stores the interpretation can be held here
 };
 
 struct LIF_IDLIST
@@ -678,6 +854,8 @@ struct LIF //LInk File structure
   struct LIF_INFO          li;   //Section 2.3
   struct LIF_STRINGDATA    lsd;  //Section 2.4
   struct LIF_EXTRA_DATA    led;  //Section 2.5
+  uint32_t                 sections; //The LIF_SECT values that were decoded
+  uint32_t                 damage;   //The LIF_DMG values for the parts found to be damaged
 };
 
 struct LIF_A //ASCII version of the LIF structure
@@ -688,24 +866,308 @@ struct LIF_A //ASCII version of the LIF structure
   struct LIF_STRINGDATA_A  lsda;  //Section 2.4
   struct LIF_EXTRA_DATA_A  leda;  //Section 2.5
 };
+
+/*
+A LIF copies each string and blob into a fixed size array, which truncates
+anything longer and costs about 100 KiB a file. A LIF_VIEW is the alternative:
+get_lif_view() only records where each part of the link file is, as a LIF_SPAN
+into the caller's buffer, and nothing is decoded until it is asked for. There
+are no limits on the number of ItemIDs, property stores or property values
+(they are stepped through with the lif_next_...() functions) or on the length
+of any string. The buffer must outlive the LIF_VIEW.
+*/
+
+struct LIF_SPAN // Some bytes of the link file
+{
+  uint32_t           Offset;  // From the start of the link file
+  uint32_t           Length;  // In bytes (0 if the part isn't present)
+};
+
+struct LIF_VIEW
+{
+  const uint8_t *    buf;           // The link file the spans refer to
+  size_t             len;
+  struct LIF_HDR     lh;            // Section 2.1 (small enough to decode)
+  struct LIF_SPAN    IDList;        // Section 2.2 ItemIDs (less IDListSize and the terminator)
+  uint32_t           NumItemIDs;
+  struct LIF_SPAN    LinkInfo;      // Section 2.3 (the whole structure)
+  uint32_t           LinkInfoFlags;
+  struct LIF_SPAN    VolumeID;      // Section 2.3.1 (the whole structure)
+  uint32_t           DriveType;
+  uint32_t           DriveSN;
+  struct LIF_SPAN    VolumeLabel;   // Code page string (without the terminator)
+  struct LIF_SPAN    VolumeLabelU;  // UTF-16LE string
+  struct LIF_SPAN    LBP;           // Local Base Path
+  struct LIF_SPAN    LBPU;
+  struct LIF_SPAN    CNR;           // Section 2.3.2 (the whole structure)
+  uint32_t           CNRFlags;
+  uint32_t           NetworkProviderType;
+  struct LIF_SPAN    NetName;
+  struct LIF_SPAN    DeviceName;
+  struct LIF_SPAN    NetNameU;
+  struct LIF_SPAN    DeviceNameU;
+  struct LIF_SPAN    CPS;           // Common Path Suffix
+  struct LIF_SPAN    CPSU;
+  struct LIF_SPAN    StringData[5]; // Section 2.4 Name, Relative Path, Working Dir, Arguments & Icon Location
+  int                StringUnicode; // StringData is UTF-16LE (the IsUnicode flag) rather than code page
+  struct LIF_SPAN    ExtraData;     // Section 2.5 (up to the end of the file)
+};
+
+/*
+lif_visit() walks a link file in order and calls a LIF_VISITOR function for
+each part of it, passing the LIF_VIEW so that the function can decode as much
+or as little as it needs. Any of the functions may be NULL and the parts they
+are for are then skipped. A function returns 0 to carry on or a positive value
+to stop the walk there.
+*/
+
+struct LIF_PROP // A value in a PropertyStoreDataBlock
+{
+  struct LIF_SPAN    Store;     // The whole property store the value is in
+  struct LIF_CLSID   FormatID;  // The store's FormatID
+  uint32_t           Index;     // Which value it is in the store (from 0)
+  uint32_t           ID;        // Its ID (0 in the store of named values)
+  struct LIF_SPAN    Name;      // Its UTF-16LE name (only in the store of named values)
+  uint16_t           Type;      // Its property type (VT_...)
+  struct LIF_SPAN    Value;     // The value itself (after the type and padding)
+};
+
+struct LIF_VISITOR // Each function's first argument is lif_visit()'s void*
+{
+  int (*header)(void *, const struct LIF_VIEW *);                            // See view->lh
+  int (*itemid)(void *, const struct LIF_VIEW *, uint32_t, struct LIF_SPAN); // Number (from 0) & data
+  int (*linkinfo)(void *, const struct LIF_VIEW *);                          // See view->LinkInfo etc.
+  int (*stringdata)(void *, const struct LIF_VIEW *, int, struct LIF_SPAN);  // 0 (Name) to 4 (Icon Location) & string
+  int (*block)(void *, const struct LIF_VIEW *, uint32_t, struct LIF_SPAN);  // Signature & data
+  int (*propvalue)(void *, const struct LIF_VIEW *, const struct LIF_PROP *);
+};
+
+/*
+put_lif() goes the other way, making a link file from a LIF_SPEC. Only the
+parts that aren't implied by others are given: the sizes, offsets, signatures
+and the flags that say which parts are present are all worked out as the link
+file is made. Strings are given in UTF-8 and are written as UTF-16LE where
+MS-SHLLINK calls for Unicode, otherwise byte for byte as code page strings.
+*/
+
+struct LIF_BLOCK // An ExtraData block for put_lif()
+{
+  uint32_t           Signature;
+  const uint8_t *    Data;          // The block's data (after its size and signature)
+  uint32_t           Size;          // Of the data
+};
+
+struct LIF_SPEC
+{
+  struct LIF_HDR             lh;            // Section 2.1 (H_size, CLSID, the Has... flags & Reserved are set by put_lif())
+  const struct LIF_INPUT *   ItemIDs;       // Section 2.2 Each ItemID's data (after its size)
+  uint32_t                   NumItemIDs;    // 0 for no LinkTargetIDList
+  const char *               LocalBasePath; // Section 2.3 NULL for no VolumeID or LocalBasePath
+  uint32_t                   DriveType;
+  uint32_t                   DriveSN;
+  const char *               VolumeLabel;   // NULL for none
+  const char *               NetName;       // NULL for no CommonNetworkRelativeLink
+  const char *               DeviceName;    // NULL for none
+  uint32_t                   NetworkProviderType; // 0 for none
+  const char *               CommonPathSuffix;    // NULL for an empty one
+  int                        LinkInfoUnicode;     // Add the optional Unicode strings too
+  const char *               StringData[5]; // Section 2.4 NULL for those not wanted (Unicode if lh.Flags has IsUnicode)
+  const struct LIF_BLOCK *   Blocks;        // Section 2.5 (the TerminalBlock is added)
+  uint32_t                   NumBlocks;
+};
 /******************************************************************************/
 //Public Function Declarations
 
 //Tests to see if a file is a link file (0 if it is, < -1 if not)
 extern int test_link(FILE *);
-//FILE* is an opened FILE pointer
+//FILE* is an opened FILE pointer (read from its start, its position is left as it was)
 
-//fills the LIF structure with data (0 if successful < -1 if not)
-extern int get_lif(FILE *, int, struct LIF *);
-//FILE* is an opened FILE pointer
+//Tests to see if a buffer holds a link file (0 if it does, < -1 if not)
+extern int test_link_buf(const uint8_t *, size_t);
+//const uint8_t* is a pointer to the first byte of the link file
+//size_t is the number of bytes in the buffer
+
+//fills the LIF structure with data (LIF_OK if successful, a negative
+//LIF_ERR value if not). The header is validated so test_link() is not needed.
+extern int get_lif(FILE *, int, struct LIF *, struct LIF_ARENA *);
+//FILE* is an opened FILE pointer (read from its start, its position is left as it was)
 //int is the size of the opened file
 //LIF is a pointer to a struct LIF which will hold the data
+//LIF_ARENA is an initialised arena, the file contents stay in it until it is reset
+
+//fills the LIF structure with data from a buffer holding the whole link file
+//(LIF_OK if successful, a negative LIF_ERR value if not)
+extern int get_lif_buf(const uint8_t *, size_t, struct LIF *);
+//const uint8_t* is a pointer to the first byte of the link file
+//size_t is the number of bytes in the buffer
+//LIF is a pointer to a struct LIF which will hold the data
+
+//As get_lif_buf() but the contents of only some sections are decoded
+//(LIF_OK if successful, a negative LIF_ERR value if not)
+extern int get_lif_sect(const uint8_t *, size_t, struct LIF *, uint32_t);
+//const uint8_t* is a pointer to the first byte of the link file
+//size_t is the number of bytes in the buffer
+//LIF is a pointer to a struct LIF which will hold the data
+//uint32_t is the LIF_SECT values (or EDTYPES) wanted. The header, LinkInfo,
+//StringData and the position, size & signature of each ExtraData block are
+//always decoded. Add LIF_SECT_PARTIAL to keep the parts of a damaged link
+//file that can be decoded (LIF.damage says which parts were damaged)
+
+//As get_lif_sect() for a link file at the start of a LIF_SOURCE. A source in
+//memory is decoded where it is, otherwise only the bytes the link file's
+//section sizes cover are read (LIF_OK if successful, a negative LIF_ERR value
+//if not)
+extern int get_lif_src(const struct LIF_SOURCE *, struct LIF *, struct LIF_ARENA *, uint32_t);
+//LIF_SOURCE is where to read the link file from
+//LIF is a pointer to a struct LIF which will hold the data
+//LIF_ARENA is an initialised arena, the bytes read stay in it until it is reset
+//uint32_t is the LIF_SECT values (or EDTYPES) wanted, as for get_lif_sect()
+
+//As get_lif_sect() for each of many link files held in memory, decoded by up
+//to LIF_BATCH_MAXTHREADS threads (the number that decoded with LIF_OK)
+extern size_t get_lif_batch(const struct LIF_INPUT *, size_t, struct LIF *, int *, uint32_t, int);
+//const LIF_INPUT* (arg 0) is the first of the link files
+//size_t (arg 1) is the number of link files
+//LIF* (arg 2) is an array of that many LIF structures which will hold the data
+//int* (arg 3) is an array of that many ints which receive each LIF_ERR value
+//uint32_t (arg 4) is the LIF_SECT values (or EDTYPES) wanted, as for get_lif_sect()
+//int (arg 5) is the number of threads to use (1 or less to use just this one)
+
+//Makes a LIF_SOURCE for a buffer, which includes a file mapped into memory
+extern void lif_source_mem(struct LIF_SOURCE *, const uint8_t *, size_t);
+//LIF_SOURCE is the source to set up
+//const uint8_t* is the first byte (it must stay there while the source is used)
+//size_t is the number of bytes in the buffer
+
+//Makes a LIF_SOURCE for an open file (0 if successful, -1 if its size can't be found)
+extern int lif_source_file(struct LIF_SOURCE *, FILE *);
+//LIF_SOURCE is the source to set up
+//FILE* is an opened FILE pointer (reads lock it and leave its position as it was)
+
+//Makes a LIF_SOURCE for part of another one (cut short if the other ends first)
+extern void lif_source_slice(struct LIF_SOURCE *, const struct LIF_SOURCE *, uint64_t, uint64_t);
+//LIF_SOURCE is the source to set up (it may be the one being sliced)
+//const LIF_SOURCE* is the source to take a part of
+//uint64_t is where the part starts in it
+//uint64_t is the number of bytes in the part
+
+//Reads bytes from a LIF_SOURCE (the number read, fewer if the source ends first)
+extern size_t lif_source_read(const struct LIF_SOURCE *, uint64_t, uint8_t *, size_t);
+//const LIF_SOURCE* is the source
+//uint64_t is where to start reading in it
+//uint8_t* is where to put the bytes
+//size_t is the most bytes to read
 
 //fills LIF_A with the ASCII representation of the LIF
 //(0 if successful, != 0 if not)
-extern int get_lif_a(struct LIF *, struct LIF_A *);
+extern int get_lif_a(struct LIF *, struct LIF_A *, struct LIF_ARENA *);
 //LIF must be a filled LIF structure
 //LIF_A is an empty LIF_A structure
+//LIF_ARENA is an initialised arena. The LIF_A is only valid until it is reset or freed
+
+//Prepares an empty arena (no memory is allocated until it is needed)
+extern void lif_arena_init(struct LIF_ARENA *);
+
+//Caps the memory an arena may hold, after which allocations from it fail
+//(with errno set to ENOMEM) until it is reset
+extern void lif_arena_limit(struct LIF_ARENA *, size_t);
+//LIF_ARENA is an initialised arena
+//size_t is the most bytes it may hold (0 for no limit, the default)
+
+//Allocates zeroed memory from an arena (NULL if memory has run out)
+extern void * lif_arena_alloc(struct LIF_ARENA *, size_t);
+//LIF_ARENA is an initialised arena
+//size_t is the number of bytes wanted
+
+//Makes all the memory in an arena available again (ready for the next file)
+extern void lif_arena_reset(struct LIF_ARENA *);
+
+//Releases all the memory held by an arena
+extern void lif_arena_free(struct LIF_ARENA *);
+
+//Finds the parts of a link file held in memory without copying them
+//(LIF_OK if successful, a negative LIF_ERR value if not)
+extern int get_lif_view(const uint8_t *, size_t, struct LIF_VIEW *);
+//const uint8_t* is a pointer to the first byte of the link file
+//size_t is the number of bytes in the buffer
+//LIF_VIEW is an empty structure (filled on success)
+
+//Steps through the ItemIDs in the LinkTargetIDList
+//(1 if there was another ItemID, 0 at the end)
+extern int lif_next_itemid(const struct LIF_VIEW *, uint32_t *, struct LIF_SPAN *);
+//LIF_VIEW is filled by get_lif_view()
+//uint32_t* is the position reached, set it to 0 before the first call
+//LIF_SPAN receives the ItemID's data (after its size)
+
+//Steps through the ExtraData blocks
+//(1 if there was another block, 0 at the end)
+extern int lif_next_block(const struct LIF_VIEW *, uint32_t *, uint32_t *, struct LIF_SPAN *);
+//LIF_VIEW is filled by get_lif_view()
+//uint32_t* (arg 1) is the position reached, set it to 0 before the first call
+//uint32_t* (arg 2) receives the block signature
+//LIF_SPAN receives the block's data (after its size and signature)
+
+//Steps through the property stores in a serialized property storage (such as
+//the data of a PropertyStoreDataBlock) (1 if there was another store, 0 at the end)
+extern int lif_next_propstore(const struct LIF_VIEW *, struct LIF_SPAN, uint32_t *, struct LIF_SPAN *);
+//LIF_VIEW is filled by get_lif_view()
+//LIF_SPAN (arg 1) is the serialized property storage
+//uint32_t* is the position reached, set it to 0 before the first call
+//LIF_SPAN* receives the whole property store (including its size, version & FormatID)
+
+//Steps through the property values in a property store found by lif_next_propstore()
+//(1 if there was another value, 0 at the end)
+extern int lif_next_propvalue(const struct LIF_VIEW *, struct LIF_SPAN, uint32_t *, struct LIF_SPAN *);
+//LIF_VIEW is filled by get_lif_view()
+//LIF_SPAN (arg 1) is the property store
+//uint32_t* is the position reached, set it to 0 before the first call
+//LIF_SPAN* receives the whole property value (including its size)
+
+//Returns a pointer to the first byte of a LIF_SPAN (NULL if it is empty)
+extern const uint8_t * lif_span_ptr(const struct LIF_VIEW *, struct LIF_SPAN);
+
+//Copies a code page string into a buffer, truncating it if need be, and
+//returns the full length of the string (like snprintf())
+extern size_t lif_span_cstr(const struct LIF_VIEW *, struct LIF_SPAN, char *, size_t);
+//LIF_SPAN is a code page string
+//char* is the buffer (always zero terminated if size_t > 0)
+//size_t is the size of the buffer
+
+//Converts a UTF-16LE string to UTF-8 in a buffer, truncating it if need be,
+//and returns the full length of the UTF-8 string (like snprintf())
+extern size_t lif_span_utf16(const struct LIF_VIEW *, struct LIF_SPAN, char *, size_t);
+//LIF_SPAN is a UTF-16LE string
+//char* is the buffer (always zero terminated if size_t > 0)
+//size_t is the size of the buffer
+
+//Walks a link file held in memory calling the visitor's functions for each
+//part of it (LIF_OK once it is all visited, a negative LIF_ERR value if it
+//could not be decoded or the positive value a function returned to stop it)
+extern int lif_visit(const uint8_t *, size_t, const struct LIF_VISITOR *, void *);
+//const uint8_t* is a pointer to the first byte of the link file
+//size_t is the number of bytes in the buffer
+//LIF_VISITOR holds the functions to call (NULL for the parts not wanted)
+//void* is passed to each function as its first argument
+
+//Makes a link file from a LIF_SPEC and returns its size in bytes, even if the
+//buffer is too small to hold it all (0 if a part is too big for its size field)
+extern size_t put_lif(const struct LIF_SPEC *, uint8_t *, size_t);
+//LIF_SPEC describes the link file, there is a LinkInfo if it has a
+//LocalBasePath or NetName
+//uint8_t* is where to put the link file (it may be NULL if size_t is 0)
+//size_t is the size of the buffer, only as much of the link file as fits is put in it
+
+//Finds the places a signature appears in a buffer, in order, and returns how
+//many were found (if that is size_t (arg 6) there may be more, so call it
+//again from one past the last one found)
+extern size_t lif_scan(const uint8_t *, size_t, const uint8_t *, size_t, size_t, size_t *, size_t);
+//const uint8_t* (arg 0) is the buffer
+//size_t (arg 1) is the number of bytes in the buffer
+//const uint8_t* (arg 2) is the signature
+//size_t (arg 3) is the number of bytes in the signature
+//size_t (arg 4) is the offset in the buffer to start looking from
+//size_t* (arg 5) receives the offset in the buffer of each place it was found
+//size_t (arg 6) is the most offsets to find
 
 //Finds a series of Property stores in a buffer
 //(0 if successful, != 0 if not)
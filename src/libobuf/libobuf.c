@@ -0,0 +1,583 @@
+/*********************************************************
+**                                                      **
+**                 libobuf.c                            **
+**                                                      **
+** A library to build output in a growable byte buffer  **
+** and write it out in large blocks                     **
+**                                                      **
+**         Copyright Paul Tew 2011 to 2024              **
+**                                                      **
+*********************************************************/
+
+/*
+This file is part of Lifer.
+
+    Lifer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Lifer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Lifer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "./libobuf.h"
+
+//SSE2 is always there on x86-64 (and on 32 bit x86 if the compiler is told
+//it can use it), AVX2 only if the compiler is told it can use it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define OBUF_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#define OBUF_MINSIZE 4096 // The smallest allocation for an OBUF
+
+//Private function declarations
+int obuf_room(struct OBUF *, size_t);
+size_t obuf_utf8len(const unsigned char *);
+size_t obuf_xmlclean(const unsigned char *, size_t);
+size_t obuf_svclean(const unsigned char *, size_t, char);
+
+//
+//Function: obuf_room() makes room for n more bytes in ob, writing out what is
+//          already there first if ob has a stream and the buffer would pass
+//          OBUF_FLUSHSIZE. Returns 0 if successful or -1 if not.
+int obuf_room(struct OBUF * ob, size_t n)
+{
+  size_t cap;
+  char * buf;
+
+  if ((ob->out != NULL) && (ob->len + n > OBUF_FLUSHSIZE))
+  {
+    obuf_flush(ob);
+  }
+  if (ob->len + n <= ob->cap)
+  {
+    return 0;
+  }
+  cap = (ob->cap < OBUF_MINSIZE) ? OBUF_MINSIZE : ob->cap;
+  while (cap < ob->len + n)
+  {
+    cap *= 2;
+  }
+  if ((buf = (char *)realloc(ob->buf, cap)) == NULL)
+  {
+    ob->failed = 1;
+    return -1;
+  }
+  ob->buf = buf;
+  ob->cap = cap;
+  return 0;
+}
+
+//
+//Function: obuf_init() prepares ob as an empty buffer that is written to out,
+//          or kept in memory if out is NULL.
+void obuf_init(struct OBUF * ob, FILE * out)
+{
+  memset(ob, 0, sizeof(struct OBUF));
+  ob->out = out;
+}
+
+//
+//Function: obuf_str() appends the nul terminated string str to ob.
+void obuf_str(struct OBUF * ob, const void * str)
+{
+  obuf_mem(ob, str, strlen((const char *)str));
+}
+
+//
+//Function: obuf_mem() appends n bytes from data to ob. A block too big to be
+//          worth copying is written straight to the stream.
+void obuf_mem(struct OBUF * ob, const void * data, size_t n)
+{
+  if (n == 0) //Nothing to add (data and buf may both be NULL)
+  {
+    return;
+  }
+  if ((ob->out != NULL) && (n >= OBUF_FLUSHSIZE))
+  {
+    obuf_flush(ob);
+    if (fwrite(data, 1, n, ob->out) != n)
+    {
+      ob->failed = 1;
+    }
+    return;
+  }
+  if (obuf_room(ob, n) == 0)
+  {
+    memcpy(ob->buf + ob->len, data, n);
+    ob->len += n;
+  }
+}
+
+//
+//Function: obuf_chr() appends the character c to ob.
+void obuf_chr(struct OBUF * ob, char c)
+{
+  if (obuf_room(ob, 1) == 0)
+  {
+    ob->buf[ob->len++] = c;
+  }
+}
+
+//
+//Function: obuf_uint() appends n to ob as a decimal number.
+void obuf_uint(struct OBUF * ob, uint64_t n)
+{
+  char digits[20]; // Enough for the largest uint64_t
+  int i = sizeof(digits);
+
+  do
+  {
+    digits[--i] = (char)('0' + (n % 10));
+    n /= 10;
+  } while (n > 0);
+  obuf_mem(ob, digits + i, sizeof(digits) - i);
+}
+
+//
+//Function: obuf_svclean() returns the number of bytes at the start of the n
+//          at s before the first one that means a csv or tsv field has to be
+//          quoted: the separator sep, a double quote or a line end. Whole
+//          blocks of bytes are checked at once where the processor allows it.
+size_t obuf_svclean(const unsigned char * s, size_t n, char sep)
+{
+  size_t i = 0;
+#ifdef __AVX2__
+  const __m256i sep32 = _mm256_set1_epi8(sep);
+  __m256i v32, bad32;
+#endif
+#ifdef OBUF_SSE2
+  const __m128i sep16 = _mm_set1_epi8(sep);
+  __m128i v, bad;
+#endif
+
+#ifdef __AVX2__
+  while (i + 32 <= n)
+  {
+    v32 = _mm256_loadu_si256((const __m256i *)(s + i));
+    bad32 = _mm256_or_si256(_mm256_cmpeq_epi8(v32, sep32), _mm256_cmpeq_epi8(v32, _mm256_set1_epi8('"')));
+    bad32 = _mm256_or_si256(bad32, _mm256_cmpeq_epi8(v32, _mm256_set1_epi8('\n')));
+    bad32 = _mm256_or_si256(bad32, _mm256_cmpeq_epi8(v32, _mm256_set1_epi8('\r')));
+    if (_mm256_movemask_epi8(bad32) != 0)
+    {
+      break;
+    }
+    i += 32;
+  }
+#endif
+#ifdef OBUF_SSE2
+  while (i + 16 <= n)
+  {
+    v = _mm_loadu_si128((const __m128i *)(s + i));
+    bad = _mm_or_si128(_mm_cmpeq_epi8(v, sep16), _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    bad = _mm_or_si128(bad, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+    bad = _mm_or_si128(bad, _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    if (_mm_movemask_epi8(bad) != 0)
+    {
+      break;
+    }
+    i += 16;
+  }
+#endif
+  while ((i < n) && (s[i] != (unsigned char)sep) && (s[i] != '"') && (s[i] != '\n') && (s[i] != '\r'))
+  {
+    i++;
+  }
+  return i;
+}
+
+//
+//Function: obuf_field() appends the string str followed by the separator sep
+//          to ob. A string holding the separator, a double quote or a line
+//          end is quoted as RFC 4180 has it: it goes between double quotes
+//          and any double quote in it is doubled. Anything else (which is
+//          almost everything) is copied as it is.
+void obuf_field(struct OBUF * ob, const void * str, char sep)
+{
+  const char * s = (const char *)str;
+  const char * q;
+  size_t n = strlen(s);
+
+  if (obuf_svclean((const unsigned char *)s, n, sep) == n)
+  {
+    if (obuf_room(ob, n + 1) == 0)
+    {
+      memcpy(ob->buf + ob->len, s, n);
+      ob->buf[ob->len + n] = sep;
+      ob->len += n + 1;
+    }
+    return;
+  }
+  obuf_chr(ob, '"');
+  while ((q = (const char *)memchr(s, '"', n)) != NULL)
+  {
+    //Up to and including the quote, then the quote again
+    obuf_mem(ob, s, (size_t)(q - s) + 1);
+    obuf_chr(ob, '"');
+    n -= (size_t)(q - s) + 1;
+    s = q + 1;
+  }
+  obuf_mem(ob, s, n);
+  obuf_chr(ob, '"');
+  obuf_chr(ob, sep);
+}
+
+//
+//Function: obuf_cat() appends str and then each of the strings that follow it
+//          to ob. The last argument must be NULL.
+void obuf_cat(struct OBUF * ob, const void * str, ...)
+{
+  va_list args;
+
+  va_start(args, str);
+  while (str != NULL)
+  {
+    obuf_mem(ob, str, strlen((const char *)str));
+    str = va_arg(args, const void *);
+  }
+  va_end(args);
+}
+
+//
+//Function: obuf_utf8len() returns the length of the UTF-8 sequence starting
+//          at s or 0 if s doesn't start a valid one (overlong forms,
+//          surrogates and code points past U+10FFFF are not valid).
+size_t obuf_utf8len(const unsigned char * s)
+{
+  size_t n, i;
+  uint32_t cp;
+
+  if ((s[0] & 0xE0) == 0xC0)
+  {
+    n = 2;
+    cp = s[0] & 0x1F;
+  }
+  else if ((s[0] & 0xF0) == 0xE0)
+  {
+    n = 3;
+    cp = s[0] & 0x0F;
+  }
+  else if ((s[0] & 0xF8) == 0xF0)
+  {
+    n = 4;
+    cp = s[0] & 0x07;
+  }
+  else
+  {
+    return 0;
+  }
+  for (i = 1; i < n; i++)
+  {
+    if ((s[i] & 0xC0) != 0x80) // Also stops at the terminating nul
+    {
+      return 0;
+    }
+    cp = (cp << 6) | (s[i] & 0x3F);
+  }
+  if (((n == 2) && (cp < 0x80)) || ((n == 3) && (cp < 0x800)) || ((n == 4) && (cp < 0x10000)) ||
+    ((cp >= 0xD800) && (cp <= 0xDFFF)) || (cp > 0x10FFFF))
+  {
+    return 0;
+  }
+  return n;
+}
+
+//
+//Function: obuf_utf8() appends the nul terminated string str to ob as valid
+//          UTF-8. Valid UTF-8 is copied as it is and any other byte over 0x7F
+//          is taken to be Latin-1 (see obuf_json()) and converted.
+void obuf_utf8(struct OBUF * ob, const void * str)
+{
+  const unsigned char * s = (const unsigned char *)str;
+  const unsigned char * run;
+  char latin[2];
+  size_t n;
+
+  for (;;)
+  {
+    run = s;
+    while ((*s > 0) && (*s < 0x80))
+    {
+      s++;
+    }
+    if (s > run)
+    {
+      obuf_mem(ob, run, (size_t)(s - run));
+    }
+    if (*s == 0)
+    {
+      break;
+    }
+    if ((n = obuf_utf8len(s)) > 0)
+    {
+      obuf_mem(ob, s, n);
+      s += n;
+      continue;
+    }
+    latin[0] = (char)(0xC0 | (*s >> 6));
+    latin[1] = (char)(0x80 | (*s & 0x3F));
+    obuf_mem(ob, latin, 2);
+    s++;
+  }
+}
+
+//
+//Function: obuf_json() appends the nul terminated string str to ob as a JSON
+//          string. Quotes, backslashes and control characters are escaped.
+//          Valid UTF-8 is copied as it is but any other byte over 0x7F is
+//          taken to be Latin-1 (the ANSI strings in a link file are in the
+//          code page of the machine that made it) and written as \u00XX so
+//          the output is always valid UTF-8.
+void obuf_json(struct OBUF * ob, const void * str)
+{
+  const unsigned char * s = (const unsigned char *)str;
+  const unsigned char * run;
+  const char * hex = "0123456789ABCDEF";
+  char esc[6] = { '\\', 'u', '0', '0', 0, 0 };
+  size_t n;
+
+  obuf_chr(ob, '"');
+  for (;;)
+  {
+    //Copy the characters that need nothing doing to them in one go
+    run = s;
+    while ((*s >= 0x20) && (*s < 0x80) && (*s != '"') && (*s != '\\'))
+    {
+      s++;
+    }
+    if (s > run)
+    {
+      obuf_mem(ob, run, (size_t)(s - run));
+    }
+    if (*s == 0)
+    {
+      break;
+    }
+    if ((*s >= 0x80) && ((n = obuf_utf8len(s)) > 0))
+    {
+      obuf_mem(ob, s, n);
+      s += n;
+      continue;
+    }
+    switch (*s)
+    {
+    case '"':
+      obuf_mem(ob, "\\\"", 2);
+      break;
+    case '\\':
+      obuf_mem(ob, "\\\\", 2);
+      break;
+    case '\n':
+      obuf_mem(ob, "\\n", 2);
+      break;
+    case '\r':
+      obuf_mem(ob, "\\r", 2);
+      break;
+    case '\t':
+      obuf_mem(ob, "\\t", 2);
+      break;
+    default:
+      esc[4] = hex[*s >> 4];
+      esc[5] = hex[*s & 0x0F];
+      obuf_mem(ob, esc, 6);
+    }
+    s++;
+  }
+  obuf_chr(ob, '"');
+}
+
+//
+//Function: obuf_xmlclean() returns the number of bytes at the start of the n
+//          at s that can go into an XML document as they are: printable ASCII
+//          other than the five characters that XML escapes. Whole blocks of
+//          bytes are checked at once where the processor allows it (as signed
+//          bytes anything from 0x80 up is negative, so one comparison finds
+//          both the control characters and the non-ASCII ones).
+size_t obuf_xmlclean(const unsigned char * s, size_t n)
+{
+  size_t i = 0;
+#ifdef __AVX2__
+  const __m256i space32 = _mm256_set1_epi8(0x20);
+  __m256i v32, bad32;
+#endif
+#ifdef OBUF_SSE2
+  const __m128i space = _mm_set1_epi8(0x20);
+  __m128i v, bad;
+#endif
+
+#ifdef __AVX2__
+  while (i + 32 <= n)
+  {
+    v32 = _mm256_loadu_si256((const __m256i *)(s + i));
+    bad32 = _mm256_or_si256(_mm256_cmpgt_epi8(space32, v32), _mm256_cmpeq_epi8(v32, _mm256_set1_epi8('&')));
+    bad32 = _mm256_or_si256(bad32, _mm256_cmpeq_epi8(v32, _mm256_set1_epi8('<')));
+    bad32 = _mm256_or_si256(bad32, _mm256_cmpeq_epi8(v32, _mm256_set1_epi8('>')));
+    bad32 = _mm256_or_si256(bad32, _mm256_cmpeq_epi8(v32, _mm256_set1_epi8('"')));
+    bad32 = _mm256_or_si256(bad32, _mm256_cmpeq_epi8(v32, _mm256_set1_epi8('\'')));
+    if (_mm256_movemask_epi8(bad32) != 0)
+    {
+      break;
+    }
+    i += 32;
+  }
+#endif
+#ifdef OBUF_SSE2
+  while (i + 16 <= n)
+  {
+    v = _mm_loadu_si128((const __m128i *)(s + i));
+    bad = _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, _mm_set1_epi8('&')));
+    bad = _mm_or_si128(bad, _mm_cmpeq_epi8(v, _mm_set1_epi8('<')));
+    bad = _mm_or_si128(bad, _mm_cmpeq_epi8(v, _mm_set1_epi8('>')));
+    bad = _mm_or_si128(bad, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    bad = _mm_or_si128(bad, _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')));
+    if (_mm_movemask_epi8(bad) != 0)
+    {
+      break;
+    }
+    i += 16;
+  }
+#endif
+  //The rest (and the block that stopped the loops above) a byte at a time
+  while ((i < n) && (s[i] >= 0x20) && (s[i] < 0x80) && (s[i] != '&') && (s[i] != '<') &&
+    (s[i] != '>') && (s[i] != '"') && (s[i] != '\''))
+  {
+    i++;
+  }
+  return i;
+}
+
+//
+//Function: obuf_xml() appends the nul terminated string str to ob as XML
+//          character data (see obuf_xmlmem()).
+void obuf_xml(struct OBUF * ob, const void * str)
+{
+  obuf_xmlmem(ob, str, strlen((const char *)str));
+}
+
+//
+//Function: obuf_xmlmem() appends the n bytes at data to ob as XML character
+//          data that is safe in an element or in a quoted attribute. The five
+//          XML special characters become entities and a carriage return a
+//          character reference. Valid UTF-8 is copied as it is but any other
+//          byte over 0x7F is taken to be Latin-1 (see obuf_json()). Control
+//          characters (and U+FFFE and U+FFFF) can't be written in XML 1.0 at
+//          all, so they become U+FFFD.
+void obuf_xmlmem(struct OBUF * ob, const void * data, size_t n)
+{
+  const unsigned char * s = (const unsigned char *)data;
+  const unsigned char * end = s + n;
+  unsigned char seq[5];
+  char latin[2];
+  size_t len;
+
+  while (s < end)
+  {
+    len = obuf_xmlclean(s, (size_t)(end - s));
+    if (len > 0)
+    {
+      obuf_mem(ob, s, len);
+      s += len;
+      if (s == end)
+      {
+        break;
+      }
+    }
+    if (*s >= 0x80)
+    {
+      //obuf_utf8len() stops at a nul, so give it one after the last byte
+      memset(seq, 0, sizeof(seq));
+      memcpy(seq, s, ((size_t)(end - s) < 4) ? (size_t)(end - s) : 4);
+      if ((len = obuf_utf8len(seq)) > 0)
+      {
+        if ((len == 3) && (s[0] == 0xEF) && (s[1] == 0xBF) && (s[2] >= 0xBE))
+        {
+          obuf_mem(ob, "\xEF\xBF\xBD", 3);
+        }
+        else
+        {
+          obuf_mem(ob, s, len);
+        }
+        s += len;
+        continue;
+      }
+      latin[0] = (char)(0xC0 | (*s >> 6));
+      latin[1] = (char)(0x80 | (*s & 0x3F));
+      obuf_mem(ob, latin, 2);
+      s++;
+      continue;
+    }
+    switch (*s)
+    {
+    case '&':
+      obuf_mem(ob, "&amp;", 5);
+      break;
+    case '<':
+      obuf_mem(ob, "&lt;", 4);
+      break;
+    case '>':
+      obuf_mem(ob, "&gt;", 4);
+      break;
+    case '"':
+      obuf_mem(ob, "&quot;", 6);
+      break;
+    case '\'':
+      obuf_mem(ob, "&apos;", 6);
+      break;
+    case '\t':
+    case '\n':
+      obuf_chr(ob, (char)*s);
+      break;
+    case '\r':
+      obuf_mem(ob, "&#13;", 5);
+      break;
+    default:
+      obuf_mem(ob, "\xEF\xBF\xBD", 3);
+    }
+    s++;
+  }
+}
+
+//
+//Function: obuf_flush() writes whatever ob holds to its stream and empties
+//          it. Returns 0 if successful or -1 if anything appended to ob has
+//          been lost.
+int obuf_flush(struct OBUF * ob)
+{
+  if ((ob->out != NULL) && (ob->len > 0))
+  {
+    if (fwrite(ob->buf, 1, ob->len, ob->out) != ob->len)
+    {
+      ob->failed = 1;
+    }
+    ob->len = 0;
+  }
+  return ob->failed ? -1 : 0;
+}
+
+//
+//Function: obuf_reset() empties ob without writing it. The memory is kept so
+//          that ob can be filled again without allocating.
+void obuf_reset(struct OBUF * ob)
+{
+  ob->len = 0;
+  ob->failed = 0;
+}
+
+//
+//Function: obuf_free() releases the memory held by ob.
+void obuf_free(struct OBUF * ob)
+{
+  free(ob->buf);
+  ob->buf = NULL;
+  ob->len = ob->cap = 0;
+}
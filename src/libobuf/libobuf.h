@@ -0,0 +1,160 @@
+/***************************************************************
+**                                                            **
+**                       libobuf.h                            **
+**                                                            **
+**    A library to build output in a growable byte buffer     **
+**    and write it out in large blocks                        **
+**                                                            **
+**            Copyright Paul Tew 2011 to 2024                 **
+**                                                            **
+** Structures:                                                **
+** -----------                                                **
+** OBUF - The buffer and the stream it is written to          **
+**                                                            **
+** Exported Functions:                                        **
+** -------------------                                        **
+** obuf_init(OBUF*, FILE*)                                    **
+**       Prepares an empty OBUF that writes to a stream (or   **
+**       keeps everything in memory if the stream is NULL)    **
+**                                                            **
+** obuf_str(OBUF*, const void*)                               **
+** obuf_mem(OBUF*, const void*, size_t)                       **
+** obuf_chr(OBUF*, char)                                      **
+** obuf_uint(OBUF*, uint64_t)                                 **
+**       Append a string, some bytes, a character or an       **
+**       unsigned number in decimal                           **
+**                                                            **
+** obuf_field(OBUF*, const void*, char)                       **
+**       Appends a string (quoted if it has to be) followed by**
+**       a separator                                          **
+**                                                            **
+** obuf_cat(OBUF*, const void*, ...)                          **
+**       Appends each string in turn up to a NULL argument    **
+**                                                            **
+** obuf_utf8(OBUF*, const void*)                              **
+**       Appends a string as valid UTF-8                      **
+**                                                            **
+** obuf_json(OBUF*, const void*)                              **
+**       Appends a string as a quoted and escaped JSON string **
+**                                                            **
+** obuf_xml(OBUF*, const void*)                               **
+** obuf_xmlmem(OBUF*, const void*, size_t)                    **
+**       Append a string or some bytes as escaped XML text    **
+**                                                            **
+** obuf_flush(OBUF*)                                          **
+**       Writes the buffer to its stream and empties it.      **
+**       Returns 0 on success, -1 if anything was lost.       **
+**                                                            **
+** obuf_reset(OBUF*)                                          **
+**       Empties the buffer without writing it                **
+**                                                            **
+** obuf_free(OBUF*)                                           **
+**       Releases the memory held by an OBUF                  **
+**                                                            **
+***************************************************************/
+
+/*
+This file is part of Lifer.
+
+    Lifer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Lifer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Lifer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+
+An OBUF holds formatted output until there is enough of it to be worth a
+write. Appending never takes a lock or parses a format string, it is just a
+copy into the buffer. An OBUF with a stream is written out with a single
+fwrite() whenever another append would take it past OBUF_FLUSHSIZE (and when
+obuf_flush() is called). Without a stream the buffer simply grows, which is
+how a whole record can be built in memory and handed to another thread.
+
+An OBUF is not shared between threads, each thread should have its own.
+
+The strings in a link file can hold anything, so the csv/tsv, XML and JSON
+functions quote or escape whatever could break the output they are written
+into. Most strings (paths above all) need nothing doing to them and
+obuf_field() and obuf_xml() check them 16 bytes at a time with SSE2 (32 with
+AVX2 if the compiler is told to use it), copying clean runs in one go.
+
+*/
+
+#ifndef _LIBOBUF_H_
+#define _LIBOBUF_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <inttypes.h>
+
+#define OBUF_FLUSHSIZE (64 * 1024) // Bytes held before an OBUF with a stream is written
+
+struct OBUF
+{
+  char *             buf;
+  size_t             len;    // Bytes in buf
+  size_t             cap;    // Allocated size of buf
+  FILE *             out;    // Where the buffer is written (NULL to keep it in memory)
+  int                failed; // Set if memory ran out or a write failed
+};
+
+/******************************************************************************/
+//Public Function Declarations
+
+//Prepares an empty OBUF
+extern void obuf_init(struct OBUF *, FILE *);
+//OBUF* is the buffer to prepare
+//FILE* is the stream to write to (NULL to keep everything in memory)
+
+//Appends a nul terminated string (of char or unsigned char, as liblife's are)
+extern void obuf_str(struct OBUF *, const void *);
+
+//Appends a number of bytes
+extern void obuf_mem(struct OBUF *, const void *, size_t);
+
+//Appends one character
+extern void obuf_chr(struct OBUF *, char);
+
+//Appends an unsigned number in decimal
+extern void obuf_uint(struct OBUF *, uint64_t);
+
+//Appends a string and then a separator (one field of a csv or tsv record, quoted
+//as RFC 4180 has it if the string holds the separator, a quote or a line end)
+extern void obuf_field(struct OBUF *, const void *, char);
+
+//Appends each of the strings given up to a NULL argument
+extern void obuf_cat(struct OBUF *, const void *, ...);
+
+//Appends a nul terminated string as UTF-8 (bytes that aren't are taken as Latin-1)
+extern void obuf_utf8(struct OBUF *, const void *);
+
+//Appends a nul terminated string as a JSON string (quoted, escaped and UTF-8)
+extern void obuf_json(struct OBUF *, const void *);
+
+//Appends a nul terminated string as XML character data (escaped and UTF-8)
+extern void obuf_xml(struct OBUF *, const void *);
+
+//Appends a number of bytes as XML character data (escaped and UTF-8)
+extern void obuf_xmlmem(struct OBUF *, const void *, size_t);
+
+//Writes the buffer to its stream and empties it (0 if successful, -1 if not)
+extern int obuf_flush(struct OBUF *);
+
+//Empties the buffer without writing it (the memory is kept for reuse)
+extern void obuf_reset(struct OBUF *);
+
+//Frees the memory held by an OBUF
+extern void obuf_free(struct OBUF *);
+
+#endif
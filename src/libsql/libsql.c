@@ -0,0 +1,1020 @@
+/*********************************************************
+**                                                      **
+**                 libsql.c                             **
+**                                                      **
+** A library to write decoded link files to an SQLite   **
+** database                                             **
+**                                                      **
+**         Copyright Paul Tew 2011 to 2024              **
+**                                                      **
+*********************************************************/
+
+/*
+This file is part of Lifer.
+
+    Lifer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Lifer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Lifer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "./libsql.h"
+
+#ifdef HAVE_SQLITE3
+#include <sqlite3.h>
+
+//The table made for each statement and the statement that adds a row to it.
+//The parameters are bound in the order they are listed here.
+static const char * const sql_tables[SQL_NSTMTS][2] =
+{
+  {
+    "CREATE TABLE links (id INTEGER PRIMARY KEY, file_name TEXT, file_size INTEGER, "
+    "accessed INTEGER, modified INTEGER, changed INTEGER, "
+    "header_size INTEGER, clsid TEXT, flags INTEGER, attributes INTEGER, "
+    "target_created INTEGER, target_accessed INTEGER, target_written INTEGER, "
+    "target_size INTEGER, icon_index INTEGER, show_state INTEGER, hotkey INTEGER, "
+    "reserved1 INTEGER, reserved2 INTEGER, reserved3 INTEGER, "
+    "idlist_size INTEGER, idlist_items INTEGER, "
+    "linkinfo_size INTEGER, linkinfo_header_size INTEGER, linkinfo_flags INTEGER, "
+    "volumeid_offset INTEGER, local_base_path_offset INTEGER, cnr_offset INTEGER, "
+    "common_path_suffix_offset INTEGER, local_base_path_offset_u INTEGER, "
+    "common_path_suffix_offset_u INTEGER, "
+    "volumeid_size INTEGER, drive_type INTEGER, drive_serial INTEGER, "
+    "volume_label_offset INTEGER, volume_label_offset_u INTEGER, "
+    "volume_label TEXT, volume_label_u TEXT, local_base_path TEXT, local_base_path_u TEXT, "
+    "cnr_size INTEGER, cnr_flags INTEGER, net_name_offset INTEGER, device_name_offset INTEGER, "
+    "network_provider_type INTEGER, net_name_offset_u INTEGER, device_name_offset_u INTEGER, "
+    "net_name TEXT, device_name TEXT, net_name_u TEXT, device_name_u TEXT, "
+    "common_path_suffix TEXT, common_path_suffix_u TEXT, "
+    "stringdata_size INTEGER, name_chars INTEGER, name TEXT, "
+    "relative_path_chars INTEGER, relative_path TEXT, working_dir_chars INTEGER, working_dir TEXT, "
+    "arguments_chars INTEGER, arguments TEXT, icon_location_chars INTEGER, icon_location TEXT, "
+    "extradata_size INTEGER, extradata_types INTEGER)",
+    "INSERT INTO links VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,"
+    "?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)"
+  },
+  {
+    "CREATE TABLE itemids (link_id INTEGER, item INTEGER, offset INTEGER, size INTEGER, data BLOB)",
+    "INSERT INTO itemids VALUES (?,?,?,?,?)"
+  },
+  {
+    "CREATE TABLE properties (link_id INTEGER, item INTEGER, store INTEGER, format_id TEXT, "
+    "value_num INTEGER, name TEXT, id INTEGER, type INTEGER, value)",
+    "INSERT INTO properties VALUES (?,?,?,?,?,?,?,?,?)"
+  },
+  {
+    "CREATE TABLE extradata (link_id INTEGER, block TEXT, signature INTEGER, offset INTEGER, size INTEGER)",
+    "INSERT INTO extradata VALUES (?,?,?,?,?)"
+  },
+  {
+    "CREATE TABLE console (link_id INTEGER, fill_attributes INTEGER, popup_fill_attributes INTEGER, "
+    "screen_buffer_size_x INTEGER, screen_buffer_size_y INTEGER, window_size_x INTEGER, "
+    "window_size_y INTEGER, window_origin_x INTEGER, window_origin_y INTEGER, "
+    "unused1 INTEGER, unused2 INTEGER, font_height INTEGER, font_width INTEGER, "
+    "font_family INTEGER, font_pitch INTEGER, font_weight INTEGER, face_name TEXT, "
+    "cursor_size INTEGER, full_screen INTEGER, quick_edit INTEGER, insert_mode INTEGER, "
+    "auto_position INTEGER, history_buffer_size INTEGER, history_buffers INTEGER, "
+    "history_no_dup INTEGER, color_table BLOB)",
+    "INSERT INTO console VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)"
+  },
+  {
+    "CREATE TABLE console_fe (link_id INTEGER, code_page INTEGER)",
+    "INSERT INTO console_fe VALUES (?,?)"
+  },
+  {
+    "CREATE TABLE darwin (link_id INTEGER, data_ansi TEXT, data_unicode TEXT)",
+    "INSERT INTO darwin VALUES (?,?,?)"
+  },
+  {
+    "CREATE TABLE environment (link_id INTEGER, target_ansi TEXT, target_unicode TEXT)",
+    "INSERT INTO environment VALUES (?,?,?)"
+  },
+  {
+    "CREATE TABLE icon_environment (link_id INTEGER, target_ansi TEXT, target_unicode TEXT)",
+    "INSERT INTO icon_environment VALUES (?,?,?)"
+  },
+  {
+    "CREATE TABLE known_folder (link_id INTEGER, folder_id TEXT, item_offset INTEGER)",
+    "INSERT INTO known_folder VALUES (?,?,?)"
+  },
+  {
+    "CREATE TABLE shim (link_id INTEGER, layer_name TEXT)",
+    "INSERT INTO shim VALUES (?,?)"
+  },
+  {
+    "CREATE TABLE special_folder (link_id INTEGER, folder_id INTEGER, item_offset INTEGER)",
+    "INSERT INTO special_folder VALUES (?,?,?)"
+  },
+  {
+    "CREATE TABLE tracker (link_id INTEGER, length INTEGER, version INTEGER, machine_id TEXT, "
+    "droid_volume TEXT, droid_file TEXT, birth_droid_volume TEXT, birth_droid_file TEXT)",
+    "INSERT INTO tracker VALUES (?,?,?,?,?,?,?,?)"
+  },
+  {
+    "CREATE TABLE vista_idlist (link_id INTEGER, items INTEGER)",
+    "INSERT INTO vista_idlist VALUES (?,?)"
+  }
+};
+
+//Made by sql_close() once all the rows are in
+static const char * const sql_indexes[] =
+{
+  "CREATE INDEX itemids_link ON itemids (link_id)",
+  "CREATE INDEX properties_link ON properties (link_id)",
+  "CREATE INDEX properties_id ON properties (format_id, id)",
+  "CREATE INDEX extradata_link ON extradata (link_id)",
+  "CREATE INDEX console_link ON console (link_id)",
+  "CREATE INDEX console_fe_link ON console_fe (link_id)",
+  "CREATE INDEX darwin_link ON darwin (link_id)",
+  "CREATE INDEX environment_link ON environment (link_id)",
+  "CREATE INDEX icon_environment_link ON icon_environment (link_id)",
+  "CREATE INDEX known_folder_link ON known_folder (link_id)",
+  "CREATE INDEX shim_link ON shim (link_id)",
+  "CREATE INDEX special_folder_link ON special_folder (link_id)",
+  "CREATE INDEX tracker_link ON tracker (link_id)",
+  "CREATE INDEX vista_idlist_link ON vista_idlist (link_id)"
+};
+
+//Private function declarations
+int sql_fail(struct SQL_WRITER *);
+void sql_end(struct SQL_WRITER *);
+int sql_exec(struct SQL_WRITER *, const char *);
+void sql_row(struct SQL_WRITER *, enum SQL_STMT, int64_t);
+void sql_int(struct SQL_WRITER *, int, int64_t);
+void sql_text(struct SQL_WRITER *, int, const void *);
+void sql_putcp(struct OBUF *, uint32_t);
+void sql_wtext(struct SQL_WRITER *, int, const wchar_t *, size_t);
+void sql_utf16(struct SQL_WRITER *, int, const unsigned char *, size_t);
+void sql_blob(struct SQL_WRITER *, const void *, size_t);
+void sql_guid(struct SQL_WRITER *, int, const struct LIF_CLSID *);
+uint64_t sql_le(const unsigned char *, int);
+void sql_value(struct SQL_WRITER *, const struct LIF_SER_PROPVALUE *, int);
+int sql_step(struct SQL_WRITER *);
+int sql_links(struct SQL_WRITER *, const char *, const struct stat *, int, const struct LIF *);
+int sql_propstores(struct SQL_WRITER *, int, const struct LIF_PROPERTY_STORE_PROPS *);
+int sql_itemids(struct SQL_WRITER *, const struct LIF *);
+int sql_extradata(struct SQL_WRITER *, const struct LIF *);
+
+//
+//Function: sql_fail() records SQLite's last error in w->msg and returns -1.
+int sql_fail(struct SQL_WRITER * w)
+{
+  snprintf(w->msg, sizeof(w->msg), "%s", (w->db != NULL) ? sqlite3_errmsg(w->db) : "out of memory");
+  return -1;
+}
+
+//
+//Function: sql_end() finalizes the statements and closes the database without
+//          committing anything.
+void sql_end(struct SQL_WRITER * w)
+{
+  int i;
+
+  for (i = 0; i < SQL_NSTMTS; i++)
+  {
+    sqlite3_finalize(w->stmts[i]);
+    w->stmts[i] = NULL;
+  }
+  sqlite3_close(w->db);
+  w->db = NULL;
+  obuf_free(&w->text);
+}
+
+//
+//Function: sql_exec() runs the SQL statement sql. Returns 0 if successful or
+//          -1 if not.
+int sql_exec(struct SQL_WRITER * w, const char * sql)
+{
+  if (sqlite3_exec(w->db, sql, NULL, NULL, NULL) != SQLITE_OK)
+  {
+    return sql_fail(w);
+  }
+  return 0;
+}
+
+//
+//Function: sql_row() starts a row of the table for stmt. Tables other than
+//          links start with the link_id, which is bound here.
+void sql_row(struct SQL_WRITER * w, enum SQL_STMT stmt, int64_t link_id)
+{
+  w->cur = w->stmts[stmt];
+  w->col = 0;
+  sql_int(w, 1, link_id);
+}
+
+//
+//Function: sql_int() binds n to the next parameter, or leaves it NULL if
+//          present isn't set.
+void sql_int(struct SQL_WRITER * w, int present, int64_t n)
+{
+  w->col++;
+  if (present)
+  {
+    sqlite3_bind_int64(w->cur, w->col, n);
+  }
+}
+
+//
+//Function: sql_text() binds the nul terminated string str to the next
+//          parameter (or leaves it NULL). A string that isn't all ASCII is
+//          converted to UTF-8 first, taking any byte that isn't UTF-8 to be
+//          Latin-1 (see obuf_utf8()).
+void sql_text(struct SQL_WRITER * w, int present, const void * str)
+{
+  const unsigned char * s = (const unsigned char *)str;
+
+  w->col++;
+  if (!present)
+  {
+    return;
+  }
+  while ((*s > 0) && (*s < 0x80))
+  {
+    s++;
+  }
+  if (*s == 0)
+  {
+    sqlite3_bind_text(w->cur, w->col, (const char *)str, (int)(s - (const unsigned char *)str), SQLITE_TRANSIENT);
+    return;
+  }
+  obuf_reset(&w->text);
+  obuf_utf8(&w->text, str);
+  if (!w->text.failed)
+  {
+    sqlite3_bind_text(w->cur, w->col, w->text.buf, (int)w->text.len, SQLITE_TRANSIENT);
+  }
+}
+
+//
+//Function: sql_putcp() appends the code point cp to ob in UTF-8. Surrogates
+//          and values past U+10FFFF become U+FFFD.
+void sql_putcp(struct OBUF * ob, uint32_t cp)
+{
+  char u[4];
+
+  if (((cp >= 0xD800) && (cp <= 0xDFFF)) || (cp > 0x10FFFF))
+  {
+    cp = 0xFFFD;
+  }
+  if (cp < 0x80)
+  {
+    obuf_chr(ob, (char)cp);
+  }
+  else if (cp < 0x800)
+  {
+    u[0] = (char)(0xC0 | (cp >> 6));
+    u[1] = (char)(0x80 | (cp & 0x3F));
+    obuf_mem(ob, u, 2);
+  }
+  else if (cp < 0x10000)
+  {
+    u[0] = (char)(0xE0 | (cp >> 12));
+    u[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    u[2] = (char)(0x80 | (cp & 0x3F));
+    obuf_mem(ob, u, 3);
+  }
+  else
+  {
+    u[0] = (char)(0xF0 | (cp >> 18));
+    u[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    u[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    u[3] = (char)(0x80 | (cp & 0x3F));
+    obuf_mem(ob, u, 4);
+  }
+}
+
+//
+//Function: sql_wtext() binds the wide string str (of at most max characters)
+//          to the next parameter as UTF-8, or leaves it NULL. Where wchar_t
+//          is 16 bits the string is UTF-16 and surrogate pairs are joined.
+void sql_wtext(struct SQL_WRITER * w, int present, const wchar_t * str, size_t max)
+{
+  size_t i;
+  uint32_t cp;
+
+  w->col++;
+  if (!present)
+  {
+    return;
+  }
+  obuf_reset(&w->text);
+  for (i = 0; (i < max) && (str[i] != 0); i++)
+  {
+    cp = (uint32_t)str[i];
+    if ((cp >= 0xD800) && (cp <= 0xDBFF) && (i + 1 < max) &&
+      ((uint32_t)str[i + 1] >= 0xDC00) && ((uint32_t)str[i + 1] <= 0xDFFF))
+    {
+      cp = 0x10000 + ((cp - 0xD800) << 10) + ((uint32_t)str[++i] - 0xDC00);
+    }
+    sql_putcp(&w->text, cp);
+  }
+  if (!w->text.failed)
+  {
+    sqlite3_bind_text(w->cur, w->col, (w->text.len > 0) ? w->text.buf : "", (int)w->text.len, SQLITE_TRANSIENT);
+  }
+}
+
+//
+//Function: sql_utf16() binds the UTF-16LE string in the n bytes at p (up to
+//          a nul character) to the next parameter as UTF-8, or leaves it NULL.
+void sql_utf16(struct SQL_WRITER * w, int present, const unsigned char * p, size_t n)
+{
+  size_t i;
+  uint32_t cp, lo;
+
+  w->col++;
+  if (!present)
+  {
+    return;
+  }
+  obuf_reset(&w->text);
+  for (i = 0; i + 1 < n; i += 2)
+  {
+    if ((cp = (uint32_t)(p[i] | (p[i + 1] << 8))) == 0)
+    {
+      break;
+    }
+    if ((cp >= 0xD800) && (cp <= 0xDBFF) && (i + 3 < n))
+    {
+      lo = (uint32_t)(p[i + 2] | (p[i + 3] << 8));
+      if ((lo >= 0xDC00) && (lo <= 0xDFFF))
+      {
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+        i += 2;
+      }
+    }
+    sql_putcp(&w->text, cp);
+  }
+  if (!w->text.failed)
+  {
+    sqlite3_bind_text(w->cur, w->col, (w->text.len > 0) ? w->text.buf : "", (int)w->text.len, SQLITE_TRANSIENT);
+  }
+}
+
+//
+//Function: sql_blob() binds the n bytes at data to the next parameter.
+void sql_blob(struct SQL_WRITER * w, const void * data, size_t n)
+{
+  w->col++;
+  sqlite3_bind_blob(w->cur, w->col, data, (int)n, SQLITE_TRANSIENT);
+}
+
+//
+//Function: sql_guid() binds the GUID in guid to the next parameter as text
+//          in the form get_droid_a() uses, or leaves it NULL.
+void sql_guid(struct SQL_WRITER * w, int present, const struct LIF_CLSID * guid)
+{
+  char str[40];
+
+  w->col++;
+  if (!present)
+  {
+    return;
+  }
+  snprintf(str, sizeof(str), "{%.8"PRIX32"-%.4"PRIX16"-%.4"PRIX16"-%.2X%.2X-%.2X%.2X%.2X%.2X%.2X%.2X}",
+    guid->Data1, guid->Data2, guid->Data3, guid->Data4hi[0], guid->Data4hi[1],
+    guid->Data4lo[0], guid->Data4lo[1], guid->Data4lo[2], guid->Data4lo[3], guid->Data4lo[4], guid->Data4lo[5]);
+  sqlite3_bind_text(w->cur, w->col, str, -1, SQLITE_TRANSIENT);
+}
+
+//
+//Function: sql_le() returns the n byte little endian number at p.
+uint64_t sql_le(const unsigned char * p, int n)
+{
+  uint64_t v = 0;
+
+  while (n-- > 0)
+  {
+    v = (v << 8) | p[n];
+  }
+  return v;
+}
+
+//
+//Function: sql_value() binds the value of the property pv to the next
+//          parameter. Integers, booleans and FILETIMEs are stored as integers
+//          and strings and GUIDs as text. Anything else (or anything too
+//          short to be what its type says) is stored as the raw bytes. named
+//          is set if the property has a name (which comes before the value).
+void sql_value(struct SQL_WRITER * w, const struct LIF_SER_PROPVALUE * pv, int named)
+{
+  const unsigned char * v = pv->Value;
+  unsigned char str[sizeof(pv->Value) + 1];
+  int64_t n;
+  uint64_t len;
+
+  //ValueSize counts itself, the name or ID, Reserved, the type and the padding
+  n = (int64_t)pv->ValueSize - 13 - (named ? (int64_t)pv->NameSizeOrID : 0);
+  n = (n < 0) ? 0 : (n > (int64_t)sizeof(pv->Value)) ? (int64_t)sizeof(pv->Value) : n;
+  switch (pv->PropertyType)
+  {
+  case VT_I1:
+    sql_int(w, n >= 1, (int8_t)v[0]);
+    return;
+  case VT_UI1:
+    sql_int(w, n >= 1, v[0]);
+    return;
+  case VT_I2:
+    sql_int(w, n >= 2, (int16_t)sql_le(v, 2));
+    return;
+  case VT_UI2:
+    sql_int(w, n >= 2, (int64_t)sql_le(v, 2));
+    return;
+  case VT_BOOL:
+    sql_int(w, n >= 2, sql_le(v, 2) != 0);
+    return;
+  case VT_I4:
+  case VT_INT:
+    sql_int(w, n >= 4, (int32_t)sql_le(v, 4));
+    return;
+  case VT_UI4:
+  case VT_UINT:
+  case VT_ERROR:
+    sql_int(w, n >= 4, (int64_t)sql_le(v, 4));
+    return;
+  case VT_I8:
+  case VT_UI8:
+  case VT_FILETIME:
+    sql_int(w, n >= 8, (int64_t)sql_le(v, 8));
+    return;
+  case VT_CLSID:
+    if (n >= 16)
+    {
+      struct LIF_CLSID guid;
+
+      guid.Data1 = (uint32_t)sql_le(v, 4);
+      guid.Data2 = (uint16_t)sql_le(v + 4, 2);
+      guid.Data3 = (uint16_t)sql_le(v + 6, 2);
+      memcpy(guid.Data4hi, v + 8, 2);
+      memcpy(guid.Data4lo, v + 10, 6);
+      sql_guid(w, 1, &guid);
+      return;
+    }
+    break;
+  case VT_LPWSTR: // A count of characters then the string
+    if (n >= 4)
+    {
+      len = sql_le(v, 4) * 2;
+      sql_utf16(w, 1, v + 4, (len < (uint64_t)n - 4) ? (size_t)len : (size_t)n - 4);
+      return;
+    }
+    break;
+  case VT_LPSTR: // A count of bytes then the string, which may still be UTF-16
+  case VT_BSTR:
+    if (n >= 4)
+    {
+      len = sql_le(v, 4);
+      len = (len < (uint64_t)n - 4) ? len : (uint64_t)n - 4;
+      if ((len >= 2) && (v[4 + len - 1] == 0) && (v[4 + len - 2] == 0))
+      {
+        sql_utf16(w, 1, v + 4, (size_t)len);
+      }
+      else
+      {
+        //The terminator ends the string if there is one
+        memcpy(str, v + 4, (size_t)len);
+        str[len] = 0;
+        sql_text(w, 1, str);
+      }
+      return;
+    }
+    break;
+  default:
+    break;
+  }
+  sql_blob(w, v, (size_t)n);
+}
+
+//
+//Function: sql_step() inserts the row that has been bound and clears the
+//          statement for the next. Returns 0 if successful or -1 if not.
+int sql_step(struct SQL_WRITER * w)
+{
+  int result;
+
+  if (w->text.failed)
+  {
+    obuf_reset(&w->text);
+    sqlite3_clear_bindings(w->cur);
+    snprintf(w->msg, sizeof(w->msg), "out of memory");
+    return -1;
+  }
+  if (w->col != sqlite3_bind_parameter_count(w->cur))
+  {
+    sqlite3_clear_bindings(w->cur);
+    snprintf(w->msg, sizeof(w->msg), "%d values given for %.100s", w->col, sqlite3_sql(w->cur));
+    return -1;
+  }
+  result = sqlite3_step(w->cur);
+  sqlite3_reset(w->cur);
+  sqlite3_clear_bindings(w->cur);
+  if (result != SQLITE_DONE)
+  {
+    return sql_fail(w);
+  }
+  return 0;
+}
+
+//
+//Function: sql_links() adds the links row for the link file fname. Its
+//          times are NULL if times is 0.
+int sql_links(struct SQL_WRITER * w, const char * fname, const struct stat * statbuf, int times, const struct LIF * lif)
+{
+  int i;
+  int idlist = (lif->lh.Flags & 0x00000001) != 0;        // HasLinkTargetIDList
+  int info = (lif->lh.Flags & 0x00000002) != 0;          // HasLinkInfo
+  int volid = info && (lif->li.Flags & 0x00000001);      // VolumeIDAndLocalBasePath
+  int cnr = info && (lif->li.Flags & 0x00000002);        // CommonNetworkRelativeLinkAndPathSuffix
+
+  w->cur = w->stmts[SQL_LINKS];
+  w->col = 0;
+  sql_int(w, 1, w->links);
+  sql_text(w, 1, fname);
+  sql_int(w, 1, (int64_t)statbuf->st_size);
+  sql_int(w, times, (int64_t)statbuf->st_atime);
+  sql_int(w, times, (int64_t)statbuf->st_mtime);
+  sql_int(w, times, (int64_t)statbuf->st_ctime);
+  // S2.1 ShellLinkHeader
+  sql_int(w, 1, lif->lh.H_size);
+  sql_guid(w, 1, &lif->lh.CLSID);
+  sql_int(w, 1, lif->lh.Flags);
+  sql_int(w, 1, lif->lh.Attr);
+  sql_int(w, 1, lif->lh.CrDate);
+  sql_int(w, 1, lif->lh.AcDate);
+  sql_int(w, 1, lif->lh.WtDate);
+  sql_int(w, 1, lif->lh.Size);
+  sql_int(w, 1, lif->lh.IconIndex);
+  sql_int(w, 1, lif->lh.ShowState);
+  sql_int(w, 1, (lif->lh.Hotkey.HighKey << 8) | lif->lh.Hotkey.LowKey);
+  sql_int(w, 1, lif->lh.Reserved1);
+  sql_int(w, 1, lif->lh.Reserved2);
+  sql_int(w, 1, lif->lh.Reserved3);
+  // S2.2 LinkTargetIDList
+  sql_int(w, idlist, lif->lidl.IDListSize);
+  sql_int(w, idlist, lif->lidl.NumItemIDs);
+  // S2.3 LinkInfo
+  sql_int(w, info, lif->li.Size);
+  sql_int(w, info, lif->li.HeaderSize);
+  sql_int(w, info, lif->li.Flags);
+  sql_int(w, info, lif->li.IDOffset);
+  sql_int(w, info, lif->li.LBPOffset);
+  sql_int(w, info, lif->li.CNRLOffset);
+  sql_int(w, info, lif->li.CPSOffset);
+  sql_int(w, info, lif->li.LBPOffsetU);
+  sql_int(w, info, lif->li.CPSOffsetU);
+  sql_int(w, volid, lif->li.VolID.Size);
+  sql_int(w, volid, lif->li.VolID.DriveType);
+  sql_int(w, volid, lif->li.VolID.DriveSN);
+  sql_int(w, volid, lif->li.VolID.VLOffset);
+  sql_int(w, volid, lif->li.VolID.VLOffsetU);
+  sql_text(w, volid, lif->li.VolID.VolumeLabel);
+  sql_wtext(w, volid && (lif->li.VolID.VLOffsetU > 0), lif->li.VolID.VolumeLabelU, 33);
+  sql_text(w, volid, lif->li.LBP);
+  sql_wtext(w, volid && (lif->li.LBPOffsetU > 0), lif->li.LBPU, 300);
+  sql_int(w, cnr, lif->li.CNR.Size);
+  sql_int(w, cnr, lif->li.CNR.Flags);
+  sql_int(w, cnr, lif->li.CNR.NetNameOffset);
+  sql_int(w, cnr, lif->li.CNR.DeviceNameOffset);
+  //ValidNetType and ValidDevice say whether the provider type and device name are there
+  sql_int(w, cnr && (lif->li.CNR.Flags & 0x00000002), lif->li.CNR.NetworkProviderType);
+  sql_int(w, cnr, lif->li.CNR.NetNameOffsetU);
+  sql_int(w, cnr, lif->li.CNR.DeviceNameOffsetU);
+  sql_text(w, cnr, lif->li.CNR.NetName);
+  sql_text(w, cnr && (lif->li.CNR.Flags & 0x00000001), lif->li.CNR.DeviceName);
+  sql_wtext(w, cnr && (lif->li.CNR.NetNameOffsetU > 0), lif->li.CNR.NetNameU, 300);
+  sql_wtext(w, cnr && (lif->li.CNR.DeviceNameOffsetU > 0), lif->li.CNR.DeviceNameU, 300);
+  sql_text(w, info, lif->li.CPS);
+  sql_wtext(w, info && (lif->li.CPSOffsetU > 0), lif->li.CPSU, 100);
+  // S2.4 StringData
+  sql_int(w, 1, lif->lsd.Size);
+  for (i = 0; i < 5; i++)
+  {
+    //HasName, HasRelativePath, HasWorkingDir, HasArguments and HasIconLocation
+    sql_int(w, lif->lh.Flags & (0x00000004 << i), lif->lsd.CountChars[i]);
+    sql_text(w, lif->lh.Flags & (0x00000004 << i), lif->lsd.Data[i]);
+  }
+  // S2.5 ExtraData
+  sql_int(w, 1, lif->led.Size);
+  sql_int(w, 1, lif->led.edtypes);
+  return sql_step(w);
+}
+
+//
+//Function: sql_propstores() adds a properties row for each value in the
+//          property stores psp. item is the number of the ItemID that holds
+//          them or 0 for the PropertyStoreDataBlock.
+int sql_propstores(struct SQL_WRITER * w, int item, const struct LIF_PROPERTY_STORE_PROPS * psp)
+{
+  const struct LIF_SER_PROPSTORE * ps;
+  const struct LIF_SER_PROPVALUE * pv;
+  int i, j, named;
+
+  for (i = 0; i < psp->NumStores; i++)
+  {
+    ps = &psp->Stores[i];
+    named = (ps->NameType == 0);
+    for (j = 0; j < ps->NumValues; j++)
+    {
+      pv = &ps->PropValues[j];
+      if (pv->ValueSize == 0) // The terminator
+      {
+        continue;
+      }
+      sql_row(w, SQL_PROPERTIES, w->links);
+      sql_int(w, item > 0, item);
+      sql_int(w, 1, i + 1);
+      sql_guid(w, 1, &ps->FormatID);
+      sql_int(w, 1, j + 1);
+      sql_utf16(w, named, pv->Name, (pv->NameSizeOrID < sizeof(pv->Name)) ? pv->NameSizeOrID : sizeof(pv->Name));
+      sql_int(w, !named, pv->NameSizeOrID);
+      sql_int(w, 1, pv->PropertyType);
+      sql_value(w, pv, named);
+      if (sql_step(w) != 0)
+      {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+//
+//Function: sql_itemids() adds an itemids row for each ItemID in the
+//          LinkTargetIDList and the properties held in any of them.
+int sql_itemids(struct SQL_WRITER * w, const struct LIF * lif)
+{
+  int i;
+  uint32_t offset, n;
+  const struct LIF_ITEMID * id;
+
+  //The first ItemID follows the header and the IDListSize
+  offset = lif->lh.H_size + 2;
+  for (i = 0; i < lif->lidl.NumItemIDs; i++)
+  {
+    id = &lif->lidl.Items[i];
+    //ItemIDSize counts itself
+    n = (id->ItemIDSize > 2) ? id->ItemIDSize - 2u : 0;
+    n = (n < MAXITEMIDSIZE) ? n : MAXITEMIDSIZE;
+    sql_row(w, SQL_ITEMIDS, w->links);
+    sql_int(w, 1, i + 1);
+    sql_int(w, 1, offset);
+    sql_int(w, 1, id->ItemIDSize);
+    sql_blob(w, id->Data, n);
+    if (sql_step(w) != 0)
+    {
+      return -1;
+    }
+    if ((find_propstores((unsigned char *)id->Data, (int)n, (int)(offset + 2), &w->psp) == 0) &&
+      (sql_propstores(w, i + 1, &w->psp) != 0))
+    {
+      return -1;
+    }
+    offset += id->ItemIDSize;
+  }
+  return 0;
+}
+
+//
+//Function: sql_extradata() adds an extradata row for each ExtraData block
+//          and a row to the table of each block that has one.
+int sql_extradata(struct SQL_WRITER * w, const struct LIF * lif)
+{
+  const struct LIF_EXTRA_DATA * led = &lif->led;
+  unsigned char colors[16 * 4], machine[17];
+  int i;
+  struct
+  {
+    enum EDTYPES     type;
+    const char *     name;
+    uint32_t         sig;
+    uint16_t         posn;
+    uint32_t         size;
+  } blocks[11] =
+  {
+    { CONSOLE_PROPS, "ConsoleDataBlock", led->lcp.sig, led->lcp.Posn, led->lcp.Size },
+    { CONSOLE_FE_PROPS, "ConsoleFEDataBlock", led->lcfep.sig, led->lcfep.Posn, led->lcfep.Size },
+    { DARWIN_PROPS, "DarwinDataBlock", led->ldp.sig, led->ldp.Posn, led->ldp.Size },
+    { ENVIRONMENT_PROPS, "EnvironmentVariableDataBlock", led->lep.sig, led->lep.Posn, led->lep.Size },
+    { ICON_ENVIRONMENT_PROPS, "IconEnvironmentDataBlock", led->liep.sig, led->liep.Posn, led->liep.Size },
+    { KNOWN_FOLDER_PROPS, "KnownFolderDataBlock", led->lkfp.sig, led->lkfp.Posn, led->lkfp.Size },
+    { PROPERTY_STORE_PROPS, "PropertyStoreDataBlock", led->lpsp.sig, led->lpsp.Posn, led->lpsp.Size },
+    { SHIM_PROPS, "ShimDataBlock", led->lsp.sig, led->lsp.Posn, led->lsp.Size },
+    { SPECIAL_FOLDER_PROPS, "SpecialFolderDataBlock", led->lsfp.sig, led->lsfp.Posn, led->lsfp.Size },
+    { TRACKER_PROPS, "TrackerDataBlock", led->ltp.sig, led->ltp.Posn, led->ltp.Size },
+    { VISTA_AND_ABOVE_IDLIST_PROPS, "VistaAndAboveIDListDataBlock", led->lvidlp.sig, led->lvidlp.Posn, led->lvidlp.Size }
+  };
+
+  for (i = 0; i < 11; i++)
+  {
+    if (led->edtypes & blocks[i].type)
+    {
+      sql_row(w, SQL_EXTRADATA, w->links);
+      sql_text(w, 1, blocks[i].name);
+      sql_int(w, 1, blocks[i].sig);
+      sql_int(w, 1, blocks[i].posn);
+      sql_int(w, 1, blocks[i].size);
+      if (sql_step(w) != 0)
+      {
+        return -1;
+      }
+    }
+  }
+  // S2.5.1 ConsoleDataBlock
+  if (led->edtypes & CONSOLE_PROPS)
+  {
+    sql_row(w, SQL_CONSOLE, w->links);
+    sql_int(w, 1, led->lcp.FillAttributes);
+    sql_int(w, 1, led->lcp.PopupFillAttributes);
+    sql_int(w, 1, led->lcp.ScreenBufferSizeX);
+    sql_int(w, 1, led->lcp.ScreenBufferSizeY);
+    sql_int(w, 1, led->lcp.WindowSizeX);
+    sql_int(w, 1, led->lcp.WindowSizeY);
+    sql_int(w, 1, led->lcp.WindowOriginX);
+    sql_int(w, 1, led->lcp.WindowOriginY);
+    sql_int(w, 1, led->lcp.Unused1);
+    sql_int(w, 1, led->lcp.Unused2);
+    sql_int(w, 1, led->lcp.FontSize_Height);
+    sql_int(w, 1, led->lcp.FontSize_Width);
+    sql_int(w, 1, led->lcp.FontFamily_Family);
+    sql_int(w, 1, led->lcp.FontFamily_Pitch);
+    sql_int(w, 1, led->lcp.FontWeight);
+    sql_wtext(w, 1, led->lcp.FaceName, 32);
+    sql_int(w, 1, led->lcp.CursorSize);
+    sql_int(w, 1, led->lcp.FullScreen);
+    sql_int(w, 1, led->lcp.QuickEdit);
+    sql_int(w, 1, led->lcp.InsertMode);
+    sql_int(w, 1, led->lcp.AutoPosition);
+    sql_int(w, 1, led->lcp.HistoryBufferSize);
+    sql_int(w, 1, led->lcp.NumberOfHistoryBuffers);
+    sql_int(w, 1, led->lcp.HistoryNoDup);
+    //The 16 COLORREFs as they are in the file
+    for (i = 0; i < 16; i++)
+    {
+      colors[i * 4] = (unsigned char)led->lcp.ColorTable[i];
+      colors[i * 4 + 1] = (unsigned char)(led->lcp.ColorTable[i] >> 8);
+      colors[i * 4 + 2] = (unsigned char)(led->lcp.ColorTable[i] >> 16);
+      colors[i * 4 + 3] = (unsigned char)(led->lcp.ColorTable[i] >> 24);
+    }
+    sql_blob(w, colors, sizeof(colors));
+    if (sql_step(w) != 0)
+    {
+      return -1;
+    }
+  }
+  // S2.5.2 ConsoleFEDataBlock
+  if (led->edtypes & CONSOLE_FE_PROPS)
+  {
+    sql_row(w, SQL_CONSOLE_FE, w->links);
+    sql_int(w, 1, led->lcfep.CodePage);
+    if (sql_step(w) != 0)
+    {
+      return -1;
+    }
+  }
+  // S2.5.3 DarwinDataBlock
+  if (led->edtypes & DARWIN_PROPS)
+  {
+    sql_row(w, SQL_DARWIN, w->links);
+    sql_text(w, 1, led->ldp.DarwinDataAnsi);
+    sql_wtext(w, 1, led->ldp.DarwinDataUnicode, 260);
+    if (sql_step(w) != 0)
+    {
+      return -1;
+    }
+  }
+  // S2.5.4 EnvironmentVariableDataBlock
+  if (led->edtypes & ENVIRONMENT_PROPS)
+  {
+    sql_row(w, SQL_ENVIRONMENT, w->links);
+    sql_text(w, 1, led->lep.TargetAnsi);
+    sql_wtext(w, 1, led->lep.TargetUnicode, 260);
+    if (sql_step(w) != 0)
+    {
+      return -1;
+    }
+  }
+  // S2.5.5 IconEnvironmentDataBlock
+  if (led->edtypes & ICON_ENVIRONMENT_PROPS)
+  {
+    sql_row(w, SQL_ICON_ENVIRONMENT, w->links);
+    sql_text(w, 1, led->liep.TargetAnsi);
+    sql_wtext(w, 1, led->liep.TargetUnicode, 260);
+    if (sql_step(w) != 0)
+    {
+      return -1;
+    }
+  }
+  // S2.5.6 KnownFolderDataBlock
+  if (led->edtypes & KNOWN_FOLDER_PROPS)
+  {
+    sql_row(w, SQL_KNOWN_FOLDER, w->links);
+    sql_guid(w, 1, &led->lkfp.KFGUID);
+    sql_int(w, 1, led->lkfp.KFOffset);
+    if (sql_step(w) != 0)
+    {
+      return -1;
+    }
+  }
+  // S2.5.7 PropertyStoreDataBlock
+  if ((led->edtypes & PROPERTY_STORE_PROPS) && (sql_propstores(w, 0, &led->lpsp) != 0))
+  {
+    return -1;
+  }
+  // S2.5.8 ShimDataBlock
+  if (led->edtypes & SHIM_PROPS)
+  {
+    sql_row(w, SQL_SHIM, w->links);
+    sql_wtext(w, 1, led->lsp.LayerName, 600);
+    if (sql_step(w) != 0)
+    {
+      return -1;
+    }
+  }
+  // S2.5.9 SpecialFolderDataBlock
+  if (led->edtypes & SPECIAL_FOLDER_PROPS)
+  {
+    sql_row(w, SQL_SPECIAL_FOLDER, w->links);
+    sql_int(w, 1, led->lsfp.SpecialFolderID);
+    sql_int(w, 1, led->lsfp.Offset);
+    if (sql_step(w) != 0)
+    {
+      return -1;
+    }
+  }
+  // S2.5.10 TrackerDataBlock
+  if (led->edtypes & TRACKER_PROPS)
+  {
+    //A NetBIOS name fills all 16 bytes without a terminator
+    memcpy(machine, led->ltp.MachineID, 16);
+    machine[16] = 0;
+    sql_row(w, SQL_TRACKER, w->links);
+    sql_int(w, 1, led->ltp.Length);
+    sql_int(w, 1, led->ltp.Version);
+    sql_text(w, 1, machine);
+    sql_guid(w, 1, &led->ltp.Droid1);
+    sql_guid(w, 1, &led->ltp.Droid2);
+    sql_guid(w, 1, &led->ltp.DroidBirth1);
+    sql_guid(w, 1, &led->ltp.DroidBirth2);
+    if (sql_step(w) != 0)
+    {
+      return -1;
+    }
+  }
+  // S2.5.11 VistaAndAboveIDListDataBlock
+  if (led->edtypes & VISTA_AND_ABOVE_IDLIST_PROPS)
+  {
+    sql_row(w, SQL_VISTA_IDLIST, w->links);
+    sql_int(w, 1, led->lvidlp.NumItemIDs);
+    if (sql_step(w) != 0)
+    {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+//
+//Function: sql_open() creates the database at path, makes its tables,
+//          prepares the statements and starts the first transaction. The
+//          database is made in one go and is of no use if lifer is stopped
+//          part way, so SQLite is told not to keep a journal or wait for the
+//          disk. Returns 0 if successful or -1 if not.
+extern int sql_open(struct SQL_WRITER * w, const char * path)
+{
+  int i;
+
+  memset(w, 0, sizeof(struct SQL_WRITER));
+  obuf_init(&w->text, NULL);
+  if (sqlite3_open_v2(path, &w->db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK)
+  {
+    sql_fail(w);
+    sql_end(w);
+    return -1;
+  }
+  if ((sql_exec(w, "PRAGMA journal_mode = OFF") != 0) ||
+    (sql_exec(w, "PRAGMA synchronous = OFF") != 0) ||
+    (sql_exec(w, "BEGIN") != 0))
+  {
+    sql_end(w);
+    return -1;
+  }
+  for (i = 0; i < SQL_NSTMTS; i++)
+  {
+    if (sql_exec(w, sql_tables[i][0]) != 0)
+    {
+      sql_end(w);
+      return -1;
+    }
+    if (sqlite3_prepare_v2(w->db, sql_tables[i][1], -1, &w->stmts[i], NULL) != SQLITE_OK)
+    {
+      sql_fail(w);
+      sql_end(w);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+//
+//Function: sql_add() adds the link file fname, decoded into lif, to the
+//          database. A new transaction is started every SQL_TXNROWS files.
+//          Returns 0 if successful or -1 if not.
+extern int sql_add(struct SQL_WRITER * w, const char * fname, const struct stat * statbuf, int times, const struct LIF * lif)
+{
+  w->links++;
+  if ((sql_links(w, fname, statbuf, times, lif) != 0) ||
+    (sql_itemids(w, lif) != 0) ||
+    (sql_extradata(w, lif) != 0))
+  {
+    return -1;
+  }
+  if (++w->txnrows >= SQL_TXNROWS)
+  {
+    w->txnrows = 0;
+    if ((sql_exec(w, "COMMIT") != 0) || (sql_exec(w, "BEGIN") != 0))
+    {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+//
+//Function: sql_close() commits the last transaction, makes the indexes and
+//          closes the database. Returns 0 if successful or -1 if not (the
+//          database is closed either way).
+extern int sql_close(struct SQL_WRITER * w)
+{
+  int i, result = 0;
+
+  if (w->db == NULL)
+  {
+    return 0;
+  }
+  for (i = 0; i < SQL_NSTMTS; i++)
+  {
+    sqlite3_finalize(w->stmts[i]);
+    w->stmts[i] = NULL;
+  }
+  if (sqlite3_get_autocommit(w->db) == 0)
+  {
+    result = sql_exec(w, "COMMIT");
+  }
+  for (i = 0; (result == 0) && (i < (int)(sizeof(sql_indexes) / sizeof(sql_indexes[0]))); i++)
+  {
+    result = sql_exec(w, sql_indexes[i]);
+  }
+  if ((sqlite3_close(w->db) != SQLITE_OK) && (result == 0))
+  {
+    result = sql_fail(w);
+  }
+  w->db = NULL;
+  obuf_free(&w->text);
+  return result;
+}
+
+#else
+
+//Without SQLite there is no database to write to
+
+extern int sql_open(struct SQL_WRITER * w, const char * path)
+{
+  (void)path;
+  memset(w, 0, sizeof(struct SQL_WRITER));
+  snprintf(w->msg, sizeof(w->msg), "lifer was built without SQLite (see INSTALLATION)");
+  return -1;
+}
+
+extern int sql_add(struct SQL_WRITER * w, const char * fname, const struct stat * statbuf, int times, const struct LIF * lif)
+{
+  (void)fname;
+  (void)statbuf;
+  (void)times;
+  (void)lif;
+  snprintf(w->msg, sizeof(w->msg), "lifer was built without SQLite");
+  return -1;
+}
+
+extern int sql_close(struct SQL_WRITER * w)
+{
+  (void)w;
+  return 0;
+}
+
+#endif
+
+//
+//Function: sql_error() returns a message saying why the last call to one of
+//          the functions above failed.
+extern const char * sql_error(struct SQL_WRITER * w)
+{
+  return w->msg;
+}
@@ -0,0 +1,148 @@
+/***************************************************************
+**                                                            **
+**                        libsql.h                            **
+**                                                            **
+**    A library to write decoded link files to an SQLite      **
+**    database                                                **
+**                                                            **
+**            Copyright Paul Tew 2011 to 2024                 **
+**                                                            **
+** Structures:                                                **
+** -----------                                                **
+** SQL_WRITER - The database and the prepared statements      **
+**              that add rows to it                           **
+**                                                            **
+** Exported Functions:                                        **
+** -------------------                                        **
+** sql_open(SQL_WRITER*, const char*)                         **
+**       Creates the tables in a new database. Returns 0 on   **
+**       success, -1 on failure.                              **
+**                                                            **
+** sql_add(SQL_WRITER*, const char*, stat*, int, LIF*)        **
+**       Adds one link file to the database. Returns 0 on     **
+**       success, -1 on failure.                              **
+**                                                            **
+** sql_close(SQL_WRITER*)                                     **
+**       Commits the last rows, builds the indexes and closes **
+**       the database. Returns 0 on success, -1 on failure.   **
+**                                                            **
+** sql_error(SQL_WRITER*)                                     **
+**       Returns a message saying why the last call failed    **
+**                                                            **
+***************************************************************/
+
+/*
+This file is part of Lifer.
+
+    Lifer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Lifer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Lifer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+
+The database has a row in the links table for each link file and a table for
+each kind of thing a link file can hold any number of (the ItemIDs of the
+LinkTargetIDList, the ExtraData blocks and the property values). Each of the
+ExtraData blocks that has something to say also has a table of its own. The
+rows of the other tables refer to their link file by links.id (link_id).
+
+Everything is written from the binary values in a LIF, get_lif_a() is never
+called: numbers, flags and sizes are integers, the embedded times are raw
+FILETIMEs and the times of the link file itself are seconds since 1970. Every
+string is stored as UTF-8. A value from a part of the link file that isn't
+there is NULL.
+
+Rows are inserted through statements prepared once in sql_open() and are
+committed SQL_TXNROWS link files at a time. The indexes are only made by
+sql_close(), once everything has been loaded.
+
+SQLite is optional. Unless lifer is built with HAVE_SQLITE3 defined (and
+linked with the SQLite library) sql_open() always fails.
+
+An SQL_WRITER must only be used by one thread at a time.
+
+*/
+
+#ifndef _LIBSQL_H_
+#define _LIBSQL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include "../liblife/liblife.h"
+#include "../libobuf/libobuf.h"
+
+#define SQL_TXNROWS 10000     // Link files added in each transaction
+
+enum SQL_STMT                 // The prepared statements, one for each table
+{
+  SQL_LINKS,
+  SQL_ITEMIDS,
+  SQL_PROPERTIES,
+  SQL_EXTRADATA,
+  SQL_CONSOLE,
+  SQL_CONSOLE_FE,
+  SQL_DARWIN,
+  SQL_ENVIRONMENT,
+  SQL_ICON_ENVIRONMENT,
+  SQL_KNOWN_FOLDER,
+  SQL_SHIM,
+  SQL_SPECIAL_FOLDER,
+  SQL_TRACKER,
+  SQL_VISTA_IDLIST,
+  SQL_NSTMTS
+};
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+struct SQL_WRITER
+{
+  struct sqlite3 *       db;
+  struct sqlite3_stmt *  stmts[SQL_NSTMTS];
+  struct sqlite3_stmt *  cur;     // The statement being bound
+  int                    col;     // Parameters of cur bound so far
+  int64_t                links;   // Link files added (and so the id of the last)
+  int                    txnrows; // Link files added in the open transaction
+  int                    failed;  // Set if a statement failed
+  struct OBUF            text;    // Strings are converted to UTF-8 here
+  struct LIF_PROPERTY_STORE_PROPS psp; // The property stores of an ItemID
+  char                   msg[200]; // Why the last call failed
+};
+
+/******************************************************************************/
+//Public Function Declarations
+
+//Creates a new database (0 if successful, -1 if not)
+extern int sql_open(struct SQL_WRITER *, const char *);
+//SQL_WRITER* is the writer to prepare
+//const char* is the path of the database
+
+//Adds a link file to the database (0 if successful, -1 if not)
+extern int sql_add(struct SQL_WRITER *, const char *, const struct stat *, int, const struct LIF *);
+//SQL_WRITER* is the writer
+//const char* is the name of the link file
+//stat* is the file system information for the link file
+//int is 0 if the link file has no times of its own (e.g. it was carved), so
+//  its times are stored as NULL, !0 to store those in stat*
+//LIF* is the decoded link file (decoded with LIF_SECT_ALL)
+
+//Commits, indexes and closes the database (0 if successful, -1 if not)
+extern int sql_close(struct SQL_WRITER *);
+
+//Returns why the last call failed
+extern const char * sql_error(struct SQL_WRITER *);
+
+#endif
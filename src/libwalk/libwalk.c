@@ -0,0 +1,919 @@
+/*********************************************************
+**                                                      **
+**                 libwalk.c                            **
+**                                                      **
+** A library to list the regular files held in a        **
+** directory tree                                       **
+**                                                      **
+**         Copyright Paul Tew 2011 to 2024              **
+**                                                      **
+*********************************************************/
+
+/*
+This file is part of Lifer.
+
+    Lifer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Lifer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Lifer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "./libwalk.h"
+
+//Conditional includes and definitions dependant on OS
+#ifdef _WIN32
+// Windows
+#include "../win/dirent.h"
+#define WALK_SEP '\\'
+#else
+// *nix
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#define WALK_SEP '/'
+#endif
+
+//Private structures
+struct WALK_ENT
+{
+  char *             name;   // Entry name
+  struct WALK_DIR *  dir;    // The sub-directory if the entry is one, NULL for a file
+};
+
+struct WALK_DIR
+{
+  char *             rel;    // Path relative to the root ("" for the root itself)
+  struct WALK_DIR *  parent;
+  dev_t              dev;    // Device and inode numbers (used to spot loops)
+  ino_t              ino;
+  int                read;   // 1 if its entries were read
+  int                done;   // 1 once a thread has finished with it (read or not)
+  struct WALK_ENT *  ents;   // Files and sub-directories in the order they were read
+  size_t             count;
+  size_t             cap;
+  struct WALK_DIR *  next;   // Chain of every WALK_DIR allocated (for walk cleanup)
+};
+
+#ifndef _WIN32
+struct WALK_DEQUE
+{
+  pthread_mutex_t    lock;
+  struct WALK_DIR ** items;  // items[head] to items[tail - 1] are queued
+  size_t             head;
+  size_t             tail;
+  size_t             cap;
+};
+#endif
+
+struct WALK_STATE
+{
+  const char *       root;
+  size_t             rlen;     // Length of root
+  int                recurse;
+  int                failed;   // Set if memory ran out
+  struct WALK_DIR *  all;      // Every WALK_DIR allocated
+  void            (* found)(void *, const char *, const char *);
+  void *             arg;      // Passed to found()
+  char *             path;     // The path passed to found() (grown as needed)
+  size_t             pathcap;
+#ifndef _WIN32
+  int                rootfd;
+  int                nthreads;
+  struct WALK_DEQUE  deques[WALK_MAXTHREADS]; // One per thread
+  pthread_mutex_t    lock;     // Guards pending, gen, ahead, waiting, all, failed and done
+  pthread_cond_t     wake;     // Wakes the walking threads
+  pthread_cond_t     ready;    // Wakes the calling thread when a directory is done
+  size_t             pending;  // Directories queued or being read
+  unsigned long      gen;      // Incremented whenever a directory is queued
+  size_t             ahead;    // Entries read but not yet passed on
+  int                waiting;  // Set while the calling thread waits for a directory
+  struct WALK_DIR ** seen;     // Hash table of the directories passed on (calling thread only)
+  size_t             nseen;
+  size_t             seencap;
+#endif
+};
+
+struct WALK_WORKER
+{
+  struct WALK_STATE *ws;
+  int                id;
+};
+
+//Declaration of functions used privately
+struct WALK_DIR * new_dir(struct WALK_STATE *, struct WALK_DIR *, const char *);
+int add_ent(struct WALK_DIR *, const char *, struct WALK_DIR *);
+int is_loop(struct WALK_DIR *);
+int emit_dir(struct WALK_STATE *, struct WALK_DIR *, int);
+int wait_dir(struct WALK_STATE *, struct WALK_DIR *);
+void drop_dir(struct WALK_STATE *, struct WALK_DIR *);
+void set_failed(struct WALK_STATE *);
+void free_dirs(struct WALK_DIR *);
+void walk_error(struct WALK_STATE *, struct WALK_DIR *);
+#ifdef _WIN32
+int scan_win(struct WALK_STATE *, struct WALK_DIR *);
+#else
+int seen_dir(struct WALK_STATE *, struct WALK_DIR *);
+size_t hash_dir(struct WALK_DIR *);
+int deque_push(struct WALK_DEQUE *, struct WALK_DIR *);
+struct WALK_DIR * deque_pop(struct WALK_DEQUE *);
+struct WALK_DIR * deque_steal(struct WALK_DEQUE *);
+void queue_dir(struct WALK_STATE *, int, struct WALK_DIR *);
+void scan_dir(struct WALK_STATE *, int, struct WALK_DIR *);
+void * walk_worker(void *);
+#endif
+
+
+//Function walk_dir(const char* root, int recurse, int nthreads, found(),
+//void* arg) passes each regular file in the directory root (and below it if
+//recurse is !0) to found()
+extern int walk_dir(const char * root, int recurse, int nthreads,
+  void (* found)(void *, const char *, const char *), void * arg)
+{
+  struct WALK_STATE  ws;
+  struct WALK_DIR *  top;
+  char *             rootcopy;
+  size_t             rlen;
+  int                result = 0;
+#ifndef _WIN32
+  struct WALK_WORKER workers[WALK_MAXTHREADS];
+  pthread_t          threads[WALK_MAXTHREADS];
+  struct stat        statbuf;
+  int                i, started = 0;
+#endif
+
+  //Trailing separators are dropped so that they aren't doubled up in the
+  //paths that are built below
+  rlen = strlen(root);
+  if ((rootcopy = (char *)malloc(rlen + 1)) == NULL)
+  {
+    return -1;
+  }
+  memcpy(rootcopy, root, rlen + 1);
+  while ((rlen > 1) && ((rootcopy[rlen - 1] == '/') || (rootcopy[rlen - 1] == WALK_SEP)))
+  {
+    rootcopy[--rlen] = 0;
+  }
+
+  ws.root = rootcopy;
+  ws.rlen = rlen;
+  ws.recurse = recurse;
+  ws.failed = 0;
+  ws.all = NULL;
+  ws.found = found;
+  ws.arg = arg;
+  ws.path = NULL;
+  ws.pathcap = 0;
+#ifndef _WIN32
+  //new_dir() takes the lock so it must be ready before the first call
+  pthread_mutex_init(&ws.lock, NULL);
+#endif
+  if ((top = new_dir(&ws, NULL, "")) == NULL)
+  {
+#ifndef _WIN32
+    pthread_mutex_destroy(&ws.lock);
+#endif
+    free(rootcopy);
+    return -1;
+  }
+
+#ifdef _WIN32
+  //Windows: each directory is read by this thread when emit_dir() comes to
+  //it. There are no inode numbers to spot loops with.
+  (void)nthreads;
+  if (scan_win(&ws, top) != 0)
+  {
+    result = -1;
+  }
+  else
+  {
+    emit_dir(&ws, top, 1);
+  }
+#else
+  //*nix: every directory is opened relative to rootfd so the working
+  //directory is never changed
+  if ((ws.rootfd = open(rootcopy, O_RDONLY | O_DIRECTORY)) < 0)
+  {
+    walk_error(&ws, top);
+    free_dirs(ws.all);
+    pthread_mutex_destroy(&ws.lock);
+    free(rootcopy);
+    return -1;
+  }
+  if (fstat(ws.rootfd, &statbuf) == 0)
+  {
+    top->dev = statbuf.st_dev;
+    top->ino = statbuf.st_ino;
+  }
+  if (nthreads <= 0)
+  {
+    nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (nthreads < 1)
+  {
+    nthreads = 1;
+  }
+  if (nthreads > WALK_MAXTHREADS)
+  {
+    nthreads = WALK_MAXTHREADS;
+  }
+  //No point in more than one thread if there is only one directory
+  if (!recurse)
+  {
+    nthreads = 1;
+  }
+  ws.nthreads = nthreads;
+  ws.pending = 0;
+  ws.gen = 0;
+  ws.ahead = 0;
+  ws.waiting = 0;
+  ws.seen = NULL;
+  ws.nseen = 0;
+  ws.seencap = 0;
+  pthread_cond_init(&ws.wake, NULL);
+  pthread_cond_init(&ws.ready, NULL);
+  for (i = 0; i < nthreads; i++)
+  {
+    pthread_mutex_init(&ws.deques[i].lock, NULL);
+    ws.deques[i].items = NULL;
+    ws.deques[i].head = 0;
+    ws.deques[i].tail = 0;
+    ws.deques[i].cap = 0;
+    workers[i].ws = &ws;
+    workers[i].id = i;
+  }
+  queue_dir(&ws, 0, top);
+  //The walking threads read the directories while this one passes the files
+  //on as soon as the order allows
+  for (i = 0; i < nthreads; i++)
+  {
+    if (pthread_create(&threads[i], NULL, walk_worker, &workers[i]) != 0)
+    {
+      break;
+    }
+    started++;
+  }
+  if (started == 0)
+  {
+    //No threads, so read the whole tree here first
+    ws.waiting = 1;
+    walk_worker(&workers[0]);
+  }
+  emit_dir(&ws, top, 1);
+  //Let the threads finish whatever is left (if the walk failed part way)
+  pthread_mutex_lock(&ws.lock);
+  ws.waiting = 1;
+  pthread_cond_broadcast(&ws.wake);
+  pthread_mutex_unlock(&ws.lock);
+  for (i = 0; i < started; i++)
+  {
+    pthread_join(threads[i], NULL);
+  }
+  for (i = 0; i < nthreads; i++)
+  {
+    free(ws.deques[i].items);
+    pthread_mutex_destroy(&ws.deques[i].lock);
+  }
+  pthread_cond_destroy(&ws.ready);
+  pthread_cond_destroy(&ws.wake);
+  pthread_mutex_destroy(&ws.lock);
+  close(ws.rootfd);
+  free(ws.seen);
+#endif
+
+  free_dirs(ws.all);
+  free(ws.path);
+  free(rootcopy);
+  if (ws.failed)
+  {
+    fprintf(stderr, "Error in function walk_dir(): out of memory\n");
+    return -1;
+  }
+  return result;
+}
+//
+//Function new_dir(struct WALK_STATE*, struct WALK_DIR* parent, const char* name)
+//allocates the WALK_DIR for directory name found in parent (NULL for the root)
+struct WALK_DIR * new_dir(struct WALK_STATE * ws, struct WALK_DIR * parent, const char * name)
+{
+  struct WALK_DIR * d;
+  size_t            plen = 0;
+
+  if ((d = (struct WALK_DIR *)calloc(1, sizeof(struct WALK_DIR))) == NULL)
+  {
+    return NULL;
+  }
+  if ((parent != NULL) && (parent->rel[0] != 0))
+  {
+    plen = strlen(parent->rel) + 1;
+  }
+  if ((d->rel = (char *)malloc(plen + strlen(name) + 1)) == NULL)
+  {
+    free(d);
+    return NULL;
+  }
+  if (plen > 0)
+  {
+    sprintf(d->rel, "%s%c%s", parent->rel, WALK_SEP, name);
+  }
+  else
+  {
+    strcpy(d->rel, name);
+  }
+  d->parent = parent;
+#ifndef _WIN32
+  pthread_mutex_lock(&ws->lock);
+#endif
+  d->next = ws->all;
+  ws->all = d;
+#ifndef _WIN32
+  pthread_mutex_unlock(&ws->lock);
+#endif
+  return d;
+}
+//
+//Function add_ent(struct WALK_DIR* d, const char* name, struct WALK_DIR* sub)
+//appends an entry to d. Returns 0 on success, 1 if memory ran out.
+int add_ent(struct WALK_DIR * d, const char * name, struct WALK_DIR * sub)
+{
+  struct WALK_ENT * grown;
+
+  if (d->count == d->cap)
+  {
+    d->cap = (d->cap == 0) ? 16 : d->cap * 2;
+    grown = (struct WALK_ENT *)realloc(d->ents, d->cap * sizeof(struct WALK_ENT));
+    if (grown == NULL)
+    {
+      return 1;
+    }
+    d->ents = grown;
+  }
+  if ((d->ents[d->count].name = (char *)malloc(strlen(name) + 1)) == NULL)
+  {
+    return 1;
+  }
+  strcpy(d->ents[d->count].name, name);
+  d->ents[d->count].dir = sub;
+  d->count++;
+  return 0;
+}
+//
+//Function is_loop(struct WALK_DIR* d) returns 1 if d is the same directory
+//(device and inode) as one of its parents, i.e. it was reached through a
+//symbolic link that points back up the tree. Only directories on the current
+//path are compared, so the result doesn't depend on the order in which other
+//threads happen to read directories.
+int is_loop(struct WALK_DIR * d)
+{
+  struct WALK_DIR * p;
+
+  for (p = d->parent; p != NULL; p = p->parent)
+  {
+    if ((p->dev == d->dev) && (p->ino == d->ino))
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+//
+//Function emit_dir(struct WALK_STATE*, struct WALK_DIR* d, int list) passes
+//the files in d to ws->found() (if list is !0), with those of each
+//sub-directory at the point where it was found, then frees d's entries.
+//Returns 0 on success, 1 if the walk failed.
+int emit_dir(struct WALK_STATE * ws, struct WALK_DIR * d, int list)
+{
+  char * grown;
+  size_t i, need, dlen;
+  int    result = 0;
+
+  if (wait_dir(ws, d) != 0)
+  {
+    return 1;
+  }
+#ifndef _WIN32
+  //A directory reached by more than one path is passed on at the first of
+  //them. The others still have to be waited for and freed.
+  if (list && d->read)
+  {
+    switch (seen_dir(ws, d))
+    {
+    case 0:
+      break;
+    case 1:
+      list = 0;
+      break;
+    default:
+      set_failed(ws);
+      return 1;
+    }
+  }
+#endif
+  dlen = strlen(d->rel);
+  for (i = 0; (i < d->count) && (result == 0); i++)
+  {
+    if (d->ents[i].dir != NULL)
+    {
+      result = emit_dir(ws, d->ents[i].dir, list);
+      continue;
+    }
+    if (!list)
+    {
+      continue;
+    }
+    need = ws->rlen + dlen + strlen(d->ents[i].name) + 3;
+    if (need > ws->pathcap)
+    {
+      if ((grown = (char *)realloc(ws->path, need)) == NULL)
+      {
+        set_failed(ws);
+        result = 1;
+        break;
+      }
+      ws->path = grown;
+      ws->pathcap = need;
+    }
+    if (dlen > 0)
+    {
+      sprintf(ws->path, "%s%c%s%c%s", ws->root, WALK_SEP, d->rel, WALK_SEP, d->ents[i].name);
+    }
+    else
+    {
+      sprintf(ws->path, "%s%c%s", ws->root, WALK_SEP, d->ents[i].name);
+    }
+    ws->found(ws->arg, ws->path, ws->path + ws->rlen + 1);
+  }
+  drop_dir(ws, d);
+  return result;
+}
+//
+//Function wait_dir(struct WALK_STATE*, struct WALK_DIR* d) makes sure that d
+//has been read before its entries are passed on. On *nix it waits for a
+//walking thread to finish with d, on Windows it reads d itself. Returns 0 if
+//d is ready, 1 if the walk failed.
+int wait_dir(struct WALK_STATE * ws, struct WALK_DIR * d)
+{
+#ifdef _WIN32
+  if (!d->done)
+  {
+    scan_win(ws, d);
+  }
+  return ws->failed;
+#else
+  int result;
+
+  pthread_mutex_lock(&ws->lock);
+  while (!d->done && (ws->pending > 0) && !ws->failed)
+  {
+    //The walking threads may go past WALK_MAXAHEAD until d is done
+    ws->waiting = 1;
+    pthread_cond_broadcast(&ws->wake);
+    pthread_cond_wait(&ws->ready, &ws->lock);
+  }
+  ws->waiting = 0;
+  result = (!d->done || ws->failed);
+  pthread_mutex_unlock(&ws->lock);
+  return result;
+#endif
+}
+//
+//Function drop_dir(struct WALK_STATE*, struct WALK_DIR* d) frees the entries
+//of d once they have been passed on. The WALK_DIR itself is kept until the
+//walk ends as its sub-directories (and ws->seen) point to it.
+void drop_dir(struct WALK_STATE * ws, struct WALK_DIR * d)
+{
+  size_t i;
+
+  for (i = 0; i < d->count; i++)
+  {
+    free(d->ents[i].name);
+  }
+  free(d->ents);
+  free(d->rel);
+  d->ents = NULL;
+  d->rel = NULL;
+#ifndef _WIN32
+  pthread_mutex_lock(&ws->lock);
+  if ((ws->ahead > WALK_MAXAHEAD) && (ws->ahead - d->count <= WALK_MAXAHEAD))
+  {
+    pthread_cond_broadcast(&ws->wake);
+  }
+  ws->ahead -= d->count;
+  pthread_mutex_unlock(&ws->lock);
+#else
+  (void)ws;
+#endif
+  d->count = 0;
+  d->cap = 0;
+}
+//
+//Function set_failed(struct WALK_STATE*) records that memory ran out and
+//wakes every thread so that the walk can end
+void set_failed(struct WALK_STATE * ws)
+{
+#ifndef _WIN32
+  pthread_mutex_lock(&ws->lock);
+#endif
+  ws->failed = 1;
+#ifndef _WIN32
+  pthread_cond_signal(&ws->ready);
+  pthread_cond_broadcast(&ws->wake);
+  pthread_mutex_unlock(&ws->lock);
+#endif
+}
+//
+//Function free_dirs(struct WALK_DIR* all) frees a chain of WALK_DIR
+void free_dirs(struct WALK_DIR * all)
+{
+  struct WALK_DIR * next;
+  size_t            i;
+
+  while (all != NULL)
+  {
+    next = all->next;
+    for (i = 0; i < all->count; i++)
+    {
+      free(all->ents[i].name);
+    }
+    free(all->ents);
+    free(all->rel);
+    free(all);
+    all = next;
+  }
+}
+//
+//Function walk_error(struct WALK_STATE*, struct WALK_DIR* d) reports that
+//directory d could not be read (errno holds the reason)
+void walk_error(struct WALK_STATE * ws, struct WALK_DIR * d)
+{
+  perror("Error");
+  if (d->rel[0] != 0)
+  {
+    fprintf(stderr, "whilst processing directory: \'%s%c%s\'\n", ws->root, WALK_SEP, d->rel);
+  }
+  else
+  {
+    fprintf(stderr, "whilst processing directory: \'%s\'\n", ws->root);
+  }
+}
+
+#ifdef _WIN32
+//
+//Function scan_win(struct WALK_STATE*, struct WALK_DIR* d) reads the entries
+//of directory d. Returns 0 on success, -1 if d couldn't be opened.
+int scan_win(struct WALK_STATE * ws, struct WALK_DIR * d)
+{
+  DIR *             dp;
+  struct dirent *   entry;
+  struct stat       statbuf;
+  struct WALK_DIR * child;
+  char *            path, *full;
+
+  d->done = 1;
+  if ((path = (char *)malloc(ws->rlen + strlen(d->rel) + 2)) == NULL)
+  {
+    ws->failed = 1;
+    return 0;
+  }
+  sprintf(path, (d->rel[0] != 0) ? "%s%c%s" : "%s", ws->root, WALK_SEP, d->rel);
+  if ((dp = opendir(path)) == NULL)
+  {
+    walk_error(ws, d);
+    free(path);
+    return -1;
+  }
+  d->read = 1;
+  while ((entry = readdir(dp)) != NULL)
+  {
+    if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0))
+    {
+      continue;
+    }
+    full = (char *)malloc(strlen(path) + strlen(entry->d_name) + 2);
+    if (full == NULL)
+    {
+      ws->failed = 1;
+      break;
+    }
+    sprintf(full, "%s%c%s", path, WALK_SEP, entry->d_name);
+    if (stat(full, &statbuf) == 0)
+    {
+      if ((statbuf.st_mode & S_IFMT) == S_IFREG)
+      {
+        ws->failed |= add_ent(d, entry->d_name, NULL);
+      }
+      else if (((statbuf.st_mode & S_IFMT) == S_IFDIR) && ws->recurse)
+      {
+        if ((child = new_dir(ws, d, entry->d_name)) == NULL)
+        {
+          ws->failed = 1;
+        }
+        else
+        {
+          ws->failed |= add_ent(d, entry->d_name, child);
+        }
+      }
+    }
+    free(full);
+    if (ws->failed)
+    {
+      break;
+    }
+  }
+  closedir(dp);
+  free(path);
+  return 0;
+}
+#else
+//
+//Function seen_dir(struct WALK_STATE*, struct WALK_DIR* d) returns 1 if a
+//directory with d's device and inode numbers has already been passed on,
+//otherwise it records d and returns 0 (-1 if memory ran out)
+int seen_dir(struct WALK_STATE * ws, struct WALK_DIR * d)
+{
+  struct WALK_DIR ** grown;
+  size_t             i, j, cap;
+
+  if ((ws->nseen + 1) * 2 > ws->seencap)
+  {
+    cap = (ws->seencap == 0) ? 256 : ws->seencap * 2;
+    if ((grown = (struct WALK_DIR **)calloc(cap, sizeof(struct WALK_DIR *))) == NULL)
+    {
+      return -1;
+    }
+    for (i = 0; i < ws->seencap; i++)
+    {
+      if (ws->seen[i] != NULL)
+      {
+        j = hash_dir(ws->seen[i]) & (cap - 1);
+        while (grown[j] != NULL)
+        {
+          j = (j + 1) & (cap - 1);
+        }
+        grown[j] = ws->seen[i];
+      }
+    }
+    free(ws->seen);
+    ws->seen = grown;
+    ws->seencap = cap;
+  }
+  i = hash_dir(d) & (ws->seencap - 1);
+  while (ws->seen[i] != NULL)
+  {
+    if ((ws->seen[i]->dev == d->dev) && (ws->seen[i]->ino == d->ino))
+    {
+      return 1;
+    }
+    i = (i + 1) & (ws->seencap - 1);
+  }
+  ws->seen[i] = d;
+  ws->nseen++;
+  return 0;
+}
+//
+//Function hash_dir(struct WALK_DIR* d) hashes d's device and inode numbers
+size_t hash_dir(struct WALK_DIR * d)
+{
+  unsigned long long h = ((unsigned long long)d->dev << 32) ^ (unsigned long long)d->ino;
+
+  return (size_t)((h * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+//
+//Function deque_push(struct WALK_DEQUE*, struct WALK_DIR*) adds a directory to
+//the tail of a thread's queue. Returns 0 on success, 1 if memory ran out.
+int deque_push(struct WALK_DEQUE * dq, struct WALK_DIR * d)
+{
+  struct WALK_DIR ** grown;
+  int                result = 0;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->tail == dq->cap)
+  {
+    if (dq->head > 0) //Reclaim the space left by stolen entries
+    {
+      memmove(dq->items, &dq->items[dq->head], (dq->tail - dq->head) * sizeof(struct WALK_DIR *));
+      dq->tail -= dq->head;
+      dq->head = 0;
+    }
+    else
+    {
+      dq->cap = (dq->cap == 0) ? 64 : dq->cap * 2;
+      grown = (struct WALK_DIR **)realloc(dq->items, dq->cap * sizeof(struct WALK_DIR *));
+      if (grown == NULL)
+      {
+        dq->cap = dq->tail;
+        result = 1;
+      }
+      else
+      {
+        dq->items = grown;
+      }
+    }
+  }
+  if (result == 0)
+  {
+    dq->items[dq->tail++] = d;
+  }
+  pthread_mutex_unlock(&dq->lock);
+  return result;
+}
+//
+//Function deque_pop(struct WALK_DEQUE*) takes the most recently queued
+//directory from the tail of the owning thread's queue (NULL if empty)
+struct WALK_DIR * deque_pop(struct WALK_DEQUE * dq)
+{
+  struct WALK_DIR * d = NULL;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->tail > dq->head)
+  {
+    d = dq->items[--dq->tail];
+  }
+  pthread_mutex_unlock(&dq->lock);
+  return d;
+}
+//
+//Function deque_steal(struct WALK_DEQUE*) takes the oldest directory from the
+//head of another thread's queue (NULL if empty). The oldest entries are
+//nearest the root so they tend to carry the most work with them.
+struct WALK_DIR * deque_steal(struct WALK_DEQUE * dq)
+{
+  struct WALK_DIR * d = NULL;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->tail > dq->head)
+  {
+    d = dq->items[dq->head++];
+  }
+  pthread_mutex_unlock(&dq->lock);
+  return d;
+}
+//
+//Function queue_dir(struct WALK_STATE*, int id, struct WALK_DIR* d) queues d
+//to be read by thread id (or any thread that steals it)
+void queue_dir(struct WALK_STATE * ws, int id, struct WALK_DIR * d)
+{
+  if (deque_push(&ws->deques[id], d) != 0)
+  {
+    set_failed(ws);
+    return;
+  }
+  pthread_mutex_lock(&ws->lock);
+  ws->pending++;
+  ws->gen++;
+  pthread_cond_signal(&ws->wake);
+  pthread_mutex_unlock(&ws->lock);
+}
+//
+//Function scan_dir(struct WALK_STATE*, int id, struct WALK_DIR* d) reads the
+//entries of directory d. Sub-directories are queued on thread id's queue.
+void scan_dir(struct WALK_STATE * ws, int id, struct WALK_DIR * d)
+{
+  DIR *           dp;
+  struct dirent * entry;
+  struct stat     statbuf;
+  struct WALK_DIR *child;
+  int             fd, isdir, isreg;
+
+  if ((fd = openat(ws->rootfd, (d->rel[0] != 0) ? d->rel : ".", O_RDONLY | O_DIRECTORY)) < 0)
+  {
+    walk_error(ws, d);
+    return;
+  }
+  if (fstat(fd, &statbuf) != 0)
+  {
+    walk_error(ws, d);
+    close(fd);
+    return;
+  }
+  d->dev = statbuf.st_dev;
+  d->ino = statbuf.st_ino;
+  if (is_loop(d))
+  {
+    close(fd);
+    return;
+  }
+  if ((dp = fdopendir(fd)) == NULL)
+  {
+    walk_error(ws, d);
+    close(fd);
+    return;
+  }
+  d->read = 1;
+  while ((entry = readdir(dp)) != NULL)
+  {
+    if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0))
+    {
+      continue;
+    }
+    isdir = 0;
+    isreg = 0;
+#ifdef DT_UNKNOWN
+    //d_type saves a stat() unless the entry is a symbolic link (which is
+    //followed) or the file system doesn't record the type
+    if (entry->d_type == DT_REG)
+    {
+      isreg = 1;
+    }
+    else if (entry->d_type == DT_DIR)
+    {
+      isdir = 1;
+    }
+    else if ((entry->d_type == DT_LNK) || (entry->d_type == DT_UNKNOWN))
+#endif
+    {
+      if (fstatat(dirfd(dp), entry->d_name, &statbuf, 0) == 0)
+      {
+        isreg = ((statbuf.st_mode & S_IFMT) == S_IFREG);
+        isdir = ((statbuf.st_mode & S_IFMT) == S_IFDIR);
+      }
+    }
+    if (isreg)
+    {
+      if (add_ent(d, entry->d_name, NULL) != 0)
+      {
+        set_failed(ws);
+        break;
+      }
+    }
+    else if (isdir && ws->recurse)
+    {
+      if (((child = new_dir(ws, d, entry->d_name)) == NULL) ||
+        (add_ent(d, entry->d_name, child) != 0))
+      {
+        set_failed(ws);
+        break;
+      }
+      queue_dir(ws, id, child);
+    }
+  }
+  closedir(dp);
+}
+//
+//Function walk_worker(void* arg) is the body of each walking thread. It reads
+//directories from its own queue, then steals from the other threads' queues
+//and waits for more work until no directory is left pending.
+void * walk_worker(void * arg)
+{
+  struct WALK_WORKER *w = (struct WALK_WORKER *)arg;
+  struct WALK_STATE * ws = w->ws;
+  struct WALK_DIR *   d;
+  unsigned long       seen;
+  int                 i, done;
+
+  for (;;)
+  {
+    pthread_mutex_lock(&ws->lock);
+    //Don't get too far ahead of the calling thread
+    while ((ws->ahead > WALK_MAXAHEAD) && !ws->waiting && !ws->failed)
+    {
+      pthread_cond_wait(&ws->wake, &ws->lock);
+    }
+    seen = ws->gen;
+    pthread_mutex_unlock(&ws->lock);
+
+    d = deque_pop(&ws->deques[w->id]);
+    for (i = 1; (d == NULL) && (i < ws->nthreads); i++)
+    {
+      d = deque_steal(&ws->deques[(w->id + i) % ws->nthreads]);
+    }
+    if (d != NULL)
+    {
+      scan_dir(ws, w->id, d);
+      pthread_mutex_lock(&ws->lock);
+      d->done = 1;
+      ws->ahead += d->count;
+      ws->pending--;
+      pthread_cond_signal(&ws->ready);
+      if (ws->pending == 0)
+      {
+        pthread_cond_broadcast(&ws->wake);
+      }
+      pthread_mutex_unlock(&ws->lock);
+      continue;
+    }
+    //Nothing to do just now. Wait until something is queued or everything
+    //is finished.
+    pthread_mutex_lock(&ws->lock);
+    while ((ws->pending > 0) && (ws->gen == seen))
+    {
+      pthread_cond_wait(&ws->wake, &ws->lock);
+    }
+    done = (ws->pending == 0);
+    pthread_mutex_unlock(&ws->lock);
+    if (done)
+    {
+      break;
+    }
+  }
+  return NULL;
+}
+#endif
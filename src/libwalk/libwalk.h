@@ -0,0 +1,90 @@
+/***************************************************************
+**                                                            **
+**                       libwalk.h                            **
+**                                                            **
+**    A library to list the regular files held in a           **
+**    directory tree                                          **
+**                                                            **
+**            Copyright Paul Tew 2011 to 2024                 **
+**                                                            **
+** Exported Functions:                                        **
+** -------------------                                        **
+** walk_dir(const char*, int, int, found(), void*)            **
+**       Passes each regular file found in a directory (and   **
+**       optionally its sub-directories) to found(), in a     **
+**       repeatable order, as soon as it can.                 **
+**       Returns 0 on success, -1 if the directory could not  **
+**       be opened or memory ran out.                         **
+**                                                            **
+***************************************************************/
+
+/*
+This file is part of Lifer.
+
+    Lifer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Lifer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Lifer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+
+On *nix the walk never changes the working directory. Each directory is opened
+with openat() relative to the root directory and read with fdopendir(). The
+d_type member of each entry is used to tell files from directories so that
+stat() is only needed for symbolic links and file systems that don't fill
+d_type in. Directories are shared between a number of threads, each with its
+own queue of directories to read, and an idle thread steals work from the
+others. A directory that is the same (by device and inode number) as one of
+those above it isn't read, so a symbolic link loop can't send the walk round
+in circles. A directory reached by more than one path is passed on only once,
+at the first of those paths.
+
+The calling thread passes the files on while the other threads are still
+reading, so the caller can start work on the first file straight away. The
+order doesn't depend on the number of threads or on which thread read which
+directory. Files are passed on in the order readdir() returned them and the
+contents of a sub-directory at the point where the sub-directory itself was
+found. A directory is freed once its files have been passed on, and the
+threads wait whenever more than WALK_MAXAHEAD entries are waiting to be passed
+on, so a large tree is never held in memory all at once.
+
+On Windows the calling thread reads each directory itself, using opendir() and
+stat(), when it comes to it.
+
+*/
+
+#ifndef _LIBWALK_H_
+#define _LIBWALK_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define WALK_MAXTHREADS 64    // The most threads that walk_dir() will start
+#define WALK_MAXAHEAD 65536   // Entries read but not yet passed on before the threads wait
+
+/******************************************************************************/
+//Public Function Declarations
+
+//Passes the regular files below a directory to found() (0 if successful, -1 if not)
+extern int walk_dir(const char *, int, int, void (*)(void *, const char *, const char *), void *);
+//const char* is the path of the directory to walk
+//int (arg 1) is 0 to list just this directory, !0 to descend into sub-directories
+//int (arg 2) is the number of threads to use (<= 0 to use one per processor)
+//found() is called in the calling thread for each file with the void* given,
+//  the path to open (the root directory + name) and the path relative to the
+//  root directory. The strings are only valid until found() returns
+//void* is passed to found() unchanged
+
+#endif
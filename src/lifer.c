@@ -8,8 +8,10 @@
 **                                                      **
 ** Usage:                                               **
 ** lifer [-vh]                                          **
-** lifer [-s] [-o csv|tsv|txt] dir|file(s)              **
-** lifer -i [-o txt|xml]                                **
+** lifer [-sr] [-j N] [-o csv|tsv|txt|xml|jsonl]        **
+**       dir(s)|file(s)                                 **
+** lifer -i [-o txt|xml|jsonl]                          **
+** lifer --carve [-j N] [-o ...] image(s)               **
 **                                                      **
 *********************************************************/
 
@@ -38,31 +40,126 @@ This file is part of lifer.
 #include <sys/types.h>
 #include <time.h>
 #include <wchar.h>
+#include <errno.h>
 // local headers
 #include "./liblife/liblife.h"
 #include "./version.h"
 #include "./libbin2hex/libbin2hex.h"
+#include "./libwalk/libwalk.h"
+#include "./libobuf/libobuf.h"
+#include "./libipc/libipc.h"
+#include "./libsql/libsql.h"
 
 //Conditional includes and definitions dependant on OS
 #ifdef _WIN32
 // Windows 
 #include <io.h>
-#include "./win/dirent.h"
+#include <fcntl.h>
 #include "./win/getopt.h"
-#include <direct.h>
 #define PATH_MAX _MAX_PATH // Why is this different between Win & *nix? (I have no idea BTW)
 #else
 // *nix 
 #include <unistd.h>
-#include <dirent.h>
-#define _getcwd getcwd  // _getcwd() is Windows, getcwd() is *nix
-#define _chdir chdir    // same issue here
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <getopt.h>
 #endif
 
 //Global stuff
-enum otype { csv, tsv, txt, xml };
-enum otype output_type;
-int filecount;
+enum otype { csv, tsv, txt, xml, jsonl, arrow, sqlite };
+
+#define LIFER_MAXJOBS       64                // The most parser threads '-j' will start
+#define LIFER_JOBSPERTHREAD 16                // Queued files for each parser thread
+#define LIFER_STACKSIZE     (1024 * 1024)     // Stack for each parser thread
+#define LIFER_JSONDEPTH     12                // Deepest nesting of objects and arrays in a JSON record
+#define LIFER_MAXBATCH      (1024 * 1024)     // The most rows '-b' will put in an Arrow record batch
+#define LIFER_ARENAMAX      (64 * 1024 * 1024) // The most memory each parser's arena may hold
+#define LIFER_TIMEOUT       60                // Default seconds a parser thread may spend on a file ('-t')
+#define LIFER_MAXTIMEOUT    (24 * 60 * 60)    // The most seconds '-t' will allow
+#define LIFER_CARVECHUNK    (64 * 1024 * 1024) // Bytes of an image scanned at a time ('--carve')
+#define LIFER_CARVEMAX      (1024 * 1024)     // The most of an image given to the parser for each hit
+#define LIFER_CARVEHITS     256               // Link file headers found in each call to lif_scan()
+#define LIFER_CARVEKEEP     75                // Bytes after a chunk scanned with it (a header less one)
+
+//The settings and the state of one run of lifer
+struct LIFER_RUN
+{
+  enum otype           output_type;
+  int                  less;      // Shortened output
+  int                  idlist;    // Print idlist information
+  int                  recurse;   // Descend into sub-directories
+  int                  jobs;      // Number of parser threads (1 = parse in the main thread)
+  int                  carve;     // Files are disk images to carve link files from ('--carve')
+  int                  partial;   // Output what can be decoded of damaged link files ('-p')
+  int                  timeout;   // Seconds a parser thread may spend on a file (0 = no limit, '-t')
+  unsigned long        filecount; // Number of records output so far
+  uint32_t             sections;  // The parts of each link file to decode (see out_sections())
+  int                  flushrec;  // Write each record as soon as it is made (stdout is a terminal)
+  struct OBUF          out;       // The records, written to stdout
+  struct OBUF          err;       // Messages about files that could not be parsed, written to stderr
+  struct OBUF          row;       // An Arrow row or a LIF made in the main thread ('-o arrow' or '-o sqlite')
+  struct IPC_WRITER    ipc;       // The Arrow stream, written to out ('-o arrow')
+  struct SQL_WRITER    sql;       // The database ('-o sqlite:FILE')
+  struct LIF_ARENA     arena;     // Memory for the ASCII data when parsing in the main thread
+  struct LIFER_POOL *  pool;      // The parser threads (NULL if there are none)
+  const unsigned char* image;     // The part of the image being carved that is in memory
+  uint64_t             imagebase; // Where image starts in the image file
+  size_t               imagelen;  // Bytes at image
+  struct stat          imagestat; // The stat data given to every link file carved from it
+  struct LIF_SOURCE *  imagesrc;  // The image file if it isn't mapped (link files are read from it)
+};
+
+//A JSON record being written (see json_key()). For each object or array that
+//is open there is a flag to say if anything has been put in it yet.
+struct LIFER_JSON
+{
+  struct OBUF *        out;
+  int                  depth;     // Number of objects and arrays open
+  int                  used[LIFER_JSONDEPTH];
+};
+
+#ifndef _WIN32
+//A file queued for the parser threads
+struct LIFER_JOB
+{
+  char *               path;      // Path to open
+  char *               name;      // Name to report it by (shares path's allocation)
+  int64_t              offset;    // Where a carved link file starts in the image (-1 for a file)
+  struct OBUF          out;       // The formatted record (the slot keeps the memory for its next job)
+  struct OBUF          err;       // Any error messages about the file
+  int                  ok;        // 1 if out holds a record
+  int                  done;      // 1 once a parser thread has finished with it
+  int                  abandoned; // 1 if the writer gave up waiting for it (see pool_abandon())
+  size_t               number;    // Which job it is, set when a parser thread takes it
+  pthread_t            parser;    // The parser thread that took it
+  struct timespec      started;   // When it was taken (CLOCK_REALTIME, as pthread_cond_timedwait() uses)
+};
+
+//The parser threads, the writer thread and the queue between them. Jobs are
+//numbered in the order they were added and job n lives in jobs[n % size].
+//A parser thread that takes longer than run->timeout over a file is left to
+//it and another is started in its place (see pool_abandon()).
+struct LIFER_POOL
+{
+  struct LIFER_RUN *   run;
+  struct LIFER_JOB *   jobs;
+  size_t               size;      // Number of queue slots
+  size_t               next;      // Number of the next job to be added
+  size_t               taken;     // Number of the next job for a parser thread
+  size_t               written;   // Number of the next job to be written
+  int                  closed;    // Set when no more jobs will be added
+  pthread_mutex_t      lock;
+  pthread_cond_t       added;     // A job was added (or the queue closed)
+  pthread_cond_t       finished;  // A job was parsed
+  pthread_cond_t       freed;     // A job was written so its slot is free
+  pthread_t            parsers[LIFER_MAXJOBS];
+  int                  nparsers;
+  pthread_t            writer;
+  int                  writing;   // 1 if the writer thread was started
+  int                  stuck;     // Parser threads abandoned that haven't finished yet
+};
+#endif
 
 //Function help_message() prints a help message to stdout
 void help_message()
@@ -70,15 +167,34 @@ void help_message()
   printf("********************************************************************************\n");
   printf("\nlifer - A Windows link file (a.k.a. shortcut) analyser\n");
   printf("Version: %u.%u.%u\n\n", _MAJOR, _MINOR, _BUILD);
-  printf("Usage: lifer  [-vhs] [-o csv|tsv|txt|xml] file(s)|directory\n");
-  printf("       lifer   -i    [-o txt|xml]         file(s)|directory\n\n");
+  printf("Usage: lifer  [-vhspr] [-j N [-t N]] [-o csv|tsv|txt|xml|jsonl|arrow] [-b N]\n");
+  printf("              file(s)|directory(s)\n");
+  printf("       lifer   [-r] [-j N [-t N]] -o sqlite:FILE file(s)|directory(s)\n");
+  printf("       lifer   -i[r] [-j N [-t N]] [-o txt|xml|jsonl] file(s)|directory(s)\n");
+  printf("       lifer   --carve [-si] [-j N] [-o ...] image(s)\n\n");
   printf("Options:\n");
   printf("  -v    print version number\n");
   printf("  -h    print this help\n");
   printf("  -s    shortened output (default is to output all fields)\n");
-  printf("  -o    output type (choose from csv, tsv, txt or xml). \n");
-  printf("        The default is txt.\n");
-  printf("  -i    print idlist information (only with output type: 'txt' or 'xml')\n\n");
+  printf("  -o    output type (choose from csv, tsv, txt, xml, jsonl or arrow). \n");
+  printf("        The default is txt. jsonl is one JSON object per line and arrow\n");
+  printf("        is an Apache Arrow IPC stream with a typed column for each field.\n");
+  printf("        sqlite:FILE writes everything to tables in a new SQLite database\n");
+  printf("        named FILE instead of to standard output.\n");
+  printf("  -b    rows in each Arrow record batch (1 to %d, default %d)\n", LIFER_MAXBATCH, IPC_BATCHROWS);
+  printf("  -i    print idlist information (only with output type: 'txt', 'xml'\n");
+  printf("        or 'jsonl')\n");
+  printf("  -p    output what can be decoded of damaged link files instead of\n");
+  printf("        skipping them (the damage is reported to stderr)\n");
+  printf("  -r    recurse into sub-directories of any directory given\n");
+  printf("  -j    number of files to parse at once (1 to %d, default 1). The output\n", LIFER_MAXJOBS);
+  printf("        is in the same order whatever the number.\n");
+  printf("  -t    with -j, give up on a file still being read and parsed after\n");
+  printf("        N seconds (0 to %d, 0 = never, default %d). It is reported to\n", LIFER_MAXTIMEOUT, LIFER_TIMEOUT);
+  printf("        stderr and the rest carry on.\n");
+  printf("  --carve  treat each file as a raw disk image (or an extract of unallocated\n");
+  printf("        space) and output every link file found in it. Each one is named\n");
+  printf("        IMAGE@OFFSET, OFFSET being its byte offset in the image. Implies -p.\n\n");
   printf("Output is to standard output, therefore to send to a file, use the\n");
   printf("redirection operator '>'.\n\n");
   printf("Example:\n  lifer -o csv {DIRECTORY} > Links.csv\n\n");
@@ -90,909 +206,910 @@ void help_message()
 
 
 //
-//Function: replace_comma(unsigned char * str, int len)
-//          Takes a zero terminated string 'str' of length 'len' max
-//          and substitutes semi-colons for commas.
-//          Return value is the number of substitutions.
-//          This function is useful for CSV output so that strings don't mess 
-//          up the formatting
-int replace_comma(unsigned char * str, uint16_t len)
+//Function: utc_time() converts the time_t at t to UTC in tms and returns tms.
+//          Unlike gmtime() it is safe to call from more than one thread.
+struct tm* utc_time(const time_t* t, struct tm* tms)
+{
+#ifdef _WIN32
+  gmtime_s(tms, t);
+#else
+  gmtime_r(t, tms);
+#endif
+  return tms;
+}
+
+//
+//Function: stat_time() puts the stat time at t into buf (at least 29 bytes)
+//          in the strftime() format fmt and returns buf. If times is 0 the
+//          link file has no times of its own (it was carved from an image)
+//          and buf is set to "[N/A]" instead.
+char* stat_time(char* buf, const time_t* t, const char* fmt, int times)
 {
-  int result = 0, i;
-  for (i = 0; (i < len); i++)
+  struct tm tms;
+
+  if (!times)
   {
-    if (str[i] == ',')
-    {
-      str[i] = ';';
-      result++;
-    }
+    strcpy(buf, "[N/A]");
+    return buf;
   }
-  return result;
+  strftime(buf, 29, fmt, utc_time(t, &tms));
+  return buf;
 }
 
 //
-//Function: sv_out(FILE * fp) processes the link file and outputs the csv or tsv
-//          version of the decoded data.
-void sv_out(FILE* fp, char* fname, int less, char sep)
+//Function: hex_put() appends a line of a hex dump made by wbin2hex() to the
+//          OBUF at out.
+void hex_put(void* out, const char* line, size_t len)
 {
-  struct LIF   lif;
-  struct LIF_A lif_a;
-  struct stat statbuf;
-  char buf[40];
-  int  i, j;
+  obuf_mem((struct OBUF*)out, line, len);
+}
 
+//
+//Function: sv_header() outputs the line of column names that goes before the
+//          first csv or tsv record.
+void sv_header(struct OBUF* out, int less, char sep)
+{
+  obuf_field(out, "File Name", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "Link File Size", sep);
+  }
+  obuf_field(out, "Link File Last Accessed", sep);
+  obuf_field(out, "Link File Last Modified", sep);
+  obuf_field(out, "Link File Last Changed", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "Hdr Size", sep);
+    obuf_field(out, "Hdr CLSID", sep);
+    obuf_field(out, "Hdr Flags", sep);
+  }
+  obuf_field(out, "Hdr Attributes", sep);
+  obuf_field(out, "Hdr FileCreate", sep);
+  obuf_field(out, "Hdr FileAccess", sep);
+  obuf_field(out, "Hdr FileWrite", sep);
+  obuf_field(out, "Hdr TargetSize", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "Hdr IconIndex", sep);
+    obuf_field(out, "Hdr WindowState", sep);
+    obuf_field(out, "Hdr HotKeys", sep);
+    obuf_field(out, "Hdr Reserved1", sep);
+    obuf_field(out, "Hdr Reserved2", sep);
+    obuf_field(out, "Hdr Reserved3", sep);
+    obuf_field(out, "IDList Size", sep);
+    obuf_field(out, "IDList No Items", sep);
+    obuf_field(out, "LinkInfo Size", sep);
+    obuf_field(out, "LinkInfo Hdr Size", sep);
+    obuf_field(out, "LinkInfo Flags", sep);
+    obuf_field(out, "LinkInfo VolID Offset", sep);
+    obuf_field(out, "LinkInfo Base Path Offset", sep);
+    obuf_field(out, "LinkInfo CNR Offset", sep);
+    obuf_field(out, "LinkInfo CPS Offset", sep);
+    obuf_field(out, "LinkInfo LBP Offset Unicode", sep);
+    obuf_field(out, "LinkInfo CPS Offset Unicode", sep);
+    obuf_field(out, "LinkInfo VolID Size", sep);
+  }
+  obuf_field(out, "LinkInfo VolID Drive Type", sep);
+  obuf_field(out, "LinkInfo VolID Drive Ser No", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "LinkInfo VolID VLOffset", sep);
+    obuf_field(out, "LinkInfo VolID VLOffsetU", sep);
+  }
+  obuf_field(out, "LinkInfo VolID Vol Label", sep);
+  obuf_field(out, "LinkInfo VolID Vol LabelU", sep);
+  obuf_field(out, "LinkInfo Local Base Path", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "LinkInfo CNR Size", sep);
+    obuf_field(out, "LinkInfo CNR Flags", sep);
+    obuf_field(out, "LinkInfo CNR NetNameOffset", sep);
+    obuf_field(out, "LinkInfo CNR DeviceNameOffset", sep);
+  }
+  obuf_field(out, "LinkInfo CNR NetwkProviderType", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "LinkInfo CNR NetNameOffsetU", sep);
+    obuf_field(out, "LinkInfo CNR DeviceNameOffsetU", sep);
+  }
+  obuf_field(out, "LinkInfo CNR NetName", sep);
+  obuf_field(out, "LinkInfo CNR DeviceName", sep);
+  obuf_field(out, "LinkInfo CNR NetNameU", sep);
+  obuf_field(out, "LinkInfo CNR DeviceNameU", sep);
 
-  // Get the stat info for the file itself
-  stat(fname, &statbuf);
+  obuf_field(out, "LinkInfo Common Path Suffix", sep);
+  obuf_field(out, "LinkInfo Local Base Path Unicode", sep);
+  obuf_field(out, "LinkInfo Common Path Suffix Unicode", sep);
 
-  if (get_lif(fp, statbuf.st_size, &lif) < 0)
+  if (less == 0)
   {
-    fprintf(stderr, "Error processing file \'%s\' - sorry\n", fname);
-    return;
+    obuf_field(out, "StrData Total Size (bytes)", sep);
+    obuf_field(out, "StrData Name Num Chars", sep);
   }
-  if (get_lif_a(&lif, &lif_a))
+  obuf_field(out, "StrData - Name", sep);
+  if (less == 0)
   {
-    fprintf(stderr, "Could not make ASCII version of \'%s\' - sorry\n", fname);
-    return;
+    obuf_field(out, "StrData Rel Path Num Chars", sep);
   }
-  //Now print the header if needed
-  if (filecount == 0)
+  obuf_field(out, "StrData Relative Path", sep);
+  if (less == 0)
   {
-    printf("File Name%c", sep);
-    if (less == 0)
-    {
-      printf("Link File Size%c", sep);
-    }
-    printf("Link File Last Accessed%cLink File Last Modified%c", sep, sep);
-    printf("Link File Last Changed%c", sep);
-    if (less == 0)
-    {
-      printf("Hdr Size%cHdr CLSID%cHdr Flags%c", sep, sep, sep);
-    }
-    printf("Hdr Attributes%c", sep);
-    printf("Hdr FileCreate%cHdr FileAccess%c", sep, sep);
-    printf("Hdr FileWrite%c", sep);
-    printf("Hdr TargetSize%c", sep);
-    if (less == 0)
-    {
-      printf("Hdr IconIndex%cHdr WindowState%cHdr HotKeys%c", sep, sep, sep);
-      printf("Hdr Reserved1%cHdr Reserved2%cHdr Reserved3%c", sep, sep, sep);
-      printf("IDList Size%c", sep);
-      printf("IDList No Items%c", sep);
-      printf("LinkInfo Size%c", sep);
-      printf("LinkInfo Hdr Size%c", sep);
-      printf("LinkInfo Flags%c", sep);
-      printf("LinkInfo VolID Offset%c", sep);
-      printf("LinkInfo Base Path Offset%c", sep);
-      printf("LinkInfo CNR Offset%c", sep);
-      printf("LinkInfo CPS Offset%c", sep);
-      printf("LinkInfo LBP Offset Unicode%c", sep);
-      printf("LinkInfo CPS Offset Unicode%c", sep);
-      printf("LinkInfo VolID Size%c", sep);
-    }
-    printf("LinkInfo VolID Drive Type%c", sep);
-    printf("LinkInfo VolID Drive Ser No%c", sep);
-    if (less == 0)
-    {
-      printf("LinkInfo VolID VLOffset%c", sep);
-      printf("LinkInfo VolID VLOffsetU%c", sep);
-    }
-    printf("LinkInfo VolID Vol Label%c", sep);
-    printf("LinkInfo VolID Vol LabelU%c", sep);
-    printf("LinkInfo Local Base Path%c", sep);
-    if (less == 0)
-    {
-      printf("LinkInfo CNR Size%c", sep);
-      printf("LinkInfo CNR Flags%c", sep);
-      printf("LinkInfo CNR NetNameOffset%c", sep);
-      printf("LinkInfo CNR DeviceNameOffset%c", sep);
-    }
-    printf("LinkInfo CNR NetwkProviderType%c", sep);
-    if (less == 0)
-    {
-      printf("LinkInfo CNR NetNameOffsetU%c", sep);
-      printf("LinkInfo CNR DeviceNameOffsetU%c", sep);
-    }
-    printf("LinkInfo CNR NetName%c", sep);
-    printf("LinkInfo CNR DeviceName%c", sep);
-    printf("LinkInfo CNR NetNameU%c", sep);
-    printf("LinkInfo CNR DeviceNameU%c", sep);
+    obuf_field(out, "StrData Working Dir Num Chars", sep);
+  }
+  obuf_field(out, "StrData Working Dir", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "StrData Cmd Line Args Num Chars", sep);
+  }
+  obuf_field(out, "StrData Cmd Line Args", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "StrData Icon Loc Num Chars", sep);
+  }
+  obuf_field(out, "StrData Icon Location", sep);
+  // S2.5 ExtraData structures
+  if (less == 0)
+  {
+    obuf_field(out, "ExtraData Total Size (bytes)", sep);
+  }
+  obuf_field(out, "ExtraData Structures", sep);
+
+  // S2.5.1 ConsoleDataBlock
+  if (less == 0)
+  {
+    obuf_field(out, "ED CDB File Offset (bytes)", sep);
+    obuf_field(out, "ED CDB Size (bytes)", sep);
+    obuf_field(out, "ED CDB Signature", sep);
+    obuf_field(out, "ED CDB FillAttributes", sep);
+    obuf_field(out, "ED CDB PopupFillAttr", sep);
+    obuf_field(out, "ED CDB ScrBufSizeX", sep);
+    obuf_field(out, "ED CDB ScrBufSizeY", sep);
+    obuf_field(out, "ED CDB WindowSizeX", sep);
+    obuf_field(out, "ED CDB WindowSizeY", sep);
+    obuf_field(out, "ED CDB WindowOriginX", sep);
+    obuf_field(out, "ED CDB WindowOriginY", sep);
+    obuf_field(out, "ED CDB Unused1", sep);
+    obuf_field(out, "ED CDB Unused2", sep);
+    obuf_field(out, "ED CDB FontHeight", sep);
+    obuf_field(out, "ED CDB FontWidth", sep);
+    obuf_field(out, "ED CDB FontFamily", sep);
+    obuf_field(out, "ED CDB FontPitch", sep);
+    obuf_field(out, "ED CDB FontWeight", sep);
+    obuf_field(out, "ED CDB FaceName", sep);
+    obuf_field(out, "ED CDB CursorSize", sep);
+    obuf_field(out, "ED CDB FullScreen", sep);
+    obuf_field(out, "ED CDB QuickEdit", sep);
+    obuf_field(out, "ED CDB InsertMode", sep);
+    obuf_field(out, "ED CDB AutoPosition", sep);
+    obuf_field(out, "ED CDB HistoryBufSize", sep);
+    obuf_field(out, "ED CDB NumHistoryBuf", sep);
+    obuf_field(out, "ED CDB HistoryNoDup", sep);
+    obuf_field(out, "ED CDB ColorTable", sep);
+  }
+  // S2.5.2 ConsoleFEDataBlock
+  if (less == 0)
+  {
+    obuf_field(out, "ED CFEDB File Offset (bytes)", sep);
+    obuf_field(out, "ED CFEDB Size (bytes)", sep);
+    obuf_field(out, "ED CFEDB Signature", sep);
+    obuf_field(out, "ED CFEDB CodePage", sep);
+  }
+  // S2.5.3 DarwinDataBlock
+  if (less == 0)
+  {
+    obuf_field(out, "ED DDB File Offset (bytes)", sep);
+    obuf_field(out, "ED DDB Size (bytes)", sep);
+    obuf_field(out, "ED DDB Signature", sep);
+    obuf_field(out, "ED DDB DarwinDataAnsi", sep);
+    obuf_field(out, "ED DDB DarwinDataUnicode", sep);
+  }
+  // S2.5.4 EnvironmentVariableDataBlock
+  if (less == 0)
+  {
+    obuf_field(out, "ED EVDB File Offset (bytes)", sep);
+    obuf_field(out, "ED EVDB Size (bytes)", sep);
+    obuf_field(out, "ED EVDB Signature", sep);
+    obuf_field(out, "ED EVDB TargetAnsi", sep);
+    obuf_field(out, "ED EVDB TargetUnicode", sep);
+  }
+  // S2.5.5 IconEnvironmentDataBlock
+  if (less == 0)
+  {
+    obuf_field(out, "ED IEDB File Offset (bytes)", sep);
+    obuf_field(out, "ED IEDB Size (bytes)", sep);
+    obuf_field(out, "ED IEDB Signature", sep);
+    obuf_field(out, "ED IEDB TargetAnsi", sep);
+    obuf_field(out, "ED IEDB TargetUnicode", sep);
+  }
+  // S2.5.6 KnownFolderDataBlock
+  if (less == 0)
+  {
+    obuf_field(out, "ED KFDB File Offset (bytes)", sep);
+    obuf_field(out, "ED KFDB Size (bytes)", sep);
+    obuf_field(out, "ED KFDB Signature", sep);
+    obuf_field(out, "ED KFDB KnownFolderID", sep);
+    obuf_field(out, "ED KFDB Offset", sep);
+  }
+  // S2.5.7 PropertyStoreDataBlock
+  if (less == 0)
+  {
+    obuf_field(out, "ED PS File Offset (bytes)", sep);
+    obuf_field(out, "ED PS Size (bytes)", sep);
+    obuf_field(out, "ED PS Signature", sep);
+    obuf_field(out, "ED PS Number of Stores ", sep);
+  }
+  // S2.5.9 SpecialFolderDataBlock
+  if (less == 0)
+  {
+    obuf_field(out, "ED SFolderData File Offset (bytes)", sep);
+    obuf_field(out, "ED SFolderData Size (bytes)", sep);
+    obuf_field(out, "ED SFolderData Signature", sep);
+    obuf_field(out, "ED SFolderData ID", sep);
+    obuf_field(out, "ED SFolderData Offset", sep);
+  }
+  // S 2.5.10 TrackerDataBlock
+  if (less == 0)
+  {
+    obuf_field(out, "ED TrackerData File Offset (bytes)", sep);
+    obuf_field(out, "ED TrackerData Size (bytes)", sep);
+    obuf_field(out, "ED TrackerData Signature", sep);
+    obuf_field(out, "ED TrackerData Length", sep);
+    obuf_field(out, "ED TrackerData Version", sep);
+  }
+  obuf_field(out, "ED TrackerData MachineID", sep);
+  obuf_field(out, "ED TrackerData Droid1", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "ED TD Droid1 Version", sep);
+    obuf_field(out, "ED TD Droid1 Variant", sep);
+  }
+  obuf_field(out, "ED TD Droid1 Time", sep);
+  obuf_field(out, "ED TD Droid1 Clock Seq", sep);
+  obuf_field(out, "ED TD Droid1 Node", sep);
+  obuf_field(out, "ED TrackerData Droid2", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "ED TD Droid2 Version", sep);
+    obuf_field(out, "ED TD Droid2 Variant", sep);
+  }
+  obuf_field(out, "ED TD Droid2 Time", sep);
+  obuf_field(out, "ED TD Droid2 Clock Seq", sep);
+  obuf_field(out, "ED TD Droid2 Node", sep);
+  obuf_field(out, "ED TrackerData DroidBirth1", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "ED TD DroidBirth1 Version", sep);
+    obuf_field(out, "ED TD DroidBirth1 Variant", sep);
+  }
+  obuf_field(out, "ED TD DroidBirth1 Time", sep);
+  obuf_field(out, "ED TD DroidBirth1 Clock Seq", sep);
+  obuf_field(out, "ED TD DroidBirth1 Node", sep);
+  obuf_field(out, "ED TrackerData DroidBirth2", sep);
+  if (less == 0)
+  {
+    obuf_field(out, "ED TD DroidBirth2 Version", sep);
+    obuf_field(out, "ED TD DroidBirth2 Variant", sep);
+  }
+  obuf_field(out, "ED TD DroidBirth2 Time", sep);
+  obuf_field(out, "ED TD DroidBirth2 Clock Seq", sep);
+  obuf_field(out, "ED TD DroidBirth2 Node", sep);
+  //ED Vista & above IDList
+  if (less == 0)
+  {
+    obuf_field(out, "ED >= Vista IDList File Offset (bytes)", sep);
+    obuf_field(out, "ED >= Vista IDList Size", sep);
+    obuf_field(out, "ED >= Vista IDList Signature", sep);
+    obuf_field(out, "ED >= Vista IDList Num Items", sep);
+  }
+  obuf_chr(out, '\n');
+}
 
-    printf("LinkInfo Common Path Suffix%c", sep);
-    printf("LinkInfo Local Base Path Unicode%c", sep);
-    printf("LinkInfo Common Path Suffix Unicode%c", sep);
+//
+//Function: sv_out() takes the decoded link file and outputs the csv or tsv
+//          version of the decoded data (lif_a is the ASCII version of lif)
+//          to out.
+void sv_out(struct OBUF* out, struct LIF* lif, struct LIF_A* lif_a, struct stat* statbuf, int times, char* fname, int less, char sep)
+{
+  char buf[40];
+  int  i, j;
 
-    if (less == 0)
-    {
-      printf("StrData Total Size (bytes)%c", sep);
-      printf("StrData Name Num Chars%c", sep);
-    }
-    printf("StrData - Name%c", sep);
-    if (less == 0)
-    {
-      printf("StrData Rel Path Num Chars%c", sep);
-    }
-    printf("StrData Relative Path%c", sep);
-    if (less == 0)
-    {
-      printf("StrData Working Dir Num Chars%c", sep);
-    }
-    printf("StrData Working Dir%c", sep);
-    if (less == 0)
-    {
-      printf("StrData Cmd Line Args Num Chars%c", sep);
-    }
-    printf("StrData Cmd Line Args%c", sep);
-    if (less == 0)
-    {
-      printf("StrData Icon Loc Num Chars%c", sep);
-    }
-    printf("StrData Icon Location%c", sep);
-    // S2.5 ExtraData structures
-    if (less == 0)
-    {
-      printf("ExtraData Total Size (bytes)%c", sep);
-    }
-    printf("ExtraData Structures%c", sep);
 
-    // S2.5.1 ConsoleDataBlock
-    if (less == 0)
-    {
-      printf("ED CDB File Offset (bytes)%c", sep);
-      printf("ED CDB Size (bytes)%c", sep);
-      printf("ED CDB Signature%c", sep);
-      printf("ED CDB FillAttributes%c", sep);
-      printf("ED CDB PopupFillAttr%c", sep);
-      printf("ED CDB ScrBufSizeX%c", sep);
-      printf("ED CDB ScrBufSizeY%c", sep);
-      printf("ED CDB WindowSizeX%c", sep);
-      printf("ED CDB WindowSizeY%c", sep);
-      printf("ED CDB WindowOriginX%c", sep);
-      printf("ED CDB WindowOriginY%c", sep);
-      printf("ED CDB Unused1%c", sep);
-      printf("ED CDB Unused2%c", sep);
-      printf("ED CDB FontHeight%c", sep);
-      printf("ED CDB FontWidth%c", sep);
-      printf("ED CDB FontFamily%c", sep);
-      printf("ED CDB FontPitch%c", sep);
-      printf("ED CDB FontWeight%c", sep);
-      printf("ED CDB FaceName%c", sep);
-      printf("ED CDB CursorSize%c", sep);
-      printf("ED CDB FullScreen%c", sep);
-      printf("ED CDB QuickEdit%c", sep);
-      printf("ED CDB InsertMode%c", sep);
-      printf("ED CDB AutoPosition%c", sep);
-      printf("ED CDB HistoryBufSize%c", sep);
-      printf("ED CDB NumHistoryBuf%c", sep);
-      printf("ED CDB HistoryNoDup%c", sep);
-      printf("ED CDB ColorTable%c", sep);
-    }
-    // S2.5.2 ConsoleFEDataBlock
-    if (less == 0)
-    {
-      printf("ED CFEDB File Offset (bytes)%c", sep);
-      printf("ED CFEDB Size (bytes)%c", sep);
-      printf("ED CFEDB Signature%c", sep);
-      printf("ED CFEDB CodePage%c", sep);
-    }
-    // S2.5.3 DarwinDataBlock
-    if (less == 0)
-    {
-      printf("ED DDB File Offset (bytes)%c", sep);
-      printf("ED DDB Size (bytes)%c", sep);
-      printf("ED DDB Signature%c", sep);
-      printf("ED DDB DarwinDataAnsi%c", sep);
-      printf("ED DDB DarwinDataUnicode%c", sep);
-    }
-    // S2.5.4 EnvironmentVariableDataBlock
-    if (less == 0)
-    {
-      printf("ED EVDB File Offset (bytes)%c", sep);
-      printf("ED EVDB Size (bytes)%c", sep);
-      printf("ED EVDB Signature%c", sep);
-      printf("ED EVDB TargetAnsi%c", sep);
-      printf("ED EVDB TargetUnicode%c", sep);
-    }
-    // S2.5.5 IconEnvironmentDataBlock
-    if (less == 0)
-    {
-      printf("ED IEDB File Offset (bytes)%c", sep);
-      printf("ED IEDB Size (bytes)%c", sep);
-      printf("ED IEDB Signature%c", sep);
-      printf("ED IEDB TargetAnsi%c", sep);
-      printf("ED IEDB TargetUnicode%c", sep);
-    }
-    // S2.5.6 KnownFolderDataBlock
-    if (less == 0)
-    {
-      printf("ED KFDB File Offset (bytes)%c", sep);
-      printf("ED KFDB Size (bytes)%c", sep);
-      printf("ED KFDB Signature%c", sep);
-      printf("ED KFDB KnownFolderID%c", sep);
-      printf("ED KFDB Offset%c", sep);
-    }
-    // S2.5.7 PropertyStoreDataBlock
-    if (less == 0)
-    {
-      printf("ED PS File Offset (bytes)%c", sep);
-      printf("ED PS Size (bytes)%c", sep);
-      printf("ED PS Signature%c", sep);
-      printf("ED PS Number of Stores %c", sep);
-    }
-    // S2.5.9 SpecialFolderDataBlock
-    if (less == 0)
-    {
-      printf("ED SFolderData File Offset (bytes)%c", sep);
-      printf("ED SFolderData Size (bytes)%c", sep);
-      printf("ED SFolderData Signature%c", sep);
-      printf("ED SFolderData ID%c", sep);
-      printf("ED SFolderData Offset%c", sep);
-    }
-    // S 2.5.10 TrackerDataBlock
-    if (less == 0)
-    {
-      printf("ED TrackerData File Offset (bytes)%c", sep);
-      printf("ED TrackerData Size (bytes)%c", sep);
-      printf("ED TrackerData Signature%c", sep);
-      printf("ED TrackerData Length%c", sep);
-      printf("ED TrackerData Version%c", sep);
-    }
-    printf("ED TrackerData MachineID%c", sep);
-    printf("ED TrackerData Droid1%c", sep);
-    if (less == 0)
-    {
-      printf("ED TD Droid1 Version%c", sep);
-      printf("ED TD Droid1 Variant%c", sep);
-    }
-    printf("ED TD Droid1 Time%c", sep);
-    printf("ED TD Droid1 Clock Seq%c", sep);
-    printf("ED TD Droid1 Node%c", sep);
-    printf("ED TrackerData Droid2%c", sep);
-    if (less == 0)
-    {
-      printf("ED TD Droid2 Version%c", sep);
-      printf("ED TD Droid2 Variant%c", sep);
-    }
-    printf("ED TD Droid2 Time%c", sep);
-    printf("ED TD Droid2 Clock Seq%c", sep);
-    printf("ED TD Droid2 Node%c", sep);
-    printf("ED TrackerData DroidBirth1%c", sep);
-    if (less == 0)
-    {
-      printf("ED TD DroidBirth1 Version%c", sep);
-      printf("ED TD DroidBirth1 Variant%c", sep);
-    }
-    printf("ED TD DroidBirth1 Time%c", sep);
-    printf("ED TD DroidBirth1 Clock Seq%c", sep);
-    printf("ED TD DroidBirth1 Node%c", sep);
-    printf("ED TrackerData DroidBirth2%c", sep);
-    if (less == 0)
-    {
-      printf("ED TD DroidBirth2 Version%c", sep);
-      printf("ED TD DroidBirth2 Variant%c", sep);
-    }
-    printf("ED TD DroidBirth2 Time%c", sep);
-    printf("ED TD DroidBirth2 Clock Seq%c", sep);
-    printf("ED TD DroidBirth2 Node%c", sep);
-    //ED Vista & above IDList
-    if (less == 0)
-    {
-      printf("ED >= Vista IDList File Offset (bytes)%c", sep);
-      printf("ED >= Vista IDList Size%c", sep);
-      printf("ED >= Vista IDList Signature%c", sep);
-      printf("ED >= Vista IDList Num Items%c", sep);
-    }
-    printf("\n");
-  }
   //Print a record
-  printf("%s%c", fname, sep);
+  obuf_field(out, fname, sep);
   if (less == 0)
   {
-    printf("%u%c", (unsigned int)statbuf.st_size, sep);
+    obuf_uint(out, (unsigned int)statbuf->st_size);
+    obuf_chr(out, sep);
   }
-  strftime(buf, 29, "%Y-%m-%d %H:%M:%S (UTC)", gmtime(&statbuf.st_atime));
-  printf("%s%c", buf, sep);
-  strftime(buf, 29, "%Y-%m-%d %H:%M:%S (UTC)", gmtime(&statbuf.st_mtime));
-  printf("%s%c", buf, sep);
-  strftime(buf, 29, "%Y-%m-%d %H:%M:%S (UTC)", gmtime(&statbuf.st_ctime));
-  printf("%s%c", buf, sep);
+  stat_time(buf, &statbuf->st_atime, "%Y-%m-%d %H:%M:%S (UTC)", times);
+  obuf_field(out, buf, sep);
+  stat_time(buf, &statbuf->st_mtime, "%Y-%m-%d %H:%M:%S (UTC)", times);
+  obuf_field(out, buf, sep);
+  stat_time(buf, &statbuf->st_ctime, "%Y-%m-%d %H:%M:%S (UTC)", times);
+  obuf_field(out, buf, sep);
   if (less == 0)
   {
-    printf("%s%c%s%c", lif_a.lha.H_size, sep, lif_a.lha.CLSID, sep);
-    printf("%s%c", lif_a.lha.Flags, sep);
+    obuf_field(out, lif_a->lha.H_size, sep);
+    obuf_field(out, lif_a->lha.CLSID, sep);
+    obuf_field(out, lif_a->lha.Flags, sep);
   }
-  printf("%s%c", lif_a.lha.Attr, sep);
+  obuf_field(out, lif_a->lha.Attr, sep);
   if (less == 0)
   {
-    printf("%s%c", lif_a.lha.CrDate_long, sep);
-    printf("%s%c%s%c", lif_a.lha.AcDate_long, sep, lif_a.lha.WtDate_long, sep);
+    obuf_field(out, lif_a->lha.CrDate_long, sep);
+    obuf_field(out, lif_a->lha.AcDate_long, sep);
+    obuf_field(out, lif_a->lha.WtDate_long, sep);
   }
   else
   {
-    printf("%s%c", lif_a.lha.CrDate, sep);
-    printf("%s%c%s%c", lif_a.lha.AcDate, sep, lif_a.lha.WtDate, sep);
+    obuf_field(out, lif_a->lha.CrDate, sep);
+    obuf_field(out, lif_a->lha.AcDate, sep);
+    obuf_field(out, lif_a->lha.WtDate, sep);
   }
-  printf("%s%c", lif_a.lha.Size, sep);
+  obuf_field(out, lif_a->lha.Size, sep);
   if (less == 0)
   {
-    printf("%s%c%s%c", lif_a.lha.IconIndex, sep, lif_a.lha.ShowState, sep);
-    printf("%s%c%s%c", lif_a.lha.Hotkey, sep, lif_a.lha.Reserved1, sep);
-    printf("%s%c%s%c", lif_a.lha.Reserved2, sep, lif_a.lha.Reserved3, sep);
-    printf("%s%c", lif_a.lidla.IDListSize, sep);
-    printf("%s%c", lif_a.lidla.NumItemIDs, sep);
-    printf("%s%c", lif_a.lia.Size, sep);
-    printf("%s%c", lif_a.lia.HeaderSize, sep);
-    printf("%s%c", lif_a.lia.Flags, sep);
-    printf("%s%c", lif_a.lia.IDOffset, sep);
-    printf("%s%c", lif_a.lia.LBPOffset, sep);
-    printf("%s%c", lif_a.lia.CNRLOffset, sep);
-    printf("%s%c", lif_a.lia.CPSOffset, sep);
-    printf("%s%c", lif_a.lia.LBPOffsetU, sep);
-    printf("%s%c", lif_a.lia.CPSOffsetU, sep);
-    printf("%s%c", lif_a.lia.VolID.Size, sep);
+    obuf_field(out, lif_a->lha.IconIndex, sep);
+    obuf_field(out, lif_a->lha.ShowState, sep);
+    obuf_field(out, lif_a->lha.Hotkey, sep);
+    obuf_field(out, lif_a->lha.Reserved1, sep);
+    obuf_field(out, lif_a->lha.Reserved2, sep);
+    obuf_field(out, lif_a->lha.Reserved3, sep);
+    obuf_field(out, lif_a->lidla.IDListSize, sep);
+    obuf_field(out, lif_a->lidla.NumItemIDs, sep);
+    obuf_field(out, lif_a->lia.Size, sep);
+    obuf_field(out, lif_a->lia.HeaderSize, sep);
+    obuf_field(out, lif_a->lia.Flags, sep);
+    obuf_field(out, lif_a->lia.IDOffset, sep);
+    obuf_field(out, lif_a->lia.LBPOffset, sep);
+    obuf_field(out, lif_a->lia.CNRLOffset, sep);
+    obuf_field(out, lif_a->lia.CPSOffset, sep);
+    obuf_field(out, lif_a->lia.LBPOffsetU, sep);
+    obuf_field(out, lif_a->lia.CPSOffsetU, sep);
+    obuf_field(out, lif_a->lia.VolID.Size, sep);
   }
-  printf("%s%c", lif_a.lia.VolID.DriveType, sep);
-  printf("%s%c", lif_a.lia.VolID.DriveSN, sep);
+  obuf_field(out, lif_a->lia.VolID.DriveType, sep);
+  obuf_field(out, lif_a->lia.VolID.DriveSN, sep);
   if (less == 0)
   {
-    printf("%s%c", lif_a.lia.VolID.VLOffset, sep);
-    printf("%s%c", lif_a.lia.VolID.VLOffsetU, sep);
+    obuf_field(out, lif_a->lia.VolID.VLOffset, sep);
+    obuf_field(out, lif_a->lia.VolID.VLOffsetU, sep);
   }
-  printf("%s%c", lif_a.lia.VolID.VolumeLabel, sep);
-  printf("%s%c", lif_a.lia.VolID.VolumeLabelU, sep);
+  obuf_field(out, lif_a->lia.VolID.VolumeLabel, sep);
+  obuf_field(out, lif_a->lia.VolID.VolumeLabelU, sep);
 
-  printf("%s%c", lif_a.lia.LBP, sep);
+  obuf_field(out, lif_a->lia.LBP, sep);
   if (less == 0)
   {
-    printf("%s%c", lif_a.lia.CNR.Size, sep);
-    printf("%s%c", lif_a.lia.CNR.Flags, sep);
-    printf("%s%c", lif_a.lia.CNR.NetNameOffset, sep);
-    printf("%s%c", lif_a.lia.CNR.DeviceNameOffset, sep);
+    obuf_field(out, lif_a->lia.CNR.Size, sep);
+    obuf_field(out, lif_a->lia.CNR.Flags, sep);
+    obuf_field(out, lif_a->lia.CNR.NetNameOffset, sep);
+    obuf_field(out, lif_a->lia.CNR.DeviceNameOffset, sep);
   }
-  printf("%s%c", lif_a.lia.CNR.NetworkProviderType, sep);
+  obuf_field(out, lif_a->lia.CNR.NetworkProviderType, sep);
   if (less == 0)
   {
-    printf("%s%c", lif_a.lia.CNR.NetNameOffsetU, sep);
-    printf("%s%c", lif_a.lia.CNR.DeviceNameOffsetU, sep);
+    obuf_field(out, lif_a->lia.CNR.NetNameOffsetU, sep);
+    obuf_field(out, lif_a->lia.CNR.DeviceNameOffsetU, sep);
   }
-  printf("%s%c", lif_a.lia.CNR.NetName, sep);
-  printf("%s%c", lif_a.lia.CNR.DeviceName, sep);
-  printf("%s%c", lif_a.lia.CNR.NetNameU, sep);
-  printf("%s%c", lif_a.lia.CNR.DeviceNameU, sep);
-  printf("%s%c", lif_a.lia.CPS, sep);
-  printf("%s%c", lif_a.lia.LBPU, sep);
-  printf("%s%c", lif_a.lia.CPSU, sep);
+  obuf_field(out, lif_a->lia.CNR.NetName, sep);
+  obuf_field(out, lif_a->lia.CNR.DeviceName, sep);
+  obuf_field(out, lif_a->lia.CNR.NetNameU, sep);
+  obuf_field(out, lif_a->lia.CNR.DeviceNameU, sep);
+  obuf_field(out, lif_a->lia.CPS, sep);
+  obuf_field(out, lif_a->lia.LBPU, sep);
+  obuf_field(out, lif_a->lia.CPSU, sep);
 
   if (less == 0)
   {
-    printf("%s%c", lif_a.lsda.Size, sep);
+    obuf_field(out, lif_a->lsda.Size, sep);
   }
   for (i = 0; i < 5; i++)
   {
     if (less == 0)
     {
-      printf("%s%c", lif_a.lsda.CountChars[i], sep);
-    }
-    //If csv output then replace a comma in the string with a semi-colon
-    if (output_type == csv)
-    {
-      replace_comma(lif_a.lsda.Data[i], lif.lsd.CountChars[i]);
+      obuf_field(out, lif_a->lsda.CountChars[i], sep);
     }
-    printf("%s%c", lif_a.lsda.Data[i], sep);
+    obuf_field(out, lif_a->lsda.Data[i], sep);
   }
   // S2.5 ExtraData
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.Size, sep);
+    obuf_field(out, lif_a->leda.Size, sep);
   }
-  printf("%s%c", lif_a.leda.edtypes, sep);
+  obuf_field(out, lif_a->leda.edtypes, sep);
 
   // S2.5.1 ConsoleDataBlock
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.lcpa.Posn, sep);
-    printf("%s%c", lif_a.leda.lcpa.Size, sep);
-    printf("%s%c", lif_a.leda.lcpa.sig, sep);
-    printf("%s%c", lif_a.leda.lcpa.FillAttributes, sep);
-    printf("%s%c", lif_a.leda.lcpa.PopupFillAttributes, sep);
-    printf("%s%c", lif_a.leda.lcpa.ScreenBufferSizeX, sep);
-    printf("%s%c", lif_a.leda.lcpa.ScreenBufferSizeY, sep);
-    printf("%s%c", lif_a.leda.lcpa.WindowSizeX, sep);
-    printf("%s%c", lif_a.leda.lcpa.WindowSizeY, sep);
-    printf("%s%c", lif_a.leda.lcpa.WindowOriginX, sep);
-    printf("%s%c", lif_a.leda.lcpa.WindowOriginY, sep);
-    printf("%s%c", lif_a.leda.lcpa.Unused1, sep);
-    printf("%s%c", lif_a.leda.lcpa.Unused2, sep);
-    printf("%s%c", lif_a.leda.lcpa.FontHeight, sep);
-    printf("%s%c", lif_a.leda.lcpa.FontWidth, sep);
-    printf("%s%c", lif_a.leda.lcpa.FontFamily, sep);
-    printf("%s%c", lif_a.leda.lcpa.FontPitch, sep);
-    printf("%s%c", lif_a.leda.lcpa.FontWeight, sep);
-    printf("%s%c", lif_a.leda.lcpa.FaceName, sep);
-    printf("%s%c", lif_a.leda.lcpa.CursorSize, sep);
-    printf("%s%c", lif_a.leda.lcpa.FullScreen, sep);
-    printf("%s%c", lif_a.leda.lcpa.QuickEdit, sep);
-    printf("%s%c", lif_a.leda.lcpa.InsertMode, sep);
-    printf("%s%c", lif_a.leda.lcpa.AutoPosition, sep);
-    printf("%s%c", lif_a.leda.lcpa.HistoryBufferSize, sep);
-    printf("%s%c", lif_a.leda.lcpa.NumberOfHistoryBuffers, sep);
-    printf("%s%c", lif_a.leda.lcpa.HistoryNoDup, sep);
+    obuf_field(out, lif_a->leda.lcpa.Posn, sep);
+    obuf_field(out, lif_a->leda.lcpa.Size, sep);
+    obuf_field(out, lif_a->leda.lcpa.sig, sep);
+    obuf_field(out, lif_a->leda.lcpa.FillAttributes, sep);
+    obuf_field(out, lif_a->leda.lcpa.PopupFillAttributes, sep);
+    obuf_field(out, lif_a->leda.lcpa.ScreenBufferSizeX, sep);
+    obuf_field(out, lif_a->leda.lcpa.ScreenBufferSizeY, sep);
+    obuf_field(out, lif_a->leda.lcpa.WindowSizeX, sep);
+    obuf_field(out, lif_a->leda.lcpa.WindowSizeY, sep);
+    obuf_field(out, lif_a->leda.lcpa.WindowOriginX, sep);
+    obuf_field(out, lif_a->leda.lcpa.WindowOriginY, sep);
+    obuf_field(out, lif_a->leda.lcpa.Unused1, sep);
+    obuf_field(out, lif_a->leda.lcpa.Unused2, sep);
+    obuf_field(out, lif_a->leda.lcpa.FontHeight, sep);
+    obuf_field(out, lif_a->leda.lcpa.FontWidth, sep);
+    obuf_field(out, lif_a->leda.lcpa.FontFamily, sep);
+    obuf_field(out, lif_a->leda.lcpa.FontPitch, sep);
+    obuf_field(out, lif_a->leda.lcpa.FontWeight, sep);
+    obuf_field(out, lif_a->leda.lcpa.FaceName, sep);
+    obuf_field(out, lif_a->leda.lcpa.CursorSize, sep);
+    obuf_field(out, lif_a->leda.lcpa.FullScreen, sep);
+    obuf_field(out, lif_a->leda.lcpa.QuickEdit, sep);
+    obuf_field(out, lif_a->leda.lcpa.InsertMode, sep);
+    obuf_field(out, lif_a->leda.lcpa.AutoPosition, sep);
+    obuf_field(out, lif_a->leda.lcpa.HistoryBufferSize, sep);
+    obuf_field(out, lif_a->leda.lcpa.NumberOfHistoryBuffers, sep);
+    obuf_field(out, lif_a->leda.lcpa.HistoryNoDup, sep);
     for (j = 0; j < 15; j++)
     {
       //15 consecutive ColorTable Entries
-      printf("%s%c", lif_a.leda.lcpa.ColorTable[j], ';');
+      obuf_field(out, lif_a->leda.lcpa.ColorTable[j], ';');
     }
     // And the last one terminated with the field separator
-    printf("%s%c", lif_a.leda.lcpa.ColorTable[j], sep);
+    obuf_field(out, lif_a->leda.lcpa.ColorTable[j], sep);
   }
   // S2.5.2 ConsoleFEDataBlock
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.lcfepa.Posn, sep);
-    printf("%s%c", lif_a.leda.lcfepa.Size, sep);
-    printf("%s%c", lif_a.leda.lcfepa.sig, sep);
-    printf("%s%c", lif_a.leda.lcfepa.CodePage, sep);
+    obuf_field(out, lif_a->leda.lcfepa.Posn, sep);
+    obuf_field(out, lif_a->leda.lcfepa.Size, sep);
+    obuf_field(out, lif_a->leda.lcfepa.sig, sep);
+    obuf_field(out, lif_a->leda.lcfepa.CodePage, sep);
   }
   // S2.5.3 DarwinDataBlock
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.ldpa.Posn, sep);
-    printf("%s%c", lif_a.leda.ldpa.Size, sep);
-    printf("%s%c", lif_a.leda.ldpa.sig, sep);
-    if (output_type == csv)
-    {
-      replace_comma(lif_a.leda.ldpa.DarwinDataAnsi, 260);
-      replace_comma(lif_a.leda.ldpa.DarwinDataUnicode, 520);
-    }
-
-    printf("%s%c", lif_a.leda.ldpa.DarwinDataAnsi, sep);
-    printf("%s%c", lif_a.leda.ldpa.DarwinDataUnicode, sep);
+    obuf_field(out, lif_a->leda.ldpa.Posn, sep);
+    obuf_field(out, lif_a->leda.ldpa.Size, sep);
+    obuf_field(out, lif_a->leda.ldpa.sig, sep);
+    obuf_field(out, lif_a->leda.ldpa.DarwinDataAnsi, sep);
+    obuf_field(out, lif_a->leda.ldpa.DarwinDataUnicode, sep);
   }
   // S2.5.4 EnvironmentVariableDataBlock
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.lepa.Posn, sep);
-    printf("%s%c", lif_a.leda.lepa.Size, sep);
-    printf("%s%c", lif_a.leda.lepa.sig, sep);
-    if (output_type == csv)
-    {
-      replace_comma(lif_a.leda.lepa.TargetAnsi, 260);
-      replace_comma(lif_a.leda.lepa.TargetUnicode, 520);
-    }
-
-    printf("%s%c", lif_a.leda.lepa.TargetAnsi, sep);
-    printf("%s%c", lif_a.leda.lepa.TargetUnicode, sep);
+    obuf_field(out, lif_a->leda.lepa.Posn, sep);
+    obuf_field(out, lif_a->leda.lepa.Size, sep);
+    obuf_field(out, lif_a->leda.lepa.sig, sep);
+    obuf_field(out, lif_a->leda.lepa.TargetAnsi, sep);
+    obuf_field(out, lif_a->leda.lepa.TargetUnicode, sep);
   }
   // S2.5.5 IconEnvironmentDataBlock
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.liepa.Posn, sep);
-    printf("%s%c", lif_a.leda.liepa.Size, sep);
-    printf("%s%c", lif_a.leda.liepa.sig, sep);
-    if (output_type == csv)
-    {
-      replace_comma(lif_a.leda.liepa.TargetAnsi, 260);
-      replace_comma(lif_a.leda.liepa.TargetUnicode, 520);
-    }
-    printf("%s%c", lif_a.leda.liepa.TargetAnsi, sep);
-    printf("%s%c", lif_a.leda.liepa.TargetUnicode, sep);
+    obuf_field(out, lif_a->leda.liepa.Posn, sep);
+    obuf_field(out, lif_a->leda.liepa.Size, sep);
+    obuf_field(out, lif_a->leda.liepa.sig, sep);
+    obuf_field(out, lif_a->leda.liepa.TargetAnsi, sep);
+    obuf_field(out, lif_a->leda.liepa.TargetUnicode, sep);
   }
   // S2.5.7 PropertyStoreDataBlock
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.lkfpa.Posn, sep);
-    printf("%s%c", lif_a.leda.lkfpa.Size, sep);
-    printf("%s%c", lif_a.leda.lkfpa.sig, sep);
-    printf("%s%c", lif_a.leda.lkfpa.KFGUID.UUID, sep);
-    printf("%s%c", lif_a.leda.lkfpa.KFOffset, sep);
+    obuf_field(out, lif_a->leda.lkfpa.Posn, sep);
+    obuf_field(out, lif_a->leda.lkfpa.Size, sep);
+    obuf_field(out, lif_a->leda.lkfpa.sig, sep);
+    obuf_field(out, lif_a->leda.lkfpa.KFGUID.UUID, sep);
+    obuf_field(out, lif_a->leda.lkfpa.KFOffset, sep);
   }
   // S2.5.7 PropertyStoreDataBlock
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.lpspa.Posn, sep);
-    printf("%s%c", lif_a.leda.lpspa.Size, sep);
-    printf("%s%c", lif_a.leda.lpspa.sig, sep);
-    printf("%s%c", lif_a.leda.lpspa.NumStores, sep);
+    obuf_field(out, lif_a->leda.lpspa.Posn, sep);
+    obuf_field(out, lif_a->leda.lpspa.Size, sep);
+    obuf_field(out, lif_a->leda.lpspa.sig, sep);
+    obuf_field(out, lif_a->leda.lpspa.NumStores, sep);
   }
   // S2.5.9 SpecialFolderDataBlock
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.lsfpa.Posn, sep);
-    printf("%s%c", lif_a.leda.lsfpa.Size, sep);
-    printf("%s%c", lif_a.leda.lsfpa.sig, sep);
-    printf("%s%c", lif_a.leda.lsfpa.SpecialFolderID, sep);
-    printf("%s%c", lif_a.leda.lsfpa.Offset, sep);
+    obuf_field(out, lif_a->leda.lsfpa.Posn, sep);
+    obuf_field(out, lif_a->leda.lsfpa.Size, sep);
+    obuf_field(out, lif_a->leda.lsfpa.sig, sep);
+    obuf_field(out, lif_a->leda.lsfpa.SpecialFolderID, sep);
+    obuf_field(out, lif_a->leda.lsfpa.Offset, sep);
   }
   // S2.5.10 TrackerDataBlock
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.ltpa.Posn, sep);
-    printf("%s%c", lif_a.leda.ltpa.Size, sep);
-    printf("%s%c", lif_a.leda.ltpa.sig, sep);
-    printf("%s%c", lif_a.leda.ltpa.Length, sep);
-    printf("%s%c", lif_a.leda.ltpa.Version, sep);
+    obuf_field(out, lif_a->leda.ltpa.Posn, sep);
+    obuf_field(out, lif_a->leda.ltpa.Size, sep);
+    obuf_field(out, lif_a->leda.ltpa.sig, sep);
+    obuf_field(out, lif_a->leda.ltpa.Length, sep);
+    obuf_field(out, lif_a->leda.ltpa.Version, sep);
   }
-  printf("%s%c", lif_a.leda.ltpa.MachineID, sep);
-  printf("%s%c", lif_a.leda.ltpa.Droid1.UUID, sep);
+  obuf_field(out, lif_a->leda.ltpa.MachineID, sep);
+  obuf_field(out, lif_a->leda.ltpa.Droid1.UUID, sep);
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.ltpa.Droid1.Version, sep);
-    printf("%s%c", lif_a.leda.ltpa.Droid1.Variant, sep);
-    printf("%s%c", lif_a.leda.ltpa.Droid1.Time_long, sep);
+    obuf_field(out, lif_a->leda.ltpa.Droid1.Version, sep);
+    obuf_field(out, lif_a->leda.ltpa.Droid1.Variant, sep);
+    obuf_field(out, lif_a->leda.ltpa.Droid1.Time_long, sep);
   }
   else
   {
-    printf("%s%c", lif_a.leda.ltpa.Droid1.Time, sep);
+    obuf_field(out, lif_a->leda.ltpa.Droid1.Time, sep);
   }
-  printf("%s%c", lif_a.leda.ltpa.Droid1.ClockSeq, sep);
-  printf("%s%c", lif_a.leda.ltpa.Droid1.Node, sep);
-  printf("%s%c", lif_a.leda.ltpa.Droid2.UUID, sep);
+  obuf_field(out, lif_a->leda.ltpa.Droid1.ClockSeq, sep);
+  obuf_field(out, lif_a->leda.ltpa.Droid1.Node, sep);
+  obuf_field(out, lif_a->leda.ltpa.Droid2.UUID, sep);
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.ltpa.Droid2.Version, sep);
-    printf("%s%c", lif_a.leda.ltpa.Droid2.Variant, sep);
-    printf("%s%c", lif_a.leda.ltpa.Droid2.Time_long, sep);
+    obuf_field(out, lif_a->leda.ltpa.Droid2.Version, sep);
+    obuf_field(out, lif_a->leda.ltpa.Droid2.Variant, sep);
+    obuf_field(out, lif_a->leda.ltpa.Droid2.Time_long, sep);
   }
   else
   {
-    printf("%s%c", lif_a.leda.ltpa.Droid2.Time, sep);
+    obuf_field(out, lif_a->leda.ltpa.Droid2.Time, sep);
   }
-  printf("%s%c", lif_a.leda.ltpa.Droid2.ClockSeq, sep);
-  printf("%s%c", lif_a.leda.ltpa.Droid2.Node, sep);
-  printf("%s%c", lif_a.leda.ltpa.DroidBirth1.UUID, sep);
+  obuf_field(out, lif_a->leda.ltpa.Droid2.ClockSeq, sep);
+  obuf_field(out, lif_a->leda.ltpa.Droid2.Node, sep);
+  obuf_field(out, lif_a->leda.ltpa.DroidBirth1.UUID, sep);
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.ltpa.DroidBirth1.Version, sep);
-    printf("%s%c", lif_a.leda.ltpa.DroidBirth1.Variant, sep);
-    printf("%s%c", lif_a.leda.ltpa.DroidBirth1.Time_long, sep);
+    obuf_field(out, lif_a->leda.ltpa.DroidBirth1.Version, sep);
+    obuf_field(out, lif_a->leda.ltpa.DroidBirth1.Variant, sep);
+    obuf_field(out, lif_a->leda.ltpa.DroidBirth1.Time_long, sep);
   }
   else
   {
-    printf("%s%c", lif_a.leda.ltpa.DroidBirth1.Time, sep);
+    obuf_field(out, lif_a->leda.ltpa.DroidBirth1.Time, sep);
   }
-  printf("%s%c", lif_a.leda.ltpa.DroidBirth1.ClockSeq, sep);
-  printf("%s%c", lif_a.leda.ltpa.DroidBirth1.Node, sep);
-  printf("%s%c", lif_a.leda.ltpa.DroidBirth2.UUID, sep);
+  obuf_field(out, lif_a->leda.ltpa.DroidBirth1.ClockSeq, sep);
+  obuf_field(out, lif_a->leda.ltpa.DroidBirth1.Node, sep);
+  obuf_field(out, lif_a->leda.ltpa.DroidBirth2.UUID, sep);
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.ltpa.DroidBirth2.Version, sep);
-    printf("%s%c", lif_a.leda.ltpa.DroidBirth2.Variant, sep);
-    printf("%s%c", lif_a.leda.ltpa.DroidBirth2.Time_long, sep);
+    obuf_field(out, lif_a->leda.ltpa.DroidBirth2.Version, sep);
+    obuf_field(out, lif_a->leda.ltpa.DroidBirth2.Variant, sep);
+    obuf_field(out, lif_a->leda.ltpa.DroidBirth2.Time_long, sep);
   }
   else
   {
-    printf("%s%c", lif_a.leda.ltpa.DroidBirth2.Time, sep);
+    obuf_field(out, lif_a->leda.ltpa.DroidBirth2.Time, sep);
   }
-  printf("%s%c", lif_a.leda.ltpa.DroidBirth2.ClockSeq, sep);
-  printf("%s%c", lif_a.leda.ltpa.DroidBirth2.Node, sep);
+  obuf_field(out, lif_a->leda.ltpa.DroidBirth2.ClockSeq, sep);
+  obuf_field(out, lif_a->leda.ltpa.DroidBirth2.Node, sep);
   // S2.5.11 VistaAndAboveIDListDataBlock
   if (less == 0)
   {
-    printf("%s%c", lif_a.leda.lvidlpa.Posn, sep);
-    printf("%s%c", lif_a.leda.lvidlpa.Size, sep);
-    printf("%s%c", lif_a.leda.lvidlpa.sig, sep);
-    printf("%s%c", lif_a.leda.lvidlpa.NumItemIDs, sep);
+    obuf_field(out, lif_a->leda.lvidlpa.Posn, sep);
+    obuf_field(out, lif_a->leda.lvidlpa.Size, sep);
+    obuf_field(out, lif_a->leda.lvidlpa.sig, sep);
+    obuf_field(out, lif_a->leda.lvidlpa.NumItemIDs, sep);
   }
-  printf("\n");
+  obuf_chr(out, '\n');
 }
 
 //
-//Function: text_out(FILE * fp) processes the link file and outputs the text
-//          version of the decoded data.
-void text_out(FILE* fp, char* fname, int less, int itemid)
+//Function: text_out() takes the decoded link file and outputs the text
+//          version of the decoded data (lif_a is the ASCII version of lif)
+//          to out.
+void text_out(struct OBUF* out, struct LIF* lif, struct LIF_A* lif_a, struct stat* statbuf, int times, char* fname, int less, int itemid)
 {
-  struct LIF     lif;
-  struct LIF_A   lif_a;
-  struct stat    statbuf;
   char           buf[200];
   int            i, j, k, idpos = 0;
   struct LIF_PROPERTY_STORE_PROPS  psp;
   struct LIF_SER_PROPSTORE_A  psa;
 
-  // Get the stat info for the file itself
-  stat(fname, &statbuf);
-
-  if (get_lif(fp, statbuf.st_size, &lif) < 0)
-  {
-    fprintf(stderr, "Error processing file \'%s\' - sorry\n", fname);
-    return;
-  }
-  if (get_lif_a(&lif, &lif_a))
-  {
-    fprintf(stderr, "Could not make ASCII version of \'%s\' - sorry\n", fname);
-    return;
-  }
   //Print out the results
-  printf("\nLINK FILE -------------- %s\n", fname);
-  printf("{**OPERATING SYSTEM (stat) DATA**}\n");
+  obuf_cat(out, "\nLINK FILE -------------- ", fname, "\n", NULL);
+  obuf_str(out, "{**OPERATING SYSTEM (stat) DATA**}\n");
   //Print a record
   if (less == 0) //omit this stuff if short info required
   {
-    printf("  File Size:           %u bytes\n", (unsigned int)statbuf.st_size);
+    obuf_str(out, "  File Size:           ");
+    obuf_uint(out, (unsigned int)statbuf->st_size);
+    obuf_str(out, " bytes\n");
   }
-  strftime(buf, 29, "%Y-%m-%d %H:%M:%S (UTC)", gmtime(&statbuf.st_atime));
-  printf("  Last Accessed:       %s\n", buf);
-  strftime(buf, 29, "%Y-%m-%d %H:%M:%S (UTC)", gmtime(&statbuf.st_mtime));
-  printf("  Last Modified:       %s\n", buf);
-  strftime(buf, 29, "%Y-%m-%d %H:%M:%S (UTC)", gmtime(&statbuf.st_ctime));
-  printf("  Last Changed:        %s\n\n", buf);
+  stat_time(buf, &statbuf->st_atime, "%Y-%m-%d %H:%M:%S (UTC)", times);
+  obuf_cat(out, "  Last Accessed:       ", buf, "\n", NULL);
+  stat_time(buf, &statbuf->st_mtime, "%Y-%m-%d %H:%M:%S (UTC)", times);
+  obuf_cat(out, "  Last Modified:       ", buf, "\n", NULL);
+  stat_time(buf, &statbuf->st_ctime, "%Y-%m-%d %H:%M:%S (UTC)", times);
+  obuf_cat(out, "  Last Changed:        ", buf, "\n\n", NULL);
 
-  printf("{**LINK FILE EMBEDDED DATA**}\n");
-  printf("  {S_2.1 - ShellLinkHeader}\n");
+  obuf_str(out, "{**LINK FILE EMBEDDED DATA**}\n");
+  obuf_str(out, "  {S_2.1 - ShellLinkHeader}\n");
   if (less == 0)
   {
-    printf("    Header Size:         %s bytes\n", lif_a.lha.H_size);
-    printf("    Link File Class ID:  %s\n", lif_a.lha.CLSID);
-    printf("    Flags:               %s\n", lif_a.lha.Flags);
+    obuf_cat(out, "    Header Size:         ", lif_a->lha.H_size, " bytes\n", NULL);
+    obuf_cat(out, "    Link File Class ID:  ", lif_a->lha.CLSID, "\n", NULL);
+    obuf_cat(out, "    Flags:               ", lif_a->lha.Flags, "\n", NULL);
   }
-  printf("    Attributes:          %s\n", lif_a.lha.Attr);
+  obuf_cat(out, "    Attributes:          ", lif_a->lha.Attr, "\n", NULL);
   if (less == 0)
   {
-    printf("    Creation Time:       %s\n", lif_a.lha.CrDate_long);
-    printf("    Access Time:         %s\n", lif_a.lha.AcDate_long);
-    printf("    Write Time:          %s\n", lif_a.lha.WtDate_long);
+    obuf_cat(out, "    Creation Time:       ", lif_a->lha.CrDate_long, "\n", NULL);
+    obuf_cat(out, "    Access Time:         ", lif_a->lha.AcDate_long, "\n", NULL);
+    obuf_cat(out, "    Write Time:          ", lif_a->lha.WtDate_long, "\n", NULL);
   }
   else
   {
-    printf("    Creation Time:       %s\n", lif_a.lha.CrDate);
-    printf("    Access Time:         %s\n", lif_a.lha.AcDate);
-    printf("    Write Time:          %s\n", lif_a.lha.WtDate);
+    obuf_cat(out, "    Creation Time:       ", lif_a->lha.CrDate, "\n", NULL);
+    obuf_cat(out, "    Access Time:         ", lif_a->lha.AcDate, "\n", NULL);
+    obuf_cat(out, "    Write Time:          ", lif_a->lha.WtDate, "\n", NULL);
   }
-  printf("    Target Size:         %s bytes\n", lif_a.lha.Size);
+  obuf_cat(out, "    Target Size:         ", lif_a->lha.Size, " bytes\n", NULL);
   if (less == 0) //omit this stuff if short info required
   {
-    printf("    Icon Index:          %s\n", lif_a.lha.IconIndex);
-    printf("    Window State:        %s\n", lif_a.lha.ShowState);
-    printf("    Hot Keys:            %s\n", lif_a.lha.Hotkey);
-    printf("    Reserved1:           %s\n", lif_a.lha.Reserved1);
-    printf("    Reserved2:           %s\n", lif_a.lha.Reserved2);
-    printf("    Reserved3:           %s\n", lif_a.lha.Reserved3);
+    obuf_cat(out, "    Icon Index:          ", lif_a->lha.IconIndex, "\n", NULL);
+    obuf_cat(out, "    Window State:        ", lif_a->lha.ShowState, "\n", NULL);
+    obuf_cat(out, "    Hot Keys:            ", lif_a->lha.Hotkey, "\n", NULL);
+    obuf_cat(out, "    Reserved1:           ", lif_a->lha.Reserved1, "\n", NULL);
+    obuf_cat(out, "    Reserved2:           ", lif_a->lha.Reserved2, "\n", NULL);
+    obuf_cat(out, "    Reserved3:           ", lif_a->lha.Reserved3, "\n", NULL);
   }
-  if (lif.lh.Flags & 0x00000001) //If there is an ItemIDList
+  if (lif->lh.Flags & 0x00000001) //If there is an ItemIDList
   {
     if (less == 0)
     {
-      printf("  {S_2.2 - LinkTargetIDList}\n");
-      printf("    Size:                %u bytes\n",
-        lif.lidl.IDListSize + 2);
+      obuf_str(out, "  {S_2.2 - LinkTargetIDList}\n");
+      obuf_str(out, "    Size:                ");
+      obuf_uint(out, lif->lidl.IDListSize + 2);
+      obuf_str(out, " bytes\n");
       if (itemid > 0) // If the '-i' option is switched on
       {
-        idpos = lif.lh.H_size;
-        printf("    IDList Size:         %s bytes\n",
-          lif_a.lidla.IDListSize);
-        printf("    Number of ItemIDs    %s\n", lif_a.lidla.NumItemIDs);
-        for (i = 0; i < lif.lidl.NumItemIDs; i++)
+        idpos = lif->lh.H_size;
+        obuf_cat(out, "    IDList Size:         ", lif_a->lidla.IDListSize, " bytes\n", NULL);
+        obuf_cat(out, "    Number of ItemIDs    ", lif_a->lidla.NumItemIDs, "\n", NULL);
+        for (i = 0; i < lif->lidl.NumItemIDs; i++)
         {
-          printf("    {ItemID %i}\n", i + 1);
-          printf("      ItemID  Size:      %s bytes\n", lif_a.lidla.Items[i].ItemIDSize);
-          if (find_propstores((unsigned char*)&lif.lidl.Items[i].Data, lif.lidl.Items[i].ItemIDSize, idpos, &psp) == 0)
+          obuf_str(out, "    {ItemID ");
+          obuf_uint(out, i + 1);
+          obuf_str(out, "}\n");
+          obuf_cat(out, "      ItemID  Size:      ", lif_a->lidla.Items[i].ItemIDSize, " bytes\n", NULL);
+          if (find_propstores((unsigned char*)&lif->lidl.Items[i].Data, (lif->lidl.Items[i].ItemIDSize < MAXITEMIDSIZE) ? lif->lidl.Items[i].ItemIDSize : MAXITEMIDSIZE, idpos, &psp) == 0)
           {
             // If PropStoreProps exist:
-            printf("      [Property Stores found within this ItemID]\n");
-            printf("      Propstores Size:   %u bytes\n", psp.Size);
-            printf("      File Offset:       %u bytes\n", psp.Posn);
-            printf("      No of Prop Stores: %u\n", psp.NumStores);
+            obuf_str(out, "      [Property Stores found within this ItemID]\n");
+            obuf_str(out, "      Propstores Size:   ");
+            obuf_uint(out, psp.Size);
+            obuf_str(out, " bytes\n");
+            obuf_str(out, "      File Offset:       ");
+            obuf_uint(out, psp.Posn);
+            obuf_str(out, " bytes\n");
+            obuf_str(out, "      No of Prop Stores: ");
+            obuf_uint(out, psp.NumStores);
+            obuf_chr(out, '\n');
             for (j = 0; j < psp.NumStores; j++)
             {
               if (get_propstore_a(&psp.Stores[j], &psa) == 0)
               {
-                printf("      {ItemID %u Property Store %u}\n", i + 1, j + 1);
-                printf("        Store Size:      %s bytes\n", psa.StorageSize);
-                printf("        Version:         %s\n", psa.Version);
-                printf("        Format ID:       %s\n", psa.FormatID.UUID);
-                printf("        Name Type:       %s\n", psa.NameType);
-                printf("        No of Values:    %s\n", psa.NumValues);
+                obuf_str(out, "      {ItemID ");
+                obuf_uint(out, i + 1);
+                obuf_str(out, " Property Store ");
+                obuf_uint(out, j + 1);
+                obuf_str(out, "}\n");
+                obuf_cat(out, "        Store Size:      ", psa.StorageSize, " bytes\n", NULL);
+                obuf_cat(out, "        Version:         ", psa.Version, "\n", NULL);
+                obuf_cat(out, "        Format ID:       ", psa.FormatID.UUID, "\n", NULL);
+                obuf_cat(out, "        Name Type:       ", psa.NameType, "\n", NULL);
+                obuf_cat(out, "        No of Values:    ", psa.NumValues, "\n", NULL);
                 for (k = 0; k < psp.Stores[j].NumValues; k++)
                 {
-                  printf("        {Item ID %u Property Store %u Property Value %u}\n", i + 1, j + 1, k + 1);
-                  printf("          Value Size:    %s bytes\n", psa.PropValues[k].ValueSize);
+                  obuf_str(out, "        {Item ID ");
+                  obuf_uint(out, i + 1);
+                  obuf_str(out, " Property Store ");
+                  obuf_uint(out, j + 1);
+                  obuf_str(out, " Property Value ");
+                  obuf_uint(out, k + 1);
+                  obuf_str(out, "}\n");
+                  obuf_cat(out, "          Value Size:    ", psa.PropValues[k].ValueSize, " bytes\n", NULL);
                   if (psp.Stores[j].PropValues[k].ValueSize > 0)
                   {
                     if (psp.Stores[j].NameType == 0)
                     {
-                      printf("          Name Size:     %s bytes\n", psa.PropValues[k].NameSizeOrID);
-                      printf("          Name:          %s\n", psa.PropValues[k].Name);
+                      obuf_cat(out, "          Name Size:     ", psa.PropValues[k].NameSizeOrID, " bytes\n", NULL);
+                      obuf_cat(out, "          Name:          ", psa.PropValues[k].Name, "\n", NULL);
                     }
                     else
                     {
-                      printf("          ID:            %s\n", psa.PropValues[k].NameSizeOrID);
+                      obuf_cat(out, "          ID:            ", psa.PropValues[k].NameSizeOrID, "\n", NULL);
                     }
-                    printf("          Property Type: %s\n", psa.PropValues[k].PropertyType);
-                    printf("          Value:         %s\n", psa.PropValues[k].Value);
+                    obuf_cat(out, "          Property Type: ", psa.PropValues[k].PropertyType, "\n", NULL);
+                    obuf_cat(out, "          Value:         ", psa.PropValues[k].Value, "\n", NULL);
 
                   }
                 }
               }
               else
               {
-                printf("        [Unable to interpret Property Store %u]\n", j);
+                obuf_str(out, "        [Unable to interpret Property Store ");
+                obuf_uint(out, j);
+                obuf_str(out, "]\n");
               }
             }
-            idpos += lif.lidl.Items[i].ItemIDSize; // point idpos at the start of the next ItemID
+            idpos += lif->lidl.Items[i].ItemIDSize; // point idpos at the start of the next ItemID
           }
           else
           {
-            printf("      [No Property Stores found in this ITemID. Here is the raw data:]\n");
-            bin2hex((unsigned char*)&lif.lidl.Items[i].Data, lif.lidl.Items[i].ItemIDSize, 1, 16, 6, 1, 1);
+            obuf_str(out, "      [No Property Stores found in this ITemID. Here is the raw data:]\n");
+            wbin2hex(hex_put, out, (unsigned char*)&lif->lidl.Items[i].Data, (lif->lidl.Items[i].ItemIDSize < MAXITEMIDSIZE) ? lif->lidl.Items[i].ItemIDSize : MAXITEMIDSIZE, 1, 16, 6, 1, 1);
           }
         }
-        printf("    IDList Terminator    2 bytes\n");
+        obuf_str(out, "    IDList Terminator    2 bytes\n");
       }
       else
       {
-        printf("    (Use the '-i' option to see the contents)\n");
+        obuf_str(out, "    (Use the '-i' option to see the contents)\n");
       }
     }
   }
-  if (lif.lh.Flags & 0x00000002) //If there is a LinkInfo
+  if (lif->lh.Flags & 0x00000002) //If there is a LinkInfo
   {
-    printf("  {S_2.3 - LinkInfo}\n");
+    obuf_str(out, "  {S_2.3 - LinkInfo}\n");
     if (less == 0)
     {
-      printf("    Total Size:          %s bytes\n", lif_a.lia.Size);
-      printf("    Header Size:         %s bytes\n", lif_a.lia.HeaderSize);
-      printf("    Flags:               %s\n", lif_a.lia.Flags);
-      printf("    Volume ID Offset:    %s\n", lif_a.lia.IDOffset);
-      printf("    Base Path Offset:    %s\n", lif_a.lia.LBPOffset);
-      printf("    CNR Link Offset:     %s\n", lif_a.lia.CNRLOffset);
-      printf("    CPS Offset:          %s\n", lif_a.lia.CPSOffset);
-      printf("    LBP Offset Unicode:  %s\n", lif_a.lia.LBPOffsetU);
-      printf("    CPS Offset Unicode:  %s\n", lif_a.lia.CPSOffsetU);
+      obuf_cat(out, "    Total Size:          ", lif_a->lia.Size, " bytes\n", NULL);
+      obuf_cat(out, "    Header Size:         ", lif_a->lia.HeaderSize, " bytes\n", NULL);
+      obuf_cat(out, "    Flags:               ", lif_a->lia.Flags, "\n", NULL);
+      obuf_cat(out, "    Volume ID Offset:    ", lif_a->lia.IDOffset, "\n", NULL);
+      obuf_cat(out, "    Base Path Offset:    ", lif_a->lia.LBPOffset, "\n", NULL);
+      obuf_cat(out, "    CNR Link Offset:     ", lif_a->lia.CNRLOffset, "\n", NULL);
+      obuf_cat(out, "    CPS Offset:          ", lif_a->lia.CPSOffset, "\n", NULL);
+      obuf_cat(out, "    LBP Offset Unicode:  ", lif_a->lia.LBPOffsetU, "\n", NULL);
+      obuf_cat(out, "    CPS Offset Unicode:  ", lif_a->lia.CPSOffsetU, "\n", NULL);
     }
     //There is a Volume ID structure (& LBP)
-    if (lif.li.Flags & 0x00000001)
+    if (lif->li.Flags & 0x00000001)
     {
-      printf("    {S_2.3.1 - LinkInfo - VolumeID}\n");
+      obuf_str(out, "    {S_2.3.1 - LinkInfo - VolumeID}\n");
       if (less == 0)
       {
-        printf("      Vol ID Size:       %s bytes\n", lif_a.lia.VolID.Size);
+        obuf_cat(out, "      Vol ID Size:       ", lif_a->lia.VolID.Size, " bytes\n", NULL);
       }
-      printf("      Drive Type:        %s\n", lif_a.lia.VolID.DriveType);
-      printf("      Drive Serial No:   %s\n", lif_a.lia.VolID.DriveSN);
+      obuf_cat(out, "      Drive Type:        ", lif_a->lia.VolID.DriveType, "\n", NULL);
+      obuf_cat(out, "      Drive Serial No:   ", lif_a->lia.VolID.DriveSN, "\n", NULL);
       if (less == 0)
       {
-        if (!(lif.li.HeaderSize >= 0x00000024))//Which to use?
+        if (!(lif->li.HeaderSize >= 0x00000024))//Which to use?
           //ANSI or Unicode versions
         {
-          printf("      Vol Label Offset:  %s\n", lif_a.lia.VolID.VLOffset);
+          obuf_cat(out, "      Vol Label Offset:  ", lif_a->lia.VolID.VLOffset, "\n", NULL);
         }
         else
         {
-          printf("      Vol Label OffsetU: %s\n", lif_a.lia.VolID.VLOffsetU);
+          obuf_cat(out, "      Vol Label OffsetU: ", lif_a->lia.VolID.VLOffsetU, "\n", NULL);
         }
       }
-      if (!(lif.li.HeaderSize >= 0x00000024))
+      if (!(lif->li.HeaderSize >= 0x00000024))
       {
-        printf("      Volume Label:      %s\n", lif_a.lia.VolID.VolumeLabel);
+        obuf_cat(out, "      Volume Label:      ", lif_a->lia.VolID.VolumeLabel, "\n", NULL);
       }
       else
       {
-        printf("      Volume LabelU:     %s\n", lif_a.lia.VolID.VolumeLabelU);
+        obuf_cat(out, "      Volume LabelU:     ", lif_a->lia.VolID.VolumeLabelU, "\n", NULL);
       }
-      printf("      Local Base Path:   %s\n", lif_a.lia.LBP);
+      obuf_cat(out, "      Local Base Path:   ", lif_a->lia.LBP, "\n", NULL);
     }//End of VolumeID
   //CommonNetworkRelativeLink
-    if (lif.li.Flags & 0x00000002)
+    if (lif->li.Flags & 0x00000002)
     {
-      printf("    {S_2.3.2 - LinkInfo - CommonNetworkRelativeLink}\n");
+      obuf_str(out, "    {S_2.3.2 - LinkInfo - CommonNetworkRelativeLink}\n");
       if (less == 0)
       {
-        printf("      CNR Size:          %s\n", lif_a.lia.CNR.Size);
-        printf("      Flags:             %s\n", lif_a.lia.CNR.Flags);
-        printf("      Net Name Offset:   %s\n", lif_a.lia.CNR.NetNameOffset);
-        printf("      Device Name Off:   %s\n", lif_a.lia.CNR.DeviceNameOffset);
+        obuf_cat(out, "      CNR Size:          ", lif_a->lia.CNR.Size, "\n", NULL);
+        obuf_cat(out, "      Flags:             ", lif_a->lia.CNR.Flags, "\n", NULL);
+        obuf_cat(out, "      Net Name Offset:   ", lif_a->lia.CNR.NetNameOffset, "\n", NULL);
+        obuf_cat(out, "      Device Name Off:   ", lif_a->lia.CNR.DeviceNameOffset, "\n", NULL);
       }
-      printf("      Net Provider Type: %s\n", lif_a.lia.CNR.NetworkProviderType);
-      if ((less == 0) && (lif.li.CNR.NetNameOffset > 0x00000014))
+      obuf_cat(out, "      Net Provider Type: ", lif_a->lia.CNR.NetworkProviderType, "\n", NULL);
+      if ((less == 0) && (lif->li.CNR.NetNameOffset > 0x00000014))
       {
-        printf("      Net Name Offset U: %s\n", lif_a.lia.CNR.NetNameOffsetU);
-        printf("      Device Name Off U: %s\n", lif_a.lia.CNR.DeviceNameOffsetU);
+        obuf_cat(out, "      Net Name Offset U: ", lif_a->lia.CNR.NetNameOffsetU, "\n", NULL);
+        obuf_cat(out, "      Device Name Off U: ", lif_a->lia.CNR.DeviceNameOffsetU, "\n", NULL);
       }
-      printf("      Net Name:          %s\n", lif_a.lia.CNR.NetName);
-      printf("      Device Name:       %s\n", lif_a.lia.CNR.DeviceName);
-      if (lif.li.CNR.NetNameOffset > 0x00000014)
+      obuf_cat(out, "      Net Name:          ", lif_a->lia.CNR.NetName, "\n", NULL);
+      obuf_cat(out, "      Device Name:       ", lif_a->lia.CNR.DeviceName, "\n", NULL);
+      if (lif->li.CNR.NetNameOffset > 0x00000014)
       {
-        printf("      Net Name Unicode:  %s\n", lif_a.lia.CNR.NetNameU);
-        printf("      Device Name Uni:   %s\n", lif_a.lia.CNR.DeviceNameU);
+        obuf_cat(out, "      Net Name Unicode:  ", lif_a->lia.CNR.NetNameU, "\n", NULL);
+        obuf_cat(out, "      Device Name Uni:   ", lif_a->lia.CNR.DeviceNameU, "\n", NULL);
       }
-      printf("    Common Path Suffix:  %s\n", lif_a.lia.CPS);
+      obuf_cat(out, "    Common Path Suffix:  ", lif_a->lia.CPS, "\n", NULL);
     }//End of CNR
-    if (lif.li.LBPOffsetU > 0)
+    if (lif->li.LBPOffsetU > 0)
     {
-      printf("    Local Base Path Uni: %s\n", lif_a.lia.LBPU);
+      obuf_cat(out, "    Local Base Path Uni: ", lif_a->lia.LBPU, "\n", NULL);
     }
-    if (lif.li.CPSOffsetU > 0)
+    if (lif->li.CPSOffsetU > 0)
     {
-      printf("    Common Path Sfx Uni: %s\n", lif_a.lia.CPSU);
+      obuf_cat(out, "    Common Path Sfx Uni: ", lif_a->lia.CPSU, "\n", NULL);
     }
   }//End of Link Info
 //STRINGDATA
-  if (lif.lh.Flags & 0x0000007C)
+  if (lif->lh.Flags & 0x0000007C)
   {
-    printf("  {S_2.4 - StringData}\n");
+    obuf_str(out, "  {S_2.4 - StringData}\n");
     if (less == 0)
     {
-      printf("    StringData Size:     %s bytes\n", lif_a.lsda.Size);
+      obuf_cat(out, "    StringData Size:     ", lif_a->lsda.Size, " bytes\n", NULL);
     }
-    if (lif.lh.Flags & 0x00000004)
+    if (lif->lh.Flags & 0x00000004)
     {
-      printf("    {S_2.4 - StringData - NAME_STRING}\n");
+      obuf_str(out, "    {S_2.4 - StringData - NAME_STRING}\n");
       if (less == 0)
       {
-        printf("      CountCharacters:   %s characters\n",
-          lif_a.lsda.CountChars[0]);
+        obuf_cat(out, "      CountCharacters:   ", lif_a->lsda.CountChars[0], " characters\n", NULL);
       }
-      printf("      Name String:       %s\n", lif_a.lsda.Data[0]);
+      obuf_cat(out, "      Name String:       ", lif_a->lsda.Data[0], "\n", NULL);
     }
-    if (lif.lh.Flags & 0x00000008)
+    if (lif->lh.Flags & 0x00000008)
     {
-      printf("    {S_2.4 - StringData - RELATIVE_PATH}\n");
+      obuf_str(out, "    {S_2.4 - StringData - RELATIVE_PATH}\n");
       if (less == 0)
       {
-        printf("      CountCharacters:   %s characters\n",
-          lif_a.lsda.CountChars[1]);
+        obuf_cat(out, "      CountCharacters:   ", lif_a->lsda.CountChars[1], " characters\n", NULL);
       }
-      printf("      Relative Path:     %s\n", lif_a.lsda.Data[1]);
+      obuf_cat(out, "      Relative Path:     ", lif_a->lsda.Data[1], "\n", NULL);
     }
-    if (lif.lh.Flags & 0x00000010)
+    if (lif->lh.Flags & 0x00000010)
     {
-      printf("    {S_2.4 - StringData - WORKING_DIR}\n");
+      obuf_str(out, "    {S_2.4 - StringData - WORKING_DIR}\n");
       if (less == 0)
       {
-        printf("      CountCharacters:   %s characters\n",
-          lif_a.lsda.CountChars[2]);
+        obuf_cat(out, "      CountCharacters:   ", lif_a->lsda.CountChars[2], " characters\n", NULL);
       }
-      printf("      Working Dir:       %s\n", lif_a.lsda.Data[2]);
+      obuf_cat(out, "      Working Dir:       ", lif_a->lsda.Data[2], "\n", NULL);
     }
-    if (lif.lh.Flags & 0x00000020)
+    if (lif->lh.Flags & 0x00000020)
     {
-      printf("    {S_2.4 - StringData - COMMAND_LINE_ARGUMENTS}\n");
+      obuf_str(out, "    {S_2.4 - StringData - COMMAND_LINE_ARGUMENTS}\n");
       if (less == 0)
       {
-        printf("      CountCharacters:   %s characters\n",
-          lif_a.lsda.CountChars[3]);
+        obuf_cat(out, "      CountCharacters:   ", lif_a->lsda.CountChars[3], " characters\n", NULL);
       }
-      printf("      Cmd Line Args:     %s\n", lif_a.lsda.Data[3]);
+      obuf_cat(out, "      Cmd Line Args:     ", lif_a->lsda.Data[3], "\n", NULL);
     }
-    if (lif.lh.Flags & 0x00000040)
+    if (lif->lh.Flags & 0x00000040)
     {
-      printf("    {S_2.4 - StringData - ICON_LOCATION}\n");
+      obuf_str(out, "    {S_2.4 - StringData - ICON_LOCATION}\n");
       if (less == 0)
       {
-        printf("      CountCharacters:   %s characters\n",
-          lif_a.lsda.CountChars[4]);
+        obuf_cat(out, "      CountCharacters:   ", lif_a->lsda.CountChars[4], " characters\n", NULL);
       }
-      printf("      Icon Location:     %s\n", lif_a.lsda.Data[4]);
+      obuf_cat(out, "      Icon Location:     ", lif_a->lsda.Data[4], "\n", NULL);
     }
 
   }// End of STRINGDATA
 
 //EXTRADATA
-  printf("  {S_2.5 - ExtraData}\n");
+  obuf_str(out, "  {S_2.5 - ExtraData}\n");
   if (less == 0)
   {
-    printf("    Extra Data Size:     %s bytes\n", lif_a.leda.Size);
-    printf("    ED Structures:       %s\n", lif_a.leda.edtypes);
+    obuf_cat(out, "    Extra Data Size:     ", lif_a->leda.Size, " bytes\n", NULL);
+    obuf_cat(out, "    ED Structures:       ", lif_a->leda.edtypes, "\n", NULL);
   }
-  if (lif.led.edtypes & CONSOLE_PROPS)
+  if (lif->led.edtypes & CONSOLE_PROPS)
   {
     // Even if we are printing the shortened version we show that there is a 
     // ConsoleDataBlock structure present.
-    printf("    {S_2.5.1 - ExtraData - ConsoleDataBlock}\n");
+    obuf_str(out, "    {S_2.5.1 - ExtraData - ConsoleDataBlock}\n");
     if (less == 0)
     {
-      printf("      File Offset:       %s bytes\n", lif_a.leda.lcpa.Posn);
-      printf("      BlockSize:         %s bytes\n", lif_a.leda.lcpa.Size);
-      printf("      BlockSignature:    %s\n", lif_a.leda.lcpa.sig);
+      obuf_cat(out, "      File Offset:       ", lif_a->leda.lcpa.Posn, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSize:         ", lif_a->leda.lcpa.Size, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSignature:    ", lif_a->leda.lcpa.sig, "\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.FillAttributes & 0x0001) strncat(buf, "FOREGROUND_BLUE | ", 18);
-      if (lif.led.lcp.FillAttributes & 0x0002) strncat(buf, "FOREGROUND_GREEN | ", 19);
-      if (lif.led.lcp.FillAttributes & 0x0004) strncat(buf, "FOREGROUND_RED | ", 17);
-      if (lif.led.lcp.FillAttributes & 0x0008) strncat(buf, "FOREGROUND_INTENSITY | ", 23);
-      if (lif.led.lcp.FillAttributes & 0x0010) strncat(buf, "BACKGROUND_BLUE | ", 18);
-      if (lif.led.lcp.FillAttributes & 0x0020) strncat(buf, "BACKGROUND_GREEN | ", 19);
-      if (lif.led.lcp.FillAttributes & 0x0040) strncat(buf, "BACKGROUND_RED | ", 17);
-      if (lif.led.lcp.FillAttributes & 0x0080) strncat(buf, "BACKGROUND_INTENSITY | ", 23);
+      if (lif->led.lcp.FillAttributes & 0x0001) strncat(buf, "FOREGROUND_BLUE | ", 18);
+      if (lif->led.lcp.FillAttributes & 0x0002) strncat(buf, "FOREGROUND_GREEN | ", 19);
+      if (lif->led.lcp.FillAttributes & 0x0004) strncat(buf, "FOREGROUND_RED | ", 17);
+      if (lif->led.lcp.FillAttributes & 0x0008) strncat(buf, "FOREGROUND_INTENSITY | ", 23);
+      if (lif->led.lcp.FillAttributes & 0x0010) strncat(buf, "BACKGROUND_BLUE | ", 18);
+      if (lif->led.lcp.FillAttributes & 0x0020) strncat(buf, "BACKGROUND_GREEN | ", 19);
+      if (lif->led.lcp.FillAttributes & 0x0040) strncat(buf, "BACKGROUND_RED | ", 17);
+      if (lif->led.lcp.FillAttributes & 0x0080) strncat(buf, "BACKGROUND_INTENSITY | ", 23);
       i = strlen(buf);
       if (i > 2)
       {
@@ -1002,16 +1119,16 @@ void text_out(FILE* fp, char* fname, int less, int itemid)
       {
         snprintf(buf, 300, "No FillAttributes");
       }
-      printf("      FillAttributes:    %s   %s\n", lif_a.leda.lcpa.FillAttributes, buf);
+      obuf_cat(out, "      FillAttributes:    ", lif_a->leda.lcpa.FillAttributes, "   ", buf, "\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.PopupFillAttributes & 0x0001) strncat(buf, "FOREGROUND_BLUE | ", 18);
-      if (lif.led.lcp.PopupFillAttributes & 0x0002) strncat(buf, "FOREGROUND_GREEN | ", 19);
-      if (lif.led.lcp.PopupFillAttributes & 0x0004) strncat(buf, "FOREGROUND_RED | ", 17);
-      if (lif.led.lcp.PopupFillAttributes & 0x0008) strncat(buf, "FOREGROUND_INTENSITY | ", 23);
-      if (lif.led.lcp.PopupFillAttributes & 0x0010) strncat(buf, "BACKGROUND_BLUE | ", 18);
-      if (lif.led.lcp.PopupFillAttributes & 0x0020) strncat(buf, "BACKGROUND_GREEN | ", 19);
-      if (lif.led.lcp.PopupFillAttributes & 0x0040) strncat(buf, "BACKGROUND_RED | ", 17);
-      if (lif.led.lcp.PopupFillAttributes & 0x0080) strncat(buf, "BACKGROUND_INTENSITY | ", 23);
+      if (lif->led.lcp.PopupFillAttributes & 0x0001) strncat(buf, "FOREGROUND_BLUE | ", 18);
+      if (lif->led.lcp.PopupFillAttributes & 0x0002) strncat(buf, "FOREGROUND_GREEN | ", 19);
+      if (lif->led.lcp.PopupFillAttributes & 0x0004) strncat(buf, "FOREGROUND_RED | ", 17);
+      if (lif->led.lcp.PopupFillAttributes & 0x0008) strncat(buf, "FOREGROUND_INTENSITY | ", 23);
+      if (lif->led.lcp.PopupFillAttributes & 0x0010) strncat(buf, "BACKGROUND_BLUE | ", 18);
+      if (lif->led.lcp.PopupFillAttributes & 0x0020) strncat(buf, "BACKGROUND_GREEN | ", 19);
+      if (lif->led.lcp.PopupFillAttributes & 0x0040) strncat(buf, "BACKGROUND_RED | ", 17);
+      if (lif->led.lcp.PopupFillAttributes & 0x0080) strncat(buf, "BACKGROUND_INTENSITY | ", 23);
       i = strlen(buf);
       if (i > 2)
       {
@@ -1021,21 +1138,21 @@ void text_out(FILE* fp, char* fname, int less, int itemid)
       {
         snprintf(buf, 300, "No PopupFillAttributes");
       }
-      printf("      PopupFillAttr:     %s   %s\n", lif_a.leda.lcpa.PopupFillAttributes, buf);
-      printf("      ScreenBufSizeX:    %s\n", lif_a.leda.lcpa.ScreenBufferSizeX);
-      printf("      ScreenBufSizeY:    %s\n", lif_a.leda.lcpa.ScreenBufferSizeY);
-      printf("      WindowSizeX:       %s\n", lif_a.leda.lcpa.WindowSizeX);
-      printf("      WindowSizeY:       %s\n", lif_a.leda.lcpa.WindowSizeY);
-      printf("      WindowOriginX:     %s\n", lif_a.leda.lcpa.WindowOriginX);
-      printf("      WindowOriginY:     %s\n", lif_a.leda.lcpa.WindowOriginY);
-      printf("      Unused1:           %s\n", lif_a.leda.lcpa.Unused1);
-      printf("      Unused2:           %s\n", lif_a.leda.lcpa.Unused2);
-      printf("      {FontSize}\n");
-      printf("        FontHeight:      %s\n", lif_a.leda.lcpa.FontHeight);
-      printf("        FontWidth:       %s\n", lif_a.leda.lcpa.FontWidth);
-      printf("      {FontFamily}\n");
+      obuf_cat(out, "      PopupFillAttr:     ", lif_a->leda.lcpa.PopupFillAttributes, "   ", buf, "\n", NULL);
+      obuf_cat(out, "      ScreenBufSizeX:    ", lif_a->leda.lcpa.ScreenBufferSizeX, "\n", NULL);
+      obuf_cat(out, "      ScreenBufSizeY:    ", lif_a->leda.lcpa.ScreenBufferSizeY, "\n", NULL);
+      obuf_cat(out, "      WindowSizeX:       ", lif_a->leda.lcpa.WindowSizeX, "\n", NULL);
+      obuf_cat(out, "      WindowSizeY:       ", lif_a->leda.lcpa.WindowSizeY, "\n", NULL);
+      obuf_cat(out, "      WindowOriginX:     ", lif_a->leda.lcpa.WindowOriginX, "\n", NULL);
+      obuf_cat(out, "      WindowOriginY:     ", lif_a->leda.lcpa.WindowOriginY, "\n", NULL);
+      obuf_cat(out, "      Unused1:           ", lif_a->leda.lcpa.Unused1, "\n", NULL);
+      obuf_cat(out, "      Unused2:           ", lif_a->leda.lcpa.Unused2, "\n", NULL);
+      obuf_str(out, "      {FontSize}\n");
+      obuf_cat(out, "        FontHeight:      ", lif_a->leda.lcpa.FontHeight, "\n", NULL);
+      obuf_cat(out, "        FontWidth:       ", lif_a->leda.lcpa.FontWidth, "\n", NULL);
+      obuf_str(out, "      {FontFamily}\n");
       buf[0] = (char)0;
-      switch (lif.led.lcp.FontFamily_Family)
+      switch (lif->led.lcp.FontFamily_Family)
       {
       case 0x00000000:
         strncat(buf, "FF_DONTCARE", 11);
@@ -1058,19 +1175,19 @@ void text_out(FILE* fp, char* fname, int less, int itemid)
       default:
         strncat(buf, "UNKNOWN (Not allowed in specification) | ", 39);
       }
-      printf("        Family:          %s   %s\n", lif_a.leda.lcpa.FontFamily, buf);
+      obuf_cat(out, "        Family:          ", lif_a->leda.lcpa.FontFamily, "   ", buf, "\n", NULL);
 
       buf[0] = (char)0;
-      if (lif.led.lcp.FontFamily_Pitch == 0x0000) strncat(buf, "TMPF_NONE | ", 12);
+      if (lif->led.lcp.FontFamily_Pitch == 0x0000) strncat(buf, "TMPF_NONE | ", 12);
       else 
       {
-        if (lif.led.lcp.FontFamily_Pitch & 0x0001)
+        if (lif->led.lcp.FontFamily_Pitch & 0x0001)
           strncat(buf, "TMPF_FIXED_PITCH | ", 19);
-        if (lif.led.lcp.FontFamily_Pitch & 0x0002) 
+        if (lif->led.lcp.FontFamily_Pitch & 0x0002) 
           strncat(buf, "TMPF_VECTOR | ", 14);
-        if (lif.led.lcp.FontFamily_Pitch & 0x0004) 
+        if (lif->led.lcp.FontFamily_Pitch & 0x0004) 
           strncat(buf, "TMPF_TRUETYPE | ", 16);
-        if (lif.led.lcp.FontFamily_Pitch & 0x008) 
+        if (lif->led.lcp.FontFamily_Pitch & 0x008) 
           strncat(buf, "TMPF_DEVICE | ", 14);
       }
       i = strlen(buf);
@@ -1082,10 +1199,10 @@ void text_out(FILE* fp, char* fname, int less, int itemid)
       {
         snprintf(buf, 300, "Unknown");
       }
-      printf("        Pitch:           %s   %s\n", lif_a.leda.lcpa.FontPitch, buf);
+      obuf_cat(out, "        Pitch:           ", lif_a->leda.lcpa.FontPitch, "   ", buf, "\n", NULL);
 
       buf[0] = (char)0;
-      if (lif.led.lcp.FontWeight < 700)
+      if (lif->led.lcp.FontWeight < 700)
       {
         strncat(buf, "A regular-weight font", 21);
       }
@@ -1093,18 +1210,18 @@ void text_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "A bold font", 11);
       }
-      printf("      FontWeight:        %s   %s\n", lif_a.leda.lcpa.FontWeight, buf);
-      printf("      FaceName:          %s\n", lif_a.leda.lcpa.FaceName);
+      obuf_cat(out, "      FontWeight:        ", lif_a->leda.lcpa.FontWeight, "   ", buf, "\n", NULL);
+      obuf_cat(out, "      FaceName:          ", lif_a->leda.lcpa.FaceName, "\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.CursorSize <= 25)
+      if (lif->led.lcp.CursorSize <= 25)
       {
         strncat(buf, "A small cursor", 14);
       }
-      else if ((lif.led.lcp.CursorSize > 25) & (lif.led.lcp.CursorSize <= 50))
+      else if ((lif->led.lcp.CursorSize > 25) & (lif->led.lcp.CursorSize <= 50))
       {
         strncat(buf, "A medium cursor", 15);
       }
-      else if ((lif.led.lcp.CursorSize > 50) & (lif.led.lcp.CursorSize <= 100))
+      else if ((lif->led.lcp.CursorSize > 50) & (lif->led.lcp.CursorSize <= 100))
       {
         strncat(buf, "A large cursor", 14);
       }
@@ -1112,9 +1229,9 @@ void text_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "An undefined cursor size", 25);
       }
-      printf("      CursorSize:        %s   %s\n", lif_a.leda.lcpa.CursorSize, buf);
+      obuf_cat(out, "      CursorSize:        ", lif_a->leda.lcpa.CursorSize, "   ", buf, "\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.FullScreen == 0)
+      if (lif->led.lcp.FullScreen == 0)
       {
         strncat(buf, "Off", 3);
       }
@@ -1122,9 +1239,9 @@ void text_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "On", 2);
       }
-      printf("      FullScreen:        %s   %s\n", lif_a.leda.lcpa.FullScreen, buf);
+      obuf_cat(out, "      FullScreen:        ", lif_a->leda.lcpa.FullScreen, "   ", buf, "\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.QuickEdit == 0)
+      if (lif->led.lcp.QuickEdit == 0)
       {
         strncat(buf, "Off", 3);
       }
@@ -1132,9 +1249,9 @@ void text_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "On", 2);
       }
-      printf("      QuickEdit:         %s   %s\n", lif_a.leda.lcpa.QuickEdit, buf);
+      obuf_cat(out, "      QuickEdit:         ", lif_a->leda.lcpa.QuickEdit, "   ", buf, "\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.InsertMode == 0)
+      if (lif->led.lcp.InsertMode == 0)
       {
         strncat(buf, "Disabled", 8);
       }
@@ -1142,9 +1259,9 @@ void text_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "Enabled", 7);
       }
-      printf("      InsertMode:        %s   %s\n", lif_a.leda.lcpa.InsertMode, buf);
+      obuf_cat(out, "      InsertMode:        ", lif_a->leda.lcpa.InsertMode, "   ", buf, "\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.AutoPosition == 0)
+      if (lif->led.lcp.AutoPosition == 0)
       {
         strncat(buf, "Off", 20);
       }
@@ -1152,11 +1269,11 @@ void text_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "On", 19);
       }
-      printf("      AutoPosition:      %s   %s\n", lif_a.leda.lcpa.AutoPosition, buf);
-      printf("      HistoryBufSize:    %s\n", lif_a.leda.lcpa.HistoryBufferSize);
-      printf("      NumHistBuffers:    %s\n", lif_a.leda.lcpa.NumberOfHistoryBuffers);
+      obuf_cat(out, "      AutoPosition:      ", lif_a->leda.lcpa.AutoPosition, "   ", buf, "\n", NULL);
+      obuf_cat(out, "      HistoryBufSize:    ", lif_a->leda.lcpa.HistoryBufferSize, "\n", NULL);
+      obuf_cat(out, "      NumHistBuffers:    ", lif_a->leda.lcpa.NumberOfHistoryBuffers, "\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.HistoryNoDup == 0)
+      if (lif->led.lcp.HistoryNoDup == 0)
       {
         strncat(buf, "Duplicates not allowed", 22);
       }
@@ -1164,566 +1281,583 @@ void text_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "Duplicates allowed", 18);
       }
-      printf("      HistoryNoDup:      %s   %s\n", lif_a.leda.lcpa.HistoryNoDup, buf);
-      printf("      ColorTable:        ");
-      printf("%s %s %s %s\n", lif_a.leda.lcpa.ColorTable[0],
-        lif_a.leda.lcpa.ColorTable[1],
-        lif_a.leda.lcpa.ColorTable[2],
-        lif_a.leda.lcpa.ColorTable[3]);
-      printf("                         %s %s %s %s\n", lif_a.leda.lcpa.ColorTable[4],
-        lif_a.leda.lcpa.ColorTable[5],
-        lif_a.leda.lcpa.ColorTable[6],
-        lif_a.leda.lcpa.ColorTable[7]);
-      printf("                         %s %s %s %s\n", lif_a.leda.lcpa.ColorTable[8],
-        lif_a.leda.lcpa.ColorTable[9],
-        lif_a.leda.lcpa.ColorTable[10],
-        lif_a.leda.lcpa.ColorTable[11]);
-      printf("                         %s %s %s %s\n", lif_a.leda.lcpa.ColorTable[12],
-        lif_a.leda.lcpa.ColorTable[13],
-        lif_a.leda.lcpa.ColorTable[14],
-        lif_a.leda.lcpa.ColorTable[15]);
-    }
-  }
-  if (lif.led.edtypes & CONSOLE_FE_PROPS)
-  {
-    printf("    {S_2.5.2 - ExtraData - ConsoleFEDataBlock}\n");
+      obuf_cat(out, "      HistoryNoDup:      ", lif_a->leda.lcpa.HistoryNoDup, "   ", buf, "\n", NULL);
+      obuf_str(out, "      ColorTable:        ");
+      obuf_cat(out, lif_a->leda.lcpa.ColorTable[0], " ", lif_a->leda.lcpa.ColorTable[1], " ", lif_a->leda.lcpa.ColorTable[2], " ", lif_a->leda.lcpa.ColorTable[3], "\n", NULL);
+      obuf_cat(out, "                         ", lif_a->leda.lcpa.ColorTable[4], " ", lif_a->leda.lcpa.ColorTable[5], " ", lif_a->leda.lcpa.ColorTable[6], " ", lif_a->leda.lcpa.ColorTable[7], "\n", NULL);
+      obuf_cat(out, "                         ", lif_a->leda.lcpa.ColorTable[8], " ", lif_a->leda.lcpa.ColorTable[9], " ", lif_a->leda.lcpa.ColorTable[10], " ", lif_a->leda.lcpa.ColorTable[11], "\n", NULL);
+      obuf_cat(out, "                         ", lif_a->leda.lcpa.ColorTable[12], " ", lif_a->leda.lcpa.ColorTable[13], " ", lif_a->leda.lcpa.ColorTable[14], " ", lif_a->leda.lcpa.ColorTable[15], "\n", NULL);
+    }
+  }
+  if (lif->led.edtypes & CONSOLE_FE_PROPS)
+  {
+    obuf_str(out, "    {S_2.5.2 - ExtraData - ConsoleFEDataBlock}\n");
     if (less == 0)
     {
-      printf("      File Offset:       %s bytes\n", lif_a.leda.lcfepa.Posn);
-      printf("      BlockSize:         %s bytes\n", lif_a.leda.lcfepa.Size);
-      printf("      BlockSignature:    %s\n", lif_a.leda.lcfepa.sig);
-      printf("      Code Page:         %s\n", lif_a.leda.lcfepa.CodePage);
+      obuf_cat(out, "      File Offset:       ", lif_a->leda.lcfepa.Posn, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSize:         ", lif_a->leda.lcfepa.Size, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSignature:    ", lif_a->leda.lcfepa.sig, "\n", NULL);
+      obuf_cat(out, "      Code Page:         ", lif_a->leda.lcfepa.CodePage, "\n", NULL);
     }
   }
-  if (lif.led.edtypes & DARWIN_PROPS)
+  if (lif->led.edtypes & DARWIN_PROPS)
   {
-    printf("    {S_2.5.3 - ExtraData - DarwinDataBlock}\n");
+    obuf_str(out, "    {S_2.5.3 - ExtraData - DarwinDataBlock}\n");
     if (less == 0)
     {
-      printf("      File Offset:       %s bytes\n", lif_a.leda.ldpa.Posn);
-      printf("      BlockSize:         %s bytes\n", lif_a.leda.ldpa.Size);
-      printf("      BlockSignature:    %s\n", lif_a.leda.ldpa.sig);
-      printf("      DarwinDataAnsi:    %s\n", lif_a.leda.ldpa.DarwinDataAnsi);
-      printf("      DarwinDataUnicode: %s\n", lif_a.leda.ldpa.DarwinDataUnicode);
+      obuf_cat(out, "      File Offset:       ", lif_a->leda.ldpa.Posn, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSize:         ", lif_a->leda.ldpa.Size, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSignature:    ", lif_a->leda.ldpa.sig, "\n", NULL);
+      obuf_cat(out, "      DarwinDataAnsi:    ", lif_a->leda.ldpa.DarwinDataAnsi, "\n", NULL);
+      obuf_cat(out, "      DarwinDataUnicode: ", lif_a->leda.ldpa.DarwinDataUnicode, "\n", NULL);
     }
   }
-  if (lif.led.edtypes & ENVIRONMENT_PROPS)
+  if (lif->led.edtypes & ENVIRONMENT_PROPS)
   {
-    printf("    {S_2.5.4 - ExtraData - EnvironmentVariableDataBlock}\n");
+    obuf_str(out, "    {S_2.5.4 - ExtraData - EnvironmentVariableDataBlock}\n");
     if (less == 0)
     {
-      printf("      File Offset:       %s bytes\n", lif_a.leda.lepa.Posn);
-      printf("      BlockSize:         %s bytes\n", lif_a.leda.lepa.Size);
-      printf("      BlockSignature:    %s\n", lif_a.leda.lepa.sig);
-      printf("      TargetAnsi:        %s\n", lif_a.leda.lepa.TargetAnsi);
-      printf("      TargetUnicode:     %s\n", lif_a.leda.lepa.TargetUnicode);
+      obuf_cat(out, "      File Offset:       ", lif_a->leda.lepa.Posn, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSize:         ", lif_a->leda.lepa.Size, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSignature:    ", lif_a->leda.lepa.sig, "\n", NULL);
+      obuf_cat(out, "      TargetAnsi:        ", lif_a->leda.lepa.TargetAnsi, "\n", NULL);
+      obuf_cat(out, "      TargetUnicode:     ", lif_a->leda.lepa.TargetUnicode, "\n", NULL);
     }
   }
-  if (lif.led.edtypes & ICON_ENVIRONMENT_PROPS)
+  if (lif->led.edtypes & ICON_ENVIRONMENT_PROPS)
   {
-    printf("    {S_2.5.5 - ExtraData - IconEnvironmentDataBlock}\n");
+    obuf_str(out, "    {S_2.5.5 - ExtraData - IconEnvironmentDataBlock}\n");
     if (less == 0)
     {
-      printf("      File Offset:       %s bytes\n", lif_a.leda.liepa.Posn);
-      printf("      BlockSize:         %s bytes\n", lif_a.leda.liepa.Size);
-      printf("      BlockSignature:    %s\n", lif_a.leda.liepa.sig);
-      printf("      TargetAnsi:        %s\n", lif_a.leda.liepa.TargetAnsi);
-      printf("      TargetUnicode:     %s\n", lif_a.leda.liepa.TargetUnicode);
+      obuf_cat(out, "      File Offset:       ", lif_a->leda.liepa.Posn, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSize:         ", lif_a->leda.liepa.Size, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSignature:    ", lif_a->leda.liepa.sig, "\n", NULL);
+      obuf_cat(out, "      TargetAnsi:        ", lif_a->leda.liepa.TargetAnsi, "\n", NULL);
+      obuf_cat(out, "      TargetUnicode:     ", lif_a->leda.liepa.TargetUnicode, "\n", NULL);
     }
   }
-  if (lif.led.edtypes & KNOWN_FOLDER_PROPS)
+  if (lif->led.edtypes & KNOWN_FOLDER_PROPS)
   {
-    printf("    {S_2.5.6 - ExtraData - KnownFolderDataBlock}\n");
+    obuf_str(out, "    {S_2.5.6 - ExtraData - KnownFolderDataBlock}\n");
     if (less == 0)
     {
-      printf("      File Offset:       %s bytes\n", lif_a.leda.lkfpa.Posn);
-      printf("      BlockSize:         %s bytes\n", lif_a.leda.lkfpa.Size);
-      printf("      BlockSignature:    %s\n", lif_a.leda.lkfpa.sig);
-      printf("      KnownFolderID:     %s\n", lif_a.leda.lkfpa.KFGUID.UUID);
-      printf("      Offset:            %s\n", lif_a.leda.lkfpa.KFOffset);
+      obuf_cat(out, "      File Offset:       ", lif_a->leda.lkfpa.Posn, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSize:         ", lif_a->leda.lkfpa.Size, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSignature:    ", lif_a->leda.lkfpa.sig, "\n", NULL);
+      obuf_cat(out, "      KnownFolderID:     ", lif_a->leda.lkfpa.KFGUID.UUID, "\n", NULL);
+      obuf_cat(out, "      Offset:            ", lif_a->leda.lkfpa.KFOffset, "\n", NULL);
     }
   }
-  if (lif.led.edtypes & PROPERTY_STORE_PROPS)
+  if (lif->led.edtypes & PROPERTY_STORE_PROPS)
   {
-    printf("    {S_2.5.7 - ExtraData - PropertyStoreDataBlock}\n");
+    obuf_str(out, "    {S_2.5.7 - ExtraData - PropertyStoreDataBlock}\n");
     if (less == 0)
     {
-      printf("      File Offset:       %s bytes\n", lif_a.leda.lpspa.Posn);
-      printf("      BlockSize:         %s bytes\n", lif_a.leda.lpspa.Size);
-      printf("      BlockSignature:    %s\n", lif_a.leda.lpspa.sig);
-      printf("      Number of Stores:  %s\n", lif_a.leda.lpspa.NumStores);
-      for (i = 0; i < lif.led.lpsp.NumStores; i++)
-      {
-        printf("      {Property Store %i}\n", i+1);
-        printf("        Store Size:       %s bytes\n", lif_a.leda.lpspa.Stores[i].StorageSize);
-        printf("        Version:          %s\n", lif_a.leda.lpspa.Stores[i].Version);
-        printf("        Format ID:        %s\n", lif_a.leda.lpspa.Stores[i].FormatID.UUID);
-        printf("        Name Type:        %s\n", lif_a.leda.lpspa.Stores[i].NameType);
-        printf("        Number of Values: %s\n", lif_a.leda.lpspa.Stores[i].NumValues);
-        for (j = 0; j < lif.led.lpsp.Stores[i].NumValues; j++)
+      obuf_cat(out, "      File Offset:       ", lif_a->leda.lpspa.Posn, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSize:         ", lif_a->leda.lpspa.Size, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSignature:    ", lif_a->leda.lpspa.sig, "\n", NULL);
+      obuf_cat(out, "      Number of Stores:  ", lif_a->leda.lpspa.NumStores, "\n", NULL);
+      for (i = 0; i < lif->led.lpsp.NumStores; i++)
+      {
+        obuf_str(out, "      {Property Store ");
+        obuf_uint(out, i+1);
+        obuf_str(out, "}\n");
+        obuf_cat(out, "        Store Size:       ", lif_a->leda.lpspa.Stores[i].StorageSize, " bytes\n", NULL);
+        obuf_cat(out, "        Version:          ", lif_a->leda.lpspa.Stores[i].Version, "\n", NULL);
+        obuf_cat(out, "        Format ID:        ", lif_a->leda.lpspa.Stores[i].FormatID.UUID, "\n", NULL);
+        obuf_cat(out, "        Name Type:        ", lif_a->leda.lpspa.Stores[i].NameType, "\n", NULL);
+        obuf_cat(out, "        Number of Values: ", lif_a->leda.lpspa.Stores[i].NumValues, "\n", NULL);
+        for (j = 0; j < lif->led.lpsp.Stores[i].NumValues; j++)
         {
-          printf("        {Property Store %i Property Value %i}\n", i + 1, j + 1);
-          printf("          Value Size:      %s bytes\n", lif_a.leda.lpspa.Stores[i].PropValues[j].ValueSize);
-          if (lif.led.lpsp.Stores[i].PropValues[j].ValueSize > 0)
+          obuf_str(out, "        {Property Store ");
+          obuf_uint(out, i + 1);
+          obuf_str(out, " Property Value ");
+          obuf_uint(out, j + 1);
+          obuf_str(out, "}\n");
+          obuf_cat(out, "          Value Size:      ", lif_a->leda.lpspa.Stores[i].PropValues[j].ValueSize, " bytes\n", NULL);
+          if (lif->led.lpsp.Stores[i].PropValues[j].ValueSize > 0)
           {
-            if (lif.led.lpsp.Stores[i].NameType == 0)
+            if (lif->led.lpsp.Stores[i].NameType == 0)
             {
-              printf("          Name Size:       %s bytes\n", lif_a.leda.lpspa.Stores[i].PropValues[j].NameSizeOrID);
-              printf("          Name:            %s\n", lif_a.leda.lpspa.Stores[i].PropValues[j].Name);
+              obuf_cat(out, "          Name Size:       ", lif_a->leda.lpspa.Stores[i].PropValues[j].NameSizeOrID, " bytes\n", NULL);
+              obuf_cat(out, "          Name:            ", lif_a->leda.lpspa.Stores[i].PropValues[j].Name, "\n", NULL);
             }
             else
             {
-              printf("          ID:              %s\n", lif_a.leda.lpspa.Stores[i].PropValues[j].NameSizeOrID);
+              obuf_cat(out, "          ID:              ", lif_a->leda.lpspa.Stores[i].PropValues[j].NameSizeOrID, "\n", NULL);
             }
-            printf("          Property Type:   %s\n", lif_a.leda.lpspa.Stores[i].PropValues[j].PropertyType);
-            printf("          Value:           %s\n", lif_a.leda.lpspa.Stores[i].PropValues[j].Value);
+            obuf_cat(out, "          Property Type:   ", lif_a->leda.lpspa.Stores[i].PropValues[j].PropertyType, "\n", NULL);
+            obuf_cat(out, "          Value:           ", lif_a->leda.lpspa.Stores[i].PropValues[j].Value, "\n", NULL);
 
           }
         }
       }
     }
   }
-  if (lif.led.edtypes & SHIM_PROPS)
+  if (lif->led.edtypes & SHIM_PROPS)
   {
-    printf("    {S_2.5.7 - ExtraData - ShimDataBlock}\n");
+    obuf_str(out, "    {S_2.5.7 - ExtraData - ShimDataBlock}\n");
     if (less == 0)
     {
-      printf("      File Offset:       %s bytes\n", lif_a.leda.lspa.Posn);
-      printf("      BlockSize:         %s bytes\n", lif_a.leda.lspa.Size);
-      printf("      BlockSignature:    %s\n", lif_a.leda.lspa.sig);
-      printf("      Layer Name:        %s\n", lif_a.leda.lspa.LayerName);
+      obuf_cat(out, "      File Offset:       ", lif_a->leda.lspa.Posn, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSize:         ", lif_a->leda.lspa.Size, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSignature:    ", lif_a->leda.lspa.sig, "\n", NULL);
+      obuf_cat(out, "      Layer Name:        ", lif_a->leda.lspa.LayerName, "\n", NULL);
     }
   }
-  if (lif.led.edtypes & SPECIAL_FOLDER_PROPS)
+  if (lif->led.edtypes & SPECIAL_FOLDER_PROPS)
   {
-    printf("    {S_2.5.9 - ExtraData - SpecialFolderDataBlock}\n");
+    obuf_str(out, "    {S_2.5.9 - ExtraData - SpecialFolderDataBlock}\n");
     if (less == 0)
     {
-      printf("      File Offset:       %s bytes\n", lif_a.leda.lsfpa.Posn);
-      printf("      BlockSize:         %s bytes\n", lif_a.leda.lsfpa.Size);
-      printf("      BlockSignature:    %s\n", lif_a.leda.lsfpa.sig);
-      printf("      Folder ID:         %s\n", lif_a.leda.lsfpa.SpecialFolderID);
-      printf("      Offset:            %s\n", lif_a.leda.lsfpa.Offset);
+      obuf_cat(out, "      File Offset:       ", lif_a->leda.lsfpa.Posn, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSize:         ", lif_a->leda.lsfpa.Size, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSignature:    ", lif_a->leda.lsfpa.sig, "\n", NULL);
+      obuf_cat(out, "      Folder ID:         ", lif_a->leda.lsfpa.SpecialFolderID, "\n", NULL);
+      obuf_cat(out, "      Offset:            ", lif_a->leda.lsfpa.Offset, "\n", NULL);
     }
   }
-  if (lif.led.edtypes & TRACKER_PROPS)
+  if (lif->led.edtypes & TRACKER_PROPS)
   {
-    printf("    {S_2.5.10 - ExtraData - TrackerDataBlock}\n");
+    obuf_str(out, "    {S_2.5.10 - ExtraData - TrackerDataBlock}\n");
     if (less == 0)
     {
-      printf("      File Offset:       %s bytes\n", lif_a.leda.ltpa.Posn);
-      printf("      BlockSize:         %s bytes\n", lif_a.leda.ltpa.Size);
-      printf("      BlockSignature:    %s\n", lif_a.leda.ltpa.sig);
-      printf("      Length:            %s bytes\n", lif_a.leda.ltpa.Length);
-      printf("      Version:           %s\n", lif_a.leda.ltpa.Version);
+      obuf_cat(out, "      File Offset:       ", lif_a->leda.ltpa.Posn, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSize:         ", lif_a->leda.ltpa.Size, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSignature:    ", lif_a->leda.ltpa.sig, "\n", NULL);
+      obuf_cat(out, "      Length:            ", lif_a->leda.ltpa.Length, " bytes\n", NULL);
+      obuf_cat(out, "      Version:           ", lif_a->leda.ltpa.Version, "\n", NULL);
     }
-    printf("      MachineID:         %s\n", lif_a.leda.ltpa.MachineID);
-    printf("      Droid1:            %s\n", lif_a.leda.ltpa.Droid1.UUID);
+    obuf_cat(out, "      MachineID:         ", lif_a->leda.ltpa.MachineID, "\n", NULL);
+    obuf_cat(out, "      Droid1:            ", lif_a->leda.ltpa.Droid1.UUID, "\n", NULL);
     if (less == 0)
     {
-      printf("        UUID Version:      %s\n", lif_a.leda.ltpa.Droid1.Version);
-      printf("        UUID Variant:      %s\n", lif_a.leda.ltpa.Droid1.Variant);
+      obuf_cat(out, "        UUID Version:      ", lif_a->leda.ltpa.Droid1.Version, "\n", NULL);
+      obuf_cat(out, "        UUID Variant:      ", lif_a->leda.ltpa.Droid1.Variant, "\n", NULL);
     }
-    if ((lif_a.leda.ltpa.Droid1.Version[0] == '1')
-      & (lif_a.leda.ltpa.Droid1.Version[1] == ' '))
+    if ((lif_a->leda.ltpa.Droid1.Version[0] == '1')
+      & (lif_a->leda.ltpa.Droid1.Version[1] == ' '))
     {
-      printf("        UUID Sequence:     %s\n",
-        lif_a.leda.ltpa.Droid1.ClockSeq);
+      obuf_cat(out, "        UUID Sequence:     ", lif_a->leda.ltpa.Droid1.ClockSeq, "\n", NULL);
       if (less == 0)
       {
-        printf("        UUID Time:         %s\n",
-          lif_a.leda.ltpa.Droid1.Time_long);
+        obuf_cat(out, "        UUID Time:         ", lif_a->leda.ltpa.Droid1.Time_long, "\n", NULL);
       }
       else
       {
-        printf("        UUID Time:         %s\n", lif_a.leda.ltpa.Droid1.Time);
+        obuf_cat(out, "        UUID Time:         ", lif_a->leda.ltpa.Droid1.Time, "\n", NULL);
       }
-      printf("        UUID Node (MAC):   %s\n",
-        lif_a.leda.ltpa.Droid1.Node);
+      obuf_cat(out, "        UUID Node (MAC):   ", lif_a->leda.ltpa.Droid1.Node, "\n", NULL);
     }
-    printf("      Droid2:            %s\n", lif_a.leda.ltpa.Droid2.UUID);
+    obuf_cat(out, "      Droid2:            ", lif_a->leda.ltpa.Droid2.UUID, "\n", NULL);
     if (less == 0)
     {
-      printf("        UUID Version:      %s\n", lif_a.leda.ltpa.Droid2.Version);
-      printf("        UUID Variant:      %s\n", lif_a.leda.ltpa.Droid2.Variant);
+      obuf_cat(out, "        UUID Version:      ", lif_a->leda.ltpa.Droid2.Version, "\n", NULL);
+      obuf_cat(out, "        UUID Variant:      ", lif_a->leda.ltpa.Droid2.Variant, "\n", NULL);
     }
-    if ((lif_a.leda.ltpa.Droid2.Version[0] == '1')
-      & (lif_a.leda.ltpa.Droid2.Version[1] == ' '))
+    if ((lif_a->leda.ltpa.Droid2.Version[0] == '1')
+      & (lif_a->leda.ltpa.Droid2.Version[1] == ' '))
     {
-      printf("        UUID Sequence:     %s\n",
-        lif_a.leda.ltpa.Droid2.ClockSeq);
+      obuf_cat(out, "        UUID Sequence:     ", lif_a->leda.ltpa.Droid2.ClockSeq, "\n", NULL);
       if (less == 0)
       {
-        printf("        UUID Time:         %s\n",
-          lif_a.leda.ltpa.Droid2.Time_long);
+        obuf_cat(out, "        UUID Time:         ", lif_a->leda.ltpa.Droid2.Time_long, "\n", NULL);
       }
       else
       {
-        printf("        UUID Time:         %s\n", lif_a.leda.ltpa.Droid2.Time);
+        obuf_cat(out, "        UUID Time:         ", lif_a->leda.ltpa.Droid2.Time, "\n", NULL);
       }
-      printf("        UUID Node (MAC):   %s\n",
-        lif_a.leda.ltpa.Droid2.Node);
+      obuf_cat(out, "        UUID Node (MAC):   ", lif_a->leda.ltpa.Droid2.Node, "\n", NULL);
     }
     //Rather a simplistic test to see if the two sets of Droids are the same
-    if (!((lif.led.ltp.Droid1.Data1 == lif.led.ltp.DroidBirth1.Data1)
-      & (lif.led.ltp.Droid2.Data1 == lif.led.ltp.DroidBirth2.Data1)
+    if (!((lif->led.ltp.Droid1.Data1 == lif->led.ltp.DroidBirth1.Data1)
+      & (lif->led.ltp.Droid2.Data1 == lif->led.ltp.DroidBirth2.Data1)
       & (less != 0)))
     {
-      printf("      DroidBirth1:       %s\n",
-        lif_a.leda.ltpa.DroidBirth1.UUID);
+      obuf_cat(out, "      DroidBirth1:       ", lif_a->leda.ltpa.DroidBirth1.UUID, "\n", NULL);
       if (less == 0)
       {
-        printf("        UUID Version:      %s\n",
-          lif_a.leda.ltpa.DroidBirth1.Version);
-        printf("        UUID Variant:      %s\n",
-          lif_a.leda.ltpa.DroidBirth1.Variant);
+        obuf_cat(out, "        UUID Version:      ", lif_a->leda.ltpa.DroidBirth1.Version, "\n", NULL);
+        obuf_cat(out, "        UUID Variant:      ", lif_a->leda.ltpa.DroidBirth1.Variant, "\n", NULL);
       }
-      if ((lif_a.leda.ltpa.DroidBirth1.Version[0] == '1')
-        & (lif_a.leda.ltpa.DroidBirth1.Version[1] == ' '))
+      if ((lif_a->leda.ltpa.DroidBirth1.Version[0] == '1')
+        & (lif_a->leda.ltpa.DroidBirth1.Version[1] == ' '))
       {
-        printf("        UUID Sequence:     %s\n",
-          lif_a.leda.ltpa.DroidBirth1.ClockSeq);
+        obuf_cat(out, "        UUID Sequence:     ", lif_a->leda.ltpa.DroidBirth1.ClockSeq, "\n", NULL);
         if (less == 0)
         {
-          printf("        UUID Time:         %s\n",
-            lif_a.leda.ltpa.DroidBirth1.Time_long);
+          obuf_cat(out, "        UUID Time:         ", lif_a->leda.ltpa.DroidBirth1.Time_long, "\n", NULL);
         }
         else
         {
-          printf("        UUID Time:         %s\n",
-            lif_a.leda.ltpa.DroidBirth1.Time);
+          obuf_cat(out, "        UUID Time:         ", lif_a->leda.ltpa.DroidBirth1.Time, "\n", NULL);
         }
-        printf("        UUID Node (MAC):   %s\n",
-          lif_a.leda.ltpa.DroidBirth1.Node);
+        obuf_cat(out, "        UUID Node (MAC):   ", lif_a->leda.ltpa.DroidBirth1.Node, "\n", NULL);
       }
-      printf("      DroidBirth2:       %s\n",
-        lif_a.leda.ltpa.DroidBirth2.UUID);
+      obuf_cat(out, "      DroidBirth2:       ", lif_a->leda.ltpa.DroidBirth2.UUID, "\n", NULL);
       if (less == 0)
       {
-        printf("        UUID Version:      %s\n",
-          lif_a.leda.ltpa.DroidBirth2.Version);
-        printf("        UUID Variant:      %s\n",
-          lif_a.leda.ltpa.DroidBirth2.Variant);
+        obuf_cat(out, "        UUID Version:      ", lif_a->leda.ltpa.DroidBirth2.Version, "\n", NULL);
+        obuf_cat(out, "        UUID Variant:      ", lif_a->leda.ltpa.DroidBirth2.Variant, "\n", NULL);
       }
-      if ((lif_a.leda.ltpa.DroidBirth2.Version[0] == '1')
-        & (lif_a.leda.ltpa.DroidBirth2.Version[1] == ' '))
+      if ((lif_a->leda.ltpa.DroidBirth2.Version[0] == '1')
+        & (lif_a->leda.ltpa.DroidBirth2.Version[1] == ' '))
       {
-        printf("        UUID Sequence:     %s\n",
-          lif_a.leda.ltpa.DroidBirth2.ClockSeq);
+        obuf_cat(out, "        UUID Sequence:     ", lif_a->leda.ltpa.DroidBirth2.ClockSeq, "\n", NULL);
         if (less == 0)
         {
-          printf("        UUID Time:         %s\n",
-            lif_a.leda.ltpa.DroidBirth2.Time_long);
+          obuf_cat(out, "        UUID Time:         ", lif_a->leda.ltpa.DroidBirth2.Time_long, "\n", NULL);
         }
         else
         {
-          printf("        UUID Time:         %s\n",
-            lif_a.leda.ltpa.DroidBirth2.Time);
+          obuf_cat(out, "        UUID Time:         ", lif_a->leda.ltpa.DroidBirth2.Time, "\n", NULL);
         }
-        printf("        UUID Node (MAC):   %s\n",
-          lif_a.leda.ltpa.DroidBirth2.Node);
+        obuf_cat(out, "        UUID Node (MAC):   ", lif_a->leda.ltpa.DroidBirth2.Node, "\n", NULL);
       }
     }
   }
-  if (lif.led.edtypes & VISTA_AND_ABOVE_IDLIST_PROPS)
+  if (lif->led.edtypes & VISTA_AND_ABOVE_IDLIST_PROPS)
   {
     if (less == 0)
     {
-      printf("    {S_2.5.11 - ExtraData - VistaAndAboveIDListDataBlock}\n");
-      printf("      File Offset:       %s bytes\n", lif_a.leda.lvidlpa.Posn);
-      printf("      BlockSize:         %s bytes\n", lif_a.leda.lvidlpa.Size);
-      printf("      BlockSignature:    %s\n", lif_a.leda.lvidlpa.sig);
-      printf("      Number of Items:     %s\n", lif_a.leda.lvidlpa.NumItemIDs);
+      obuf_str(out, "    {S_2.5.11 - ExtraData - VistaAndAboveIDListDataBlock}\n");
+      obuf_cat(out, "      File Offset:       ", lif_a->leda.lvidlpa.Posn, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSize:         ", lif_a->leda.lvidlpa.Size, " bytes\n", NULL);
+      obuf_cat(out, "      BlockSignature:    ", lif_a->leda.lvidlpa.sig, "\n", NULL);
+      obuf_cat(out, "      Number of Items:     ", lif_a->leda.lvidlpa.NumItemIDs, "\n", NULL);
     }
   }
-  printf("\n");
+  obuf_chr(out, '\n');
+}
+
+//
+//Function: xml_text() outputs the element tag holding the string str, escaped
+//          so that nothing in a link file can break the document.
+void xml_text(struct OBUF* out, const char* tag, const void* str)
+{
+  obuf_cat(out, "<", tag, ">", NULL);
+  obuf_xml(out, str);
+  obuf_cat(out, "</", tag, ">\n", NULL);
+}
+
+//
+//Function: xml_hex_put() appends a line of a hex dump made by wbin2hex() to
+//          the OBUF at out as XML character data (the ANSI column can hold
+//          anything printable).
+void xml_hex_put(void* out, const char* line, size_t len)
+{
+  obuf_xmlmem((struct OBUF*)out, line, len);
+}
+
+//
+//Function: xml_header() outputs the XML declaration and opens the root element
+//          before the first record.
+void xml_header(struct OBUF* out)
+{
+  obuf_str(out, "<?xml version=\"1.0\" ?>\n");
+  obuf_str(out, "<!-- lifer, a Windows link file analyser. Version ");
+  obuf_uint(out, _MAJOR);
+  obuf_str(out, ".");
+  obuf_uint(out, _MINOR);
+  obuf_str(out, ".");
+  obuf_uint(out, _BUILD);
+  obuf_str(out, " -->\n");
+  obuf_str(out, "<LinkFiles>\n");
 }
 
 //
-//Function: xml_out(FILE * fp) processes the link file and outputs the text
-//          version of the decoded data.
-void xml_out(FILE* fp, char* fname, int less, int itemid)
+//Function: xml_out() takes the decoded link file and outputs the text
+//          version of the decoded data (lif_a is the ASCII version of lif)
+//          to out.
+void xml_out(struct OBUF* out, struct LIF* lif, struct LIF_A* lif_a, struct stat* statbuf, int times, char* fname, int less, int itemid)
 {
-  struct LIF     lif;
-  struct LIF_A   lif_a;
-  struct stat    statbuf;
   char           buf[200];
   int            i, j, k, idpos = 0;
   struct LIF_PROPERTY_STORE_PROPS  psp;
   struct LIF_SER_PROPSTORE_A  psa;
 
-  // Get the stat info for the file itself
-  stat(fname, &statbuf);
-
-  if (get_lif(fp, statbuf.st_size, &lif) < 0)
-  {
-    fprintf(stderr, "Error processing file \'%s\' - sorry\n", fname);
-    return;
-  }
-  if (get_lif_a(&lif, &lif_a))
-  {
-    fprintf(stderr, "Could not make ASCII version of \'%s\' - sorry\n", fname);
-    return;
-  }
 
-  if (filecount == 0)
-  {
-    //Print the header
-    printf("<?xml version=\"1.0\" ?>\n");
-    printf("<!-- lifer, a Windows link file analyser. Version %i.%i.%i -->\n", _MAJOR, _MINOR, _BUILD);
-    printf("<LinkFiles>\n");
-  }
   // Now deal with individual link files
 
-  printf("<LinkFile>\n");
+  obuf_str(out, "<LinkFile>\n");
   // stat data
-  printf("<FileSystemInfo FileName=\"%s\" LinkFileSize=\"%u\">\n", fname, (unsigned int)statbuf.st_size);
-  printf("<FileTimes>\n");
-  printf("<!-- All times are UTC -->\n");
-  strftime(buf, 29, "%Y-%m-%d %H:%M:%S", gmtime(&statbuf.st_atime));
-  printf("<LastAccessed>%s</LastAccessed>\n", buf);
-  strftime(buf, 29, "%Y-%m-%d %H:%M:%S", gmtime(&statbuf.st_mtime));
-  printf("<LastModified>%s</LastModified>\n", buf);
-  strftime(buf, 29, "%Y-%m-%d %H:%M:%S", gmtime(&statbuf.st_ctime));
-  printf("<LastChanged>%s</LastChanged>\n", buf);
-  printf("</FileTimes>\n");
-  printf("</FileSystemInfo>\n");
-
-  printf("<EmbeddedInfo>\n");
+  obuf_str(out, "<FileSystemInfo FileName=\"");
+  obuf_xml(out, fname);
+  obuf_str(out, "\" LinkFileSize=\"");
+  obuf_uint(out, (unsigned int)statbuf->st_size);
+  obuf_str(out, "\">\n");
+  obuf_str(out, "<FileTimes>\n");
+  obuf_str(out, "<!-- All times are UTC -->\n");
+  stat_time(buf, &statbuf->st_atime, "%Y-%m-%d %H:%M:%S", times);
+  obuf_cat(out, "<LastAccessed>", buf, "</LastAccessed>\n", NULL);
+  stat_time(buf, &statbuf->st_mtime, "%Y-%m-%d %H:%M:%S", times);
+  obuf_cat(out, "<LastModified>", buf, "</LastModified>\n", NULL);
+  stat_time(buf, &statbuf->st_ctime, "%Y-%m-%d %H:%M:%S", times);
+  obuf_cat(out, "<LastChanged>", buf, "</LastChanged>\n", NULL);
+  obuf_str(out, "</FileTimes>\n");
+  obuf_str(out, "</FileSystemInfo>\n");
+
+  obuf_str(out, "<EmbeddedInfo>\n");
   //ShellLinkHeader
-  printf("<ShellLinkHeader Size=\"%s\">\n", lif_a.lha.H_size);
+  obuf_cat(out, "<ShellLinkHeader Size=\"", lif_a->lha.H_size, "\">\n", NULL);
   if (less == 0)
   {
-    printf("<CLSID>%s</CLSID>\n", lif_a.lha.CLSID);
-    printf("<Flags>%s</Flags>\n", lif_a.lha.Flags);
+    obuf_cat(out, "<CLSID>", lif_a->lha.CLSID, "</CLSID>\n", NULL);
+    obuf_cat(out, "<Flags>", lif_a->lha.Flags, "</Flags>\n", NULL);
   }
-  printf("<Attributes>%s</Attributes>\n", lif_a.lha.Attr);
-  printf("<TargetTimes>\n");
-  printf("<!-- Times are UTC -->\n");
+  obuf_cat(out, "<Attributes>", lif_a->lha.Attr, "</Attributes>\n", NULL);
+  obuf_str(out, "<TargetTimes>\n");
+  obuf_str(out, "<!-- Times are UTC -->\n");
   if (less == 0)
   {
-    printf("<Created>%s</Created>\n", lif_a.lha.CrDate_long);
-    printf("<Accessed>%s</Accessed>\n", lif_a.lha.AcDate_long);
-    printf("<LastWritten>%s</LastWritten>\n", lif_a.lha.WtDate_long);
+    obuf_cat(out, "<Created>", lif_a->lha.CrDate_long, "</Created>\n", NULL);
+    obuf_cat(out, "<Accessed>", lif_a->lha.AcDate_long, "</Accessed>\n", NULL);
+    obuf_cat(out, "<LastWritten>", lif_a->lha.WtDate_long, "</LastWritten>\n", NULL);
   }
   else
   {
-    printf("<Created>%s</Created>\n", lif_a.lha.CrDate);
-    printf("<Accessed>%s</Accessed>\n", lif_a.lha.AcDate);
-    printf("<LastWritten>%s</LastWritten>\n", lif_a.lha.WtDate);
+    obuf_cat(out, "<Created>", lif_a->lha.CrDate, "</Created>\n", NULL);
+    obuf_cat(out, "<Accessed>", lif_a->lha.AcDate, "</Accessed>\n", NULL);
+    obuf_cat(out, "<LastWritten>", lif_a->lha.WtDate, "</LastWritten>\n", NULL);
   }
-  printf("</TargetTimes>\n");
-  printf("<TargetFileSize>%s</TargetFileSize>\n", lif_a.lha.Size);
+  obuf_str(out, "</TargetTimes>\n");
+  obuf_cat(out, "<TargetFileSize>", lif_a->lha.Size, "</TargetFileSize>\n", NULL);
   if (less == 0) //omit this stuff if short info required
   {
-    printf("<IconIndex>%s</IconIndex>\n", lif_a.lha.IconIndex);
-    printf("<WindowState>%s</WindowState>\n", lif_a.lha.ShowState);
-    printf("<HotKeys>%s</HotKeys>\n", lif_a.lha.Hotkey);
-    printf("<Reserved1>%s</Reserved1>\n", lif_a.lha.Reserved1);
-    printf("<Reserved2>%s</Reserved2>\n", lif_a.lha.Reserved2);
-    printf("<Reserved3>%s</Reserved3>\n", lif_a.lha.Reserved3);
+    obuf_cat(out, "<IconIndex>", lif_a->lha.IconIndex, "</IconIndex>\n", NULL);
+    obuf_cat(out, "<WindowState>", lif_a->lha.ShowState, "</WindowState>\n", NULL);
+    obuf_cat(out, "<HotKeys>", lif_a->lha.Hotkey, "</HotKeys>\n", NULL);
+    obuf_cat(out, "<Reserved1>", lif_a->lha.Reserved1, "</Reserved1>\n", NULL);
+    obuf_cat(out, "<Reserved2>", lif_a->lha.Reserved2, "</Reserved2>\n", NULL);
+    obuf_cat(out, "<Reserved3>", lif_a->lha.Reserved3, "</Reserved3>\n", NULL);
   }
-  printf("</ShellLinkHeader>\n");
+  obuf_str(out, "</ShellLinkHeader>\n");
 
   // ItemIDList
-  if (lif.lh.Flags & 0x00000001) //If there is an ItemIDList
+  if (lif->lh.Flags & 0x00000001) //If there is an ItemIDList
   {
     if (less == 0) //IDLists are not printed if the option is for shortened output
     {
-      printf("<LinkTargetIDList Size=\"%u\" NumItemIDs=\"%u\">\n", lif.lidl.IDListSize, lif.lidl.NumItemIDs);
+      obuf_str(out, "<LinkTargetIDList Size=\"");
+      obuf_uint(out, lif->lidl.IDListSize);
+      obuf_str(out, "\" NumItemIDs=\"");
+      obuf_uint(out, lif->lidl.NumItemIDs);
+      obuf_str(out, "\">\n");
       if (itemid > 0) // If the '-i' option is switched on
       {
-        idpos = lif.lh.H_size;
-        for (i = 0; i < lif.lidl.NumItemIDs; i++)
+        idpos = lif->lh.H_size;
+        for (i = 0; i < lif->lidl.NumItemIDs; i++)
         {
-          printf("<ItemID Num=\"%i\" Size=\"%s\">\n", i + 1, lif_a.lidla.Items[i].ItemIDSize);
-          if (find_propstores((unsigned char*)&lif.lidl.Items[i].Data, lif.lidl.Items[i].ItemIDSize, idpos, &psp) == 0)
+          obuf_str(out, "<ItemID Num=\"");
+          obuf_uint(out, i + 1);
+          obuf_cat(out, "\" Size=\"", lif_a->lidla.Items[i].ItemIDSize, "\">\n", NULL);
+          if (find_propstores((unsigned char*)&lif->lidl.Items[i].Data, (lif->lidl.Items[i].ItemIDSize < MAXITEMIDSIZE) ? lif->lidl.Items[i].ItemIDSize : MAXITEMIDSIZE, idpos, &psp) == 0)
           {
             // If PropStoreProps exist:
-            printf("<PropStoreProps Size=\"%u\" FileOffset=\"%u\" NumStores=\"%u\">\n", psp.Size, psp.Posn, psp.NumStores);
+            obuf_str(out, "<PropStoreProps Size=\"");
+            obuf_uint(out, psp.Size);
+            obuf_str(out, "\" FileOffset=\"");
+            obuf_uint(out, psp.Posn);
+            obuf_str(out, "\" NumStores=\"");
+            obuf_uint(out, psp.NumStores);
+            obuf_str(out, "\">\n");
             for (j = 0; j < psp.NumStores; j++)
             {
               if (get_propstore_a(&psp.Stores[j], &psa) == 0)
               {
-                printf("<PropertyStore Num=\"%u\" Size=\"%s\">\n", j + 1, psa.StorageSize);
-                printf("<Version>%s</Version>\n", psa.Version);
-                printf("<FormatID>%s</FormatID>\n", psa.FormatID.UUID);
-                printf("<NameType>%s</NameType>\n", psa.NameType);
-                printf("<PropValues NumValues=\"%s\">\n", psa.NumValues);
+                obuf_str(out, "<PropertyStore Num=\"");
+                obuf_uint(out, j + 1);
+                obuf_cat(out, "\" Size=\"", psa.StorageSize, "\">\n", NULL);
+                obuf_cat(out, "<Version>", psa.Version, "</Version>\n", NULL);
+                obuf_cat(out, "<FormatID>", psa.FormatID.UUID, "</FormatID>\n", NULL);
+                obuf_cat(out, "<NameType>", psa.NameType, "</NameType>\n", NULL);
+                obuf_cat(out, "<PropValues NumValues=\"", psa.NumValues, "\">\n", NULL);
                 for (k = 0; k < psp.Stores[j].NumValues; k++)
                 {
-                  printf("<Value Num=\"%u\" Size=\"%s\">\n", k + 1, psa.PropValues[k].ValueSize);
+                  obuf_str(out, "<Value Num=\"");
+                  obuf_uint(out, k + 1);
+                  obuf_cat(out, "\" Size=\"", psa.PropValues[k].ValueSize, "\">\n", NULL);
                   if (psp.Stores[j].PropValues[k].ValueSize > 0)
                   {
                     if (psp.Stores[j].NameType == 0)
                     {
-                      printf("<NameSize>%s</NameSize>\n", psa.PropValues[k].NameSizeOrID);
-                      printf("<Name>%s</Name>\n", psa.PropValues[k].Name);
+                      obuf_cat(out, "<NameSize>", psa.PropValues[k].NameSizeOrID, "</NameSize>\n", NULL);
+                      xml_text(out, "Name", psa.PropValues[k].Name);
                     }
                     else
                     {
-                      printf("<ID>%s</ID>\n", psa.PropValues[k].NameSizeOrID);
+                      obuf_cat(out, "<ID>", psa.PropValues[k].NameSizeOrID, "</ID>\n", NULL);
                     }
-                    printf("<Type>%s</Type>\n", psa.PropValues[k].PropertyType);
-                    printf("<Content><![CDATA[%s]]></Content>\n", psa.PropValues[k].Value);
+                    obuf_cat(out, "<Type>", psa.PropValues[k].PropertyType, "</Type>\n", NULL);
+                    xml_text(out, "Content", psa.PropValues[k].Value);
                   }
-                  printf("</Value>\n");
+                  obuf_str(out, "</Value>\n");
                 }
-                printf("</PropValues>\n");
-                printf("</PropertyStore>\n");
+                obuf_str(out, "</PropValues>\n");
+                obuf_str(out, "</PropertyStore>\n");
               }
               else
               {
-                printf("<!-- Unable to interpret Property Store %i -->\n", j);
+                obuf_str(out, "<!-- Unable to interpret Property Store ");
+                obuf_uint(out, j);
+                obuf_str(out, " -->\n");
               }
             }
-            printf("</PropStoreProps>\n");
-            idpos += lif.lidl.Items[i].ItemIDSize; // point idpos at the start of the next ItemID
+            obuf_str(out, "</PropStoreProps>\n");
+            idpos += lif->lidl.Items[i].ItemIDSize; // point idpos at the start of the next ItemID
           }
           else
           {
-            printf("<!-- No Property Stores found in this ITemID. Here is the raw data -->\n");
-            printf("<![CDATA[\n");
-            bin2hex((unsigned char*)&lif.lidl.Items[i].Data, lif.lidl.Items[i].ItemIDSize, 1, 16, 0, 1, 0);
-            printf("]]>\n");
-            idpos += lif.lidl.Items[i].ItemIDSize; // point idpos at the start of the next ItemID
+            obuf_str(out, "<!-- No Property Stores found in this ITemID. Here is the raw data -->\n");
+            wbin2hex(xml_hex_put, out, (unsigned char*)&lif->lidl.Items[i].Data, (lif->lidl.Items[i].ItemIDSize < MAXITEMIDSIZE) ? lif->lidl.Items[i].ItemIDSize : MAXITEMIDSIZE, 1, 16, 0, 1, 0);
+            idpos += lif->lidl.Items[i].ItemIDSize; // point idpos at the start of the next ItemID
           }
-          printf("</ItemID>\n");
+          obuf_str(out, "</ItemID>\n");
         }
-        printf("<IDListTerminator Size=\"2\"></IDListTerminator>\n");
+        obuf_str(out, "<IDListTerminator Size=\"2\"></IDListTerminator>\n");
       }
-      printf("</LinkTargetIDList>\n");
+      obuf_str(out, "</LinkTargetIDList>\n");
     }
   }
 
   //LinkInfo
-  if (lif.lh.Flags & 0x00000002) //If there is a LinkInfo
+  if (lif->lh.Flags & 0x00000002) //If there is a LinkInfo
   {
-    printf("<LinkInfo Size=\"%s\">\n", lif_a.lia.Size);
+    obuf_cat(out, "<LinkInfo Size=\"", lif_a->lia.Size, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<LinkInfoHeader Size=\"%s\">\n", lif_a.lia.HeaderSize);
-      printf("<Flags>%s</Flags>\n", lif_a.lia.Flags);
-      printf("<VolumeIDOffset>%s</VolumeIDOffset>\n", lif_a.lia.IDOffset);
-      printf("<BasePathOffset>%s</BasePathOffset>\n", lif_a.lia.LBPOffset);
-      printf("<CNRLinkOffset>%s</CNRLinkOffset>\n", lif_a.lia.CNRLOffset);
-      printf("<CPSOffset>%s</CPSOffset>\n", lif_a.lia.CPSOffset);
-      printf("<LBPOffsetUnicode>%s</LBPOffsetUnicode>\n", lif_a.lia.LBPOffsetU);
-      printf("<CPSOffsetUnicode>%s</CPSOffsetUnicode>\n", lif_a.lia.CPSOffsetU);
-      printf("</LinkInfoHeader>\n");
+      obuf_cat(out, "<LinkInfoHeader Size=\"", lif_a->lia.HeaderSize, "\">\n", NULL);
+      obuf_cat(out, "<Flags>", lif_a->lia.Flags, "</Flags>\n", NULL);
+      obuf_cat(out, "<VolumeIDOffset>", lif_a->lia.IDOffset, "</VolumeIDOffset>\n", NULL);
+      obuf_cat(out, "<BasePathOffset>", lif_a->lia.LBPOffset, "</BasePathOffset>\n", NULL);
+      obuf_cat(out, "<CNRLinkOffset>", lif_a->lia.CNRLOffset, "</CNRLinkOffset>\n", NULL);
+      obuf_cat(out, "<CPSOffset>", lif_a->lia.CPSOffset, "</CPSOffset>\n", NULL);
+      obuf_cat(out, "<LBPOffsetUnicode>", lif_a->lia.LBPOffsetU, "</LBPOffsetUnicode>\n", NULL);
+      obuf_cat(out, "<CPSOffsetUnicode>", lif_a->lia.CPSOffsetU, "</CPSOffsetUnicode>\n", NULL);
+      obuf_str(out, "</LinkInfoHeader>\n");
     }
     //There is a Volume ID structure (& LBP)
-    if (lif.li.Flags & 0x00000001)
+    if (lif->li.Flags & 0x00000001)
     {
-      printf("<VolumeID Size=\"%s\">\n", lif_a.lia.VolID.Size);
-      printf("<DriveType>%s</DriveType>\n", lif_a.lia.VolID.DriveType);
-      printf("<DriveSerialNo>%s</DriveSerialNo>\n", lif_a.lia.VolID.DriveSN);
+      obuf_cat(out, "<VolumeID Size=\"", lif_a->lia.VolID.Size, "\">\n", NULL);
+      obuf_cat(out, "<DriveType>", lif_a->lia.VolID.DriveType, "</DriveType>\n", NULL);
+      obuf_cat(out, "<DriveSerialNo>", lif_a->lia.VolID.DriveSN, "</DriveSerialNo>\n", NULL);
       if (less == 0)
       {
-        if (!(lif.li.HeaderSize >= 0x00000024))//Which to use?
+        if (!(lif->li.HeaderSize >= 0x00000024))//Which to use?
                                                //ANSI or Unicode versions
         {
-          printf("<VolLabelOffset>%s</VolLabelOffset>\n", lif_a.lia.VolID.VLOffset);
+          obuf_cat(out, "<VolLabelOffset>", lif_a->lia.VolID.VLOffset, "</VolLabelOffset>\n", NULL);
         }
         else
         {
-          printf("<VolLabelOffsetUnicode>%s</VolLabelOffsetUnicode>\n", lif_a.lia.VolID.VLOffsetU);
+          obuf_cat(out, "<VolLabelOffsetUnicode>", lif_a->lia.VolID.VLOffsetU, "</VolLabelOffsetUnicode>\n", NULL);
         }
       }
-      if (!(lif.li.HeaderSize >= 0x00000024))
+      if (!(lif->li.HeaderSize >= 0x00000024))
       {
-        printf("<VolumeLabel>%s</VolumeLabel>\n", lif_a.lia.VolID.VolumeLabel);
+        xml_text(out, "VolumeLabel", lif_a->lia.VolID.VolumeLabel);
       }
       else
       {
-        printf("<VolumeLabelUnicode>%s</VolumeLabelUnicode>\n", lif_a.lia.VolID.VolumeLabelU);
+        xml_text(out, "VolumeLabelUnicode", lif_a->lia.VolID.VolumeLabelU);
       }
-      printf("<LocalBasePath>%s</LocalBasePath>\n", lif_a.lia.LBP);
-      printf("</VolumeID>\n");
+      xml_text(out, "LocalBasePath", lif_a->lia.LBP);
+      obuf_str(out, "</VolumeID>\n");
     }//End of VolumeID
      //CommonNetworkRelativeLink
-    if (lif.li.Flags & 0x00000002)
+    if (lif->li.Flags & 0x00000002)
     {
-      printf("<CommonNetworkRelativeLink Size=\"%s\">\n", lif_a.lia.CNR.Size);
+      obuf_cat(out, "<CommonNetworkRelativeLink Size=\"", lif_a->lia.CNR.Size, "\">\n", NULL);
       if (less == 0)
       {
-        printf("<Flags>%s</Flags>\n", lif_a.lia.CNR.Flags);
-        printf("<NetNameOffset>%s</NetNameOffset>\n", lif_a.lia.CNR.NetNameOffset);
-        printf("<DeviceNameOffset>%s</DeviceNameOffset>\n", lif_a.lia.CNR.DeviceNameOffset);
+        obuf_cat(out, "<Flags>", lif_a->lia.CNR.Flags, "</Flags>\n", NULL);
+        obuf_cat(out, "<NetNameOffset>", lif_a->lia.CNR.NetNameOffset, "</NetNameOffset>\n", NULL);
+        obuf_cat(out, "<DeviceNameOffset>", lif_a->lia.CNR.DeviceNameOffset, "</DeviceNameOffset>\n", NULL);
       }
-      printf("<NetProviderType>%s</NetProviderType>\n", lif_a.lia.CNR.NetworkProviderType);
-      if ((less == 0) && (lif.li.CNR.NetNameOffset > 0x00000014))
+      obuf_cat(out, "<NetProviderType>", lif_a->lia.CNR.NetworkProviderType, "</NetProviderType>\n", NULL);
+      if ((less == 0) && (lif->li.CNR.NetNameOffset > 0x00000014))
       {
-        printf("<NetNameOffsetUnicode>%s</NetNameOffsetUnicode>\n", lif_a.lia.CNR.NetNameOffsetU);
-        printf("<DeviceNameOffsetUnicode>%s</DeviceNameOffsetUnicode>\n", lif_a.lia.CNR.DeviceNameOffsetU);
+        obuf_cat(out, "<NetNameOffsetUnicode>", lif_a->lia.CNR.NetNameOffsetU, "</NetNameOffsetUnicode>\n", NULL);
+        obuf_cat(out, "<DeviceNameOffsetUnicode>", lif_a->lia.CNR.DeviceNameOffsetU, "</DeviceNameOffsetUnicode>\n", NULL);
       }
-      printf("<NetName>%s</NetName>\n", lif_a.lia.CNR.NetName);
-      printf("<DeviceName>%s</DeviceName>\n", lif_a.lia.CNR.DeviceName);
-      if (lif.li.CNR.NetNameOffset > 0x00000014)
+      xml_text(out, "NetName", lif_a->lia.CNR.NetName);
+      xml_text(out, "DeviceName", lif_a->lia.CNR.DeviceName);
+      if (lif->li.CNR.NetNameOffset > 0x00000014)
       {
-        printf("<NetNameUnicode>%s</NetNameUnicode>\n", lif_a.lia.CNR.NetNameU);
-        printf("<DeviceNameUnicode>%s</DeviceNameUnicode>\n", lif_a.lia.CNR.DeviceNameU);
+        xml_text(out, "NetNameUnicode", lif_a->lia.CNR.NetNameU);
+        xml_text(out, "DeviceNameUnicode", lif_a->lia.CNR.DeviceNameU);
       }
-      printf("<CommonPathSuffix>%s</CommonPathSuffix>\n", lif_a.lia.CPS);
+      xml_text(out, "CommonPathSuffix", lif_a->lia.CPS);
 
-      printf("</CommonNetworkRelativeLink>\n");
+      obuf_str(out, "</CommonNetworkRelativeLink>\n");
     }
-    if (lif.li.LBPOffsetU > 0)
+    if (lif->li.LBPOffsetU > 0)
     {
-      printf("<LocalBasePathUnicode>%s\n", lif_a.lia.LBPU);
+      xml_text(out, "LocalBasePathUnicode", lif_a->lia.LBPU);
     }
-    if (lif.li.CPSOffsetU > 0)
+    if (lif->li.CPSOffsetU > 0)
     {
-      printf("<CommonPathSuffixUnicode>%s</CommonPathSuffixUnicode>\n", lif_a.lia.CPSU);
+      xml_text(out, "CommonPathSuffixUnicode", lif_a->lia.CPSU);
     }
-    printf("</LinkInfo>\n");
+    obuf_str(out, "</LinkInfo>\n");
   }//End of Link Info
 
    //STRINGDATA
-  if (lif.lh.Flags & 0x0000007C)
+  if (lif->lh.Flags & 0x0000007C)
   {
-    printf("<StringData Size=\"%s\">\n", lif_a.lsda.Size);
-    if (lif.lh.Flags & 0x00000004)
+    obuf_cat(out, "<StringData Size=\"", lif_a->lsda.Size, "\">\n", NULL);
+    if (lif->lh.Flags & 0x00000004)
     {
-      printf("<NAME_STRING Characters=\"%s\">%s</NAME_STRING>\n", lif_a.lsda.CountChars[0], lif_a.lsda.Data[0]);
+      obuf_cat(out, "<NAME_STRING Characters=\"", lif_a->lsda.CountChars[0], "\">", NULL);
+      obuf_xml(out, lif_a->lsda.Data[0]);
+      obuf_str(out, "</NAME_STRING>\n");
     }
-    if (lif.lh.Flags & 0x00000008)
+    if (lif->lh.Flags & 0x00000008)
     {
-      printf("<RELATIVE_PATH Characters=\"%s\">%s</RELATIVE_PATH>\n", lif_a.lsda.CountChars[1], lif_a.lsda.Data[1]);
+      obuf_cat(out, "<RELATIVE_PATH Characters=\"", lif_a->lsda.CountChars[1], "\">", NULL);
+      obuf_xml(out, lif_a->lsda.Data[1]);
+      obuf_str(out, "</RELATIVE_PATH>\n");
     }
-    if (lif.lh.Flags & 0x00000010)
+    if (lif->lh.Flags & 0x00000010)
     {
-      printf("<WORKING_DIR Characters=\"%s\">%s</WORKING_DIR>\n", lif_a.lsda.CountChars[2], lif_a.lsda.Data[2]);
+      obuf_cat(out, "<WORKING_DIR Characters=\"", lif_a->lsda.CountChars[2], "\">", NULL);
+      obuf_xml(out, lif_a->lsda.Data[2]);
+      obuf_str(out, "</WORKING_DIR>\n");
     }
-    if (lif.lh.Flags & 0x00000020)
+    if (lif->lh.Flags & 0x00000020)
     {
-      printf("<COMMAND_LINE_ARGUMENTS Characters=\"%s\">%s</COMMAND_LINE_ARGUMENTS>\n", lif_a.lsda.CountChars[3], lif_a.lsda.Data[3]);
+      obuf_cat(out, "<COMMAND_LINE_ARGUMENTS Characters=\"", lif_a->lsda.CountChars[3], "\">", NULL);
+      obuf_xml(out, lif_a->lsda.Data[3]);
+      obuf_str(out, "</COMMAND_LINE_ARGUMENTS>\n");
     }
-    if (lif.lh.Flags & 0x00000040)
+    if (lif->lh.Flags & 0x00000040)
     {
-      printf("<ICON_LOCATION Characters=\"%s\">%s</ICON_LOCATION>\n", lif_a.lsda.CountChars[4], lif_a.lsda.Data[4]);
+      obuf_cat(out, "<ICON_LOCATION Characters=\"", lif_a->lsda.CountChars[4], "\">", NULL);
+      obuf_xml(out, lif_a->lsda.Data[4]);
+      obuf_str(out, "</ICON_LOCATION>\n");
     }
-    printf("</StringData>\n");
+    obuf_str(out, "</StringData>\n");
   }// End of STRINGDATA
 
   //EXTRADATA
-  printf("<ExtraData Size=\"%s\" EDStructures=\"%s\">\n", lif_a.leda.Size, lif_a.leda.edtypes);
-  if (lif.led.edtypes & CONSOLE_PROPS)
+  obuf_cat(out, "<ExtraData Size=\"", lif_a->leda.Size, "\" EDStructures=\"", lif_a->leda.edtypes, "\">\n", NULL);
+  if (lif->led.edtypes & CONSOLE_PROPS)
   {
-    printf("<ConsoleDataBlock FileOffset=\"%s\" Size=\"%s\">\n", lif_a.leda.lcpa.Posn, lif_a.leda.lcpa.Size);
+    obuf_cat(out, "<ConsoleDataBlock FileOffset=\"", lif_a->leda.lcpa.Posn, "\" Size=\"", lif_a->leda.lcpa.Size, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<BlockSignature>%s</BlockSignature>\n", lif_a.leda.lcpa.sig);
+      obuf_cat(out, "<BlockSignature>", lif_a->leda.lcpa.sig, "</BlockSignature>\n", NULL);
       //Build the FillAttributes string
       buf[0] = (char)0;
-      if (lif.led.lcp.FillAttributes & 0x0001) strncat(buf, "FOREGROUND_BLUE | ", 18);
-      if (lif.led.lcp.FillAttributes & 0x0002) strncat(buf, "FOREGROUND_GREEN | ", 19);
-      if (lif.led.lcp.FillAttributes & 0x0004) strncat(buf, "FOREGROUND_RED | ", 17);
-      if (lif.led.lcp.FillAttributes & 0x0008) strncat(buf, "FOREGROUND_INTENSITY | ", 23);
-      if (lif.led.lcp.FillAttributes & 0x0010) strncat(buf, "BACKGROUND_BLUE | ", 18);
-      if (lif.led.lcp.FillAttributes & 0x0020) strncat(buf, "BACKGROUND_GREEN | ", 19);
-      if (lif.led.lcp.FillAttributes & 0x0040) strncat(buf, "BACKGROUND_RED | ", 17);
-      if (lif.led.lcp.FillAttributes & 0x0080) strncat(buf, "BACKGROUND_INTENSITY | ", 23);
+      if (lif->led.lcp.FillAttributes & 0x0001) strncat(buf, "FOREGROUND_BLUE | ", 18);
+      if (lif->led.lcp.FillAttributes & 0x0002) strncat(buf, "FOREGROUND_GREEN | ", 19);
+      if (lif->led.lcp.FillAttributes & 0x0004) strncat(buf, "FOREGROUND_RED | ", 17);
+      if (lif->led.lcp.FillAttributes & 0x0008) strncat(buf, "FOREGROUND_INTENSITY | ", 23);
+      if (lif->led.lcp.FillAttributes & 0x0010) strncat(buf, "BACKGROUND_BLUE | ", 18);
+      if (lif->led.lcp.FillAttributes & 0x0020) strncat(buf, "BACKGROUND_GREEN | ", 19);
+      if (lif->led.lcp.FillAttributes & 0x0040) strncat(buf, "BACKGROUND_RED | ", 17);
+      if (lif->led.lcp.FillAttributes & 0x0080) strncat(buf, "BACKGROUND_INTENSITY | ", 23);
       i = strlen(buf);
       if (i > 2)
       {
@@ -1733,16 +1867,16 @@ void xml_out(FILE* fp, char* fname, int less, int itemid)
       {
         snprintf(buf, 300, "[NONE]");
       }
-      printf("<FillAttributes>%s  %s</FillAttributes>\n", lif_a.leda.lcpa.FillAttributes, buf);
+      obuf_cat(out, "<FillAttributes>", lif_a->leda.lcpa.FillAttributes, "  ", buf, "</FillAttributes>\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.PopupFillAttributes & 0x0001) strncat(buf, "FOREGROUND_BLUE | ", 18);
-      if (lif.led.lcp.PopupFillAttributes & 0x0002) strncat(buf, "FOREGROUND_GREEN | ", 19);
-      if (lif.led.lcp.PopupFillAttributes & 0x0004) strncat(buf, "FOREGROUND_RED | ", 17);
-      if (lif.led.lcp.PopupFillAttributes & 0x0008) strncat(buf, "FOREGROUND_INTENSITY | ", 23);
-      if (lif.led.lcp.PopupFillAttributes & 0x0010) strncat(buf, "BACKGROUND_BLUE | ", 18);
-      if (lif.led.lcp.PopupFillAttributes & 0x0020) strncat(buf, "BACKGROUND_GREEN | ", 19);
-      if (lif.led.lcp.PopupFillAttributes & 0x0040) strncat(buf, "BACKGROUND_RED | ", 17);
-      if (lif.led.lcp.PopupFillAttributes & 0x0080) strncat(buf, "BACKGROUND_INTENSITY | ", 23);
+      if (lif->led.lcp.PopupFillAttributes & 0x0001) strncat(buf, "FOREGROUND_BLUE | ", 18);
+      if (lif->led.lcp.PopupFillAttributes & 0x0002) strncat(buf, "FOREGROUND_GREEN | ", 19);
+      if (lif->led.lcp.PopupFillAttributes & 0x0004) strncat(buf, "FOREGROUND_RED | ", 17);
+      if (lif->led.lcp.PopupFillAttributes & 0x0008) strncat(buf, "FOREGROUND_INTENSITY | ", 23);
+      if (lif->led.lcp.PopupFillAttributes & 0x0010) strncat(buf, "BACKGROUND_BLUE | ", 18);
+      if (lif->led.lcp.PopupFillAttributes & 0x0020) strncat(buf, "BACKGROUND_GREEN | ", 19);
+      if (lif->led.lcp.PopupFillAttributes & 0x0040) strncat(buf, "BACKGROUND_RED | ", 17);
+      if (lif->led.lcp.PopupFillAttributes & 0x0080) strncat(buf, "BACKGROUND_INTENSITY | ", 23);
       i = strlen(buf);
       if (i > 2)
       {
@@ -1752,19 +1886,19 @@ void xml_out(FILE* fp, char* fname, int less, int itemid)
       {
         snprintf(buf, 300, "[NONE]");
       }
-      printf("<PopupFillAttributes>%s  %s</PopupFillAttributes>\n", lif_a.leda.lcpa.PopupFillAttributes, buf);
-      printf("<ScreenBufSizeX>%s</ScreenBufSizeX>\n", lif_a.leda.lcpa.ScreenBufferSizeX);
-      printf("<ScreenBufSizeY>%s</ScreenBufSizeY>\n", lif_a.leda.lcpa.ScreenBufferSizeY);
-      printf("<WindowSizeX>%s</WindowSizeX>\n", lif_a.leda.lcpa.WindowSizeX);
-      printf("<WindowSizeY>%s</WindowSizeY>\n", lif_a.leda.lcpa.WindowSizeY);
-      printf("<WindowOriginX>%s</WindowOriginX>\n", lif_a.leda.lcpa.WindowOriginX);
-      printf("<WindowOriginY>%s</WindowOriginY>\n", lif_a.leda.lcpa.WindowOriginY);
-      printf("<Unused1>%s</Unused1>\n", lif_a.leda.lcpa.Unused1);
-      printf("<Unused2>%s</Unused2>\n", lif_a.leda.lcpa.Unused2);
-      printf("<FontHeight>%s</FontHeight>\n", lif_a.leda.lcpa.FontHeight);
-      printf("<FontWidth>%s</FontWidth>\n", lif_a.leda.lcpa.FontWidth);
+      obuf_cat(out, "<PopupFillAttributes>", lif_a->leda.lcpa.PopupFillAttributes, "  ", buf, "</PopupFillAttributes>\n", NULL);
+      obuf_cat(out, "<ScreenBufSizeX>", lif_a->leda.lcpa.ScreenBufferSizeX, "</ScreenBufSizeX>\n", NULL);
+      obuf_cat(out, "<ScreenBufSizeY>", lif_a->leda.lcpa.ScreenBufferSizeY, "</ScreenBufSizeY>\n", NULL);
+      obuf_cat(out, "<WindowSizeX>", lif_a->leda.lcpa.WindowSizeX, "</WindowSizeX>\n", NULL);
+      obuf_cat(out, "<WindowSizeY>", lif_a->leda.lcpa.WindowSizeY, "</WindowSizeY>\n", NULL);
+      obuf_cat(out, "<WindowOriginX>", lif_a->leda.lcpa.WindowOriginX, "</WindowOriginX>\n", NULL);
+      obuf_cat(out, "<WindowOriginY>", lif_a->leda.lcpa.WindowOriginY, "</WindowOriginY>\n", NULL);
+      obuf_cat(out, "<Unused1>", lif_a->leda.lcpa.Unused1, "</Unused1>\n", NULL);
+      obuf_cat(out, "<Unused2>", lif_a->leda.lcpa.Unused2, "</Unused2>\n", NULL);
+      obuf_cat(out, "<FontHeight>", lif_a->leda.lcpa.FontHeight, "</FontHeight>\n", NULL);
+      obuf_cat(out, "<FontWidth>", lif_a->leda.lcpa.FontWidth, "</FontWidth>\n", NULL);
       buf[0] = (char)0;
-      switch (lif.led.lcp.FontFamily_Family)
+      switch (lif->led.lcp.FontFamily_Family)
       {
       case 0x0000:
         strncat(buf, "FF_DONTCARE", 11);
@@ -1787,18 +1921,18 @@ void xml_out(FILE* fp, char* fname, int less, int itemid)
       default:
         strncat(buf, "UNKNOWN (Not allowed in specification)", 39);
       }
-      printf("<FontFamily>%s  %s</FontFamily>\n", lif_a.leda.lcpa.FontFamily, buf);
+      obuf_cat(out, "<FontFamily>", lif_a->leda.lcpa.FontFamily, "  ", buf, "</FontFamily>\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.FontFamily_Pitch == 0x0000) strncat(buf, "TMPF_NONE | ", 12);
+      if (lif->led.lcp.FontFamily_Pitch == 0x0000) strncat(buf, "TMPF_NONE | ", 12);
       else
       {
-        if (lif.led.lcp.FontFamily_Pitch & 0x0001)
+        if (lif->led.lcp.FontFamily_Pitch & 0x0001)
           strncat(buf, "TMPF_FIXED_PITCH | ", 19);
-        if (lif.led.lcp.FontFamily_Pitch & 0x0002)
+        if (lif->led.lcp.FontFamily_Pitch & 0x0002)
           strncat(buf, "TMPF_VECTOR | ", 14);
-        if (lif.led.lcp.FontFamily_Pitch & 0x0004)
+        if (lif->led.lcp.FontFamily_Pitch & 0x0004)
           strncat(buf, "TMPF_TRUETYPE | ", 16);
-        if (lif.led.lcp.FontFamily_Pitch & 0x008)
+        if (lif->led.lcp.FontFamily_Pitch & 0x008)
           strncat(buf, "TMPF_DEVICE | ", 14);
       }
       i = strlen(buf);
@@ -1810,9 +1944,9 @@ void xml_out(FILE* fp, char* fname, int less, int itemid)
       {
         snprintf(buf, 300, "Unknown");
       }
-      printf("<FontPitch>%s  %s</FontPitch>\n", lif_a.leda.lcpa.FontPitch, buf);
+      obuf_cat(out, "<FontPitch>", lif_a->leda.lcpa.FontPitch, "  ", buf, "</FontPitch>\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.FontWeight < 700)
+      if (lif->led.lcp.FontWeight < 700)
       {
         strncat(buf, "A regular-weight font", 21);
       }
@@ -1820,18 +1954,18 @@ void xml_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "A bold font", 11);
       }
-      printf("<FontWeight>%s  %s</FontWeight>\n", lif_a.leda.lcpa.FontWeight, buf);
-      printf("<FaceName>%s</FaceName>\n", lif_a.leda.lcpa.FaceName);
+      obuf_cat(out, "<FontWeight>", lif_a->leda.lcpa.FontWeight, "  ", buf, "</FontWeight>\n", NULL);
+      xml_text(out, "FaceName", lif_a->leda.lcpa.FaceName);
       buf[0] = (char)0;
-      if (lif.led.lcp.CursorSize <= 25)
+      if (lif->led.lcp.CursorSize <= 25)
       {
         strncat(buf, "A small cursor", 14);
       }
-      else if ((lif.led.lcp.CursorSize > 25) & (lif.led.lcp.CursorSize <= 50))
+      else if ((lif->led.lcp.CursorSize > 25) & (lif->led.lcp.CursorSize <= 50))
       {
         strncat(buf, "A medium cursor", 15);
       }
-      else if ((lif.led.lcp.CursorSize > 50) & (lif.led.lcp.CursorSize <= 100))
+      else if ((lif->led.lcp.CursorSize > 50) & (lif->led.lcp.CursorSize <= 100))
       {
         strncat(buf, "A large cursor", 14);
       }
@@ -1839,9 +1973,9 @@ void xml_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "An undefined cursor size", 25);
       }
-      printf("<CursorSize>%s  %s</CursorSize>\n", lif_a.leda.lcpa.CursorSize, buf);
+      obuf_cat(out, "<CursorSize>", lif_a->leda.lcpa.CursorSize, "  ", buf, "</CursorSize>\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.FullScreen == 0)
+      if (lif->led.lcp.FullScreen == 0)
       {
         strncat(buf, "Off", 3);
       }
@@ -1849,9 +1983,9 @@ void xml_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "On", 2);
       }
-      printf("<FullScreen>%s  %s</FullScreen>\n", lif_a.leda.lcpa.FullScreen, buf);
+      obuf_cat(out, "<FullScreen>", lif_a->leda.lcpa.FullScreen, "  ", buf, "</FullScreen>\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.QuickEdit == 0)
+      if (lif->led.lcp.QuickEdit == 0)
       {
         strncat(buf, "Off", 3);
       }
@@ -1859,9 +1993,9 @@ void xml_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "On", 2);
       }
-      printf("<QuickEdit>%s  %s</QuickEdit>\n", lif_a.leda.lcpa.QuickEdit, buf);
+      obuf_cat(out, "<QuickEdit>", lif_a->leda.lcpa.QuickEdit, "  ", buf, "</QuickEdit>\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.InsertMode == 0)
+      if (lif->led.lcp.InsertMode == 0)
       {
         strncat(buf, "Disabled", 8);
       }
@@ -1869,9 +2003,9 @@ void xml_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "Enabled", 7);
       }
-      printf("<InsertMode>%s  %s</InsertMode>\n", lif_a.leda.lcpa.InsertMode, buf);
+      obuf_cat(out, "<InsertMode>", lif_a->leda.lcpa.InsertMode, "  ", buf, "</InsertMode>\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.AutoPosition == 0)
+      if (lif->led.lcp.AutoPosition == 0)
       {
         strncat(buf, "Off", 20);
       }
@@ -1879,11 +2013,11 @@ void xml_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "On", 19);
       }
-      printf("<AutoPosition>%s  %s</AutoPosition>\n", lif_a.leda.lcpa.AutoPosition, buf);
-      printf("<HistoryBufferSize>%s</HistoryBufferSize>\n", lif_a.leda.lcpa.HistoryBufferSize);
-      printf("<NumberOfHistoryBuffers>%s</NumberOfHistoryBuffers>\n", lif_a.leda.lcpa.NumberOfHistoryBuffers);
+      obuf_cat(out, "<AutoPosition>", lif_a->leda.lcpa.AutoPosition, "  ", buf, "</AutoPosition>\n", NULL);
+      obuf_cat(out, "<HistoryBufferSize>", lif_a->leda.lcpa.HistoryBufferSize, "</HistoryBufferSize>\n", NULL);
+      obuf_cat(out, "<NumberOfHistoryBuffers>", lif_a->leda.lcpa.NumberOfHistoryBuffers, "</NumberOfHistoryBuffers>\n", NULL);
       buf[0] = (char)0;
-      if (lif.led.lcp.HistoryNoDup == 0)
+      if (lif->led.lcp.HistoryNoDup == 0)
       {
         strncat(buf, "Duplicates not allowed", 22);
       }
@@ -1891,394 +2025,2129 @@ void xml_out(FILE* fp, char* fname, int less, int itemid)
       {
         strncat(buf, "Duplicates allowed", 18);
       }
-      printf("<HistoryNoDuplicates>%s  %s</HistoryNoDuplicates>\n", lif_a.leda.lcpa.HistoryNoDup, buf);
-      printf("<ColorTable>\n");
-      printf("%s %s %s %s\n", lif_a.leda.lcpa.ColorTable[0],
-        lif_a.leda.lcpa.ColorTable[1],
-        lif_a.leda.lcpa.ColorTable[2],
-        lif_a.leda.lcpa.ColorTable[3]);
-      printf("%s %s %s %s\n", lif_a.leda.lcpa.ColorTable[4],
-        lif_a.leda.lcpa.ColorTable[5],
-        lif_a.leda.lcpa.ColorTable[6],
-        lif_a.leda.lcpa.ColorTable[7]);
-      printf("%s %s %s %s\n", lif_a.leda.lcpa.ColorTable[8],
-        lif_a.leda.lcpa.ColorTable[9],
-        lif_a.leda.lcpa.ColorTable[10],
-        lif_a.leda.lcpa.ColorTable[11]);
-      printf("%s %s %s %s\n", lif_a.leda.lcpa.ColorTable[12],
-        lif_a.leda.lcpa.ColorTable[13],
-        lif_a.leda.lcpa.ColorTable[14],
-        lif_a.leda.lcpa.ColorTable[15]);
-      printf("</ColorTable>\n");
-    }
-    printf("</ConsoleDataBlock>\n");
-  }
-  if (lif.led.edtypes & CONSOLE_FE_PROPS)
-  {
-    printf("<ConsoleFEDataBlock FileOffset=\"%s\" Size=\"%s\">\n", lif_a.leda.lcfepa.Posn, lif_a.leda.lcfepa.Size);
+      obuf_cat(out, "<HistoryNoDuplicates>", lif_a->leda.lcpa.HistoryNoDup, "  ", buf, "</HistoryNoDuplicates>\n", NULL);
+      obuf_str(out, "<ColorTable>\n");
+      obuf_cat(out, lif_a->leda.lcpa.ColorTable[0], " ", lif_a->leda.lcpa.ColorTable[1], " ", lif_a->leda.lcpa.ColorTable[2], " ", lif_a->leda.lcpa.ColorTable[3], "\n", NULL);
+      obuf_cat(out, lif_a->leda.lcpa.ColorTable[4], " ", lif_a->leda.lcpa.ColorTable[5], " ", lif_a->leda.lcpa.ColorTable[6], " ", lif_a->leda.lcpa.ColorTable[7], "\n", NULL);
+      obuf_cat(out, lif_a->leda.lcpa.ColorTable[8], " ", lif_a->leda.lcpa.ColorTable[9], " ", lif_a->leda.lcpa.ColorTable[10], " ", lif_a->leda.lcpa.ColorTable[11], "\n", NULL);
+      obuf_cat(out, lif_a->leda.lcpa.ColorTable[12], " ", lif_a->leda.lcpa.ColorTable[13], " ", lif_a->leda.lcpa.ColorTable[14], " ", lif_a->leda.lcpa.ColorTable[15], "\n", NULL);
+      obuf_str(out, "</ColorTable>\n");
+    }
+    obuf_str(out, "</ConsoleDataBlock>\n");
+  }
+  if (lif->led.edtypes & CONSOLE_FE_PROPS)
+  {
+    obuf_cat(out, "<ConsoleFEDataBlock FileOffset=\"", lif_a->leda.lcfepa.Posn, "\" Size=\"", lif_a->leda.lcfepa.Size, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<BlockSignature>%s</BlockSignature>\n", lif_a.leda.lcfepa.sig);
+      obuf_cat(out, "<BlockSignature>", lif_a->leda.lcfepa.sig, "</BlockSignature>\n", NULL);
     }
-    printf("<CodePage>%s</CodePage>\n", lif_a.leda.lcfepa.CodePage);
-    printf("</ConsoleFEDataBlock>\n");
+    obuf_cat(out, "<CodePage>", lif_a->leda.lcfepa.CodePage, "</CodePage>\n", NULL);
+    obuf_str(out, "</ConsoleFEDataBlock>\n");
   }
-  if (lif.led.edtypes & DARWIN_PROPS)
+  if (lif->led.edtypes & DARWIN_PROPS)
   {
-    printf("<DarwinDataBlock FileOffset=\"%s\" Size=\"%s\">\n", lif_a.leda.ldpa.Posn, lif_a.leda.ldpa.Size);
+    obuf_cat(out, "<DarwinDataBlock FileOffset=\"", lif_a->leda.ldpa.Posn, "\" Size=\"", lif_a->leda.ldpa.Size, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<BlockSignature>%s</BlockSignature>\n", lif_a.leda.ldpa.sig);
+      obuf_cat(out, "<BlockSignature>", lif_a->leda.ldpa.sig, "</BlockSignature>\n", NULL);
     }
-    printf("<DarwinDataAnsi><![CDATA[%s]]></DarwinDataAnsi>\n", lif_a.leda.ldpa.DarwinDataAnsi);
-    printf("<DarwinDataUnicode><![CDATA[%s]]></DarwinDataUnicode>\n", lif_a.leda.ldpa.DarwinDataUnicode);
-    printf("</DarwinDataBlock>\n");
+    xml_text(out, "DarwinDataAnsi", lif_a->leda.ldpa.DarwinDataAnsi);
+    xml_text(out, "DarwinDataUnicode", lif_a->leda.ldpa.DarwinDataUnicode);
+    obuf_str(out, "</DarwinDataBlock>\n");
   }
-  if (lif.led.edtypes & ENVIRONMENT_PROPS)
+  if (lif->led.edtypes & ENVIRONMENT_PROPS)
   {
-    printf("<EnvironmentVariableDataBlock FileOffset=\"%s\" Size=\"%s\">\n", lif_a.leda.lepa.Posn, lif_a.leda.lepa.Size);
+    obuf_cat(out, "<EnvironmentVariableDataBlock FileOffset=\"", lif_a->leda.lepa.Posn, "\" Size=\"", lif_a->leda.lepa.Size, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<BlockSignature>%s</BlockSignature>\n", lif_a.leda.lepa.sig);
+      obuf_cat(out, "<BlockSignature>", lif_a->leda.lepa.sig, "</BlockSignature>\n", NULL);
     }
-    printf("<TargetAnsi><![CDATA[%s]]></TargetAnsi>\n", lif_a.leda.lepa.TargetAnsi);
-    printf("<TargetUnicode><![CDATA[%s]]></TargetUnicode>\n", lif_a.leda.lepa.TargetUnicode);
-    printf("</EnvironmentVariableDataBlock>\n");
+    xml_text(out, "TargetAnsi", lif_a->leda.lepa.TargetAnsi);
+    xml_text(out, "TargetUnicode", lif_a->leda.lepa.TargetUnicode);
+    obuf_str(out, "</EnvironmentVariableDataBlock>\n");
   }
-  if (lif.led.edtypes & ICON_ENVIRONMENT_PROPS)
+  if (lif->led.edtypes & ICON_ENVIRONMENT_PROPS)
   {
-    printf("<IconEnvironmentDataBlock FileOffset=\"%s\" Size=\"%s\">\n", lif_a.leda.liepa.Posn, lif_a.leda.liepa.Size);
+    obuf_cat(out, "<IconEnvironmentDataBlock FileOffset=\"", lif_a->leda.liepa.Posn, "\" Size=\"", lif_a->leda.liepa.Size, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<BlockSignature>%s</BlockSignature>\n", lif_a.leda.liepa.sig);
+      obuf_cat(out, "<BlockSignature>", lif_a->leda.liepa.sig, "</BlockSignature>\n", NULL);
     }
-    printf("<TargetAnsi><![CDATA[%s]]></TargetAnsi>\n", lif_a.leda.liepa.TargetAnsi);
-    printf("<TargetUnicode><![CDATA[%s]]></TargetUnicode>\n", lif_a.leda.liepa.TargetUnicode);
-    printf("</IconEnvironmentDataBlock>\n");
+    xml_text(out, "TargetAnsi", lif_a->leda.liepa.TargetAnsi);
+    xml_text(out, "TargetUnicode", lif_a->leda.liepa.TargetUnicode);
+    obuf_str(out, "</IconEnvironmentDataBlock>\n");
   }
-  if (lif.led.edtypes & KNOWN_FOLDER_PROPS)
+  if (lif->led.edtypes & KNOWN_FOLDER_PROPS)
   {
-    //printf("<KnownFolderDataBlock FileOffset=\"%s\" Size=\"%s\">\n", lif_a.leda.lkfpa.Posn, lif_a.leda.lkfpa.Size);
+    obuf_cat(out, "<KnownFolderDataBlock FileOffset=\"", lif_a->leda.lkfpa.Posn, "\" Size=\"", lif_a->leda.lkfpa.Size, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<BlockSignature>%s</BlockSignature>\n", lif_a.leda.lkfpa.sig);
+      obuf_cat(out, "<BlockSignature>", lif_a->leda.lkfpa.sig, "</BlockSignature>\n", NULL);
     }
-    printf("<KnownFolderID><![CDATA[%s]]></KnownFolderID>\n", lif_a.leda.lkfpa.KFGUID.UUID);
+    obuf_cat(out, "<KnownFolderID><![CDATA[", lif_a->leda.lkfpa.KFGUID.UUID, "]]></KnownFolderID>\n", NULL);
     if (less == 0)
     {
-      printf("<LocalOffset>%s</LocalOffset>\n", lif_a.leda.lkfpa.KFOffset);
+      obuf_cat(out, "<LocalOffset>", lif_a->leda.lkfpa.KFOffset, "</LocalOffset>\n", NULL);
     }
+    obuf_str(out, "</KnownFolderDataBlock>\n");
   }
-  if (lif.led.edtypes & PROPERTY_STORE_PROPS)
+  if (lif->led.edtypes & PROPERTY_STORE_PROPS)
   {
-    printf("<PropertyStoreDataBlock FileOffset=\"%s\" Size=\"%s\" NumStores=\"%s\">\n", lif_a.leda.lpspa.Posn, lif_a.leda.lpspa.Size, lif_a.leda.lpspa.NumStores);
+    obuf_cat(out, "<PropertyStoreDataBlock FileOffset=\"", lif_a->leda.lpspa.Posn, "\" Size=\"", lif_a->leda.lpspa.Size, "\" NumStores=\"", lif_a->leda.lpspa.NumStores, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<BlockSignature>%s</BlockSignature>\n", lif_a.leda.lpspa.sig);
-      for (i = 0; i < lif.led.lpsp.NumStores; i++)
+      obuf_cat(out, "<BlockSignature>", lif_a->leda.lpspa.sig, "</BlockSignature>\n", NULL);
+      for (i = 0; i < lif->led.lpsp.NumStores; i++)
       {
-        printf("<PropertyStore Size=\"%s\" NumValues=\"%s\">\n", lif_a.leda.lpspa.Stores[i].StorageSize, lif_a.leda.lpspa.Stores[i].NumValues);
-        printf("<Version>%s</Version>\n", lif_a.leda.lpspa.Stores[i].Version);
-        printf("<FormatID>%s</FormatID>\n", lif_a.leda.lpspa.Stores[i].FormatID.UUID);
-        printf("<NameType>%s</NameType>\n", lif_a.leda.lpspa.Stores[i].NameType);
-        for (j = 0; j < lif.led.lpsp.Stores[i].NumValues; j++)
+        obuf_cat(out, "<PropertyStore Size=\"", lif_a->leda.lpspa.Stores[i].StorageSize, "\" NumValues=\"", lif_a->leda.lpspa.Stores[i].NumValues, "\">\n", NULL);
+        obuf_cat(out, "<Version>", lif_a->leda.lpspa.Stores[i].Version, "</Version>\n", NULL);
+        obuf_cat(out, "<FormatID>", lif_a->leda.lpspa.Stores[i].FormatID.UUID, "</FormatID>\n", NULL);
+        obuf_cat(out, "<NameType>", lif_a->leda.lpspa.Stores[i].NameType, "</NameType>\n", NULL);
+        for (j = 0; j < lif->led.lpsp.Stores[i].NumValues; j++)
         {
-          printf("<PropertyValue Size=\"%s\">\n", lif_a.leda.lpspa.Stores[i].PropValues[j].ValueSize);
-          if (lif.led.lpsp.Stores[i].PropValues[j].ValueSize > 0)
+          obuf_cat(out, "<PropertyValue Size=\"", lif_a->leda.lpspa.Stores[i].PropValues[j].ValueSize, "\">\n", NULL);
+          if (lif->led.lpsp.Stores[i].PropValues[j].ValueSize > 0)
           {
-            if (lif.led.lpsp.Stores[i].NameType == 0)
+            if (lif->led.lpsp.Stores[i].NameType == 0)
             {
-              printf("<NameSize>%s</NameSize>\n", lif_a.leda.lpspa.Stores[i].PropValues[j].NameSizeOrID);
-              printf("<Name>%s</Name>\n", lif_a.leda.lpspa.Stores[i].PropValues[j].Name);
+              obuf_cat(out, "<NameSize>", lif_a->leda.lpspa.Stores[i].PropValues[j].NameSizeOrID, "</NameSize>\n", NULL);
+              xml_text(out, "Name", lif_a->leda.lpspa.Stores[i].PropValues[j].Name);
             }
             else
             {
-              printf("<ID>%s</ID>\n", lif_a.leda.lpspa.Stores[i].PropValues[j].NameSizeOrID);
+              obuf_cat(out, "<ID>", lif_a->leda.lpspa.Stores[i].PropValues[j].NameSizeOrID, "</ID>\n", NULL);
             }
-            printf("<PropertyType>%s</PropertyType>\n", lif_a.leda.lpspa.Stores[i].PropValues[j].PropertyType);
-            printf("<Value><![CDATA[%s]]></Value>\n", lif_a.leda.lpspa.Stores[i].PropValues[j].Value);
+            obuf_cat(out, "<PropertyType>", lif_a->leda.lpspa.Stores[i].PropValues[j].PropertyType, "</PropertyType>\n", NULL);
+            xml_text(out, "Value", lif_a->leda.lpspa.Stores[i].PropValues[j].Value);
           }
-          printf("</PropertyValue>\n");
+          obuf_str(out, "</PropertyValue>\n");
         }
-        printf("</PropertyStore>\n");
+        obuf_str(out, "</PropertyStore>\n");
       }
     }
-    printf("</PropertyStoreDataBlock>");
+    obuf_str(out, "</PropertyStoreDataBlock>\n");
   }
 
-  if (lif.led.edtypes & SHIM_PROPS)
+  if (lif->led.edtypes & SHIM_PROPS)
   {
-    printf("<ShimDataBlock FileOffset=\"%s\" Size=\"%s\">\n", lif_a.leda.lspa.Posn, lif_a.leda.lspa.Size);
+    obuf_cat(out, "<ShimDataBlock FileOffset=\"", lif_a->leda.lspa.Posn, "\" Size=\"", lif_a->leda.lspa.Size, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<BlockSignature>%s</BlockSignature>\n", lif_a.leda.lspa.sig);
-      printf("<LayerName>%s</LayerName>\n", lif_a.leda.lspa.LayerName);
+      obuf_cat(out, "<BlockSignature>", lif_a->leda.lspa.sig, "</BlockSignature>\n", NULL);
+      xml_text(out, "LayerName", lif_a->leda.lspa.LayerName);
     }
-    printf("</ShimDataBlock>\n");
+    obuf_str(out, "</ShimDataBlock>\n");
   }
 
-  if (lif.led.edtypes & SPECIAL_FOLDER_PROPS)
+  if (lif->led.edtypes & SPECIAL_FOLDER_PROPS)
   {
-    printf("<SpecialFolderDataBlock FileOffset=\"%s\" Size=\"%s\">\n", lif_a.leda.lsfpa.Posn, lif_a.leda.lsfpa.Size);
+    obuf_cat(out, "<SpecialFolderDataBlock FileOffset=\"", lif_a->leda.lsfpa.Posn, "\" Size=\"", lif_a->leda.lsfpa.Size, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<BlockSignature>%s</BlockSignature>\n", lif_a.leda.lsfpa.sig);
-      printf("<FolderID>%s</FolderID>\n", lif_a.leda.lsfpa.SpecialFolderID);
-      printf("<Offset>%s</Offset>\n", lif_a.leda.lsfpa.Offset);
+      obuf_cat(out, "<BlockSignature>", lif_a->leda.lsfpa.sig, "</BlockSignature>\n", NULL);
+      obuf_cat(out, "<FolderID>", lif_a->leda.lsfpa.SpecialFolderID, "</FolderID>\n", NULL);
+      obuf_cat(out, "<Offset>", lif_a->leda.lsfpa.Offset, "</Offset>\n", NULL);
     }
-    printf("</SpecialFolderDataBlock>\n");
+    obuf_str(out, "</SpecialFolderDataBlock>\n");
   }
 
-  if (lif.led.edtypes & TRACKER_PROPS)
+  if (lif->led.edtypes & TRACKER_PROPS)
   {
-    printf("<TrackerDataBlock FileOffset=\"%s\" Size=\"%s\">\n", lif_a.leda.ltpa.Posn, lif_a.leda.ltpa.Size);
+    obuf_cat(out, "<TrackerDataBlock FileOffset=\"", lif_a->leda.ltpa.Posn, "\" Size=\"", lif_a->leda.ltpa.Size, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<BlockSignature>%s</BlockSignature>\n", lif_a.leda.ltpa.sig);
-      printf("<Length>%s</Length>\n", lif_a.leda.ltpa.Length);
-      printf("<Version>%s</Version>\n", lif_a.leda.ltpa.Version);
+      obuf_cat(out, "<BlockSignature>", lif_a->leda.ltpa.sig, "</BlockSignature>\n", NULL);
+      obuf_cat(out, "<Length>", lif_a->leda.ltpa.Length, "</Length>\n", NULL);
+      obuf_cat(out, "<Version>", lif_a->leda.ltpa.Version, "</Version>\n", NULL);
     }
-    printf("<MachineID>%s</MachineID>\n", lif_a.leda.ltpa.MachineID);
-    printf("<Droid1>\n");
-    printf("<UUID>\n%s\n", lif_a.leda.ltpa.Droid1.UUID);
+    xml_text(out, "MachineID", lif_a->leda.ltpa.MachineID);
+    obuf_str(out, "<Droid1>\n");
+    obuf_cat(out, "<UUID>\n", lif_a->leda.ltpa.Droid1.UUID, "\n", NULL);
     if (less == 0)
     {
-      printf("<Version>%s</Version>\n", lif_a.leda.ltpa.Droid1.Version);
-      printf("<Variant>%s</Variant>\n", lif_a.leda.ltpa.Droid1.Variant);
+      obuf_cat(out, "<Version>", lif_a->leda.ltpa.Droid1.Version, "</Version>\n", NULL);
+      obuf_cat(out, "<Variant>", lif_a->leda.ltpa.Droid1.Variant, "</Variant>\n", NULL);
     }
-    if ((lif_a.leda.ltpa.Droid1.Version[0] == '1')
-      & (lif_a.leda.ltpa.Droid1.Version[1] == ' '))
+    if ((lif_a->leda.ltpa.Droid1.Version[0] == '1')
+      & (lif_a->leda.ltpa.Droid1.Version[1] == ' '))
     {
-      printf("<Sequence>%s</Sequence>\n",
-        lif_a.leda.ltpa.Droid1.ClockSeq);
+      obuf_cat(out, "<Sequence>", lif_a->leda.ltpa.Droid1.ClockSeq, "</Sequence>\n", NULL);
       if (less == 0)
       {
-        printf("<Time>%s</Time>\n",
-          lif_a.leda.ltpa.Droid1.Time_long);
+        obuf_cat(out, "<Time>", lif_a->leda.ltpa.Droid1.Time_long, "</Time>\n", NULL);
       }
       else
       {
-        printf("<Time>%s</Time>\n", lif_a.leda.ltpa.Droid1.Time);
+        obuf_cat(out, "<Time>", lif_a->leda.ltpa.Droid1.Time, "</Time>\n", NULL);
       }
-      printf("<Node><!-- Mac Address -->%s</Node>\n",
-        lif_a.leda.ltpa.Droid1.Node);
+      obuf_cat(out, "<Node><!-- Mac Address -->", lif_a->leda.ltpa.Droid1.Node, "</Node>\n", NULL);
     }
-    printf("</UUID>\n");
-    printf("</Droid1>\n");
+    obuf_str(out, "</UUID>\n");
+    obuf_str(out, "</Droid1>\n");
 
-    printf("<Droid2>\n");
-    printf("<UUID>\n%s\n", lif_a.leda.ltpa.Droid2.UUID);
+    obuf_str(out, "<Droid2>\n");
+    obuf_cat(out, "<UUID>\n", lif_a->leda.ltpa.Droid2.UUID, "\n", NULL);
     if (less == 0)
     {
-      printf("<Version>%s</Version>\n", lif_a.leda.ltpa.Droid2.Version);
-      printf("<Variant>%s</Variant>\n", lif_a.leda.ltpa.Droid2.Variant);
+      obuf_cat(out, "<Version>", lif_a->leda.ltpa.Droid2.Version, "</Version>\n", NULL);
+      obuf_cat(out, "<Variant>", lif_a->leda.ltpa.Droid2.Variant, "</Variant>\n", NULL);
     }
-    if ((lif_a.leda.ltpa.Droid2.Version[0] == '1')
-      & (lif_a.leda.ltpa.Droid2.Version[1] == ' '))
+    if ((lif_a->leda.ltpa.Droid2.Version[0] == '1')
+      & (lif_a->leda.ltpa.Droid2.Version[1] == ' '))
     {
-      printf("<Sequence>%s</Sequence>\n",
-        lif_a.leda.ltpa.Droid2.ClockSeq);
+      obuf_cat(out, "<Sequence>", lif_a->leda.ltpa.Droid2.ClockSeq, "</Sequence>\n", NULL);
       if (less == 0)
       {
-        printf("<Time>%s</Time>\n",
-          lif_a.leda.ltpa.Droid2.Time_long);
+        obuf_cat(out, "<Time>", lif_a->leda.ltpa.Droid2.Time_long, "</Time>\n", NULL);
       }
       else
       {
-        printf("<Time>%s</Time>\n", lif_a.leda.ltpa.Droid2.Time);
+        obuf_cat(out, "<Time>", lif_a->leda.ltpa.Droid2.Time, "</Time>\n", NULL);
       }
-      printf("<Node><!-- Mac Address -->%s</Node>\n",
-        lif_a.leda.ltpa.Droid2.Node);
+      obuf_cat(out, "<Node><!-- Mac Address -->", lif_a->leda.ltpa.Droid2.Node, "</Node>\n", NULL);
     }
-    printf("</UUID>\n");
-    printf("</Droid2>\n");
+    obuf_str(out, "</UUID>\n");
+    obuf_str(out, "</Droid2>\n");
 
     //Rather a simplistic test to see if the two sets of Droids are the same
-    if (!((lif.led.ltp.Droid1.Data1 == lif.led.ltp.DroidBirth1.Data1)
-      & (lif.led.ltp.Droid2.Data1 == lif.led.ltp.DroidBirth2.Data1)
+    if (!((lif->led.ltp.Droid1.Data1 == lif->led.ltp.DroidBirth1.Data1)
+      & (lif->led.ltp.Droid2.Data1 == lif->led.ltp.DroidBirth2.Data1)
       & (less != 0)))
     {
-      printf("<DroidBirth1>\n");
-      printf("<UUID>\n%s\n", lif_a.leda.ltpa.DroidBirth1.UUID);
+      obuf_str(out, "<DroidBirth1>\n");
+      obuf_cat(out, "<UUID>\n", lif_a->leda.ltpa.DroidBirth1.UUID, "\n", NULL);
       if (less == 0)
       {
-        printf("<Version>%s</Version>\n", lif_a.leda.ltpa.DroidBirth1.Version);
-        printf("<Variant>%s</Variant>\n", lif_a.leda.ltpa.DroidBirth1.Variant);
+        obuf_cat(out, "<Version>", lif_a->leda.ltpa.DroidBirth1.Version, "</Version>\n", NULL);
+        obuf_cat(out, "<Variant>", lif_a->leda.ltpa.DroidBirth1.Variant, "</Variant>\n", NULL);
       }
-      if ((lif_a.leda.ltpa.DroidBirth1.Version[0] == '1')
-        & (lif_a.leda.ltpa.DroidBirth1.Version[1] == ' '))
+      if ((lif_a->leda.ltpa.DroidBirth1.Version[0] == '1')
+        & (lif_a->leda.ltpa.DroidBirth1.Version[1] == ' '))
       {
-        printf("<Sequence>%s</Sequence>\n",
-          lif_a.leda.ltpa.DroidBirth1.ClockSeq);
+        obuf_cat(out, "<Sequence>", lif_a->leda.ltpa.DroidBirth1.ClockSeq, "</Sequence>\n", NULL);
         if (less == 0)
         {
-          printf("<Time>%s</Time>\n",
-            lif_a.leda.ltpa.DroidBirth1.Time_long);
+          obuf_cat(out, "<Time>", lif_a->leda.ltpa.DroidBirth1.Time_long, "</Time>\n", NULL);
         }
         else
         {
-          printf("<Time>%s</Time>\n", lif_a.leda.ltpa.DroidBirth1.Time);
+          obuf_cat(out, "<Time>", lif_a->leda.ltpa.DroidBirth1.Time, "</Time>\n", NULL);
         }
-        printf("<Node><!-- Mac Address -->%s</Node>\n",
-          lif_a.leda.ltpa.DroidBirth1.Node);
+        obuf_cat(out, "<Node><!-- Mac Address -->", lif_a->leda.ltpa.DroidBirth1.Node, "</Node>\n", NULL);
       }
-      printf("</UUID>\n");
-      printf("</DroidBirth1>\n");
+      obuf_str(out, "</UUID>\n");
+      obuf_str(out, "</DroidBirth1>\n");
 
-      printf("<DroidBirth2>\n");
-      printf("<UUID>\n%s\n", lif_a.leda.ltpa.DroidBirth2.UUID);
+      obuf_str(out, "<DroidBirth2>\n");
+      obuf_cat(out, "<UUID>\n", lif_a->leda.ltpa.DroidBirth2.UUID, "\n", NULL);
       if (less == 0)
       {
-        printf("<Version>%s</Version>\n", lif_a.leda.ltpa.DroidBirth2.Version);
-        printf("<Variant>%s</Variant>\n", lif_a.leda.ltpa.DroidBirth2.Variant);
+        obuf_cat(out, "<Version>", lif_a->leda.ltpa.DroidBirth2.Version, "</Version>\n", NULL);
+        obuf_cat(out, "<Variant>", lif_a->leda.ltpa.DroidBirth2.Variant, "</Variant>\n", NULL);
       }
-      if ((lif_a.leda.ltpa.DroidBirth2.Version[0] == '1')
-        & (lif_a.leda.ltpa.DroidBirth2.Version[1] == ' '))
+      if ((lif_a->leda.ltpa.DroidBirth2.Version[0] == '1')
+        & (lif_a->leda.ltpa.DroidBirth2.Version[1] == ' '))
       {
-        printf("<Sequence>%s</Sequence>\n",
-          lif_a.leda.ltpa.DroidBirth2.ClockSeq);
+        obuf_cat(out, "<Sequence>", lif_a->leda.ltpa.DroidBirth2.ClockSeq, "</Sequence>\n", NULL);
         if (less == 0)
         {
-          printf("<Time>%s</Time>\n",
-            lif_a.leda.ltpa.DroidBirth2.Time_long);
+          obuf_cat(out, "<Time>", lif_a->leda.ltpa.DroidBirth2.Time_long, "</Time>\n", NULL);
         }
         else
         {
-          printf("<Time>%s</Time>\n", lif_a.leda.ltpa.DroidBirth2.Time);
+          obuf_cat(out, "<Time>", lif_a->leda.ltpa.DroidBirth2.Time, "</Time>\n", NULL);
         }
-        printf("<Node><!-- Mac Address -->%s</Node>\n",
-          lif_a.leda.ltpa.DroidBirth2.Node);
+        obuf_cat(out, "<Node><!-- Mac Address -->", lif_a->leda.ltpa.DroidBirth2.Node, "</Node>\n", NULL);
       }
-      printf("</UUID>\n");
-      printf("</DroidBirth2>\n");
+      obuf_str(out, "</UUID>\n");
+      obuf_str(out, "</DroidBirth2>\n");
     }
-    printf("</TrackerDataBlock>\n");
+    obuf_str(out, "</TrackerDataBlock>\n");
   }
 
-  if (lif.led.edtypes & VISTA_AND_ABOVE_IDLIST_PROPS)
+  if (lif->led.edtypes & VISTA_AND_ABOVE_IDLIST_PROPS)
   {
-    printf("<VistaAndAboveIDListDataBlock FileOffset=\"%s\" Size=\"%s\">\n", lif_a.leda.lvidlpa.Posn, lif_a.leda.lvidlpa.Size);
+    obuf_cat(out, "<VistaAndAboveIDListDataBlock FileOffset=\"", lif_a->leda.lvidlpa.Posn, "\" Size=\"", lif_a->leda.lvidlpa.Size, "\">\n", NULL);
     if (less == 0)
     {
-      printf("<BlockSignature>%s</BlockSignature>\n", lif_a.leda.lvidlpa.sig);
-      printf("<NumItems>%s</NumItems>\n", lif_a.leda.lvidlpa.NumItemIDs);
+      obuf_cat(out, "<BlockSignature>", lif_a->leda.lvidlpa.sig, "</BlockSignature>\n", NULL);
+      obuf_cat(out, "<NumItems>", lif_a->leda.lvidlpa.NumItemIDs, "</NumItems>\n", NULL);
     }
-    printf("</VistaAndAboveIDListDataBlock>\n");
+    obuf_str(out, "</VistaAndAboveIDListDataBlock>\n");
   }
-  printf("</ExtraData>\n");
+  obuf_str(out, "</ExtraData>\n");
 
-  printf("</EmbeddedInfo>\n");
-  printf("</LinkFile>\n");
+  obuf_str(out, "</EmbeddedInfo>\n");
+  obuf_str(out, "</LinkFile>\n");
 }
 
 //
-//Function: proc_file() processes regular files
-void proc_file(char* fname, int less, int idlist)
+//Function: json_key() starts a member of the innermost open object (or an
+//          element of the innermost open array if key is NULL), putting a
+//          comma before it unless it is the first.
+void json_key(struct LIFER_JSON* js, const char* key)
 {
-  FILE *fp;
-  struct stat statbuf;
-
-  //Try to open a file pointer
-  if ((fp = fopen(fname, "rb")) == NULL)
+  if (js->used[js->depth])
   {
-    //unsuccessful
-    perror("Error");
-    fprintf(stderr, "whilst processing file: \'%s\'\n", fname);
+    obuf_chr(js->out, ',');
   }
-  else
+  js->used[js->depth] = 1;
+  if (key != NULL)
   {
-    stat(fname, &statbuf);
-    if (statbuf.st_size >= 76) //Don't bother with files that aren't big enough
-    {
-      //successful
-      if (test_link(fp) == 0) // Test to see if the file has the right magic
-      {
-        switch (output_type)
-        {
-        case csv:
-          sv_out(fp, fname, less, ','); // Output to a separated file with the separator being a comma
-          break;
-        case tsv:
-          sv_out(fp, fname, less, '\t'); // Output to a separated file with the separator being a tab
-          break;
-        case xml:
-          xml_out(fp, fname, less, idlist);
-          break;
-        case txt:
-        default:       //Anything other than these 4 options should have been
-          //trapped already - this is just belt & braces!
-          text_out(fp, fname, less, idlist); // Output to plain text
-        }
-        filecount++;
-      }
-      else
-      {
-        fprintf(stderr, "Not a Link File:\t%s\n", fname);
-      }
-
-      if (fclose(fp) != 0)
+    obuf_chr(js->out, '"');
+    obuf_str(js->out, key);
+    obuf_str(js->out, "\":");
+  }
+}
+
+//
+//Function: json_open() opens an object ('{') or an array ('[') called key.
+void json_open(struct LIFER_JSON* js, const char* key, char bracket)
+{
+  json_key(js, key);
+  obuf_chr(js->out, bracket);
+  js->used[++js->depth] = 0;
+}
+
+//
+//Function: json_close() closes the innermost object ('}') or array (']').
+void json_close(struct LIFER_JSON* js, char bracket)
+{
+  obuf_chr(js->out, bracket);
+  js->depth--;
+}
+
+//
+//Function: json_str() outputs the member key with the string value str.
+void json_str(struct LIFER_JSON* js, const char* key, const void* str)
+{
+  json_key(js, key);
+  obuf_json(js->out, str);
+}
+
+//
+//Function: json_time() outputs the member key with the stat time at t, or
+//          null if times is 0 (see stat_time()).
+void json_time(struct LIFER_JSON* js, const char* key, const time_t* t, int times)
+{
+  char buf[40];
+
+  if (!times)
+  {
+    json_key(js, key);
+    obuf_str(js->out, "null");
+    return;
+  }
+  json_str(js, key, stat_time(buf, t, "%Y-%m-%d %H:%M:%S", times));
+}
+
+//
+//Function: json_uint() outputs the member key with the number n.
+void json_uint(struct LIFER_JSON* js, const char* key, uint64_t n)
+{
+  json_key(js, key);
+  obuf_uint(js->out, n);
+}
+
+//
+//Function: json_hex() outputs the member key with the len bytes at data as
+//          a string of hex digits.
+void json_hex(struct LIFER_JSON* js, const char* key, const unsigned char* data, size_t len)
+{
+  const char* hex = "0123456789ABCDEF";
+  size_t i;
+
+  json_key(js, key);
+  obuf_chr(js->out, '"');
+  for (i = 0; i < len; i++)
+  {
+    obuf_chr(js->out, hex[data[i] >> 4]);
+    obuf_chr(js->out, hex[data[i] & 0x0F]);
+  }
+  obuf_chr(js->out, '"');
+}
+
+//
+//Function: json_droid() outputs one of the droids in a TrackerDataBlock as an
+//          object called key.
+void json_droid(struct LIFER_JSON* js, const char* key, struct LIF_CLSID_A* droid, int less)
+{
+  json_open(js, key, '{');
+  json_str(js, "UUID", droid->UUID);
+  if (less == 0)
+  {
+    json_str(js, "Version", droid->Version);
+    json_str(js, "Variant", droid->Variant);
+  }
+  if ((droid->Version[0] == '1') & (droid->Version[1] == ' '))
+  {
+    json_str(js, "Sequence", droid->ClockSeq);
+    json_str(js, "Time", (less == 0) ? droid->Time_long : droid->Time);
+    json_str(js, "Node", droid->Node);
+  }
+  json_close(js, '}');
+}
+
+//
+//Function: json_out() takes the decoded link file and outputs it as a single
+//          line JSON object (lif_a is the ASCII version of lif) to out. The
+//          members are written as they are reached, there is no tree built
+//          in memory first. The names follow the elements of the XML output.
+void json_out(struct OBUF* out, struct LIF* lif, struct LIF_A* lif_a, struct stat* statbuf, int times, char* fname, int less, int itemid)
+{
+  int            i, j, k, idpos = 0;
+  struct LIF_PROPERTY_STORE_PROPS  psp;
+  struct LIF_SER_PROPSTORE_A  psa;
+  struct LIFER_JSON js;
+  struct LIF_SER_PROPSTORE_A* store;
+  const char*    strnames[5] = { "NAME_STRING", "RELATIVE_PATH", "WORKING_DIR",
+                                 "COMMAND_LINE_ARGUMENTS", "ICON_LOCATION" };
+
+  js.out = out;
+  js.depth = 0;
+  js.used[0] = 0;
+  json_open(&js, NULL, '{');
+
+  // stat data
+  json_open(&js, "FileSystemInfo", '{');
+  json_str(&js, "FileName", fname);
+  json_uint(&js, "LinkFileSize", (unsigned int)statbuf->st_size);
+  json_open(&js, "FileTimes", '{');
+  json_time(&js, "LastAccessed", &statbuf->st_atime, times);
+  json_time(&js, "LastModified", &statbuf->st_mtime, times);
+  json_time(&js, "LastChanged", &statbuf->st_ctime, times);
+  json_close(&js, '}');
+  json_close(&js, '}');
+
+  json_open(&js, "EmbeddedInfo", '{');
+  //ShellLinkHeader
+  json_open(&js, "ShellLinkHeader", '{');
+  json_str(&js, "Size", lif_a->lha.H_size);
+  if (less == 0)
+  {
+    json_str(&js, "CLSID", lif_a->lha.CLSID);
+    json_str(&js, "Flags", lif_a->lha.Flags);
+  }
+  json_str(&js, "Attributes", lif_a->lha.Attr);
+  json_open(&js, "TargetTimes", '{');
+  json_str(&js, "Created", (less == 0) ? lif_a->lha.CrDate_long : lif_a->lha.CrDate);
+  json_str(&js, "Accessed", (less == 0) ? lif_a->lha.AcDate_long : lif_a->lha.AcDate);
+  json_str(&js, "LastWritten", (less == 0) ? lif_a->lha.WtDate_long : lif_a->lha.WtDate);
+  json_close(&js, '}');
+  json_str(&js, "TargetFileSize", lif_a->lha.Size);
+  if (less == 0) //omit this stuff if short info required
+  {
+    json_str(&js, "IconIndex", lif_a->lha.IconIndex);
+    json_str(&js, "WindowState", lif_a->lha.ShowState);
+    json_str(&js, "HotKeys", lif_a->lha.Hotkey);
+    json_str(&js, "Reserved1", lif_a->lha.Reserved1);
+    json_str(&js, "Reserved2", lif_a->lha.Reserved2);
+    json_str(&js, "Reserved3", lif_a->lha.Reserved3);
+  }
+  json_close(&js, '}');
+
+  // ItemIDList
+  if ((lif->lh.Flags & 0x00000001) && (less == 0)) //IDLists are not output for shortened output
+  {
+    json_open(&js, "LinkTargetIDList", '{');
+    json_uint(&js, "Size", lif->lidl.IDListSize);
+    json_uint(&js, "NumItemIDs", lif->lidl.NumItemIDs);
+    if (itemid > 0) // If the '-i' option is switched on
+    {
+      json_open(&js, "ItemIDs", '[');
+      idpos = lif->lh.H_size;
+      for (i = 0; i < lif->lidl.NumItemIDs; i++)
+      {
+        json_open(&js, NULL, '{');
+        json_uint(&js, "Num", i + 1);
+        json_str(&js, "Size", lif_a->lidla.Items[i].ItemIDSize);
+        if (find_propstores((unsigned char*)&lif->lidl.Items[i].Data, (lif->lidl.Items[i].ItemIDSize < MAXITEMIDSIZE) ? lif->lidl.Items[i].ItemIDSize : MAXITEMIDSIZE, idpos, &psp) == 0)
+        {
+          json_open(&js, "PropStoreProps", '{');
+          json_uint(&js, "Size", psp.Size);
+          json_uint(&js, "FileOffset", psp.Posn);
+          json_uint(&js, "NumStores", psp.NumStores);
+          json_open(&js, "PropertyStores", '[');
+          for (j = 0; j < psp.NumStores; j++)
+          {
+            json_open(&js, NULL, '{');
+            json_uint(&js, "Num", j + 1);
+            if (get_propstore_a(&psp.Stores[j], &psa) == 0)
+            {
+              json_str(&js, "Size", psa.StorageSize);
+              json_str(&js, "Version", psa.Version);
+              json_str(&js, "FormatID", psa.FormatID.UUID);
+              json_str(&js, "NameType", psa.NameType);
+              json_str(&js, "NumValues", psa.NumValues);
+              json_open(&js, "PropValues", '[');
+              for (k = 0; k < psp.Stores[j].NumValues; k++)
+              {
+                json_open(&js, NULL, '{');
+                json_uint(&js, "Num", k + 1);
+                json_str(&js, "Size", psa.PropValues[k].ValueSize);
+                if (psp.Stores[j].PropValues[k].ValueSize > 0)
+                {
+                  if (psp.Stores[j].NameType == 0)
+                  {
+                    json_str(&js, "NameSize", psa.PropValues[k].NameSizeOrID);
+                    json_str(&js, "Name", psa.PropValues[k].Name);
+                  }
+                  else
+                  {
+                    json_str(&js, "ID", psa.PropValues[k].NameSizeOrID);
+                  }
+                  json_str(&js, "Type", psa.PropValues[k].PropertyType);
+                  json_str(&js, "Content", psa.PropValues[k].Value);
+                }
+                json_close(&js, '}');
+              }
+              json_close(&js, ']');
+            }
+            else
+            {
+              json_str(&js, "Error", "Unable to interpret Property Store");
+            }
+            json_close(&js, '}');
+          }
+          json_close(&js, ']');
+          json_close(&js, '}');
+        }
+        else
+        {
+          // No Property Stores found in this ItemID so give the raw data
+          json_hex(&js, "Data", (unsigned char*)&lif->lidl.Items[i].Data, (lif->lidl.Items[i].ItemIDSize < MAXITEMIDSIZE) ? lif->lidl.Items[i].ItemIDSize : MAXITEMIDSIZE);
+        }
+        idpos += lif->lidl.Items[i].ItemIDSize; // point idpos at the start of the next ItemID
+        json_close(&js, '}');
+      }
+      json_close(&js, ']');
+    }
+    json_close(&js, '}');
+  }
+
+  //LinkInfo
+  if (lif->lh.Flags & 0x00000002) //If there is a LinkInfo
+  {
+    json_open(&js, "LinkInfo", '{');
+    json_str(&js, "Size", lif_a->lia.Size);
+    if (less == 0)
+    {
+      json_open(&js, "LinkInfoHeader", '{');
+      json_str(&js, "Size", lif_a->lia.HeaderSize);
+      json_str(&js, "Flags", lif_a->lia.Flags);
+      json_str(&js, "VolumeIDOffset", lif_a->lia.IDOffset);
+      json_str(&js, "BasePathOffset", lif_a->lia.LBPOffset);
+      json_str(&js, "CNRLinkOffset", lif_a->lia.CNRLOffset);
+      json_str(&js, "CPSOffset", lif_a->lia.CPSOffset);
+      json_str(&js, "LBPOffsetUnicode", lif_a->lia.LBPOffsetU);
+      json_str(&js, "CPSOffsetUnicode", lif_a->lia.CPSOffsetU);
+      json_close(&js, '}');
+    }
+    //There is a Volume ID structure (& LBP)
+    if (lif->li.Flags & 0x00000001)
+    {
+      json_open(&js, "VolumeID", '{');
+      json_str(&js, "Size", lif_a->lia.VolID.Size);
+      json_str(&js, "DriveType", lif_a->lia.VolID.DriveType);
+      json_str(&js, "DriveSerialNo", lif_a->lia.VolID.DriveSN);
+      if (!(lif->li.HeaderSize >= 0x00000024)) //ANSI or Unicode versions?
+      {
+        if (less == 0)
+        {
+          json_str(&js, "VolLabelOffset", lif_a->lia.VolID.VLOffset);
+        }
+        json_str(&js, "VolumeLabel", lif_a->lia.VolID.VolumeLabel);
+      }
+      else
+      {
+        if (less == 0)
+        {
+          json_str(&js, "VolLabelOffsetUnicode", lif_a->lia.VolID.VLOffsetU);
+        }
+        json_str(&js, "VolumeLabelUnicode", lif_a->lia.VolID.VolumeLabelU);
+      }
+      json_str(&js, "LocalBasePath", lif_a->lia.LBP);
+      json_close(&js, '}');
+    }
+    //CommonNetworkRelativeLink
+    if (lif->li.Flags & 0x00000002)
+    {
+      json_open(&js, "CommonNetworkRelativeLink", '{');
+      json_str(&js, "Size", lif_a->lia.CNR.Size);
+      if (less == 0)
+      {
+        json_str(&js, "Flags", lif_a->lia.CNR.Flags);
+        json_str(&js, "NetNameOffset", lif_a->lia.CNR.NetNameOffset);
+        json_str(&js, "DeviceNameOffset", lif_a->lia.CNR.DeviceNameOffset);
+      }
+      json_str(&js, "NetProviderType", lif_a->lia.CNR.NetworkProviderType);
+      if ((less == 0) && (lif->li.CNR.NetNameOffset > 0x00000014))
+      {
+        json_str(&js, "NetNameOffsetUnicode", lif_a->lia.CNR.NetNameOffsetU);
+        json_str(&js, "DeviceNameOffsetUnicode", lif_a->lia.CNR.DeviceNameOffsetU);
+      }
+      json_str(&js, "NetName", lif_a->lia.CNR.NetName);
+      json_str(&js, "DeviceName", lif_a->lia.CNR.DeviceName);
+      if (lif->li.CNR.NetNameOffset > 0x00000014)
+      {
+        json_str(&js, "NetNameUnicode", lif_a->lia.CNR.NetNameU);
+        json_str(&js, "DeviceNameUnicode", lif_a->lia.CNR.DeviceNameU);
+      }
+      json_str(&js, "CommonPathSuffix", lif_a->lia.CPS);
+      json_close(&js, '}');
+    }
+    if (lif->li.LBPOffsetU > 0)
+    {
+      json_str(&js, "LocalBasePathUnicode", lif_a->lia.LBPU);
+    }
+    if (lif->li.CPSOffsetU > 0)
+    {
+      json_str(&js, "CommonPathSuffixUnicode", lif_a->lia.CPSU);
+    }
+    json_close(&js, '}');
+  }//End of Link Info
+
+  //STRINGDATA
+  if (lif->lh.Flags & 0x0000007C)
+  {
+    json_open(&js, "StringData", '{');
+    json_str(&js, "Size", lif_a->lsda.Size);
+    for (i = 0; i < 5; i++)
+    {
+      if (lif->lh.Flags & (0x00000004 << i))
+      {
+        json_open(&js, strnames[i], '{');
+        json_str(&js, "Characters", lif_a->lsda.CountChars[i]);
+        json_str(&js, "Value", lif_a->lsda.Data[i]);
+        json_close(&js, '}');
+      }
+    }
+    json_close(&js, '}');
+  }// End of STRINGDATA
+
+  //EXTRADATA
+  json_open(&js, "ExtraData", '{');
+  json_str(&js, "Size", lif_a->leda.Size);
+  json_str(&js, "EDStructures", lif_a->leda.edtypes);
+  if (lif->led.edtypes & CONSOLE_PROPS)
+  {
+    json_open(&js, "ConsoleDataBlock", '{');
+    json_str(&js, "FileOffset", lif_a->leda.lcpa.Posn);
+    json_str(&js, "Size", lif_a->leda.lcpa.Size);
+    if (less == 0)
+    {
+      json_str(&js, "BlockSignature", lif_a->leda.lcpa.sig);
+      json_str(&js, "FillAttributes", lif_a->leda.lcpa.FillAttributes);
+      json_str(&js, "PopupFillAttributes", lif_a->leda.lcpa.PopupFillAttributes);
+      json_str(&js, "ScreenBufSizeX", lif_a->leda.lcpa.ScreenBufferSizeX);
+      json_str(&js, "ScreenBufSizeY", lif_a->leda.lcpa.ScreenBufferSizeY);
+      json_str(&js, "WindowSizeX", lif_a->leda.lcpa.WindowSizeX);
+      json_str(&js, "WindowSizeY", lif_a->leda.lcpa.WindowSizeY);
+      json_str(&js, "WindowOriginX", lif_a->leda.lcpa.WindowOriginX);
+      json_str(&js, "WindowOriginY", lif_a->leda.lcpa.WindowOriginY);
+      json_str(&js, "Unused1", lif_a->leda.lcpa.Unused1);
+      json_str(&js, "Unused2", lif_a->leda.lcpa.Unused2);
+      json_str(&js, "FontHeight", lif_a->leda.lcpa.FontHeight);
+      json_str(&js, "FontWidth", lif_a->leda.lcpa.FontWidth);
+      json_str(&js, "FontFamily", lif_a->leda.lcpa.FontFamily);
+      json_str(&js, "FontPitch", lif_a->leda.lcpa.FontPitch);
+      json_str(&js, "FontWeight", lif_a->leda.lcpa.FontWeight);
+      json_str(&js, "FaceName", lif_a->leda.lcpa.FaceName);
+      json_str(&js, "CursorSize", lif_a->leda.lcpa.CursorSize);
+      json_str(&js, "FullScreen", lif_a->leda.lcpa.FullScreen);
+      json_str(&js, "QuickEdit", lif_a->leda.lcpa.QuickEdit);
+      json_str(&js, "InsertMode", lif_a->leda.lcpa.InsertMode);
+      json_str(&js, "AutoPosition", lif_a->leda.lcpa.AutoPosition);
+      json_str(&js, "HistoryBufferSize", lif_a->leda.lcpa.HistoryBufferSize);
+      json_str(&js, "NumberOfHistoryBuffers", lif_a->leda.lcpa.NumberOfHistoryBuffers);
+      json_str(&js, "HistoryNoDuplicates", lif_a->leda.lcpa.HistoryNoDup);
+      json_open(&js, "ColorTable", '[');
+      for (i = 0; i < 16; i++)
+      {
+        json_str(&js, NULL, lif_a->leda.lcpa.ColorTable[i]);
+      }
+      json_close(&js, ']');
+    }
+    json_close(&js, '}');
+  }
+  if (lif->led.edtypes & CONSOLE_FE_PROPS)
+  {
+    json_open(&js, "ConsoleFEDataBlock", '{');
+    json_str(&js, "FileOffset", lif_a->leda.lcfepa.Posn);
+    json_str(&js, "Size", lif_a->leda.lcfepa.Size);
+    if (less == 0)
+    {
+      json_str(&js, "BlockSignature", lif_a->leda.lcfepa.sig);
+    }
+    json_str(&js, "CodePage", lif_a->leda.lcfepa.CodePage);
+    json_close(&js, '}');
+  }
+  if (lif->led.edtypes & DARWIN_PROPS)
+  {
+    json_open(&js, "DarwinDataBlock", '{');
+    json_str(&js, "FileOffset", lif_a->leda.ldpa.Posn);
+    json_str(&js, "Size", lif_a->leda.ldpa.Size);
+    if (less == 0)
+    {
+      json_str(&js, "BlockSignature", lif_a->leda.ldpa.sig);
+    }
+    json_str(&js, "DarwinDataAnsi", lif_a->leda.ldpa.DarwinDataAnsi);
+    json_str(&js, "DarwinDataUnicode", lif_a->leda.ldpa.DarwinDataUnicode);
+    json_close(&js, '}');
+  }
+  if (lif->led.edtypes & ENVIRONMENT_PROPS)
+  {
+    json_open(&js, "EnvironmentVariableDataBlock", '{');
+    json_str(&js, "FileOffset", lif_a->leda.lepa.Posn);
+    json_str(&js, "Size", lif_a->leda.lepa.Size);
+    if (less == 0)
+    {
+      json_str(&js, "BlockSignature", lif_a->leda.lepa.sig);
+    }
+    json_str(&js, "TargetAnsi", lif_a->leda.lepa.TargetAnsi);
+    json_str(&js, "TargetUnicode", lif_a->leda.lepa.TargetUnicode);
+    json_close(&js, '}');
+  }
+  if (lif->led.edtypes & ICON_ENVIRONMENT_PROPS)
+  {
+    json_open(&js, "IconEnvironmentDataBlock", '{');
+    json_str(&js, "FileOffset", lif_a->leda.liepa.Posn);
+    json_str(&js, "Size", lif_a->leda.liepa.Size);
+    if (less == 0)
+    {
+      json_str(&js, "BlockSignature", lif_a->leda.liepa.sig);
+    }
+    json_str(&js, "TargetAnsi", lif_a->leda.liepa.TargetAnsi);
+    json_str(&js, "TargetUnicode", lif_a->leda.liepa.TargetUnicode);
+    json_close(&js, '}');
+  }
+  if (lif->led.edtypes & KNOWN_FOLDER_PROPS)
+  {
+    json_open(&js, "KnownFolderDataBlock", '{');
+    json_str(&js, "FileOffset", lif_a->leda.lkfpa.Posn);
+    json_str(&js, "Size", lif_a->leda.lkfpa.Size);
+    if (less == 0)
+    {
+      json_str(&js, "BlockSignature", lif_a->leda.lkfpa.sig);
+    }
+    json_str(&js, "KnownFolderID", lif_a->leda.lkfpa.KFGUID.UUID);
+    if (less == 0)
+    {
+      json_str(&js, "LocalOffset", lif_a->leda.lkfpa.KFOffset);
+    }
+    json_close(&js, '}');
+  }
+  if (lif->led.edtypes & PROPERTY_STORE_PROPS)
+  {
+    json_open(&js, "PropertyStoreDataBlock", '{');
+    json_str(&js, "FileOffset", lif_a->leda.lpspa.Posn);
+    json_str(&js, "Size", lif_a->leda.lpspa.Size);
+    json_str(&js, "NumStores", lif_a->leda.lpspa.NumStores);
+    if (less == 0)
+    {
+      json_str(&js, "BlockSignature", lif_a->leda.lpspa.sig);
+      json_open(&js, "PropertyStores", '[');
+      for (i = 0; i < lif->led.lpsp.NumStores; i++)
+      {
+        store = &lif_a->leda.lpspa.Stores[i];
+        json_open(&js, NULL, '{');
+        json_str(&js, "Size", store->StorageSize);
+        json_str(&js, "NumValues", store->NumValues);
+        json_str(&js, "Version", store->Version);
+        json_str(&js, "FormatID", store->FormatID.UUID);
+        json_str(&js, "NameType", store->NameType);
+        json_open(&js, "PropertyValues", '[');
+        for (j = 0; j < lif->led.lpsp.Stores[i].NumValues; j++)
+        {
+          json_open(&js, NULL, '{');
+          json_str(&js, "Size", store->PropValues[j].ValueSize);
+          if (lif->led.lpsp.Stores[i].PropValues[j].ValueSize > 0)
+          {
+            if (lif->led.lpsp.Stores[i].NameType == 0)
+            {
+              json_str(&js, "NameSize", store->PropValues[j].NameSizeOrID);
+              json_str(&js, "Name", store->PropValues[j].Name);
+            }
+            else
+            {
+              json_str(&js, "ID", store->PropValues[j].NameSizeOrID);
+            }
+            json_str(&js, "PropertyType", store->PropValues[j].PropertyType);
+            json_str(&js, "Value", store->PropValues[j].Value);
+          }
+          json_close(&js, '}');
+        }
+        json_close(&js, ']');
+        json_close(&js, '}');
+      }
+      json_close(&js, ']');
+    }
+    json_close(&js, '}');
+  }
+  if (lif->led.edtypes & SHIM_PROPS)
+  {
+    json_open(&js, "ShimDataBlock", '{');
+    json_str(&js, "FileOffset", lif_a->leda.lspa.Posn);
+    json_str(&js, "Size", lif_a->leda.lspa.Size);
+    if (less == 0)
+    {
+      json_str(&js, "BlockSignature", lif_a->leda.lspa.sig);
+      json_str(&js, "LayerName", lif_a->leda.lspa.LayerName);
+    }
+    json_close(&js, '}');
+  }
+  if (lif->led.edtypes & SPECIAL_FOLDER_PROPS)
+  {
+    json_open(&js, "SpecialFolderDataBlock", '{');
+    json_str(&js, "FileOffset", lif_a->leda.lsfpa.Posn);
+    json_str(&js, "Size", lif_a->leda.lsfpa.Size);
+    if (less == 0)
+    {
+      json_str(&js, "BlockSignature", lif_a->leda.lsfpa.sig);
+      json_str(&js, "FolderID", lif_a->leda.lsfpa.SpecialFolderID);
+      json_str(&js, "Offset", lif_a->leda.lsfpa.Offset);
+    }
+    json_close(&js, '}');
+  }
+  if (lif->led.edtypes & TRACKER_PROPS)
+  {
+    json_open(&js, "TrackerDataBlock", '{');
+    json_str(&js, "FileOffset", lif_a->leda.ltpa.Posn);
+    json_str(&js, "Size", lif_a->leda.ltpa.Size);
+    if (less == 0)
+    {
+      json_str(&js, "BlockSignature", lif_a->leda.ltpa.sig);
+      json_str(&js, "Length", lif_a->leda.ltpa.Length);
+      json_str(&js, "Version", lif_a->leda.ltpa.Version);
+    }
+    json_str(&js, "MachineID", lif_a->leda.ltpa.MachineID);
+    json_droid(&js, "Droid1", &lif_a->leda.ltpa.Droid1, less);
+    json_droid(&js, "Droid2", &lif_a->leda.ltpa.Droid2, less);
+    //Rather a simplistic test to see if the two sets of Droids are the same
+    if (!((lif->led.ltp.Droid1.Data1 == lif->led.ltp.DroidBirth1.Data1)
+      & (lif->led.ltp.Droid2.Data1 == lif->led.ltp.DroidBirth2.Data1)
+      & (less != 0)))
+    {
+      json_droid(&js, "DroidBirth1", &lif_a->leda.ltpa.DroidBirth1, less);
+      json_droid(&js, "DroidBirth2", &lif_a->leda.ltpa.DroidBirth2, less);
+    }
+    json_close(&js, '}');
+  }
+  if (lif->led.edtypes & VISTA_AND_ABOVE_IDLIST_PROPS)
+  {
+    json_open(&js, "VistaAndAboveIDListDataBlock", '{');
+    json_str(&js, "FileOffset", lif_a->leda.lvidlpa.Posn);
+    json_str(&js, "Size", lif_a->leda.lvidlpa.Size);
+    if (less == 0)
+    {
+      json_str(&js, "BlockSignature", lif_a->leda.lvidlpa.sig);
+      json_str(&js, "NumItems", lif_a->leda.lvidlpa.NumItemIDs);
+    }
+    json_close(&js, '}');
+  }
+  json_close(&js, '}');
+
+  json_close(&js, '}');
+  json_close(&js, '}');
+  obuf_chr(out, '\n');
+}
+
+//
+//Function: arrow_int() and arrow_str() append a cell to the Arrow row out,
+//          holding n or str if present is set or a null if it isn't.
+void arrow_int(struct OBUF* out, const char* name, enum IPC_TYPE type, int present, int64_t n)
+{
+  if (present)
+  {
+    ipc_cell_int(out, name, type, n);
+  }
+  else
+  {
+    ipc_cell_null(out, name, type);
+  }
+}
+
+void arrow_str(struct OBUF* out, const char* name, enum IPC_TYPE type, int present, const void* str)
+{
+  if (present)
+  {
+    ipc_cell_str(out, name, type, str);
+  }
+  else
+  {
+    ipc_cell_null(out, name, type);
+  }
+}
+
+//
+//Function: arrow_droid() appends the cells for one of the UUIDs in a
+//          TrackerDataBlock. names holds the column names for the UUID, its
+//          version, variant, time, clock sequence and node. The time is a
+//          FILETIME, worked out as get_droid_a() does, and it and the clock
+//          sequence and node are null unless the UUID is time based.
+void arrow_droid(struct OBUF* out, const char* const* names, enum IPC_TYPE type, int present, struct LIF_CLSID* droid, struct LIF_CLSID_A* droid_a, int less)
+{
+  int version = (droid->Data3 & 0xF000) >> 12;
+  int timed = present && (version == 1);
+  int64_t ft;
+
+  //UUID times count 100ns intervals from 1582-10-15, FILETIMEs from 1601-01-01
+  ft = (int64_t)droid->Data1 + ((int64_t)droid->Data2 << 32) + ((int64_t)(droid->Data3 & 0x0FFF) << 48);
+  ft -= (int64_t)10000000 * (60 * 60 * 24) * (17 + 30 + 31 + (365 * 18) + 5);
+
+  arrow_str(out, names[0], type, present, droid_a->UUID);
+  if (less == 0)
+  {
+    arrow_int(out, names[1], IPC_UINT32, present, version);
+    arrow_str(out, names[2], IPC_DICT, present, droid_a->Variant);
+  }
+  arrow_int(out, names[3], IPC_INT64, timed, ft);
+  arrow_int(out, names[4], IPC_UINT32, timed, ((droid->Data4hi[0] & 0x3F) << 8) | droid->Data4hi[1]);
+  arrow_str(out, names[5], IPC_DICT, timed, droid_a->Node);
+}
+
+//
+//Function: arrow_out() takes the decoded link file and appends it to out as
+//          a row of Arrow cells (see libipc). The columns are those of the
+//          csv output but each keeps its type: numbers, flags and sizes are
+//          integers, the embedded times are FILETIMEs (int64) and the times
+//          of the link file itself are timestamps. Strings that repeat from
+//          file to file are dictionary encoded. A value from a part of the
+//          link file that isn't there is null rather than "[N/A]".
+void arrow_out(struct OBUF* out, struct LIF* lif, struct LIF_A* lif_a, struct stat* statbuf, int times, char* fname, int less)
+{
+  char colors[16 * 12];
+  int  i;
+  int  idlist = (lif->lh.Flags & 0x00000001) != 0;        // HasLinkTargetIDList
+  int  info = (lif->lh.Flags & 0x00000002) != 0;          // HasLinkInfo
+  int  volid = info && (lif->li.Flags & 0x00000001);      // VolumeIDAndLocalBasePath
+  int  cnr = info && (lif->li.Flags & 0x00000002);        // CommonNetworkRelativeLinkAndPathSuffix
+  uint32_t ed = lif->led.edtypes;
+  static const char* const strnames[5][2] = {
+    { "StrData Name Num Chars", "StrData - Name" },
+    { "StrData Rel Path Num Chars", "StrData Relative Path" },
+    { "StrData Working Dir Num Chars", "StrData Working Dir" },
+    { "StrData Cmd Line Args Num Chars", "StrData Cmd Line Args" },
+    { "StrData Icon Loc Num Chars", "StrData Icon Location" } };
+  static const enum IPC_TYPE strtypes[5] = { IPC_DICT, IPC_UTF8, IPC_DICT, IPC_UTF8, IPC_DICT };
+  static const char* const droid1[6] = { "ED TrackerData Droid1", "ED TD Droid1 Version",
+    "ED TD Droid1 Variant", "ED TD Droid1 Time", "ED TD Droid1 Clock Seq", "ED TD Droid1 Node" };
+  static const char* const droid2[6] = { "ED TrackerData Droid2", "ED TD Droid2 Version",
+    "ED TD Droid2 Variant", "ED TD Droid2 Time", "ED TD Droid2 Clock Seq", "ED TD Droid2 Node" };
+  static const char* const birth1[6] = { "ED TrackerData DroidBirth1", "ED TD DroidBirth1 Version",
+    "ED TD DroidBirth1 Variant", "ED TD DroidBirth1 Time", "ED TD DroidBirth1 Clock Seq", "ED TD DroidBirth1 Node" };
+  static const char* const birth2[6] = { "ED TrackerData DroidBirth2", "ED TD DroidBirth2 Version",
+    "ED TD DroidBirth2 Variant", "ED TD DroidBirth2 Time", "ED TD DroidBirth2 Clock Seq", "ED TD DroidBirth2 Node" };
+
+  ipc_cell_str(out, "File Name", IPC_UTF8, fname);
+  if (less == 0)
+  {
+    ipc_cell_int(out, "Link File Size", IPC_INT64, (int64_t)statbuf->st_size);
+  }
+  arrow_int(out, "Link File Last Accessed", IPC_TIMESTAMP, times, (int64_t)statbuf->st_atime);
+  arrow_int(out, "Link File Last Modified", IPC_TIMESTAMP, times, (int64_t)statbuf->st_mtime);
+  arrow_int(out, "Link File Last Changed", IPC_TIMESTAMP, times, (int64_t)statbuf->st_ctime);
+  if (less == 0)
+  {
+    ipc_cell_int(out, "Hdr Size", IPC_UINT32, lif->lh.H_size);
+    ipc_cell_str(out, "Hdr CLSID", IPC_DICT, lif_a->lha.CLSID);
+    ipc_cell_int(out, "Hdr Flags", IPC_UINT32, lif->lh.Flags);
+  }
+  ipc_cell_int(out, "Hdr Attributes", IPC_UINT32, lif->lh.Attr);
+  ipc_cell_int(out, "Hdr FileCreate", IPC_INT64, lif->lh.CrDate);
+  ipc_cell_int(out, "Hdr FileAccess", IPC_INT64, lif->lh.AcDate);
+  ipc_cell_int(out, "Hdr FileWrite", IPC_INT64, lif->lh.WtDate);
+  ipc_cell_int(out, "Hdr TargetSize", IPC_UINT32, lif->lh.Size);
+  if (less == 0)
+  {
+    ipc_cell_int(out, "Hdr IconIndex", IPC_INT32, lif->lh.IconIndex);
+    ipc_cell_int(out, "Hdr WindowState", IPC_UINT32, lif->lh.ShowState);
+    ipc_cell_int(out, "Hdr HotKeys", IPC_UINT32, (lif->lh.Hotkey.HighKey << 8) | lif->lh.Hotkey.LowKey);
+    ipc_cell_int(out, "Hdr Reserved1", IPC_UINT32, lif->lh.Reserved1);
+    ipc_cell_int(out, "Hdr Reserved2", IPC_UINT32, lif->lh.Reserved2);
+    ipc_cell_int(out, "Hdr Reserved3", IPC_UINT32, lif->lh.Reserved3);
+    arrow_int(out, "IDList Size", IPC_UINT32, idlist, lif->lidl.IDListSize);
+    arrow_int(out, "IDList No Items", IPC_UINT32, idlist, lif->lidl.NumItemIDs);
+    arrow_int(out, "LinkInfo Size", IPC_UINT32, info, lif->li.Size);
+    arrow_int(out, "LinkInfo Hdr Size", IPC_UINT32, info, lif->li.HeaderSize);
+    arrow_int(out, "LinkInfo Flags", IPC_UINT32, info, lif->li.Flags);
+    arrow_int(out, "LinkInfo VolID Offset", IPC_UINT32, info, lif->li.IDOffset);
+    arrow_int(out, "LinkInfo Base Path Offset", IPC_UINT32, info, lif->li.LBPOffset);
+    arrow_int(out, "LinkInfo CNR Offset", IPC_UINT32, info, lif->li.CNRLOffset);
+    arrow_int(out, "LinkInfo CPS Offset", IPC_UINT32, info, lif->li.CPSOffset);
+    arrow_int(out, "LinkInfo LBP Offset Unicode", IPC_UINT32, info, lif->li.LBPOffsetU);
+    arrow_int(out, "LinkInfo CPS Offset Unicode", IPC_UINT32, info, lif->li.CPSOffsetU);
+    arrow_int(out, "LinkInfo VolID Size", IPC_UINT32, volid, lif->li.VolID.Size);
+  }
+  arrow_int(out, "LinkInfo VolID Drive Type", IPC_UINT32, volid, lif->li.VolID.DriveType);
+  arrow_int(out, "LinkInfo VolID Drive Ser No", IPC_UINT32, volid, lif->li.VolID.DriveSN);
+  if (less == 0)
+  {
+    arrow_int(out, "LinkInfo VolID VLOffset", IPC_UINT32, volid, lif->li.VolID.VLOffset);
+    arrow_int(out, "LinkInfo VolID VLOffsetU", IPC_UINT32, volid, lif->li.VolID.VLOffsetU);
+  }
+  arrow_str(out, "LinkInfo VolID Vol Label", IPC_DICT, volid, lif_a->lia.VolID.VolumeLabel);
+  arrow_str(out, "LinkInfo VolID Vol LabelU", IPC_DICT, volid && (lif->li.VolID.VLOffsetU > 0), lif_a->lia.VolID.VolumeLabelU);
+  arrow_str(out, "LinkInfo Local Base Path", IPC_UTF8, volid, lif_a->lia.LBP);
+  if (less == 0)
+  {
+    arrow_int(out, "LinkInfo CNR Size", IPC_UINT32, cnr, lif->li.CNR.Size);
+    arrow_int(out, "LinkInfo CNR Flags", IPC_UINT32, cnr, lif->li.CNR.Flags);
+    arrow_int(out, "LinkInfo CNR NetNameOffset", IPC_UINT32, cnr, lif->li.CNR.NetNameOffset);
+    arrow_int(out, "LinkInfo CNR DeviceNameOffset", IPC_UINT32, cnr, lif->li.CNR.DeviceNameOffset);
+  }
+  //ValidNetType and ValidDevice say whether the provider type and device name are there
+  arrow_int(out, "LinkInfo CNR NetwkProviderType", IPC_UINT32, cnr && (lif->li.CNR.Flags & 0x00000002), lif->li.CNR.NetworkProviderType);
+  if (less == 0)
+  {
+    arrow_int(out, "LinkInfo CNR NetNameOffsetU", IPC_UINT32, cnr, lif->li.CNR.NetNameOffsetU);
+    arrow_int(out, "LinkInfo CNR DeviceNameOffsetU", IPC_UINT32, cnr, lif->li.CNR.DeviceNameOffsetU);
+  }
+  arrow_str(out, "LinkInfo CNR NetName", IPC_DICT, cnr, lif_a->lia.CNR.NetName);
+  arrow_str(out, "LinkInfo CNR DeviceName", IPC_DICT, cnr && (lif->li.CNR.Flags & 0x00000001), lif_a->lia.CNR.DeviceName);
+  arrow_str(out, "LinkInfo CNR NetNameU", IPC_DICT, cnr && (lif->li.CNR.NetNameOffsetU > 0), lif_a->lia.CNR.NetNameU);
+  arrow_str(out, "LinkInfo CNR DeviceNameU", IPC_DICT, cnr && (lif->li.CNR.DeviceNameOffsetU > 0), lif_a->lia.CNR.DeviceNameU);
+  arrow_str(out, "LinkInfo Common Path Suffix", IPC_DICT, info, lif_a->lia.CPS);
+  arrow_str(out, "LinkInfo Local Base Path Unicode", IPC_UTF8, volid && (lif->li.LBPOffsetU > 0), lif_a->lia.LBPU);
+  arrow_str(out, "LinkInfo Common Path Suffix Unicode", IPC_DICT, info && (lif->li.CPSOffsetU > 0), lif_a->lia.CPSU);
+
+  if (less == 0)
+  {
+    ipc_cell_int(out, "StrData Total Size (bytes)", IPC_UINT32, lif->lsd.Size);
+  }
+  for (i = 0; i < 5; i++)
+  {
+    //HasName, HasRelativePath, HasWorkingDir, HasArguments and HasIconLocation
+    if (less == 0)
+    {
+      arrow_int(out, strnames[i][0], IPC_UINT32, lif->lh.Flags & (0x00000004 << i), lif->lsd.CountChars[i]);
+    }
+    arrow_str(out, strnames[i][1], strtypes[i], lif->lh.Flags & (0x00000004 << i), lif_a->lsda.Data[i]);
+  }
+  // S2.5 ExtraData
+  if (less == 0)
+  {
+    ipc_cell_int(out, "ExtraData Total Size (bytes)", IPC_UINT32, lif->led.Size);
+  }
+  ipc_cell_int(out, "ExtraData Structures", IPC_UINT32, ed);
+
+  // S2.5.1 ConsoleDataBlock
+  if (less == 0)
+  {
+    arrow_int(out, "ED CDB File Offset (bytes)", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.Posn);
+    arrow_int(out, "ED CDB Size (bytes)", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.Size);
+    arrow_int(out, "ED CDB Signature", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.sig);
+    arrow_int(out, "ED CDB FillAttributes", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.FillAttributes);
+    arrow_int(out, "ED CDB PopupFillAttr", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.PopupFillAttributes);
+    arrow_int(out, "ED CDB ScrBufSizeX", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.ScreenBufferSizeX);
+    arrow_int(out, "ED CDB ScrBufSizeY", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.ScreenBufferSizeY);
+    arrow_int(out, "ED CDB WindowSizeX", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.WindowSizeX);
+    arrow_int(out, "ED CDB WindowSizeY", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.WindowSizeY);
+    arrow_int(out, "ED CDB WindowOriginX", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.WindowOriginX);
+    arrow_int(out, "ED CDB WindowOriginY", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.WindowOriginY);
+    arrow_int(out, "ED CDB Unused1", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.Unused1);
+    arrow_int(out, "ED CDB Unused2", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.Unused2);
+    arrow_int(out, "ED CDB FontHeight", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.FontSize_Height);
+    arrow_int(out, "ED CDB FontWidth", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.FontSize_Width);
+    arrow_int(out, "ED CDB FontFamily", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.FontFamily_Family);
+    arrow_int(out, "ED CDB FontPitch", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.FontFamily_Pitch);
+    arrow_int(out, "ED CDB FontWeight", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.FontWeight);
+    arrow_str(out, "ED CDB FaceName", IPC_DICT, ed & CONSOLE_PROPS, lif_a->leda.lcpa.FaceName);
+    arrow_int(out, "ED CDB CursorSize", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.CursorSize);
+    arrow_int(out, "ED CDB FullScreen", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.FullScreen);
+    arrow_int(out, "ED CDB QuickEdit", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.QuickEdit);
+    arrow_int(out, "ED CDB InsertMode", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.InsertMode);
+    arrow_int(out, "ED CDB AutoPosition", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.AutoPosition);
+    arrow_int(out, "ED CDB HistoryBufSize", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.HistoryBufferSize);
+    arrow_int(out, "ED CDB NumHistoryBuf", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.NumberOfHistoryBuffers);
+    arrow_int(out, "ED CDB HistoryNoDup", IPC_UINT32, ed & CONSOLE_PROPS, lif->led.lcp.HistoryNoDup);
+    //The 16 colours as in the csv output, a palette is usually shared by many files
+    colors[0] = '\0';
+    for (i = 0; i < 16; i++)
+    {
+      if (i > 0)
+      {
+        strcat(colors, ";");
+      }
+      strncat(colors, (char*)lif_a->leda.lcpa.ColorTable[i], 10);
+    }
+    arrow_str(out, "ED CDB ColorTable", IPC_DICT, ed & CONSOLE_PROPS, colors);
+  }
+  // S2.5.2 ConsoleFEDataBlock
+  if (less == 0)
+  {
+    arrow_int(out, "ED CFEDB File Offset (bytes)", IPC_UINT32, ed & CONSOLE_FE_PROPS, lif->led.lcfep.Posn);
+    arrow_int(out, "ED CFEDB Size (bytes)", IPC_UINT32, ed & CONSOLE_FE_PROPS, lif->led.lcfep.Size);
+    arrow_int(out, "ED CFEDB Signature", IPC_UINT32, ed & CONSOLE_FE_PROPS, lif->led.lcfep.sig);
+    arrow_int(out, "ED CFEDB CodePage", IPC_UINT32, ed & CONSOLE_FE_PROPS, lif->led.lcfep.CodePage);
+  }
+  // S2.5.3 DarwinDataBlock
+  if (less == 0)
+  {
+    arrow_int(out, "ED DDB File Offset (bytes)", IPC_UINT32, ed & DARWIN_PROPS, lif->led.ldp.Posn);
+    arrow_int(out, "ED DDB Size (bytes)", IPC_UINT32, ed & DARWIN_PROPS, lif->led.ldp.Size);
+    arrow_int(out, "ED DDB Signature", IPC_UINT32, ed & DARWIN_PROPS, lif->led.ldp.sig);
+    arrow_str(out, "ED DDB DarwinDataAnsi", IPC_DICT, ed & DARWIN_PROPS, lif_a->leda.ldpa.DarwinDataAnsi);
+    arrow_str(out, "ED DDB DarwinDataUnicode", IPC_DICT, ed & DARWIN_PROPS, lif_a->leda.ldpa.DarwinDataUnicode);
+  }
+  // S2.5.4 EnvironmentVariableDataBlock
+  if (less == 0)
+  {
+    arrow_int(out, "ED EVDB File Offset (bytes)", IPC_UINT32, ed & ENVIRONMENT_PROPS, lif->led.lep.Posn);
+    arrow_int(out, "ED EVDB Size (bytes)", IPC_UINT32, ed & ENVIRONMENT_PROPS, lif->led.lep.Size);
+    arrow_int(out, "ED EVDB Signature", IPC_UINT32, ed & ENVIRONMENT_PROPS, lif->led.lep.sig);
+    arrow_str(out, "ED EVDB TargetAnsi", IPC_DICT, ed & ENVIRONMENT_PROPS, lif_a->leda.lepa.TargetAnsi);
+    arrow_str(out, "ED EVDB TargetUnicode", IPC_DICT, ed & ENVIRONMENT_PROPS, lif_a->leda.lepa.TargetUnicode);
+  }
+  // S2.5.5 IconEnvironmentDataBlock
+  if (less == 0)
+  {
+    arrow_int(out, "ED IEDB File Offset (bytes)", IPC_UINT32, ed & ICON_ENVIRONMENT_PROPS, lif->led.liep.Posn);
+    arrow_int(out, "ED IEDB Size (bytes)", IPC_UINT32, ed & ICON_ENVIRONMENT_PROPS, lif->led.liep.Size);
+    arrow_int(out, "ED IEDB Signature", IPC_UINT32, ed & ICON_ENVIRONMENT_PROPS, lif->led.liep.sig);
+    arrow_str(out, "ED IEDB TargetAnsi", IPC_DICT, ed & ICON_ENVIRONMENT_PROPS, lif_a->leda.liepa.TargetAnsi);
+    arrow_str(out, "ED IEDB TargetUnicode", IPC_DICT, ed & ICON_ENVIRONMENT_PROPS, lif_a->leda.liepa.TargetUnicode);
+  }
+  // S2.5.6 KnownFolderDataBlock
+  if (less == 0)
+  {
+    arrow_int(out, "ED KFDB File Offset (bytes)", IPC_UINT32, ed & KNOWN_FOLDER_PROPS, lif->led.lkfp.Posn);
+    arrow_int(out, "ED KFDB Size (bytes)", IPC_UINT32, ed & KNOWN_FOLDER_PROPS, lif->led.lkfp.Size);
+    arrow_int(out, "ED KFDB Signature", IPC_UINT32, ed & KNOWN_FOLDER_PROPS, lif->led.lkfp.sig);
+    arrow_str(out, "ED KFDB KnownFolderID", IPC_DICT, ed & KNOWN_FOLDER_PROPS, lif_a->leda.lkfpa.KFGUID.UUID);
+    arrow_int(out, "ED KFDB Offset", IPC_UINT32, ed & KNOWN_FOLDER_PROPS, lif->led.lkfp.KFOffset);
+  }
+  // S2.5.7 PropertyStoreDataBlock
+  if (less == 0)
+  {
+    arrow_int(out, "ED PS File Offset (bytes)", IPC_UINT32, ed & PROPERTY_STORE_PROPS, lif->led.lpsp.Posn);
+    arrow_int(out, "ED PS Size (bytes)", IPC_UINT32, ed & PROPERTY_STORE_PROPS, lif->led.lpsp.Size);
+    arrow_int(out, "ED PS Signature", IPC_UINT32, ed & PROPERTY_STORE_PROPS, lif->led.lpsp.sig);
+    arrow_int(out, "ED PS Number of Stores", IPC_INT32, ed & PROPERTY_STORE_PROPS, lif->led.lpsp.NumStores);
+  }
+  // S2.5.9 SpecialFolderDataBlock
+  if (less == 0)
+  {
+    arrow_int(out, "ED SFolderData File Offset (bytes)", IPC_UINT32, ed & SPECIAL_FOLDER_PROPS, lif->led.lsfp.Posn);
+    arrow_int(out, "ED SFolderData Size (bytes)", IPC_UINT32, ed & SPECIAL_FOLDER_PROPS, lif->led.lsfp.Size);
+    arrow_int(out, "ED SFolderData Signature", IPC_UINT32, ed & SPECIAL_FOLDER_PROPS, lif->led.lsfp.sig);
+    arrow_int(out, "ED SFolderData ID", IPC_UINT32, ed & SPECIAL_FOLDER_PROPS, lif->led.lsfp.SpecialFolderID);
+    arrow_int(out, "ED SFolderData Offset", IPC_UINT32, ed & SPECIAL_FOLDER_PROPS, lif->led.lsfp.Offset);
+  }
+  // S2.5.10 TrackerDataBlock
+  if (less == 0)
+  {
+    arrow_int(out, "ED TrackerData File Offset (bytes)", IPC_UINT32, ed & TRACKER_PROPS, lif->led.ltp.Posn);
+    arrow_int(out, "ED TrackerData Size (bytes)", IPC_UINT32, ed & TRACKER_PROPS, lif->led.ltp.Size);
+    arrow_int(out, "ED TrackerData Signature", IPC_UINT32, ed & TRACKER_PROPS, lif->led.ltp.sig);
+    arrow_int(out, "ED TrackerData Length", IPC_UINT32, ed & TRACKER_PROPS, lif->led.ltp.Length);
+    arrow_int(out, "ED TrackerData Version", IPC_UINT32, ed & TRACKER_PROPS, lif->led.ltp.Version);
+  }
+  arrow_str(out, "ED TrackerData MachineID", IPC_DICT, ed & TRACKER_PROPS, lif_a->leda.ltpa.MachineID);
+  //The volume droids are shared by every link to the same volume, the file droids aren't
+  arrow_droid(out, droid1, IPC_DICT, ed & TRACKER_PROPS, &lif->led.ltp.Droid1, &lif_a->leda.ltpa.Droid1, less);
+  arrow_droid(out, droid2, IPC_UTF8, ed & TRACKER_PROPS, &lif->led.ltp.Droid2, &lif_a->leda.ltpa.Droid2, less);
+  arrow_droid(out, birth1, IPC_DICT, ed & TRACKER_PROPS, &lif->led.ltp.DroidBirth1, &lif_a->leda.ltpa.DroidBirth1, less);
+  arrow_droid(out, birth2, IPC_UTF8, ed & TRACKER_PROPS, &lif->led.ltp.DroidBirth2, &lif_a->leda.ltpa.DroidBirth2, less);
+  // S2.5.11 VistaAndAboveIDListDataBlock
+  if (less == 0)
+  {
+    arrow_int(out, "ED >= Vista IDList File Offset (bytes)", IPC_UINT32, ed & VISTA_AND_ABOVE_IDLIST_PROPS, lif->led.lvidlp.Posn);
+    arrow_int(out, "ED >= Vista IDList Size", IPC_UINT32, ed & VISTA_AND_ABOVE_IDLIST_PROPS, lif->led.lvidlp.Size);
+    arrow_int(out, "ED >= Vista IDList Signature", IPC_UINT32, ed & VISTA_AND_ABOVE_IDLIST_PROPS, lif->led.lvidlp.sig);
+    arrow_int(out, "ED >= Vista IDList Num Items", IPC_UINT32, ed & VISTA_AND_ABOVE_IDLIST_PROPS, lif->led.lvidlp.NumItemIDs);
+  }
+}
+
+//
+//Function: map_file() brings the whole of the open file fname into memory.
+//          On *nix the file is memory mapped read only (so the parser works
+//          directly on the page cache) and on Windows, or if mapping fails,
+//          it is read into memory from arena. Returns a pointer to the first
+//          byte or NULL on failure. *mapped is set to 1 if the memory must be
+//          released with munmap() (see unmap_file()).
+unsigned char* map_file(char* fname, size_t len, int* mapped, struct LIF_ARENA* arena)
+{
+  unsigned char *data;
+  FILE *fp;
+#ifndef _WIN32
+  int fd;
+
+  if ((fd = open(fname, O_RDONLY)) >= 0)
+  {
+    data = (unsigned char*)mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping stays valid after the descriptor is closed
+    if (data != MAP_FAILED)
+    {
+#ifdef MADV_SEQUENTIAL
+      madvise(data, len, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_WILLNEED
+      madvise(data, len, MADV_WILLNEED);
+#endif
+      *mapped = 1;
+      return data;
+    }
+  }
+#endif
+  *mapped = 0;
+  //Try to open a file pointer
+  if ((fp = fopen(fname, "rb")) == NULL)
+  {
+    return NULL;
+  }
+  if ((data = (unsigned char*)lif_arena_alloc(arena, len)) != NULL)
+  {
+    if (fread(data, 1, len, fp) != len)
+    {
+      data = NULL;
+    }
+  }
+  if (fclose(fp) != 0)
+  {
+    //Can't close the file for some reason
+    perror("Error in function map_file()");
+    fprintf(stderr, "whilst closing file: \'%s\'\n", fname);
+    exit(EXIT_FAILURE);
+  }
+  return data;
+}
+
+//
+//Function: unmap_file() releases the memory obtained from map_file(). Memory
+//          taken from the arena is released when the arena is next reset.
+void unmap_file(unsigned char* data, size_t len, int mapped)
+{
+#ifndef _WIN32
+  if (mapped)
+  {
+    munmap(data, len);
+  }
+#endif
+}
+
+//
+//Function: out_sections() returns the sections of a link file (LIF_SECT
+//          values) whose contents the chosen output actually shows. Anything
+//          else is skipped by both get_lif_sect() and get_lif_a().
+uint32_t out_sections(struct LIFER_RUN* run)
+{
+  uint32_t sections = LIF_SECT_EXTRADATA;
+
+  if (run->output_type == sqlite)
+  {
+    //The database holds everything
+    sections = LIF_SECT_ALL;
+  }
+  else if (run->less)
+  {
+    //Shortened output only shows what is in the TrackerDataBlock, plus (for
+    //xml and jsonl) the strings held in a few of the other blocks
+    sections = TRACKER_PROPS;
+    if ((run->output_type == xml) || (run->output_type == jsonl))
+    {
+      sections |= CONSOLE_FE_PROPS | DARWIN_PROPS | ENVIRONMENT_PROPS |
+        ICON_ENVIRONMENT_PROPS | KNOWN_FOLDER_PROPS;
+    }
+  }
+  else if (run->idlist)
+  {
+    sections |= LIF_SECT_IDLIST;
+  }
+  if (run->partial)
+  {
+    sections |= LIF_SECT_PARTIAL;
+  }
+  return sections;
+}
+
+//
+//Function: put_header() outputs anything that has to go before the first
+//          record (the column names or the XML declaration).
+void put_header(struct LIFER_RUN* run, struct OBUF* out)
+{
+  switch (run->output_type)
+  {
+  case csv:
+    sv_header(out, run->less, ',');
+    break;
+  case tsv:
+    sv_header(out, run->less, '\t');
+    break;
+  case xml:
+    xml_header(out);
+    break;
+  case txt:
+  default:
+    break;
+  }
+}
+
+//
+//Function: put_damage() writes the names of the parts of a link file in damage
+//          (LIF_DMG values) to err, separated by commas.
+void put_damage(struct OBUF* err, uint32_t damage)
+{
+  static const char* parts[] = { "LinkTargetIDList", "LinkInfo", "StringData", "ExtraData", "ExtraData block size" };
+  int i, n = 0;
+
+  for (i = 0; i < (int)(sizeof(parts) / sizeof(parts[0])); i++)
+  {
+    if (damage & ((uint32_t)1 << i))
+    {
+      obuf_cat(err, (n++ > 0) ? ", " : "", parts[i], NULL);
+    }
+  }
+}
+
+//
+//Function: format_lif() writes the record for the link file decoded into lif (or
+//          the reason it couldn't be, result being what get_lif_sect()
+//          returned) to out, preceded by the header if hdr is set. fname is
+//          the name to report the file by and any errors are written to err.
+//          arena holds the ASCII data until the record has been written and
+//          is then reset. Returns 0 if a record was written or -1 if not.
+int format_lif(struct LIFER_RUN* run, struct LIF* lif, int result, struct stat* statbuf, char* fname, struct OBUF* out, struct OBUF* err, int hdr, struct LIF_ARENA* arena)
+{
+  struct LIF_A lif_a;
+  int times = !run->carve; //A carved link file has no times of its own
+
+  if ((result == LIF_ERR_HDR) || ((result <= LIF_ERR_HSIZE) && (result >= LIF_ERR_RESERVED))) // The magic is wrong
+  {
+    obuf_cat(err, "Not a Link File:\t", fname, "\n", NULL);
+    return -1;
+  }
+  if (result != LIF_OK)
+  {
+    obuf_cat(err, "Error processing file \'", fname, "\' - sorry", NULL);
+    if (lif->damage != 0)
+    {
+      obuf_str(err, " (damaged: ");
+      put_damage(err, lif->damage);
+      obuf_str(err, ")");
+    }
+    obuf_str(err, "\n");
+    return -1;
+  }
+  if (lif->damage != 0)
+  {
+    //Only LIF_DMG_BLOCKSIZE gets this far unless the run is keeping what it
+    //can of damaged link files ('-p')
+    obuf_cat(err, "Damaged Link File:\t", fname, "\t", NULL);
+    put_damage(err, lif->damage);
+    obuf_str(err, "\n");
+  }
+  if (run->output_type == sqlite)
+  {
+    //The database is written from the binary values, so the record is just
+    //the LIF and the stat data (see put_row())
+    obuf_mem(out, lif, sizeof(struct LIF));
+    obuf_mem(out, statbuf, sizeof(struct stat));
+    return 0;
+  }
+  if (get_lif_a(lif, &lif_a, arena))
+  {
+    lif_arena_reset(arena);
+    obuf_cat(err, "Could not make ASCII version of \'", fname, "\' - sorry\n", NULL);
+    return -1;
+  }
+  if (hdr)
+  {
+    put_header(run, out);
+  }
+  switch (run->output_type)
+  {
+  case csv:
+    sv_out(out, lif, &lif_a, statbuf, times, fname, run->less, ','); // Output to a separated file with the separator being a comma
+    break;
+  case tsv:
+    sv_out(out, lif, &lif_a, statbuf, times, fname, run->less, '\t'); // Output to a separated file with the separator being a tab
+    break;
+  case xml:
+    xml_out(out, lif, &lif_a, statbuf, times, fname, run->less, run->idlist);
+    break;
+  case jsonl:
+    json_out(out, lif, &lif_a, statbuf, times, fname, run->less, run->idlist);
+    break;
+  case arrow:
+    arrow_out(out, lif, &lif_a, statbuf, times, fname, run->less);
+    break;
+  case txt:
+  default:       //Anything other than these 4 options should have been
+    //trapped already - this is just belt & braces!
+    text_out(out, lif, &lif_a, statbuf, times, fname, run->less, run->idlist); // Output to plain text
+  }
+  lif_arena_reset(arena);
+  return 0;
+}
+
+//
+//Function: parse_file() decodes the link file at path and writes its record
+//          to out (see format_lif()). Returns 0 if a record was written or -1 if
+//          not.
+int parse_file(struct LIFER_RUN* run, char* path, char* fname, struct OBUF* out, struct OBUF* err, int hdr, struct LIF_ARENA* arena)
+{
+  unsigned char *data;
+  size_t len;
+  int mapped, result;
+  struct stat statbuf;
+  struct LIF lif;
+
+  if (stat(path, &statbuf) != 0)
+  {
+    //unsuccessful
+    obuf_cat(err, "Error: ", strerror(errno), "\n", NULL);
+    obuf_cat(err, "whilst processing file: \'", fname, "\'\n", NULL);
+    return -1;
+  }
+  if (statbuf.st_size < 76) //Don't bother with files that aren't big enough
+  {
+    obuf_cat(err, "Not a Link File:\t", fname, "\n", NULL);
+    return -1;
+  }
+  len = (size_t)statbuf.st_size;
+  if ((data = map_file(path, len, &mapped, arena)) == NULL)
+  {
+    //unsuccessful
+    lif_arena_reset(arena);
+    obuf_cat(err, "Error: ", strerror(errno), "\n", NULL);
+    obuf_cat(err, "whilst processing file: \'", fname, "\'\n", NULL);
+    return -1;
+  }
+  //successful
+  //Check the magic and decode the file in one pass
+  result = get_lif_sect(data, len, &lif, run->sections);
+  unmap_file(data, len, mapped);
+  lif_arena_reset(arena); //The LIF has its own copy of everything it needs
+  return format_lif(run, &lif, result, &statbuf, fname, out, err, hdr, arena);
+}
+
+//
+//Function: carve_hit() decodes the link file that starts offset bytes into
+//          the image being carved, in place, and writes its record to out
+//          (see format_lif()). Nothing past LIFER_CARVEMAX bytes from its start
+//          is looked at. If the image isn't mapped the link file is read
+//          from the image file instead (only as much of it as is needed).
+//          The link file is given the image's stat data but with its own
+//          size. Its times can't be known, so none are output (see
+//          format_lif()). Returns 0 if a record was written or -1 if not.
+int carve_hit(struct LIFER_RUN* run, uint64_t offset, char* fname, struct OBUF* out, struct OBUF* err, int hdr, struct LIF_ARENA* arena)
+{
+  size_t pos, len;
+  int result;
+  struct stat statbuf;
+  struct LIF lif;
+  struct LIF_SOURCE slice;
+
+  if (run->imagesrc != NULL)
+  {
+    //The buffer for it comes from arena
+    lif_source_slice(&slice, run->imagesrc, offset, LIFER_CARVEMAX);
+    result = get_lif_src(&slice, &lif, arena, run->sections);
+  }
+  else
+  {
+    pos = (size_t)(offset - run->imagebase);
+    len = run->imagelen - pos;
+    if (len > LIFER_CARVEMAX)
+    {
+      len = LIFER_CARVEMAX;
+    }
+    result = get_lif_sect(run->image + pos, len, &lif, run->sections);
+  }
+  statbuf = run->imagestat;
+  statbuf.st_size = 0;
+  if (result == LIF_OK)
+  {
+    //The size of the sections that were found (see get_lif_sect())
+    statbuf.st_size = 0x4C + lif.li.Size + lif.lsd.Size + lif.led.Size;
+    if (lif.lidl.IDListSize > 0)
+    {
+      statbuf.st_size += lif.lidl.IDListSize + 2;
+    }
+  }
+  result = format_lif(run, &lif, result, &statbuf, fname, out, err, hdr, arena);
+  //format_lif() doesn't always reset the arena (not for '-o sqlite')
+  lif_arena_reset(arena);
+  return result;
+}
+
+//
+//Function: parse_item() writes the record for a file (offset < 0) or for a
+//          link file carved from the image being carved to out.
+int parse_item(struct LIFER_RUN* run, char* path, char* fname, int64_t offset, struct OBUF* out, struct OBUF* err, int hdr, struct LIF_ARENA* arena)
+{
+  if (offset < 0)
+  {
+    return parse_file(run, path, fname, out, err, hdr, arena);
+  }
+  return carve_hit(run, (uint64_t)offset, fname, out, err, hdr, arena);
+}
+
+//
+//Function: put_row() adds the Arrow row, or the LIF and stat data, in row,
+//          made from the file fname, to the run's stream or database.
+void put_row(struct LIFER_RUN* run, struct OBUF* row, char* fname)
+{
+  if (run->output_type == sqlite)
+  {
+    //row->buf is from malloc() so both structures are suitably aligned
+    if (row->failed || (sql_add(&run->sql, fname, (struct stat*)(row->buf + sizeof(struct LIF)), !run->carve, (struct LIF*)row->buf) != 0))
+    {
+      obuf_cat(&run->err, "Could not add \'", fname, "\' to the database: ", row->failed ? "out of memory" : sql_error(&run->sql), "\n", NULL);
+    }
+    return;
+  }
+  if (row->failed || (ipc_row(&run->ipc, row->buf, row->len) != 0))
+  {
+    obuf_cat(&run->err, "Could not add \'", fname, "\' to the Arrow output - sorry\n", NULL);
+  }
+}
+
+//
+//Function: put_output() is called once the record and any messages for a file
+//          have been added to the run's output. The messages are written
+//          straight away but records are only written when there is a good
+//          sized block of them, unless stdout is a terminal.
+void put_output(struct LIFER_RUN* run)
+{
+  if (run->err.len > 0)
+  {
+    //Keep the messages in their place amongst the records
+    obuf_flush(&run->out);
+    obuf_flush(&run->err);
+  }
+  if (run->flushrec)
+  {
+    obuf_flush(&run->out);
+  }
+}
+
+#ifndef _WIN32
+//
+//Function: pool_parse() is run by each parser thread. It takes the next job
+//          from the queue, formats its record into memory and marks it done
+//          so that the writer can output it. The record is made in buffers
+//          of the thread's own and swapped into the job when it is done, so
+//          nothing is left pointing into a job that has been abandoned.
+void* pool_parse(void* arg)
+{
+  struct LIFER_POOL* pool = (struct LIFER_POOL*)arg;
+  struct LIFER_JOB* job;
+  struct LIF_ARENA arena; // Reused for every file this thread parses
+  struct OBUF out, err, swap;
+  size_t n;
+  char* path;
+  char* name;
+  int64_t offset;
+  int ok;
+
+  lif_arena_init(&arena);
+  lif_arena_limit(&arena, LIFER_ARENAMAX);
+  obuf_init(&out, NULL);
+  obuf_init(&err, NULL);
+  for (;;)
+  {
+    pthread_mutex_lock(&pool->lock);
+    while ((pool->taken == pool->next) && !pool->closed)
+    {
+      pthread_cond_wait(&pool->added, &pool->lock);
+    }
+    if (pool->taken == pool->next)
+    {
+      //The queue is empty and nothing more will be added
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+    n = pool->taken++;
+    job = &pool->jobs[n % pool->size];
+    job->parser = pthread_self();
+    job->number = n;
+    job->abandoned = 0;
+    clock_gettime(CLOCK_REALTIME, &job->started);
+    path = job->path;
+    name = job->name;
+    offset = job->offset;
+    pthread_mutex_unlock(&pool->lock);
+
+    obuf_reset(&out);
+    obuf_reset(&err);
+    ok = (parse_item(pool->run, path, name, offset, &out, &err, 0, &arena) == 0);
+    if (out.failed || err.failed)
+    {
+      //Report it straight away, there's nowhere else to put it
+      fprintf(stderr, "Error in function pool_parse(): out of memory\n");
+      fprintf(stderr, "whilst processing file: \'%s\'\n", name);
+      ok = 0;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (job->abandoned || (job->number != n))
+    {
+      //The writer gave up waiting for this job and has already started
+      //another thread in place of this one (the slot may even hold a later
+      //job by now). The path is this thread's to free
+      pool->stuck--;
+      pthread_mutex_unlock(&pool->lock);
+      free(path);
+      break;
+    }
+    swap = job->out;
+    job->out = out;
+    out = swap;
+    swap = job->err;
+    job->err = err;
+    err = swap;
+    job->ok = ok;
+    job->done = 1;
+    pthread_cond_signal(&pool->finished);
+    pthread_mutex_unlock(&pool->lock);
+  }
+  obuf_free(&out);
+  obuf_free(&err);
+  lif_arena_free(&arena);
+  return NULL;
+}
+
+//
+//Function: pool_spawn() starts a parser thread, storing its id in tid.
+//          Returns 0 if successful or -1 if not.
+int pool_spawn(struct LIFER_POOL* pool, pthread_t* tid)
+{
+  pthread_attr_t attr;
+  int result;
+
+  //A LIF (about 100 KiB) and a LIF_A are held on the stack of each parser thread
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, LIFER_STACKSIZE);
+  result = (pthread_create(tid, &attr, pool_parse, pool) == 0) ? 0 : -1;
+  pthread_attr_destroy(&attr);
+  return result;
+}
+
+//
+//Function: pool_abandon() is called by the writer thread, holding the lock,
+//          when job (the next to be written) has been with a parser thread
+//          for longer than run->timeout. The file is reported and written
+//          as a failure, and the thread is detached and replaced so that the
+//          rest of the queue keeps moving. The thread is left to finish (or
+//          not) on its own; pool_parse() sees that its job was abandoned.
+void pool_abandon(struct LIFER_POOL* pool, struct LIFER_JOB* job)
+{
+  char secs[24];
+  int i;
+
+  snprintf(secs, sizeof(secs), "%d", pool->run->timeout);
+  obuf_reset(&job->err);
+  obuf_cat(&job->err, "Gave up on file \'", job->name, "\' - still unfinished after ",
+    secs, " seconds\n", NULL);
+  job->ok = 0;
+  job->done = 1;
+  job->abandoned = 1; //Tells the thread not to touch the job when it finishes
+  job->path = NULL; //Now belongs to the abandoned thread
+  for (i = 0; i < pool->nparsers; i++)
+  {
+    if (pthread_equal(pool->parsers[i], job->parser))
+    {
+      pthread_detach(pool->parsers[i]);
+      pool->stuck++;
+      if (pool_spawn(pool, &pool->parsers[i]) != 0)
       {
-        //Can't close the file for some reason
-        perror("Error in function proc_file()");
-        fprintf(stderr, "whilst closing file: \'%s\'\n", fname);
-        exit(EXIT_FAILURE);
+        //Carry on with one thread fewer
+        pool->parsers[i] = pool->parsers[--pool->nparsers];
+      }
+      break;
+    }
+  }
+}
+
+//
+//Function: pool_write() is run by the writer thread. It outputs the finished
+//          jobs strictly in the order they were added so the output is the
+//          same as it would have been from a single thread.
+void* pool_write(void* arg)
+{
+  struct LIFER_POOL* pool = (struct LIFER_POOL*)arg;
+  struct LIFER_JOB* job;
+  struct timespec deadline;
+
+  for (;;)
+  {
+    pthread_mutex_lock(&pool->lock);
+    job = &pool->jobs[pool->written % pool->size];
+    while (!((pool->written < pool->next) && job->done) &&
+      !((pool->written == pool->next) && pool->closed))
+    {
+      //Jobs are taken in order so the next to be written is the one that has
+      //been with a parser thread longest. Link files carved from an image are
+      //decoded in memory, only a file being read can stall
+      if ((pool->run->timeout > 0) && (pool->written < pool->taken) && (job->offset < 0))
+      {
+        deadline = job->started;
+        deadline.tv_sec += pool->run->timeout;
+        if ((pthread_cond_timedwait(&pool->finished, &pool->lock, &deadline) == ETIMEDOUT) && !job->done)
+        {
+          pool_abandon(pool, job);
+        }
+      }
+      else
+      {
+        pthread_cond_wait(&pool->finished, &pool->lock);
       }
     }
-    else
+    if (pool->written == pool->next)
+    {
+      //Everything has been written and nothing more will be added
+      pthread_mutex_unlock(&pool->lock);
+      return NULL;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    //Only this thread touches a finished job (and the run's output)
+    if (job->err.len > 0)
+    {
+      obuf_mem(&pool->run->err, job->err.buf, job->err.len);
+    }
+    if (job->ok)
     {
-      fprintf(stderr, "Not a Link File:\t%s\n", fname);
+      if (pool->run->filecount == 0)
+      {
+        put_header(pool->run, &pool->run->out);
+      }
+      if ((pool->run->output_type == arrow) || (pool->run->output_type == sqlite))
+      {
+        put_row(pool->run, &job->out, job->name);
+      }
+      else
+      {
+        obuf_mem(&pool->run->out, job->out.buf, job->out.len);
+      }
+      pool->run->filecount++;
     }
+    put_output(pool->run);
+    free(job->path);
+
+    pthread_mutex_lock(&pool->lock);
+    job->done = 0;
+    pool->written++;
+    pthread_cond_signal(&pool->freed);
+    pthread_mutex_unlock(&pool->lock);
   }
 }
 
 //
-//Function: read_dir() iterates through the files in a directory and processes
-//them
-void read_dir(char* dirname, int less, int idlist)
+//Function: pool_add() queues the file at path (reported as fname), or the
+//          link file offset bytes into the image being carved if offset
+//          isn't negative, for the parser threads. Waits if the queue is full.
+void pool_add(struct LIFER_POOL* pool, char* path, char* fname, int64_t offset)
 {
-  DIR *dp;
-  struct dirent *entry;
-  struct stat statbuf;
+  struct LIFER_JOB* job;
+  size_t plen = strlen(path) + 1, nlen = strlen(fname) + 1;
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->next - pool->written >= pool->size)
+  {
+    pthread_cond_wait(&pool->freed, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  //The slot can't be reused until this job has been written
+  job = &pool->jobs[pool->next % pool->size];
+  if ((job->path = (char*)malloc(plen + nlen)) == NULL)
+  {
+    perror("Error in function pool_add()");
+    fprintf(stderr, "whilst processing file: \'%s\'\n", fname);
+    return;
+  }
+  memcpy(job->path, path, plen);
+  job->name = job->path + plen;
+  memcpy(job->name, fname, nlen);
+  job->offset = offset;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->next++;
+  pthread_cond_signal(&pool->added);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+//
+//Function: pool_wait() waits for every queued file to be parsed and written.
+void pool_wait(struct LIFER_POOL* pool)
+{
+  pthread_mutex_lock(&pool->lock);
+  while (pool->written < pool->next)
+  {
+    pthread_cond_wait(&pool->freed, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+//
+//Function: pool_end() waits for every queued file to be parsed and written
+//          then stops the threads and frees the pool.
+void pool_end(struct LIFER_RUN* run)
+{
+  struct LIFER_POOL* pool = run->pool;
+  int i;
 
-  if ((dp = opendir(dirname)) == NULL)
+  pthread_mutex_lock(&pool->lock);
+  pool->closed = 1;
+  pthread_cond_broadcast(&pool->added);
+  pthread_cond_broadcast(&pool->finished);
+  pthread_mutex_unlock(&pool->lock);
+  //The writer goes first as it may replace parser threads until it is done
+  if (pool->writing)
+  {
+    pthread_join(pool->writer, NULL);
+  }
+  for (i = 0; i < pool->nparsers; i++)
+  {
+    pthread_join(pool->parsers[i], NULL);
+  }
+  run->pool = NULL;
+  if (pool->stuck > 0)
   {
-    // Opening the directory was unsuccessful
-    perror("Error");
-    fprintf(stderr, "whilst processing directory: \'%s\'\n", dirname);
+    //Abandoned threads may still look at the pool, leave it for the OS
     return;
   }
-  if (_chdir(dirname) == 0)
+  for (i = 0; i < (int)pool->size; i++)
   {
-      //Iterate through the directory entries
-      while ((entry = readdir(dp)) != NULL)
-      {
-          stat(entry->d_name, &statbuf);
-              //Don't want anything but regular files
-              if ((statbuf.st_mode & S_IFMT) == S_IFREG)
-              {
-                  proc_file(entry->d_name, less, idlist);
-              }
-      }//End of iterating through directory entry
+    obuf_free(&pool->jobs[i].out);
+    obuf_free(&pool->jobs[i].err);
+  }
+  pthread_cond_destroy(&pool->freed);
+  pthread_cond_destroy(&pool->finished);
+  pthread_cond_destroy(&pool->added);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->jobs);
+  free(pool);
+}
+//
+//Function: pool_start() starts the parser threads and the writer thread for
+//          run. Returns 0 if successful or -1 if not (in which case files
+//          should be parsed in the main thread).
+int pool_start(struct LIFER_RUN* run)
+{
+  struct LIFER_POOL* pool;
+  int i;
+
+  if ((pool = (struct LIFER_POOL*)calloc(1, sizeof(struct LIFER_POOL))) == NULL)
+  {
+    return -1;
+  }
+  pool->size = (size_t)run->jobs * LIFER_JOBSPERTHREAD;
+  if ((pool->jobs = (struct LIFER_JOB*)calloc(pool->size, sizeof(struct LIFER_JOB))) == NULL)
+  {
+    free(pool);
+    return -1;
+  }
+  for (i = 0; i < (int)pool->size; i++)
+  {
+    obuf_init(&pool->jobs[i].out, NULL);
+    obuf_init(&pool->jobs[i].err, NULL);
+  }
+  pool->run = run;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->added, NULL);
+  pthread_cond_init(&pool->finished, NULL);
+  pthread_cond_init(&pool->freed, NULL);
+  for (i = 0; i < run->jobs; i++)
+  {
+    if (pool_spawn(pool, &pool->parsers[i]) != 0)
+    {
+      break;
+    }
+    pool->nparsers++;
+  }
+  if (pool->nparsers > 0)
+  {
+    pool->writing = (pthread_create(&pool->writer, NULL, pool_write, pool) == 0);
+  }
+  run->pool = pool;
+  if (!pool->writing)
+  {
+    //Stop whatever was started and carry on without the pool
+    pool_end(run);
+    return -1;
+  }
+  return 0;
+}
+#endif
+
+//
+//Function: proc_item() processes a regular file (offset < 0) or a link file
+//          found offset bytes into the image being carved. path is the file
+//          to open and fname is the name to report it by. With parser threads
+//          running it is queued for them, otherwise it is dealt with here.
+void proc_item(struct LIFER_RUN* run, char* path, char* fname, int64_t offset)
+{
+  struct OBUF* out = &run->out;
+
+#ifndef _WIN32
+  if (run->pool != NULL)
+  {
+    pool_add(run->pool, path, fname, offset);
+    return;
+  }
+#endif
+  if ((run->output_type == arrow) || (run->output_type == sqlite))
+  {
+    //The row is made first and then added to the stream or database
+    out = &run->row;
+    obuf_reset(out);
+  }
+  if (parse_item(run, path, fname, offset, out, &run->err, (run->filecount == 0), &run->arena) == 0)
+  {
+    if (out == &run->row)
+    {
+      put_row(run, out, fname);
+    }
+    run->filecount++;
+  }
+  put_output(run);
+}
+
+//
+//Function: carve_scan() processes each link file that starts in the n bytes
+//          from pos in the part of the image loaded at run->image, found by
+//          its header (the HeaderSize and the LinkCLSID). Each is reported as
+//          IMAGE@OFFSET where IMAGE is fname and OFFSET is its byte offset
+//          in the image.
+void carve_scan(struct LIFER_RUN* run, char* path, char* fname, size_t pos, size_t n)
+{
+  static const unsigned char sig[20] = { 0x4C, 0x00, 0x00, 0x00, 0x01, 0x14, 0x02, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 };
+  size_t offs[LIFER_CARVEHITS];
+  size_t found, i;
+  char* name;
+  size_t nlen = strlen(fname);
+  uint64_t offset;
+
+  if ((run->imagelen < 76) || (pos > run->imagelen - 76))
+  {
+    return;
+  }
+  if (n > run->imagelen - 75 - pos)
+  {
+    n = run->imagelen - 75 - pos; //A link file has a header of 76 bytes
+  }
+  if ((name = (char*)malloc(nlen + 22)) == NULL)
+  {
+    perror("Error in function carve_scan()");
+    fprintf(stderr, "whilst processing file: \'%s\'\n", fname);
+    return;
+  }
+  do
+  {
+    //Only the signature's first byte has to be in the n bytes
+    found = lif_scan(run->image, pos + n + sizeof(sig) - 1, sig, sizeof(sig), pos, offs, LIFER_CARVEHITS);
+    for (i = 0; i < found; i++)
+    {
+      offset = run->imagebase + offs[i];
+      sprintf(name, "%s@%" PRIu64, fname, offset);
+      proc_item(run, path, name, (int64_t)offset);
+    }
+    if (found > 0)
+    {
+      n -= offs[found - 1] + 1 - pos;
+      pos = offs[found - 1] + 1;
+    }
+  } while (found == LIFER_CARVEHITS);
+  free(name);
+}
+
+//
+//Function: carve_image() processes the link files found in the disk image (or
+//          any other file) at path ('--carve'). The image is scanned
+//          LIFER_CARVECHUNK bytes at a time and each link file found is
+//          decoded, with any parser threads sharing the work. A mapped image
+//          is decoded where it lies, otherwise each link file is read from
+//          the image file through a LIF_SOURCE.
+void carve_image(struct LIFER_RUN* run, char* path, char* fname)
+{
+  FILE* fp;
+  struct LIF_SOURCE src;
+  unsigned char* buf;
+  size_t got, keep = 0;
+  uint64_t base = 0;
+  int last = 0;
+#ifndef _WIN32
+  int fd;
+  size_t pos, n;
+  void* map;
+#endif
+
+  if (stat(path, &run->imagestat) != 0)
+  {
+    fprintf(stderr, "Error: %s\nwhilst processing file: \'%s\'\n", strerror(errno), fname);
+    return;
+  }
+  if (run->imagestat.st_size < 76) //Too small to hold a link file
+  {
+    return;
   }
-  else //Changing the directory wasn't successful
+#ifndef _WIN32
+  //Map the whole image if possible, the parser threads then read the link
+  //files straight from the page cache
+  if ((uint64_t)run->imagestat.st_size <= (uint64_t)SIZE_MAX)
   {
-      perror("Error");
-      fprintf(stderr, "whilst processing directory: \'%s\'\n", dirname);
+    map = MAP_FAILED;
+    if ((fd = open(path, O_RDONLY)) != -1)
+    {
+      map = mmap(NULL, (size_t)run->imagestat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+    }
+    if (map != MAP_FAILED)
+    {
+      run->image = (const unsigned char*)map;
+      run->imagebase = 0;
+      run->imagelen = (size_t)run->imagestat.st_size;
+      madvise(map, run->imagelen, MADV_SEQUENTIAL);
+      for (pos = 0; pos < run->imagelen; pos += n)
+      {
+        n = run->imagelen - pos;
+        if (n > LIFER_CARVECHUNK)
+        {
+          n = LIFER_CARVECHUNK;
+          //Have the next chunk read in while this one is scanned
+          madvise((unsigned char*)map + pos + n,
+            (run->imagelen - pos - n < LIFER_CARVECHUNK) ? run->imagelen - pos - n : LIFER_CARVECHUNK,
+            MADV_WILLNEED);
+        }
+        carve_scan(run, path, fname, pos, n);
+      }
+      //The threads mustn't be left reading an unmapped image
+      if (run->pool != NULL)
+      {
+        pool_wait(run->pool);
+      }
+      munmap(map, (size_t)run->imagestat.st_size);
+      run->image = NULL;
       return;
+    }
   }
+#endif
+  //Scan the image a window at a time instead. Each window holds a chunk and
+  //the LIFER_CARVEKEEP bytes after it, so that the header of every link file
+  //starting in the chunk is whole, and the next window starts where the chunk
+  //ends. The link files themselves are read from the file (see carve_hit()),
+  //so the window can be reused without waiting for the parser threads.
+  if ((fp = fopen(path, "rb")) == NULL)
+  {
+    fprintf(stderr, "Error: %s\nwhilst processing file: \'%s\'\n", strerror(errno), fname);
+    return;
+  }
+  if (lif_source_file(&src, fp) != 0)
+  {
+    fprintf(stderr, "Error: %s\nwhilst processing file: \'%s\'\n", strerror(errno), fname);
+    fclose(fp);
+    return;
+  }
+  if ((buf = (unsigned char*)malloc(LIFER_CARVECHUNK + LIFER_CARVEKEEP)) == NULL)
+  {
+    perror("Error in function carve_image()");
+    fprintf(stderr, "whilst processing file: \'%s\'\n", fname);
+    fclose(fp);
+    return;
+  }
+  run->imagesrc = &src;
+  while (!last)
+  {
+    got = fread(buf + keep, 1, LIFER_CARVECHUNK + LIFER_CARVEKEEP - keep, fp);
+    last = (keep + got < LIFER_CARVECHUNK + LIFER_CARVEKEEP);
+    run->image = buf;
+    run->imagebase = base;
+    run->imagelen = keep + got;
+    //The last window has no next one so every link file in it counts
+    carve_scan(run, path, fname, 0, last ? run->imagelen : LIFER_CARVECHUNK);
+    if (!last)
+    {
+      keep = run->imagelen - LIFER_CARVECHUNK;
+      memmove(buf, buf + LIFER_CARVECHUNK, keep);
+      base += LIFER_CARVECHUNK;
+    }
+  }
+  if (ferror(fp))
+  {
+    fprintf(stderr, "Error: %s\nwhilst processing file: \'%s\'\n", strerror(errno), fname);
+  }
+#ifndef _WIN32
+  //The threads mustn't be left reading a closed file
+  if (run->pool != NULL)
+  {
+    pool_wait(run->pool);
+  }
+#endif
+  run->image = NULL;
+  run->imagesrc = NULL;
+  free(buf);
+  fclose(fp);
+}
+
+//
+//Function: proc_file() processes regular files. path is the file to open and
+//          fname is the name to report it by. With '--carve' the file is an
+//          image to carve link files from.
+void proc_file(struct LIFER_RUN* run, char* path, char* fname)
+{
+  if (run->carve)
+  {
+    carve_image(run, path, fname);
+    return;
+  }
+  proc_item(run, path, fname, -1);
+}
+
+//
+//Function: walk_found() is called by walk_dir() with each file that read_dir()
+//          finds, in the order the walk lists them.
+void walk_found(void* arg, const char* path, const char* fname)
+{
+  proc_file((struct LIFER_RUN*)arg, (char*)path, (char*)fname);
+}
+
+//
+//Function: read_dir() processes the files in a directory (and in all of its
+//sub-directories if recurse is set). Files are reported by their path
+//relative to dirname. Each is processed (or queued for the parser threads)
+//as soon as the walk comes to it rather than once the walk has finished.
+void read_dir(struct LIFER_RUN* run, char* dirname)
+{
+  // walk_dir() reports any error itself
+  walk_dir(dirname, run->recurse, 0, walk_found, run);
 }
 
 //
 //Main function
 int main(int argc, char *argv[])
 {
-  int opt, process = 1, less = 0, idlist = 0; // less is the flag for short info 
-                // (can't use short, it's a keyword)
-  int proc_dir = 0;           // A flag to deal with processing just one directory
+  int opt, process = 1;
+  struct LIFER_RUN run;       // The options for this run
   struct stat statbuffer;     // File details buffer
+  char* endp;
+  char* dbpath = NULL;        // The database for '-o sqlite:FILE'
+  long jobs, batchrows = 0, timeout;
+  static struct option longopts[] =
+  {
+    { "carve", no_argument, NULL, 'c' },
+    { NULL, 0, NULL, 0 }
+  };
 
-  output_type = txt;      //default output type
-  filecount = 0;
+  memset(&run, 0, sizeof(run));
+  run.output_type = txt;  //default output type
+  run.jobs = 1;           //parse in the main thread
+  run.timeout = LIFER_TIMEOUT;
+  lif_arena_init(&run.arena);
+  lif_arena_limit(&run.arena, LIFER_ARENAMAX);
+  obuf_init(&run.out, stdout);
+  obuf_init(&run.err, stderr);
+  obuf_init(&run.row, NULL);
+#ifdef _WIN32
+  run.flushrec = _isatty(_fileno(stdout));
+#else
+  run.flushrec = isatty(fileno(stdout));
+#endif
 
   //if someone calls lifer with no options whatsoever then print help
   if (argc == 1)
@@ -2288,7 +4157,7 @@ int main(int argc, char *argv[])
   }
 
   //Parse the options
-  while ((opt = getopt(argc, argv, "vhsio:")) != -1)
+  while ((opt = getopt_long(argc, argv, "vhsiprj:t:o:b:", longopts, NULL)) != -1)
   {
     // Parse supplied command line options
     switch (opt)
@@ -2303,36 +4172,94 @@ int main(int argc, char *argv[])
       process = 0;
       break;
     case '?':
-      printf("Usage: lifer [-vhsi] [-o csv|tsv|txt] file(s)|directory\n");
+      printf("Usage: lifer [-vhsipr] [--carve] [-j N] [-t N] [-o csv|tsv|txt|xml|jsonl|arrow|sqlite:FILE] [-b N] file(s)|directory(s)\n");
       process = 0;
       break;
     case 's':
-      less = 1;
+      run.less = 1;
       break;
     case 'i':
-      idlist = 1;
+      run.idlist = 1;
+      break;
+    case 'r':
+      run.recurse = 1;
+      break;
+    case 'c':
+      run.carve = 1;
+      run.partial = 1; //Carved link files are often partly overwritten
+      break;
+    case 'p':
+      run.partial = 1;
+      break;
+    case 'j':
+      jobs = strtol(optarg, &endp, 10);
+      if ((*optarg == '\0') || (*endp != '\0') || (jobs < 1) || (jobs > LIFER_MAXJOBS))
+      {
+        printf("Invalid argument to option \'-j\'\n");
+        printf("Valid arguments are numbers from 1 to %d\n", LIFER_MAXJOBS);
+        process = 0;
+      }
+      else
+      {
+        run.jobs = (int)jobs;
+      }
+      break;
+    case 't':
+      timeout = strtol(optarg, &endp, 10);
+      if ((*optarg == '\0') || (*endp != '\0') || (timeout < 0) || (timeout > LIFER_MAXTIMEOUT))
+      {
+        printf("Invalid argument to option \'-t\'\n");
+        printf("Valid arguments are numbers from 0 to %d\n", LIFER_MAXTIMEOUT);
+        process = 0;
+      }
+      else
+      {
+        run.timeout = (int)timeout;
+      }
+      break;
+    case 'b':
+      batchrows = strtol(optarg, &endp, 10);
+      if ((*optarg == '\0') || (*endp != '\0') || (batchrows < 1) || (batchrows > LIFER_MAXBATCH))
+      {
+        printf("Invalid argument to option \'-b\'\n");
+        printf("Valid arguments are numbers from 1 to %d\n", LIFER_MAXBATCH);
+        process = 0;
+      }
       break;
     case 'o':
       if (strcmp(optarg, "csv") == 0)
       {
-        output_type = csv;
+        run.output_type = csv;
       }
       else if (strcmp(optarg, "tsv") == 0)
       {
-        output_type = tsv;
+        run.output_type = tsv;
       }
       else if (strcmp(optarg, "txt") == 0)
       {
-        output_type = txt;
+        run.output_type = txt;
       }
       else if (strcmp(optarg, "xml") == 0)
       {
-        output_type = xml;
+        run.output_type = xml;
+      }
+      else if (strcmp(optarg, "jsonl") == 0)
+      {
+        run.output_type = jsonl;
+      }
+      else if (strcmp(optarg, "arrow") == 0)
+      {
+        run.output_type = arrow;
+      }
+      else if ((strncmp(optarg, "sqlite:", 7) == 0) && (optarg[7] != '\0'))
+      {
+        run.output_type = sqlite;
+        dbpath = optarg + 7;
       }
       else
       {
         printf("Invalid argument to option \'-o\'\n");
-        printf("Valid arguments are: \'csv\', \'tsv\', or \'txt\'[default]\n");
+        printf("Valid arguments are: \'csv\', \'tsv\', \'txt\'[default], \'xml\', \'jsonl\', \'arrow\' or \'sqlite:FILE\'\n");
         process = 0;
       }
       break;
@@ -2351,6 +4278,31 @@ int main(int argc, char *argv[])
       help_message();
       exit(EXIT_FAILURE);
     }
+    if (run.output_type == arrow)
+    {
+      if (run.flushrec)
+      {
+        fprintf(stderr, "Arrow output is binary, redirect it to a file.\n");
+        exit(EXIT_FAILURE);
+      }
+#ifdef _WIN32
+      _setmode(_fileno(stdout), _O_BINARY);
+#endif
+      ipc_init(&run.ipc, &run.out, (size_t)batchrows);
+    }
+    if ((run.output_type == sqlite) && (sql_open(&run.sql, dbpath) != 0))
+    {
+      fprintf(stderr, "Could not make the database \'%s\': %s\n", dbpath, sql_error(&run.sql));
+      exit(EXIT_FAILURE);
+    }
+    run.sections = out_sections(&run);
+#ifndef _WIN32
+    //Start the parser threads (if that fails the files are parsed here)
+    if (run.jobs > 1)
+    {
+      pool_start(&run);
+    }
+#endif
     for (; optind < argc; optind++)
     {
       if (stat(argv[optind], &statbuffer) != 0)
@@ -2358,37 +4310,54 @@ int main(int argc, char *argv[])
         //Getting file stats failed so report the error
         perror("Error in function main()");
         fprintf(stderr, "whilst processing argument: \'%s\'\n", argv[optind]);
+        continue;
       }
       //Process directory
-      if (((statbuffer.st_mode & S_IFMT) == S_IFDIR) & (proc_dir == 0))
+      if ((statbuffer.st_mode & S_IFMT) == S_IFDIR)
       {
-        //Deal with the erroneous situation where the user provides a directory
-        //argument followed by other arguments
-        if (argc > (optind + 1))
-        {
-          fprintf(stderr, "Sorry, only one directory argument allowed\n");
-          help_message();
-          exit(EXIT_FAILURE);
-        }
-        else
-        {
-          read_dir(argv[optind], less, idlist);
-        }
+        read_dir(&run, argv[optind]);
       }
       //Process regular files
       else if (((statbuffer.st_mode & S_IFMT) == S_IFREG))
       {
-        proc_file(argv[optind], less, idlist);
+        proc_file(&run, argv[optind], argv[optind]);
       }
-      proc_dir = 1; //Prevent processing of directories after first argument
-      //(The default behaviour is to process 1 directory OR
-      //several files)
     }
+#ifndef _WIN32
+    //Wait for the queued files to be written
+    if (run.pool != NULL)
+    {
+      pool_end(&run);
+    }
+#endif
     // If the output is XML then we need to make it well-formed and close it off properly
-    if (output_type == xml)
+    if (run.output_type == xml)
+    {
+      obuf_str(&run.out, "</LinkFiles>\n");
+    }
+    // An Arrow stream has to write its last batch and an end marker
+    if ((run.output_type == arrow) && (ipc_end(&run.ipc) != 0))
+    {
+      fprintf(stderr, "Error in function main(): out of memory whilst writing the Arrow output\n");
+      exit(EXIT_FAILURE);
+    }
+    // The database has its last transaction to commit and its indexes to make
+    if ((run.output_type == sqlite) && (sql_close(&run.sql) != 0))
     {
-      printf("</LinkFiles>\n");
+      fprintf(stderr, "Error in function main(): %s\n", sql_error(&run.sql));
+      exit(EXIT_FAILURE);
+    }
+    if (obuf_flush(&run.out) != 0)
+    {
+      perror("Error in function main()");
+      fprintf(stderr, "whilst writing the output\n");
+      exit(EXIT_FAILURE);
     }
   }
+  obuf_free(&run.out);
+  obuf_free(&run.err);
+  obuf_free(&run.row);
+  ipc_free(&run.ipc);
+  lif_arena_free(&run.arena);
   exit(EXIT_SUCCESS);
 }
\ No newline at end of file
@@ -0,0 +1,783 @@
+/*********************************************************
+**                                                      **
+**                      lifgen                          **
+**                                                      **
+**       Makes Windows link files for testing lifer     **
+**                                                      **
+**         Copyright Paul Tew 2011 to 2022              **
+**                                                      **
+** Usage:                                               **
+** lifgen [-vh]                                         **
+** lifgen [-n N] [-s SEED] [-d N] [-m MIX]              **
+**        -o DIRECTORY|-b FILE                          **
+**                                                      **
+*********************************************************/
+
+/*
+This file is part of lifer.
+
+    Lifer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    lifer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with lifer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+Each link file is made from a random number generator seeded with the seed
+and the link file's number, so the same options always make the same link
+files and the first N of a bigger corpus are the same as a corpus of N.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+// local headers
+#include "./liblife/liblife.h"
+#include "./version.h"
+
+//Conditional includes and definitions dependant on OS
+#ifdef _WIN32
+// Windows
+#include <io.h>
+#include <fcntl.h>
+#include "./win/getopt.h"
+#define PATH_MAX _MAX_PATH
+#else
+// *nix
+#include <unistd.h>
+#include <limits.h>
+#include <getopt.h>
+#endif
+
+#define LIFGEN_COUNT     100               // Default number of link files ('-n')
+#define LIFGEN_DEPTH     8                 // Default most ItemIDs in a LinkTargetIDList ('-d')
+#define LIFGEN_MAXDEPTH  255               // The most '-d' will allow
+#define LIFGEN_SCRATCH   (256 * 1024)      // Bytes for the ItemIDs and ExtraData blocks of a link file
+#define LIFGEN_MAXSIZE   (1024 * 1024)     // Bytes for a link file
+#define LIFGEN_PATHSIZE  4096              // Bytes for a path
+
+//The parts of a link file that '-m' decides how often to include
+enum mixpart { m_idlist, m_linkinfo, m_cnr, m_unicode, m_strings, m_tracker, m_propstore, m_console, m_count };
+
+struct LIFGEN_MIX
+{
+  const char *       name;
+  int                pct;     // The chance (0 to 100) of each link file having it
+};
+
+//Everything needed to make a link file
+struct LIFGEN
+{
+  uint64_t           rng;                      // splitmix64 state
+  uint8_t            scratch[LIFGEN_SCRATCH];  // ItemID and block data
+  size_t             used;
+  struct LIF_INPUT   items[LIFGEN_MAXDEPTH];
+  struct LIF_BLOCK   blocks[3];
+  char               path[LIFGEN_PATHSIZE];    // The target, e.g. C:\Users\...
+  char               strings[5][LIFGEN_PATHSIZE];
+  uint8_t            lnk[LIFGEN_MAXSIZE];
+};
+
+static const char* words[] =
+{
+  "Documents", "Projects", "Reports", "Budget", "Photos", "Music", "Invoices",
+  "Archive", "Tools", "Setup", "Notes", "Drafts", "Backup", "Data", "Games",
+  "Work", "Shared", "Accounts", "Letters", "Scans", "Minutes", "Designs",
+  "Release", "Build", "Clients", "Holiday", "Videos", "Library", "Old", "New"
+};
+//Only used in the Unicode StringData
+static const char* uwords[] =
+{
+  "R\xC3\xA9sum\xC3\xA9", "\xC3\x9C" "bersicht", "\xD0\x94\xD0\xBE\xD0\xBA\xD1\x83\xD0\xBC\xD0\xB5\xD0\xBD\xD1\x82\xD1\x8B",
+  "\xE5\x86\x99\xE7\x9C\x9F", "Caf\xC3\xA9", "\xF0\x9F\x93\x81 Files"
+};
+static const char* exts[] = { ".docx", ".xlsx", ".pdf", ".txt", ".exe", ".jpg", ".mp3", ".zip" };
+static const char* users[] = { "alice", "bob", "carol", "dave", "erin", "frank" };
+
+void help_message();
+uint64_t gen_rand(struct LIFGEN *);
+uint32_t gen_num(struct LIFGEN *, uint32_t);
+int gen_chance(struct LIFGEN *, int);
+int64_t gen_filetime(struct LIFGEN *);
+uint8_t * gen_put(struct LIFGEN *, const void *, size_t);
+void gen_le(struct LIFGEN *, uint64_t, int);
+void gen_wstr(struct LIFGEN *, const char *);
+void gen_guid(struct LIFGEN *, int);
+size_t gen_itemid(struct LIFGEN *, const char *, int);
+void gen_tracker(struct LIFGEN *, struct LIF_BLOCK *);
+void gen_console(struct LIFGEN *, struct LIF_BLOCK *);
+void gen_propvalue(struct LIFGEN *, uint32_t, uint16_t, const void *, size_t);
+void gen_propstore(struct LIFGEN *, struct LIF_BLOCK *, const char *);
+size_t gen_lif(struct LIFGEN *, uint64_t, uint64_t, int, const struct LIFGEN_MIX *);
+int set_mix(struct LIFGEN_MIX *, char *);
+
+//Function: help_message() prints a help message to stdout
+void help_message()
+{
+  printf("********************************************************************************\n");
+  printf("\nlifgen - Makes Windows link files (a.k.a. shortcuts) for testing lifer\n");
+  printf("Version: %u.%u.%u\n\n", _MAJOR, _MINOR, _BUILD);
+  printf("Usage: lifgen  [-vh]\n");
+  printf("       lifgen  [-n N] [-s SEED] [-d N] [-m MIX] -o DIRECTORY|-b FILE\n\n");
+  printf("Options:\n");
+  printf("  -v    print version number\n");
+  printf("  -h    print this help\n");
+  printf("  -n    number of link files to make (default %d)\n", LIFGEN_COUNT);
+  printf("  -s    seed for the random numbers (default 1). The same seed and options\n");
+  printf("        always make the same link files.\n");
+  printf("  -d    most ItemIDs in a LinkTargetIDList (5 to %d, default %d)\n", LIFGEN_MAXDEPTH, LIFGEN_DEPTH);
+  printf("  -m    how often each part is included, as a comma separated list of\n");
+  printf("        PART=PERCENT. The parts (and their defaults) are idlist (90),\n");
+  printf("        linkinfo (85), cnr (15), unicode (90), strings (80), tracker (70),\n");
+  printf("        propstore (40) and console (5).\n");
+  printf("  -o    write each link file to DIRECTORY (which must exist) as\n");
+  printf("        gen00000001.lnk, gen00000002.lnk etc.\n");
+  printf("  -b    write the link files one after another to FILE ('-' for standard\n");
+  printf("        output), which 'lifer --carve' can read.\n\n");
+  printf("Example:\n  lifgen -n 100000 -s 42 -m cnr=50,console=20 -b Corpus.bin\n\n");
+  printf("********************************************************************************\n");
+}
+
+//
+//Function: gen_rand() returns the next random number (splitmix64, which
+//          gives the same numbers everywhere, unlike rand())
+uint64_t gen_rand(struct LIFGEN* g)
+{
+  uint64_t z = (g->rng += 0x9E3779B97F4A7C15ULL);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+//
+//Function: gen_num() returns a random number from 0 to n - 1
+uint32_t gen_num(struct LIFGEN* g, uint32_t n)
+{
+  return (uint32_t)(gen_rand(g) % n);
+}
+
+//
+//Function: gen_chance() returns 1 pct percent of the time
+int gen_chance(struct LIFGEN* g, int pct)
+{
+  return ((int)gen_num(g, 100) < pct);
+}
+
+//
+//Function: gen_filetime() returns a random FILETIME from 2015 to 2024
+int64_t gen_filetime(struct LIFGEN* g)
+{
+  //Seconds from 1601 to 2015 plus up to 10 years, in 100ns intervals
+  return ((int64_t)13064544000LL + (int64_t)gen_num(g, 315360000)) * 10000000LL +
+    (int64_t)gen_num(g, 10000000);
+}
+
+//
+//Function: gen_put() appends n bytes from p (zeros if p is NULL) to the
+//          scratch data and returns where they went. Returns NULL if there
+//          isn't room, which the limits on '-d' make sure can't happen.
+uint8_t * gen_put(struct LIFGEN* g, const void* p, size_t n)
+{
+  uint8_t* dst = &g->scratch[g->used];
+
+  if (n > LIFGEN_SCRATCH - g->used)
+  {
+    return NULL;
+  }
+  if (p != NULL)
+  {
+    memcpy(dst, p, n);
+  }
+  else
+  {
+    memset(dst, 0, n);
+  }
+  g->used += n;
+  return dst;
+}
+
+//
+//Function: gen_le() appends the n byte little endian value to the scratch data
+void gen_le(struct LIFGEN* g, uint64_t value, int n)
+{
+  uint8_t b[8];
+  int     i;
+
+  for (i = 0; i < n; i++)
+  {
+    b[i] = (uint8_t)(value >> (8 * i));
+  }
+  gen_put(g, b, (size_t)n);
+}
+
+//
+//Function: gen_wstr() appends the ASCII string str to the scratch data as
+//          UTF-16LE with a terminator
+void gen_wstr(struct LIFGEN* g, const char* str)
+{
+  do
+  {
+    gen_le(g, (uint8_t)*str, 2);
+  } while (*str++ != 0);
+}
+
+//
+//Function: gen_guid() appends a random GUID to the scratch data. A version 1
+//          GUID (like those in a TrackerDataBlock) has a time and MAC address
+//          in it, otherwise it is a version 4 (random) one.
+void gen_guid(struct LIFGEN* g, int v1)
+{
+  uint64_t t;
+
+  if (v1)
+  {
+    //100ns intervals since 1582-10-15
+    t = (uint64_t)gen_filetime(g) + 5748192000000000ULL;
+    gen_le(g, t & 0xFFFFFFFF, 4);
+    gen_le(g, (t >> 32) & 0xFFFF, 2);
+    gen_le(g, ((t >> 48) & 0x0FFF) | 0x1000, 2);
+  }
+  else
+  {
+    gen_le(g, gen_rand(g), 4);
+    gen_le(g, gen_rand(g), 2);
+    gen_le(g, (gen_rand(g) & 0x0FFF) | 0x4000, 2);
+  }
+  gen_le(g, (gen_rand(g) & 0x3F) | 0x80, 1); //RFC 4122 variant
+  gen_le(g, gen_rand(g), 1);
+  gen_le(g, gen_rand(g) & 0xFFFFFFFFFFFEULL, 6); //A unicast MAC (its first byte is even)
+}
+
+//
+//Function: gen_itemid() appends the data of a file entry ItemID (a folder if
+//          folder) for the file or folder name to the scratch data and
+//          returns its size. The 0xBEEF0004 extension block holds the long
+//          name, as Windows XP writes it.
+size_t gen_itemid(struct LIFGEN* g, const char* name, int folder)
+{
+  size_t start = g->used, ext;
+
+  gen_le(g, folder ? 0x31 : 0x32, 1);
+  gen_le(g, 0, 1);
+  gen_le(g, folder ? 0 : gen_num(g, 0x1000000), 4); //File size
+  gen_le(g, gen_rand(g), 4);                        //FAT date & time
+  gen_le(g, folder ? 0x10 : 0x20, 2);               //Attributes
+  gen_put(g, name, strlen(name) + 1);               //The 8.3 name is often the same
+  if ((g->used - start) & 1)
+  {
+    gen_le(g, 0, 1);
+  }
+  ext = g->used;
+  gen_le(g, 0, 2);                                  //Size (filled in below)
+  gen_le(g, 3, 2);                                  //Version
+  gen_le(g, 0xBEEF0004, 4);
+  gen_le(g, gen_rand(g), 4);                        //Created FAT date & time
+  gen_le(g, gen_rand(g), 4);                        //Accessed FAT date & time
+  gen_le(g, 0x14, 2);
+  gen_wstr(g, name);
+  gen_le(g, ext - start, 2);                        //Offset of the extension block
+  g->scratch[ext] = (uint8_t)(g->used - ext);
+  g->scratch[ext + 1] = (uint8_t)((g->used - ext) >> 8);
+  return g->used - start;
+}
+
+//
+//Function: gen_tracker() makes a TrackerDataBlock in block
+void gen_tracker(struct LIFGEN* g, struct LIF_BLOCK* block)
+{
+  char   machine[16];
+  size_t start = g->used;
+
+  memset(machine, 0, sizeof(machine));
+  snprintf(machine, sizeof(machine), "desktop-%05u", gen_num(g, 100000));
+  gen_le(g, 0x58, 4);       //Length
+  gen_le(g, 0, 4);          //Version
+  gen_put(g, machine, 16);
+  gen_guid(g, 0);           //Droid: the volume and the file
+  gen_guid(g, 1);
+  memcpy(gen_put(g, NULL, 32), &g->scratch[start + 24], 32); //DroidBirth (unless it has moved)
+  block->Signature = 0xA0000003;
+  block->Data = &g->scratch[start];
+  block->Size = (uint32_t)(g->used - start);
+}
+
+//
+//Function: gen_console() makes a ConsoleDataBlock in block
+void gen_console(struct LIFGEN* g, struct LIF_BLOCK* block)
+{
+  static const uint32_t colours[16] =
+  {
+    0x000000, 0x800000, 0x008000, 0x808000, 0x000080, 0x800080, 0x008080, 0xC0C0C0,
+    0x808080, 0xFF0000, 0x00FF00, 0xFFFF00, 0x0000FF, 0xFF00FF, 0x00FFFF, 0xFFFFFF
+  };
+  size_t start = g->used, face;
+  int    i;
+
+  gen_le(g, 0x07, 2);       //FillAttributes
+  gen_le(g, 0xF5, 2);       //PopupFillAttributes
+  gen_le(g, 80 + 40 * gen_num(g, 3), 2); //ScreenBufferSizeX
+  gen_le(g, 300 + 9000 * gen_num(g, 2), 2);
+  gen_le(g, 80 + 40 * gen_num(g, 3), 2); //WindowSizeX
+  gen_le(g, 25 + 5 * gen_num(g, 4), 2);
+  gen_le(g, 0, 2);          //WindowOriginX & Y
+  gen_le(g, 0, 2);
+  gen_le(g, 0, 4);          //Unused1 & 2
+  gen_le(g, 0, 4);
+  gen_le(g, (12 + 2 * gen_num(g, 5)) << 16, 4); //FontSize
+  gen_le(g, 0x36, 4);       //FontFamily (TMPF_TRUETYPE | FF_MODERN)
+  gen_le(g, 400, 4);        //FontWeight
+  face = g->used;
+  gen_wstr(g, gen_chance(g, 50) ? "Consolas" : "Lucida Console");
+  gen_put(g, NULL, 64 - (g->used - face));
+  gen_le(g, 25, 4);         //CursorSize
+  gen_le(g, 0, 4);          //FullScreen
+  gen_le(g, gen_num(g, 2), 4); //QuickEdit
+  gen_le(g, 1, 4);          //InsertMode
+  gen_le(g, 1, 4);          //AutoPosition
+  gen_le(g, 50, 4);         //HistoryBufferSize
+  gen_le(g, 4, 4);          //NumberOfHistoryBuffers
+  gen_le(g, 0, 4);          //HistoryNoDup
+  for (i = 0; i < 16; i++)
+  {
+    gen_le(g, colours[i], 4);
+  }
+  block->Signature = 0xA0000002;
+  block->Data = &g->scratch[start];
+  block->Size = (uint32_t)(g->used - start);
+}
+
+//
+//Function: gen_propvalue() appends a serialized property value with the id
+//          and type to the scratch data. A VT_LPWSTR value is given as an
+//          ASCII string, the rest as the n bytes at value.
+void gen_propvalue(struct LIFGEN* g, uint32_t id, uint16_t type, const void* value, size_t n)
+{
+  size_t start = g->used;
+
+  gen_le(g, 0, 4);          //ValueSize (filled in below)
+  gen_le(g, id, 4);
+  gen_le(g, 0, 1);          //Reserved
+  gen_le(g, type, 2);
+  gen_le(g, 0, 2);          //Padding
+  if (type == 0x001F)       //VT_LPWSTR
+  {
+    gen_le(g, strlen((const char *)value) + 1, 4);
+    gen_wstr(g, (const char *)value);
+    gen_put(g, NULL, (4 - ((g->used - start) & 3)) & 3);
+  }
+  else
+  {
+    gen_put(g, value, n);
+  }
+  g->scratch[start] = (uint8_t)(g->used - start);
+  g->scratch[start + 1] = (uint8_t)((g->used - start) >> 8);
+}
+
+//
+//Function: gen_propstore() makes a PropertyStoreDataBlock in block for the
+//          file name, like those Windows Vista and later add
+void gen_propstore(struct LIFGEN* g, struct LIF_BLOCK* block, const char* name)
+{
+  //{B725F130-47EF-101A-A5F1-02608C9EEBAC} & {46588AE2-4CBC-4338-BBFC-139326986DCE}
+  static const uint8_t storage[16] =
+  { 0x30, 0xF1, 0x25, 0xB7, 0xEF, 0x47, 0x1A, 0x10, 0xA5, 0xF1, 0x02, 0x60, 0x8C, 0x9E, 0xEB, 0xAC };
+  static const uint8_t sid[16] =
+  { 0xE2, 0x8A, 0x58, 0x46, 0xBC, 0x4C, 0x38, 0x43, 0xBB, 0xFC, 0x13, 0x93, 0x26, 0x98, 0x6D, 0xCE };
+  char     sidstr[64];
+  uint8_t  value[8];
+  uint64_t v;
+  size_t   start = g->used, store;
+  int      i;
+
+  store = g->used;
+  gen_le(g, 0, 4);          //StorageSize (filled in below)
+  gen_le(g, 0x53505331, 4); //Version ('1SPS')
+  gen_put(g, storage, 16);
+  gen_propvalue(g, 10, 0x001F, name, 0);       //System.ItemNameDisplay
+  v = gen_num(g, 0x1000000);
+  for (i = 0; i < 8; i++)
+  {
+    value[i] = (uint8_t)(v >> (8 * i));
+  }
+  gen_propvalue(g, 12, 0x0015, value, 8);      //System.Size (VT_UI8)
+  v = (uint64_t)gen_filetime(g);
+  for (i = 0; i < 8; i++)
+  {
+    value[i] = (uint8_t)(v >> (8 * i));
+  }
+  gen_propvalue(g, 14, 0x0040, value, 8);      //System.DateModified (VT_FILETIME)
+  gen_le(g, 0, 4);          //The empty value that ends the store
+  g->scratch[store] = (uint8_t)(g->used - store);
+  g->scratch[store + 1] = (uint8_t)((g->used - store) >> 8);
+  if (gen_chance(g, 50))
+  {
+    store = g->used;
+    gen_le(g, 0, 4);
+    gen_le(g, 0x53505331, 4);
+    gen_put(g, sid, 16);
+    snprintf(sidstr, sizeof(sidstr), "S-1-5-21-%u-%u-%u-%u", gen_num(g, 4000000000U),
+      gen_num(g, 4000000000U), gen_num(g, 4000000000U), 1000 + gen_num(g, 10));
+    gen_propvalue(g, 4, 0x001F, sidstr, 0);    //System.SID
+    gen_le(g, 0, 4);
+    g->scratch[store] = (uint8_t)(g->used - store);
+    g->scratch[store + 1] = (uint8_t)((g->used - store) >> 8);
+  }
+  gen_le(g, 0, 4);          //The empty store that ends the storage
+  block->Signature = 0xA0000009;
+  block->Data = &g->scratch[start];
+  block->Size = (uint32_t)(g->used - start);
+}
+
+//
+//Function: gen_lif() makes link file number n from the seed in g->lnk, with
+//          up to depth ItemIDs and the parts chosen according to mix. Returns
+//          its size (0 if it couldn't be made).
+size_t gen_lif(struct LIFGEN* g, uint64_t seed, uint64_t n, int depth, const struct LIFGEN_MIX* mix)
+{
+  //{20D04FE0-3AEA-1069-A2D8-08002B30309D} (My Computer)
+  static const uint8_t computer[18] =
+  { 0x1F, 0x50, 0xE0, 0x4F, 0xD0, 0x20, 0xEA, 0x3A, 0x69, 0x10, 0xA2, 0xD8, 0x08, 0x00, 0x2B, 0x30, 0x30, 0x9D };
+  struct LIF_SPEC spec;
+  const char*     word;
+  char            share[64], device[4];
+  char*           name;
+  size_t          plen, start;
+  int             folders, i, unicode;
+
+  memset(&spec, 0, sizeof(spec));
+  g->rng = seed ^ (n * 0xD1B54A32D192ED03ULL);
+  g->used = 0;
+
+  //The target: C:\Users\<user>\<folder>\...\<name>, whose ItemIDs (with
+  //those for My Computer and the drive) come to no more than depth
+  folders = (depth > 5) ? (int)gen_num(g, (uint32_t)depth - 4) : 0;
+  plen = (size_t)snprintf(g->path, LIFGEN_PATHSIZE, "C:\\Users\\%s", users[gen_num(g, 6)]);
+  for (i = 0; i < folders; i++)
+  {
+    plen += (size_t)snprintf(&g->path[plen], LIFGEN_PATHSIZE - plen, "\\%s",
+      words[gen_num(g, sizeof(words) / sizeof(words[0]))]);
+  }
+  name = &g->path[plen + 1];
+  snprintf(&g->path[plen], LIFGEN_PATHSIZE - plen, "\\%s%s",
+    words[gen_num(g, sizeof(words) / sizeof(words[0]))], exts[gen_num(g, 8)]);
+
+  spec.lh.Attr = 0x20;      //FILE_ATTRIBUTE_ARCHIVE
+  spec.lh.CrDate = gen_filetime(g);
+  spec.lh.WtDate = spec.lh.CrDate + (int64_t)gen_num(g, 2592000) * 10000000; //Up to 30 days later
+  spec.lh.AcDate = spec.lh.WtDate + (int64_t)gen_num(g, 2592000) * 10000000;
+  spec.lh.Size = gen_num(g, 0x1000000);
+  spec.lh.ShowState = gen_chance(g, 90) ? 1 : (gen_chance(g, 50) ? 3 : 7);
+  unicode = gen_chance(g, mix[m_unicode].pct);
+  if (unicode)
+  {
+    spec.lh.Flags |= 0x00000080; //IsUnicode
+  }
+
+  //S2.2 An ItemID for My Computer, then the drive, then each folder and the file
+  if (gen_chance(g, mix[m_idlist].pct))
+  {
+    g->items[0].buf = gen_put(g, computer, sizeof(computer));
+    g->items[0].len = sizeof(computer);
+    start = g->used;
+    gen_le(g, 0x2F, 1);
+    gen_put(g, "C:\\", 3);
+    gen_put(g, NULL, 19);
+    g->items[1].buf = &g->scratch[start];
+    g->items[1].len = g->used - start;
+    spec.NumItemIDs = 2;
+    for (word = &g->path[3]; *word != 0; spec.NumItemIDs++)
+    {
+      char part[LIFGEN_PATHSIZE];
+      size_t len = strcspn(word, "\\");
+
+      memcpy(part, word, len);
+      part[len] = 0;
+      start = g->used;
+      g->items[spec.NumItemIDs].len = gen_itemid(g, part, word[len] != 0);
+      g->items[spec.NumItemIDs].buf = &g->scratch[start];
+      word += len + (word[len] != 0);
+    }
+    spec.ItemIDs = g->items;
+  }
+
+  //S2.3 Either the local path or a network share
+  if (gen_chance(g, mix[m_linkinfo].pct))
+  {
+    spec.LinkInfoUnicode = unicode && gen_chance(g, 30);
+    if (gen_chance(g, mix[m_cnr].pct))
+    {
+      snprintf(share, sizeof(share), "\\\\FILESERVER%02u\\%s", gen_num(g, 100),
+        words[gen_num(g, sizeof(words) / sizeof(words[0]))]);
+      spec.NetName = share;
+      spec.NetworkProviderType = 0x00020000; //WNNC_NET_LANMAN
+      if (gen_chance(g, 60))
+      {
+        snprintf(device, sizeof(device), "%c:", 'M' + gen_num(g, 14));
+        spec.DeviceName = device;
+      }
+      spec.CommonPathSuffix = &g->path[9]; //The path from Users on
+    }
+    else
+    {
+      spec.LocalBasePath = g->path;
+      spec.DriveType = gen_chance(g, 90) ? 3 : 2; //DRIVE_FIXED or DRIVE_REMOVABLE
+      spec.DriveSN = (uint32_t)gen_rand(g);
+      spec.VolumeLabel = gen_chance(g, 50) ? "" : (gen_chance(g, 50) ? "OS" : "DATA");
+    }
+  }
+
+  //S2.4 Name, RelativePath, WorkingDir, Arguments & IconLocation
+  if (gen_chance(g, mix[m_strings].pct))
+  {
+    if (gen_chance(g, 40))
+    {
+      snprintf(g->strings[0], LIFGEN_PATHSIZE, "%s %s", unicode && gen_chance(g, 50) ?
+        uwords[gen_num(g, sizeof(uwords) / sizeof(uwords[0]))] : words[gen_num(g, sizeof(words) / sizeof(words[0]))],
+        words[gen_num(g, sizeof(words) / sizeof(words[0]))]);
+      spec.StringData[0] = g->strings[0];
+    }
+    if (gen_chance(g, 80))
+    {
+      plen = 0;
+      for (i = 0; i < folders + 1; i++)
+      {
+        plen += (size_t)snprintf(&g->strings[1][plen], LIFGEN_PATHSIZE - plen, "..\\");
+      }
+      snprintf(&g->strings[1][plen], LIFGEN_PATHSIZE - plen, "%s", &g->path[9]);
+      spec.StringData[1] = g->strings[1];
+    }
+    if (gen_chance(g, 70))
+    {
+      snprintf(g->strings[2], LIFGEN_PATHSIZE, "%.*s", (int)(name - g->path - 1), g->path);
+      spec.StringData[2] = g->strings[2];
+    }
+    if (gen_chance(g, 20))
+    {
+      snprintf(g->strings[3], LIFGEN_PATHSIZE, "/%s \"%.200s\"", words[gen_num(g, sizeof(words) / sizeof(words[0]))], name);
+      spec.StringData[3] = g->strings[3];
+    }
+    if (gen_chance(g, 20))
+    {
+      snprintf(g->strings[4], LIFGEN_PATHSIZE, "%%SystemRoot%%\\System32\\shell32.dll");
+      spec.lh.IconIndex = (int32_t)gen_num(g, 300);
+      spec.StringData[4] = g->strings[4];
+    }
+  }
+
+  //S2.5 ExtraData
+  spec.Blocks = g->blocks;
+  if (gen_chance(g, mix[m_console].pct))
+  {
+    gen_console(g, &g->blocks[spec.NumBlocks++]);
+  }
+  if (gen_chance(g, mix[m_tracker].pct))
+  {
+    gen_tracker(g, &g->blocks[spec.NumBlocks++]);
+  }
+  if (gen_chance(g, mix[m_propstore].pct))
+  {
+    gen_propstore(g, &g->blocks[spec.NumBlocks++], name);
+  }
+  plen = put_lif(&spec, g->lnk, LIFGEN_MAXSIZE);
+  return (plen <= LIFGEN_MAXSIZE) ? plen : 0;
+}
+
+//
+//Function: set_mix() sets the percentages in mix from a '-m' argument such
+//          as "cnr=50,console=20". Returns 0 or -1 if it isn't valid.
+int set_mix(struct LIFGEN_MIX* mix, char* arg)
+{
+  char* part;
+  char* pct;
+  char* endp;
+  long  n;
+  int   i;
+
+  for (part = strtok(arg, ","); part != NULL; part = strtok(NULL, ","))
+  {
+    if ((pct = strchr(part, '=')) == NULL)
+    {
+      return -1;
+    }
+    *pct++ = 0;
+    n = strtol(pct, &endp, 10);
+    if ((*pct == '\0') || (*endp != '\0') || (n < 0) || (n > 100))
+    {
+      return -1;
+    }
+    for (i = 0; (i < m_count) && (strcmp(part, mix[i].name) != 0); i++)
+    {
+    }
+    if (i == m_count)
+    {
+      return -1;
+    }
+    mix[i].pct = (int)n;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  struct LIFGEN_MIX mix[m_count] =
+  {
+    { "idlist", 90 }, { "linkinfo", 85 }, { "cnr", 15 }, { "unicode", 90 },
+    { "strings", 80 }, { "tracker", 70 }, { "propstore", 40 }, { "console", 5 }
+  };
+  struct LIFGEN* g;
+  FILE*          fp = NULL;
+  char*          dir = NULL;
+  char*          blob = NULL;
+  char*          endp;
+  char           fname[PATH_MAX];
+  unsigned long long count = LIFGEN_COUNT, seed = 1, n, total = 0;
+  long           depth = LIFGEN_DEPTH;
+  size_t         len;
+  int            opt, process = 1;
+
+  if (argc == 1)
+  {
+    help_message();
+    process = 0;
+  }
+
+  //Parse the options
+  while ((opt = getopt(argc, argv, "vhn:s:d:m:o:b:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'v':
+      printf("lifgen - Makes Windows link files for testing lifer\n");
+      printf("Version: %u.%u.%u\n", _MAJOR, _MINOR, _BUILD);
+      process = 0;
+      break;
+    case 'h':
+      help_message();
+      process = 0;
+      break;
+    case 'n':
+      count = strtoull(optarg, &endp, 10);
+      if ((*optarg == '\0') || (*optarg == '-') || (*endp != '\0'))
+      {
+        printf("Invalid argument to option \'-n\'\n");
+        process = 0;
+      }
+      break;
+    case 's':
+      seed = strtoull(optarg, &endp, 10);
+      if ((*optarg == '\0') || (*optarg == '-') || (*endp != '\0'))
+      {
+        printf("Invalid argument to option \'-s\'\n");
+        process = 0;
+      }
+      break;
+    case 'd':
+      depth = strtol(optarg, &endp, 10);
+      if ((*optarg == '\0') || (*endp != '\0') || (depth < 5) || (depth > LIFGEN_MAXDEPTH))
+      {
+        printf("Invalid argument to option \'-d\'\n");
+        printf("Valid arguments are numbers from 5 to %d\n", LIFGEN_MAXDEPTH);
+        process = 0;
+      }
+      break;
+    case 'm':
+      if (set_mix(mix, optarg) != 0)
+      {
+        printf("Invalid argument to option \'-m\'\n");
+        printf("Valid arguments are PART=PERCENT[,PART=PERCENT...] where PART is one of\n");
+        printf("idlist, linkinfo, cnr, unicode, strings, tracker, propstore or console\n");
+        process = 0;
+      }
+      break;
+    case 'o':
+      dir = optarg;
+      break;
+    case 'b':
+      blob = optarg;
+      break;
+    default:
+      printf("Usage: lifgen [-vh] [-n N] [-s SEED] [-d N] [-m MIX] -o DIRECTORY|-b FILE\n");
+      process = 0;
+    }
+  }
+
+  if (process)
+  {
+    if ((dir == NULL) == (blob == NULL))
+    {
+      fprintf(stderr, "Give one of '-o DIRECTORY' or '-b FILE'.\n");
+      exit(EXIT_FAILURE);
+    }
+    if (blob != NULL)
+    {
+      if (strcmp(blob, "-") == 0)
+      {
+#ifdef _WIN32
+        if (_isatty(_fileno(stdout)))
+#else
+        if (isatty(fileno(stdout)))
+#endif
+        {
+          fprintf(stderr, "Link files are binary, redirect them to a file.\n");
+          exit(EXIT_FAILURE);
+        }
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        fp = stdout;
+      }
+      else if ((fp = fopen(blob, "wb")) == NULL)
+      {
+        fprintf(stderr, "Could not make the file \'%s\': %s\n", blob, strerror(errno));
+        exit(EXIT_FAILURE);
+      }
+    }
+    if ((g = (struct LIFGEN *)malloc(sizeof(struct LIFGEN))) == NULL)
+    {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+    for (n = 1; n <= count; n++)
+    {
+      if ((len = gen_lif(g, seed, n, (int)depth, mix)) == 0)
+      {
+        fprintf(stderr, "Could not make link file %llu\n", n);
+        exit(EXIT_FAILURE);
+      }
+      if (dir != NULL)
+      {
+        snprintf(fname, sizeof(fname), "%s/gen%08llu.lnk", dir, n);
+        if ((fp = fopen(fname, "wb")) == NULL)
+        {
+          fprintf(stderr, "Could not make the file \'%s\': %s\n", fname, strerror(errno));
+          exit(EXIT_FAILURE);
+        }
+      }
+      if ((fwrite(g->lnk, 1, len, fp) != len) || ((dir != NULL) && (fclose(fp) != 0)))
+      {
+        fprintf(stderr, "Could not write link file %llu: %s\n", n, strerror(errno));
+        exit(EXIT_FAILURE);
+      }
+      total += len;
+    }
+    if ((blob != NULL) && (fclose(fp) != 0))
+    {
+      fprintf(stderr, "Could not write \'%s\': %s\n", blob, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    fprintf(stderr, "Made %llu link files (%llu bytes)\n", count, total);
+    free(g);
+  }
+  return 0;
+}